@@ -0,0 +1,141 @@
+/*****************************************************************
+	FPS_Access_Journal.ino - Library example for controlling the GT-511C3 Finger Print Scanner (FPS)
+	Licensed for non-commercial use, must include this license message
+	basically, Feel free to hack away at it, but just give me credit for my work =)
+	TLDR; Wil Wheaton's Law
+
+	Description: This sketch logs every identification to a journal instead of
+	printing it, so the door is never held up by the serial port.
+	On AVR boards the journal is a ring of 16 byte entries in EEPROM that
+	survives resets (the oldest entries are overwritten when it is full), on
+	other boards it is appended to JOURNAL.BIN on an SD card.
+	Send any character over Serial to dump the journal as CSV, along with how
+	long logging took.
+
+	This code should work with the any model of ADH-Tech's FPS as long as
+	you are within the minimum logic level threshold for the FPS serial UART.
+	This code has been tested with these models:
+
+              GT-521F52 [ https://www.sparkfun.com/products/14585 ]
+              GT-521F32 [ https://www.sparkfun.com/products/14518 ]
+              GT-511C3  [ https://www.sparkfun.com/products/11792 ]
+              GT-511C1R [ https://www.sparkfun.com/products/13007 ]
+
+	See the FPS_Enroll example for the hardware hookup with a 5V Arduino.
+*****************************************************************/
+
+#include "FPS_GT511C3.h"
+#include "SoftwareSerial.h"
+#if !defined(__AVR__)
+#include <SD.h>
+#endif
+
+// set up software serial pins for Arduino's w/ Atmega328P's
+// FPS (TX) is connected to pin 4 (Arduino's Software RX)
+// FPS (RX) is connected through a converter to pin 5 (Arduino's Software TX)
+FPS_GT511C3 fps(4, 5); // (Arduino SS_RX = pin 4, Arduino SS_TX = pin 5)
+
+#if defined(__AVR__)
+// the whole EEPROM of an Uno (1024 bytes), 64 entries
+EEPROM_Journal journal(0, 64);
+#else
+const int SD_CHIP_SELECT = 10;
+File file;
+Stream_Journal* journal;
+#endif
+
+unsigned long slowestlog = 0;
+
+void setup()
+{
+	Serial.begin(9600); //set up Arduino's hardware serial UART
+	delay(100);
+	pinMode(LED_BUILTIN, OUTPUT);  //stands in for the door lock
+#if defined(__AVR__)
+	Serial.print("Journal entries kept: ");
+	Serial.println(journal.Begin());
+	fps.Journal = &journal;
+#else
+	if (SD.begin(SD_CHIP_SELECT) == false) Serial.println("SD card failed");
+	file = SD.open("JOURNAL.BIN", FILE_WRITE);
+	journal = new Stream_Journal(file);
+	fps.Journal = journal;
+#endif
+	fps.Open();         //send serial command to initialize fps
+	fps.SetLED(true);   //turn on LED so fps can see fingerprint
+}
+
+void PrintEntry(Access_Entry& entry)
+{
+	Serial.print(entry.Sequence);
+	Serial.print(",");
+	Serial.print(entry.Time);
+	Serial.print(",");
+	Serial.print(entry.Kind == Access_Entry::Kinds::Verify ? "verify" : "identify");
+	Serial.print(",");
+	Serial.print(entry.ID);
+	Serial.print(",0x");
+	Serial.print(entry.Error, HEX);
+	Serial.print(",");
+	Serial.print(entry.Granted() ? "granted" : "denied");
+	Serial.print(",");
+	Serial.print(entry.CaptureMillis);
+	Serial.print(",");
+	Serial.println(entry.MatchMillis);
+}
+
+void Dump()
+{
+	Serial.println("sequence,time,kind,id,error,result,capture ms,match ms");
+	Access_Entry entry;
+#if defined(__AVR__)
+	journal.Flush();
+	journal.Rewind();
+	while (journal.Read(entry)) PrintEntry(entry);
+	Serial.print("Logged ");
+	Serial.print(journal.Logged);
+	Serial.print(", dropped ");
+	Serial.println(journal.Dropped);
+#else
+	file.close();
+	File in = SD.open("JOURNAL.BIN");
+	unsigned long skipped = 0;
+	while (Stream_Journal::ReadEntry(in, entry, skipped)) PrintEntry(entry);
+	in.close();
+	file = SD.open("JOURNAL.BIN", FILE_WRITE);
+	Serial.print("Skipped ");
+	Serial.println(skipped);
+#endif
+	Serial.print("Slowest log: ");
+	Serial.print(slowestlog);
+	Serial.println(" us");
+}
+
+void loop()
+{
+#if defined(__AVR__)
+	journal.Poll();     //writes the queued entries to EEPROM in the background
+#endif
+	if (Serial.available())
+	{
+		while (Serial.available()) Serial.read();
+		Dump();
+	}
+
+	if (fps.IsPressFinger())
+	{
+		fps.CaptureFinger(false);
+		int id = fps.Identify1_N();  //logged by the journal
+#if defined(__AVR__)
+		if (journal.LastLogMicros > slowestlog) slowestlog = journal.LastLogMicros;
+#else
+		if (journal->LastLogMicros > slowestlog) slowestlog = journal->LastLogMicros;
+#endif
+		//Change to "if (id <3000)", if using GT-521F52
+		//Leave "if (id <200)", if using GT-521F32/GT-511C3
+		if (id <200) digitalWrite(LED_BUILTIN, HIGH);  //open the door here
+		while (fps.IsPressFinger()) delay(100);
+		digitalWrite(LED_BUILTIN, LOW);
+	}
+	delay(100);
+}
@@ -0,0 +1,88 @@
+/*****************************************************************
+	FPS_Adaptive_Capture.ino - Library example for controlling the GT-511C3 Finger Print Scanner (FPS)
+	Licensed for non-commercial use, must include this license message
+	basically, Feel free to hack away at it, but just give me credit for my work =)
+	TLDR; Wil Wheaton's Law
+
+	Description: This sketch lets Capture_Policy decide between fast and high
+	quality captures, instead of always using fast ones. It learns from every
+	attempt how often each mode matches and how long it takes, and picks the
+	one that gets people through the door quickest, retries included.
+	Send any character over Serial to see the statistics it works from.
+
+	This code should work with the any model of ADH-Tech's FPS as long as
+	you are within the minimum logic level threshold for the FPS serial UART.
+	This code has been tested with these models:
+
+              GT-521F52 [ https://www.sparkfun.com/products/14585 ]
+              GT-521F32 [ https://www.sparkfun.com/products/14518 ]
+              GT-511C3  [ https://www.sparkfun.com/products/11792 ]
+              GT-511C1R [ https://www.sparkfun.com/products/13007 ]
+
+	See the FPS_Enroll example for the hardware hookup with a 5V Arduino.
+*****************************************************************/
+
+#include "FPS_GT511C3.h"
+#include "SoftwareSerial.h"
+
+// set up software serial pins for Arduino's w/ Atmega328P's
+// FPS (TX) is connected to pin 4 (Arduino's Software RX)
+// FPS (RX) is connected through a converter to pin 5 (Arduino's Software TX)
+FPS_GT511C3 fps(4, 5); // (Arduino SS_RX = pin 4, Arduino SS_TX = pin 5)
+
+Capture_Policy policy;
+
+void setup()
+{
+	Serial.begin(9600); //set up Arduino's hardware serial UART
+	delay(100);
+	fps.Open();         //send serial command to initialize fps
+	fps.SetLED(true);   //turn on LED so fps can see fingerprint
+}
+
+void PrintStats(const char* name, Capture_Policy::Mode_Stats& stats)
+{
+	Serial.print(name);
+	Serial.print(": ");
+	Serial.print(stats.Attempts);
+	Serial.print(" attempts, match rate ");
+	Serial.print(stats.MatchRate);
+	Serial.print(", ");
+	Serial.print(stats.MeanMillis);
+	Serial.print(" ms each, expect ");
+	Serial.print(stats.ExpectedMillis());
+	Serial.println(" ms to unlock");
+}
+
+void loop()
+{
+	if (Serial.available())
+	{
+		while (Serial.available()) Serial.read();
+		PrintStats("Fast", policy.Fast);
+		PrintStats("High", policy.High);
+		PrintStats("Retry fast", policy.RetryFast);
+		PrintStats("Retry high", policy.RetryHigh);
+	}
+
+	if (fps.IsPressFinger())
+	{
+		int id = policy.Identify(fps, 3);
+		if (id >= 0)
+		{
+			Serial.print("Verified ID:");
+			Serial.print(id);
+		}
+		else
+		{
+			Serial.print("Finger not found");
+		}
+		Serial.print(" (");
+		Serial.print(policy.LastAttempts);
+		Serial.print(" attempts, ");
+		Serial.print(policy.LastUnlockMillis);
+		Serial.println(" ms)");
+		while (fps.IsPressFinger()) delay(100);
+	}
+	delay(100);
+}
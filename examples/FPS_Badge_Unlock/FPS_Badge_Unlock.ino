@@ -0,0 +1,91 @@
+/*****************************************************************
+	FPS_Badge_Unlock.ino - Library example for controlling the GT-511C3 Finger Print Scanner (FPS)
+	Licensed for non-commercial use, must include this license message
+	basically, Feel free to hack away at it, but just give me credit for my work =)
+	TLDR; Wil Wheaton's Law
+
+	Description: This sketch unlocks with a badge plus a finger. The badge number
+	picks the template slot from a table kept in flash, so the finger only has to
+	be checked against that one template with Verify1_1() instead of searching the
+	whole database with Identify1_N(), which gets slow on large databases. Unknown
+	badges fall back to Identify1_N(). The time taken by each path is reported.
+
+	To try it without a badge reader, type a badge number in the Serial Monitor
+	and then press your finger. Replace the table with your own badges and slots.
+
+	This code should work with the any model of ADH-Tech's FPS as long as
+	you are within the minimum logic level threshold for the FPS serial UART.
+	This code has been tested with these models:
+
+              GT-521F52 [ https://www.sparkfun.com/products/14585 ]
+              GT-521F32 [ https://www.sparkfun.com/products/14518 ]
+              GT-511C3  [ https://www.sparkfun.com/products/11792 ]
+              GT-511C1R [ https://www.sparkfun.com/products/13007 ]
+
+	See the FPS_Enroll example for the hardware hookup with a 5V Arduino.
+*****************************************************************/
+
+#include "FPS_GT511C3.h"
+#include "SoftwareSerial.h"
+
+// set up software serial pins for Arduino's w/ Atmega328P's
+// FPS (TX) is connected to pin 4 (Arduino's Software RX)
+// FPS (RX) is connected through a converter to pin 5 (Arduino's Software TX)
+FPS_GT511C3 fps(4, 5); // (Arduino SS_RX = pin 4, Arduino SS_TX = pin 5)
+
+// badge number -> template slot, must be sorted by badge number
+const Badge_Entry badges[] PROGMEM =
+{
+	{ 1001, 0 },
+	{ 1002, 1 },
+	{ 2040, 2 },
+	{ 31337, 3 },
+};
+Badge_Index badgeindex(badges, sizeof(badges) / sizeof(badges[0]));
+
+void setup()
+{
+	Serial.begin(9600); //set up Arduino's hardware serial UART
+	Serial.setTimeout(100000);
+	delay(100);
+	fps.Open();         //send serial command to initialize fps
+	fps.SetLED(true);   //turn on LED so fps can see fingerprint
+}
+
+void loop()
+{
+	Serial.println("Enter badge number");
+	long badge = Serial.parseInt();
+	if (badge <= 0) return;
+
+	Serial.println("Please press finger");
+	while (fps.IsPressFinger() == false) delay(100);
+	fps.CaptureFinger(false);
+	int id = badgeindex.Identify(fps, badge);
+
+	if (id >= 0)
+	{
+		Serial.print("Unlocked, ID:");
+		Serial.println(id);
+	}
+	else
+	{
+		Serial.println("Denied");
+	}
+	Serial.print((badgeindex.LastPath == Badge_Index::Paths::Verify) ? "Verify1_1 path: " : "Identify1_N path: ");
+	Serial.print(badgeindex.LastMillis);
+	Serial.println(" ms");
+	if (badgeindex.VerifyCount > 0)
+	{
+		Serial.print("Average verify: ");
+		Serial.print(badgeindex.VerifyMillis / badgeindex.VerifyCount);
+		Serial.println(" ms");
+	}
+	if (badgeindex.IdentifyCount > 0)
+	{
+		Serial.print("Average identify: ");
+		Serial.print(badgeindex.IdentifyMillis / badgeindex.IdentifyCount);
+		Serial.println(" ms");
+	}
+	while (fps.IsPressFinger()) delay(100);
+}
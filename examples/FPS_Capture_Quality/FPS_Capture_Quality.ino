@@ -0,0 +1,90 @@
+/*****************************************************************
+	FPS_Capture_Quality.ino - Library example for controlling the GT-511C3 Finger Print Scanner (FPS)
+	Licensed for non-commercial use, must include this license message
+	basically, Feel free to hack away at it, but just give me credit for my work =)
+	TLDR; Wil Wheaton's Law
+
+	Description: This sketch checks the quality of each capture before spending
+	a 1:N search on it. The captured image is scored by Image_Quality while
+	GetImage() downloads it, one row at a time, so the verdict is ready as soon
+	as the last row arrives. Poor captures are retaken in high quality instead
+	of being sent to Identify1_N().
+
+	The image is 52116 bytes, so use the fastest baud rate your wiring allows:
+	about 4.5 seconds at 115200 baud, but close to a minute at 9600.
+
+	This code should work with the any model of ADH-Tech's FPS as long as
+	you are within the minimum logic level threshold for the FPS serial UART.
+	This code has been tested with these models:
+
+              GT-521F52 [ https://www.sparkfun.com/products/14585 ]
+              GT-521F32 [ https://www.sparkfun.com/products/14518 ]
+              GT-511C3  [ https://www.sparkfun.com/products/11792 ]
+              GT-511C1R [ https://www.sparkfun.com/products/13007 ]
+
+	See the FPS_Enroll example for the hardware hookup with a 5V Arduino.
+*****************************************************************/
+
+#include "FPS_GT511C3.h"
+#include "SoftwareSerial.h"
+
+// set up software serial pins for Arduino's w/ Atmega328P's
+// FPS (TX) is connected to pin 4 (Arduino's Software RX)
+// FPS (RX) is connected through a converter to pin 5 (Arduino's Software TX)
+FPS_GT511C3 fps(4, 5); // (Arduino SS_RX = pin 4, Arduino SS_TX = pin 5)
+
+Image_Quality quality;
+
+void setup()
+{
+	Serial.begin(9600); //set up Arduino's hardware serial UART
+	delay(100);
+	fps.Open();         //send serial command to initialize fps
+	//fps.ChangeBaudRate(57600); //uncomment to speed up the image download if your wiring allows
+	fps.SetLED(true);   //turn on LED so fps can see fingerprint
+}
+
+void PrintQuality()
+{
+	Serial.print("Contrast ");
+	Serial.print(quality.Contrast);
+	Serial.print(", coverage ");
+	Serial.print(quality.Coverage);
+	Serial.print("%, clarity ");
+	Serial.println(quality.Clarity);
+}
+
+void loop()
+{
+	if (fps.IsPressFinger())
+	{
+		fps.CaptureFinger(false);
+		unsigned long started = millis();
+		bool bret = fps.GetImage(quality);
+		Serial.print("Image scored in ");
+		Serial.print(millis() - started);
+		Serial.println(" ms");
+		PrintQuality();
+		if ((bret == false) || (quality.Passed() == false))
+		{
+			Serial.println("Poor capture, retaking in high quality");
+			fps.CaptureFinger(true);
+		}
+
+		int id = fps.Identify1_N();
+		if (id <200) //<- change id value depending model you are using
+		{//if the fingerprint matches, provide the matching template ID
+			Serial.print("Verified ID:");
+			Serial.println(id);
+		}
+		else
+		{//if unable to recognize
+			Serial.println("Finger not found");
+		}
+	}
+	else
+	{
+		Serial.println("Please press finger");
+	}
+	delay(100);
+}
@@ -0,0 +1,115 @@
+/*****************************************************************
+	FPS_Command_Queue.ino - Library example for controlling the GT-511C3 Finger Print Scanner (FPS)
+	Licensed for non-commercial use, must include this license message
+	basically, Feel free to hack away at it, but just give me credit for my work =)
+	TLDR; Wil Wheaton's Law
+
+	Description: This sketch shares one scanner between a door button and some
+	background jobs with Command_Queue. Pressing the button (pin 2 to ground)
+	queues an urgent identify from the interrupt handler, which jumps ahead of
+	the housekeeping requests that loop() queues every few hundred ms.
+	Send any character over Serial to print how long each lane waited.
+
+	This code should work with the any model of ADH-Tech's FPS as long as
+	you are within the minimum logic level threshold for the FPS serial UART.
+	This code has been tested with these models:
+
+              GT-521F52 [ https://www.sparkfun.com/products/14585 ]
+              GT-521F32 [ https://www.sparkfun.com/products/14518 ]
+              GT-511C3  [ https://www.sparkfun.com/products/11792 ]
+              GT-511C1R [ https://www.sparkfun.com/products/13007 ]
+
+	See the FPS_Enroll example for the hardware hookup with a 5V Arduino.
+*****************************************************************/
+
+#include "FPS_GT511C3.h"
+#include "SoftwareSerial.h"
+
+// set up software serial pins for Arduino's w/ Atmega328P's
+// FPS (TX) is connected to pin 4 (Arduino's Software RX)
+// FPS (RX) is connected through a converter to pin 5 (Arduino's Software TX)
+FPS_GT511C3 fps(4, 5); // (Arduino SS_RX = pin 4, Arduino SS_TX = pin 5)
+
+Command_Queue queue(fps);
+
+const int BUTTON_PIN = 2;
+// a press bounces for a few ms, and each bounce would queue another identify
+const unsigned long DEBOUNCE_INTERVAL = 200;
+// ms between housekeeping requests, lower it to load the queue harder
+const unsigned long HOUSEKEEPING_INTERVAL = 200;
+
+unsigned long lasthousekeeping = 0;
+unsigned long lastpress = 0;		// only used by the interrupt handler
+int enrollcount = 0;
+
+// Runs in loop() (from queue.Poll), not in the interrupt
+void IdentifyDone(byte operation, int parameter, int result, void* context)
+{
+	if (result < 0) Serial.println("Button pressed, but no finger");
+	//Change to "result < 3000", if using GT-521F52
+	//Leave "result < 200", if using GT-521F32/GT-511C3
+	else if (result < 200)
+	{
+		Serial.print("Verified ID:");
+		Serial.println(result);
+	}
+	else Serial.println("Finger not found");
+}
+
+void EnrollCountDone(byte operation, int parameter, int result, void* context)
+{
+	enrollcount = result;
+}
+
+// Only this interrupt submits to the Urgent lane, so it needs no locking
+void ButtonPressed()
+{
+	unsigned long now = millis();
+	if (now - lastpress < DEBOUNCE_INTERVAL) return;
+	lastpress = now;
+	queue.Submit(Command_Queue::Operations::Identify, 0, IdentifyDone, NULL, Command_Queue::Lanes::Urgent);
+}
+
+void PrintLane(const char* name, Command_Queue::Lanes::Lanes_Enum lane)
+{
+	Serial.print(name);
+	Serial.print(": ");
+	Serial.print(queue.Completed[lane]);
+	Serial.print(" done, ");
+	Serial.print(queue.Dropped(lane));
+	Serial.print(" dropped, last wait ");
+	Serial.print(queue.LastWaitMillis[lane]);
+	Serial.print(" ms, max wait ");
+	Serial.print(queue.MaxWaitMillis[lane]);
+	Serial.println(" ms");
+}
+
+void setup()
+{
+	Serial.begin(9600); //set up Arduino's hardware serial UART
+	delay(100);
+	fps.Open();         //send serial command to initialize fps
+	fps.SetLED(true);   //turn on LED so fps can see fingerprint
+	pinMode(BUTTON_PIN, INPUT_PULLUP);
+	attachInterrupt(digitalPinToInterrupt(BUTTON_PIN), ButtonPressed, FALLING);
+}
+
+void loop()
+{
+	if (millis() - lasthousekeeping >= HOUSEKEEPING_INTERVAL)
+	{
+		lasthousekeeping = millis();
+		queue.Submit(Command_Queue::Operations::GetEnrollCount, 0, EnrollCountDone, NULL, Command_Queue::Lanes::Housekeeping);
+	}
+
+	queue.Poll();
+
+	if (Serial.available())
+	{
+		while (Serial.available()) Serial.read();
+		Serial.print("Enrolled: ");
+		Serial.println(enrollcount);
+		PrintLane("Urgent", Command_Queue::Lanes::Urgent);
+		PrintLane("Housekeeping", Command_Queue::Lanes::Housekeeping);
+	}
+}
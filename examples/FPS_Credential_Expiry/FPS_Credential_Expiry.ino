@@ -0,0 +1,145 @@
+/*****************************************************************
+	FPS_Credential_Expiry.ino - Library example for controlling the GT-511C3 Finger Print Scanner (FPS)
+	Licensed for non-commercial use, must include this license message
+	basically, Feel free to hack away at it, but just give me credit for my work =)
+	TLDR; Wil Wheaton's Law
+
+	Description: This sketch unlocks for enrolled fingers and deletes IDs when their
+	access expires. Expiries are set over the serial monitor, "e5 60" deletes ID 5 in
+	60 seconds and "c5" cancels it. The Expiry_Scheduler only sends a DeleteID while
+	the Power_Manager is asleep (nobody at the door), one per loop, so a finger that
+	shows up never waits behind a batch of deletes.
+	Deadlines are wall clock time (unix seconds), so they still hold after a reset. There
+	is no RTC here: send "t" and the current unix time once after every reset
+	(on Linux/macOS: date +t%s). The expiries and a Warm_Start snapshot of who is
+	enrolled are kept in EEPROM, so IDs deleted while the heap was not saved are dropped.
+
+	This code should work with the any model of ADH-Tech's FPS as long as
+	you are within the minimum logic level threshold for the FPS serial UART.
+	This code has been tested with these models:
+
+              GT-521F52 [ https://www.sparkfun.com/products/14585 ]
+              GT-521F32 [ https://www.sparkfun.com/products/14518 ]
+              GT-511C3  [ https://www.sparkfun.com/products/11792 ]
+              GT-511C1R [ https://www.sparkfun.com/products/13007 ]
+
+	See the FPS_Enroll example for the hardware hookup with a 5V Arduino.
+*****************************************************************/
+
+#include "FPS_GT511C3.h"
+#include "SoftwareSerial.h"
+
+// set up software serial pins for Arduino's w/ Atmega328P's
+// FPS (TX) is connected to pin 4 (Arduino's Software RX)
+// FPS (RX) is connected through a converter to pin 5 (Arduino's Software TX)
+FPS_GT511C3 fps(4, 5); // (Arduino SS_RX = pin 4, Arduino SS_TX = pin 5)
+
+Power_Manager power(fps);
+
+//Change to "IDS = 3000", if using GT-521F52 (the snapshot then takes 417 bytes of EEPROM)
+//Leave "IDS = 200", if using GT-521F32/GT-511C3 (67 bytes of EEPROM)
+const int IDS = 200;
+byte bitmap[(IDS + 7) / 8];
+Warm_Start snapshot(bitmap, IDS);
+
+// 6 bytes of ram (and EEPROM) per expiry
+const int CAPACITY = 40;
+Expiry_Scheduler::Entry heap[CAPACITY];
+Expiry_Scheduler expiry(fps, heap, CAPACITY);
+
+const int SNAPSHOT_ADDRESS = 0;
+const int EXPIRY_ADDRESS = SNAPSHOT_ADDRESS + Warm_Start::Size(IDS);
+
+// the wall clock, set over serial: unix seconds at clockmillis
+unsigned long clockseconds = 0;
+unsigned long clockmillis = 0;
+bool clockset = false;
+
+unsigned long Seconds()
+{
+	return clockseconds + (millis() - clockmillis) / 1000;
+}
+
+void setup()
+{
+	Serial.begin(9600); //set up Arduino's hardware serial UART
+	delay(100);
+	bool loaded = snapshot.LoadEEPROM(SNAPSHOT_ADDRESS);
+	if (snapshot.Start(fps, loaded) == false) Serial.println("The scanner did not answer, check the wiring");
+	fps.Snapshot = &snapshot;   //keeps the snapshot up to date with every delete
+	expiry.Clock = Seconds;
+	if (expiry.LoadEEPROM(EXPIRY_ADDRESS, snapshot))
+	{
+		Serial.print(expiry.Count());
+		Serial.println(" expiries loaded");
+	}
+	power.CheckInterval = 500;
+	power.Begin();      //LED stays off until a finger shows up
+	Serial.println("Send t<unix seconds> to set the clock");
+}
+
+void loop()
+{
+	if (Serial.available()) ReadCommand();
+
+	if (power.Poll())
+	{
+		fps.CaptureFinger(false);
+		int id = fps.Identify1_N();
+//Change to "id < 3000", if using GT-521F52
+//Leave "id < 200", if using GT-521F32/GT-511C3
+		if (id <200)
+		{
+			Serial.print("Verified ID:");
+			Serial.println(id);
+		}
+		else
+		{
+			Serial.println("Finger not found");
+		}
+		while (fps.IsPressFinger()) delay(100);
+	}
+
+	// deletes at most one expired ID, and only while the scanner is asleep
+	if (clockset && expiry.Poll(power))
+	{
+		Serial.print("Expired ID deleted in ");
+		Serial.print(expiry.LastDeleteMillis);
+		Serial.print(" ms, ");
+		Serial.print(expiry.Count());
+		Serial.println(" expiries left");
+	}
+
+	// saves what changed, the snapshot first so the heap is saved with its generation
+	if (snapshot.Changed()) snapshot.SaveEEPROM(SNAPSHOT_ADDRESS);
+	if (expiry.Changed()) expiry.SaveEEPROM(EXPIRY_ADDRESS, snapshot);
+}
+
+// "t<unix seconds>" sets the clock, "e<id> <seconds>" schedules an expiry, "c<id>" cancels it
+void ReadCommand()
+{
+	char command = Serial.read();
+	if (command == 't')
+	{
+		clockseconds = Serial.parseInt();
+		clockmillis = millis();
+		clockset = true;
+		Serial.println("Clock set");
+		return;
+	}
+	if ((command != 'e') && (command != 'c')) return;
+	int id = Serial.parseInt();
+	if (command == 'c')
+	{
+		Serial.println(expiry.Cancel(id) ? "Cancelled" : "No expiry for that ID");
+		return;
+	}
+	unsigned long seconds = Serial.parseInt();
+	if (clockset == false)
+	{
+		Serial.println("Set the clock first: t<unix seconds>");
+		return;
+	}
+	if (expiry.Schedule(id, Seconds() + seconds)) Serial.println("Scheduled");
+	else Serial.println("No room for more expiries");
+}
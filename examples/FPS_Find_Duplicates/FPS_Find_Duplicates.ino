@@ -0,0 +1,125 @@
+/*****************************************************************
+	FPS_Find_Duplicates.ino - Library example for controlling the GT-511C3 Finger Print Scanner (FPS)
+	Licensed for non-commercial use, must include this license message
+	basically, Feel free to hack away at it, but just give me credit for my work =)
+	TLDR; Wil Wheaton's Law
+
+	Description: This sketch looks for the same template stored more than once,
+	either twice on one scanner under different IDs or on several scanners wired
+	to the same Arduino. Every enrolled template is downloaded with GetTemplate()
+	and reduced to a 32 bit similarity signature, then signatures that are only a
+	few bits apart are reported with their scanner and slot so the extra copy can
+	be removed with DeleteID().
+
+	Signatures catch copies of a template (exported, provisioned or synced to
+	another site). A person enrolled twice from separate captures produces
+	different templates; use SetTemplate() with the duplicate check to catch those.
+
+	This code should work with the any model of ADH-Tech's FPS as long as
+	you are within the minimum logic level threshold for the FPS serial UART.
+	This code has been tested with these models:
+
+              GT-521F52 [ https://www.sparkfun.com/products/14585 ]
+              GT-521F32 [ https://www.sparkfun.com/products/14518 ]
+              GT-511C3  [ https://www.sparkfun.com/products/11792 ]
+              GT-511C1R [ https://www.sparkfun.com/products/13007 ]
+
+	See the FPS_Enroll example for the hardware hookup with a 5V Arduino.
+*****************************************************************/
+
+#include "FPS_GT511C3.h"
+#include "SoftwareSerial.h"
+
+// set up software serial pins for Arduino's w/ Atmega328P's
+// FPS (TX) is connected to pin 4 (Arduino's Software RX)
+// FPS (RX) is connected through a converter to pin 5 (Arduino's Software TX)
+FPS_GT511C3 fps(4, 5); // (Arduino SS_RX = pin 4, Arduino SS_TX = pin 5)
+// add more scanners here (each needs its own pair of pins)
+//FPS_GT511C3 fps2(6, 7);
+
+FPS_GT511C3* devices[] = { &fps /*, &fps2 */ };
+const int DEVICE_COUNT = sizeof(devices) / sizeof(devices[0]);
+
+// GT-521F52 holds 3000 templates, GT-521F32/GT-511C3 hold 200
+const int CAPACITY = 200; //<- change depending on model you are using
+
+// signatures this many bits apart or closer are reported
+const int MAX_DISTANCE = 3;
+
+// each entry takes 7 bytes of ram, raise this on boards with more memory
+const int MAX_ENTRIES = 96;
+
+struct Entry
+{
+	byte device;
+	int slot;
+	uint32_t signature;
+};
+
+Entry entries[MAX_ENTRIES];
+int entrycount = 0;
+byte tmplt[FPS_GT511C3::TEMPLATE_SIZE];
+
+void setup()
+{
+	Serial.begin(9600); //set up Arduino's hardware serial UART
+	delay(100);
+	for (int d = 0; d < DEVICE_COUNT; d++) devices[d]->Open();
+
+	Collect();
+	Report();
+}
+
+void Collect()
+{
+	for (int d = 0; d < DEVICE_COUNT; d++)
+	{
+		for (int slot = 0; slot < CAPACITY; slot++)
+		{
+			if (devices[d]->GetTemplate(slot, tmplt) != 0) continue;
+			if (entrycount == MAX_ENTRIES)
+			{
+				Serial.println("Out of entries, raise MAX_ENTRIES");
+				return;
+			}
+			entries[entrycount].device = d;
+			entries[entrycount].slot = slot;
+			entries[entrycount].signature = Template_Store::TemplateSignature(tmplt);
+			entrycount++;
+		}
+	}
+}
+
+void Report()
+{
+	Serial.print("Templates scanned: ");
+	Serial.println(entrycount);
+	int found = 0;
+	for (int i = 0; i < entrycount; i++)
+	{
+		for (int j = i + 1; j < entrycount; j++)
+		{
+			int distance = Template_Store::SignatureDistance(entries[i].signature, entries[j].signature);
+			if (distance > MAX_DISTANCE) continue;
+			found++;
+			Serial.print("Duplicate: device ");
+			Serial.print(entries[i].device);
+			Serial.print(" slot ");
+			Serial.print(entries[i].slot);
+			Serial.print(" ~ device ");
+			Serial.print(entries[j].device);
+			Serial.print(" slot ");
+			Serial.print(entries[j].slot);
+			Serial.print(" (distance ");
+			Serial.print(distance);
+			Serial.println(")");
+		}
+	}
+	Serial.print("Duplicates found: ");
+	Serial.println(found);
+}
+
+void loop()
+{
+	delay(100000);
+}
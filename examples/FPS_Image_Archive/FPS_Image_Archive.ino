@@ -0,0 +1,120 @@
+/*****************************************************************
+	FPS_Image_Archive.ino - Library example for controlling the GT-511C3 Finger Print Scanner (FPS)
+	Licensed for non-commercial use, must include this license message
+	basically, Feel free to hack away at it, but just give me credit for my work =)
+	TLDR; Wil Wheaton's Law
+
+	Description: This sketch keeps a compressed copy of every capture on an SD card.
+	The image is compressed by Image_Encoder while GetImage() downloads it, so the
+	raw 52116 byte image never has to fit in ram, and each record is written to
+	its own file (IMG00000.FPI, IMG00001.FPI, ...). Image_Decoder reads them back
+	straight from the card: each record is checked by decoding its middle row, which
+	only reads that row's group, never the whole file.
+
+	Needs an SD card shield or breakout with its chip select on pin 10. The SD
+	library takes a good part of an Atmega328P's ram, so a Mega is more comfortable.
+
+	This code should work with the any model of ADH-Tech's FPS as long as
+	you are within the minimum logic level threshold for the FPS serial UART.
+	This code has been tested with these models:
+
+              GT-521F52 [ https://www.sparkfun.com/products/14585 ]
+              GT-521F32 [ https://www.sparkfun.com/products/14518 ]
+              GT-511C3  [ https://www.sparkfun.com/products/11792 ]
+              GT-511C1R [ https://www.sparkfun.com/products/13007 ]
+
+	See the FPS_Enroll example for the hardware hookup with a 5V Arduino.
+*****************************************************************/
+
+#include "FPS_GT511C3.h"
+#include "SoftwareSerial.h"
+#include <SD.h>
+
+// set up software serial pins for Arduino's w/ Atmega328P's
+// FPS (TX) is connected to pin 4 (Arduino's Software RX)
+// FPS (RX) is connected through a converter to pin 5 (Arduino's Software TX)
+FPS_GT511C3 fps(4, 5); // (Arduino SS_RX = pin 4, Arduino SS_TX = pin 5)
+
+const int SD_CHIP_SELECT = 10;
+const long MAX_IMAGES = 100000;	// IMG00000.FPI to IMG99999.FPI, the 8.3 names have room for 5 digits
+long imagenumber = 0;
+
+byte row[Image_Encoder::MAX_WIDTH];
+
+// Lets Image_Decoder jump around in a file on the SD card
+bool SeekFile(unsigned long position, void* context)
+{
+	return ((File*)context)->seek(position);
+}
+
+// Finds the next file name that is not on the card yet, so a restart never appends to an old record
+// Returns: false if all of them are taken
+bool NextFilename(char* filename)
+{
+	for (; imagenumber < MAX_IMAGES; imagenumber++)
+	{
+		sprintf(filename, "IMG%05ld.FPI", imagenumber);
+		if (SD.exists(filename) == false) return true;
+	}
+	return false;
+}
+
+void setup()
+{
+	Serial.begin(9600); //set up Arduino's hardware serial UART
+	delay(100);
+	if (SD.begin(SD_CHIP_SELECT) == false) Serial.println("SD card failed");
+	fps.Open();         //send serial command to initialize fps
+	fps.SetLED(true);   //turn on LED so fps can see fingerprint
+}
+
+void loop()
+{
+	if (fps.IsPressFinger())
+	{
+		fps.CaptureFinger(false);
+
+		char filename[13];
+		if (NextFilename(filename) == false)
+		{
+			Serial.println("No file names left on the SD card");
+			while (fps.IsPressFinger()) delay(100);
+			return;
+		}
+		imagenumber++;
+		File file = SD.open(filename, FILE_WRITE);
+		Image_Encoder encoder(file);
+		unsigned long started = millis();
+		bool bret = fps.GetImage(encoder);
+		unsigned long elapsed = millis() - started;
+		file.close();
+
+		if (bret)
+		{
+			Serial.print(filename);
+			Serial.print(": ");
+			Serial.print(encoder.PixelCount);
+			Serial.print(" -> ");
+			Serial.print(encoder.BytesWritten);
+			Serial.print(" bytes (ratio ");
+			Serial.print((float)encoder.PixelCount / encoder.BytesWritten);
+			Serial.print(") in ");
+			Serial.print(elapsed);
+			Serial.println(" ms");
+
+			// read the middle row back from the card
+			file = SD.open(filename, FILE_READ);
+			Image_Decoder decoder(file, file.size(), SeekFile, &file);
+			if (decoder.Valid && decoder.DecodeRow(decoder.Height / 2, row)) Serial.println("Record checked");
+			else Serial.println("Record damaged");
+			file.close();
+		}
+		else
+		{
+			Serial.println("Image download failed");
+			SD.remove(filename);
+		}
+		while (fps.IsPressFinger()) delay(100);
+	}
+	delay(100);
+}
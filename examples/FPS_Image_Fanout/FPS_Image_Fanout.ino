@@ -0,0 +1,137 @@
+/*****************************************************************
+	FPS_Image_Fanout.ino - Library example for controlling the GT-511C3 Finger Print Scanner (FPS)
+	Licensed for non-commercial use, must include this license message
+	basically, Feel free to hack away at it, but just give me credit for my work =)
+	TLDR; Wil Wheaton's Law
+
+	Description: This sketch downloads each capture once and hands it to three
+	consumers at the same time with Image_Fanout: a quality check, an archive
+	on the SD card and a rough preview printed over Serial. They all read the
+	same row buffer, so no copies are made.
+	After each image it prints how long each consumer took per row. All of them
+	together have to finish a row before the 64 byte SoftwareSerial buffer fills
+	(about 5.5 ms at 115200 baud), or longer if they call fps.Pump() as they go
+	(about 16 ms at 115200 baud with the default receive ring).
+
+	The image is 52116 bytes, so use the fastest baud rate your wiring allows:
+	about 4.5 seconds at 115200 baud, but close to a minute at 9600.
+
+	This code should work with the any model of ADH-Tech's FPS as long as
+	you are within the minimum logic level threshold for the FPS serial UART.
+	This code has been tested with these models:
+
+              GT-521F52 [ https://www.sparkfun.com/products/14585 ]
+              GT-521F32 [ https://www.sparkfun.com/products/14518 ]
+              GT-511C3  [ https://www.sparkfun.com/products/11792 ]
+              GT-511C1R [ https://www.sparkfun.com/products/13007 ]
+
+	See the FPS_Enroll example for the hardware hookup with a 5V Arduino.
+*****************************************************************/
+
+#include "FPS_GT511C3.h"
+#include "SoftwareSerial.h"
+#include <SD.h>
+
+// set up software serial pins for Arduino's w/ Atmega328P's
+// FPS (TX) is connected to pin 4 (Arduino's Software RX)
+// FPS (RX) is connected through a converter to pin 5 (Arduino's Software TX)
+FPS_GT511C3 fps(4, 5); // (Arduino SS_RX = pin 4, Arduino SS_TX = pin 5)
+
+const int SD_CHIP_SELECT = 10;
+const long MAX_IMAGES = 100000;	// IMG00000.FPI to IMG99999.FPI, the 8.3 names have room for 5 digits
+long imagenumber = 0;
+
+// Finds the next file name that is not on the card yet, so a restart never appends to an old record
+// Returns: false if all of them are taken
+bool NextFilename(char* filename)
+{
+	for (; imagenumber < MAX_IMAGES; imagenumber++)
+	{
+		sprintf(filename, "IMG%05ld.FPI", imagenumber);
+		if (SD.exists(filename) == false) return true;
+	}
+	return false;
+}
+
+// Prints every 16th row, every 8th pixel, as a character from dark to light
+class Preview : public Image_Row_Handler
+{
+	public:
+		void ImageRow(int row, byte* pixels, int width)
+		{
+			if ((row % 16) != 0) return;
+			const char shades[] = "#%+-. ";
+			for (int i = 0; i < width; i += 8) Serial.print(shades[pixels[i] / 43]);
+			Serial.println();
+			fps.Pump(); // takes in what arrived from the fps while the line went out
+		}
+};
+
+Image_Quality quality;
+Preview preview;
+
+void setup()
+{
+	Serial.begin(115200); //set up Arduino's hardware serial UART, fast enough for the preview
+	delay(100);
+	if (SD.begin(SD_CHIP_SELECT) == false) Serial.println("SD card failed");
+	fps.Open();         //send serial command to initialize fps
+	//fps.ChangeBaudRate(115200); //uncomment to speed up the image download if your wiring allows
+	fps.SetLED(true);   //turn on LED so fps can see fingerprint
+}
+
+void PrintTiming(const char* name, Image_Fanout& fanout, int i)
+{
+	Serial.print(name);
+	Serial.print(": slowest row ");
+	Serial.print(fanout.SlowestRowMicros[i]);
+	Serial.print(" us, total ");
+	Serial.print(fanout.TotalMicros[i] / 1000);
+	Serial.println(" ms");
+}
+
+void loop()
+{
+	if (fps.IsPressFinger())
+	{
+		fps.CaptureFinger(false);
+
+		char filename[13];
+		if (NextFilename(filename) == false)
+		{
+			Serial.println("No file names left on the SD card");
+			while (fps.IsPressFinger()) delay(100);
+			return;
+		}
+		imagenumber++;
+		File file = SD.open(filename, FILE_WRITE);
+		Image_Encoder encoder(file);
+
+		Image_Fanout fanout;
+		fanout.Add(quality);
+		fanout.Add(encoder);
+		fanout.Add(preview);
+		bool bret = fps.GetImage(fanout);
+		file.close();
+
+		if (bret)
+		{
+			Serial.print("Quality ");
+			Serial.println(quality.Passed() ? "good" : "poor");
+			PrintTiming("Quality", fanout, 0);
+			PrintTiming("Archive", fanout, 1);
+			PrintTiming("Preview", fanout, 2);
+			Serial.print("All together: slowest row ");
+			Serial.print(fanout.SlowestRowMicrosAll);
+			Serial.println(" us");
+		}
+		else
+		{
+			Serial.print("Image download failed, receive overruns: ");
+			Serial.println(fps.Rx.Overruns);
+			SD.remove(filename);
+		}
+		while (fps.IsPressFinger()) delay(100);
+	}
+	delay(100);
+}
@@ -0,0 +1,93 @@
+/*****************************************************************
+	FPS_Last_Result.ino - Library example for controlling the GT-511C3 Finger Print Scanner (FPS)
+	Licensed for non-commercial use, must include this license message
+	basically, Feel free to hack away at it, but just give me credit for my work =)
+	TLDR; Wil Wheaton's Law
+
+	Description: This sketch identifies fingers without polling IsPressFinger
+	first, and uses fps.LastResult to tell the user why a try failed (no finger,
+	finger not found, nobody enrolled yet, or no answer from the scanner).
+	LastResult already holds the error code the scanner sent back, so no extra
+	command is needed to find out what went wrong.
+
+	This code should work with the any model of ADH-Tech's FPS as long as
+	you are within the minimum logic level threshold for the FPS serial UART.
+	This code has been tested with these models:
+
+              GT-521F52 [ https://www.sparkfun.com/products/14585 ]
+              GT-521F32 [ https://www.sparkfun.com/products/14518 ]
+              GT-511C3  [ https://www.sparkfun.com/products/11792 ]
+              GT-511C1R [ https://www.sparkfun.com/products/13007 ]
+
+	See the FPS_Enroll example for the hardware hookup with a 5V Arduino.
+*****************************************************************/
+
+#include "FPS_GT511C3.h"
+#include "SoftwareSerial.h"
+
+// set up software serial pins for Arduino's w/ Atmega328P's
+// FPS (TX) is connected to pin 4 (Arduino's Software RX)
+// FPS (RX) is connected through a converter to pin 5 (Arduino's Software TX)
+FPS_GT511C3 fps(4, 5); // (Arduino SS_RX = pin 4, Arduino SS_TX = pin 5)
+
+void setup()
+{
+	Serial.begin(9600); //set up Arduino's hardware serial UART
+	delay(100);
+	fps.ResponseTimeout = 2000; //so an unplugged scanner shows up as an error
+	fps.Open();         //send serial command to initialize fps
+	fps.SetLED(true);   //turn on LED so fps can see fingerprint
+}
+
+void loop()
+{
+	if (fps.CaptureFinger(false) == false)
+	{
+		if (fps.LastResult.NoFinger()) Serial.println("Please press finger");
+		else PrintFailure();
+	}
+	else
+	{
+		int id = fps.Identify1_N();
+//Change to "id < 3000", if using GT-521F52
+//Leave "id < 200", if using GT-521F32/GT-511C3
+		if (id <200)
+		{
+			Serial.print("Verified ID:");
+			Serial.print(id);
+			Serial.print(" in ");
+			Serial.print(fps.LastResult.Millis);
+			Serial.println(" ms");
+		}
+		else PrintFailure();
+	}
+	delay(100);
+}
+
+// Prints why the last command failed, straight from fps.LastResult
+void PrintFailure()
+{
+	if (fps.LastResult.Valid == false)
+	{
+		Serial.println("No answer from the scanner, check the wiring");
+		return;
+	}
+	switch (fps.LastResult.Error)
+	{
+		case Response_Packet::ErrorCodes::NACK_IDENTIFY_FAILED:
+			Serial.println("Finger not found");
+			break;
+		case Response_Packet::ErrorCodes::NACK_DB_IS_EMPTY:
+			Serial.println("Nobody is enrolled yet, run FPS_Enroll first");
+			break;
+		case Response_Packet::ErrorCodes::NACK_BAD_FINGER:
+			Serial.println("Bad image, press the finger flat and try again");
+			break;
+		default:
+			Serial.print("Command 0x");
+			Serial.print(fps.LastResult.Command, HEX);
+			Serial.print(" failed with error 0x");
+			Serial.println(fps.LastResult.Error, HEX);
+			break;
+	}
+}
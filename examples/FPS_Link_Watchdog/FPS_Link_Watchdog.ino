@@ -0,0 +1,84 @@
+/*****************************************************************
+	FPS_Link_Watchdog.ino - Library example for controlling the GT-511C3 Finger Print Scanner (FPS)
+	Licensed for non-commercial use, must include this license message
+	basically, Feel free to hack away at it, but just give me credit for my work =)
+	TLDR; Wil Wheaton's Law
+
+	Description: This sketch keeps a door scanner working through power cuts
+	and loose wires. Link_Watchdog gives every command a deadline, notices when
+	the fps stops answering, and reopens it (baud rate and LED included) as soon
+	as it is back, with no reset of the arduino.
+	Try unplugging the fps power while it runs, then plugging it back in.
+
+	This code should work with the any model of ADH-Tech's FPS as long as
+	you are within the minimum logic level threshold for the FPS serial UART.
+	This code has been tested with these models:
+
+              GT-521F52 [ https://www.sparkfun.com/products/14585 ]
+              GT-521F32 [ https://www.sparkfun.com/products/14518 ]
+              GT-511C3  [ https://www.sparkfun.com/products/11792 ]
+              GT-511C1R [ https://www.sparkfun.com/products/13007 ]
+
+	See the FPS_Enroll example for the hardware hookup with a 5V Arduino.
+*****************************************************************/
+
+#include "FPS_GT511C3.h"
+#include "SoftwareSerial.h"
+
+// set up software serial pins for Arduino's w/ Atmega328P's
+// FPS (TX) is connected to pin 4 (Arduino's Software RX)
+// FPS (RX) is connected through a converter to pin 5 (Arduino's Software TX)
+FPS_GT511C3 fps(4, 5); // (Arduino SS_RX = pin 4, Arduino SS_TX = pin 5)
+
+Link_Watchdog watchdog(fps);
+
+void LinkChanged(Link_Watchdog::States::States_Enum from, Link_Watchdog::States::States_Enum to)
+{
+	if (to == Link_Watchdog::States::Down)
+	{
+		Serial.println("Scanner lost, reconnecting");
+	}
+	else
+	{
+		Serial.print("Scanner back after ");
+		Serial.print(watchdog.LastRecoveryMillis);
+		Serial.print(" ms (average ");
+		Serial.print(watchdog.MeanRecoveryMillis());
+		Serial.println(" ms)");
+	}
+}
+
+void setup()
+{
+	Serial.begin(9600); //set up Arduino's hardware serial UART
+	delay(100);
+	fps.Open();         //send serial command to initialize fps
+	fps.SetLED(true);   //turn on LED so fps can see fingerprint
+	watchdog.StateChanged = LinkChanged;
+	if (watchdog.Begin() == false) Serial.println("Scanner not answering yet");
+}
+
+void loop()
+{
+	// only talk to the fps while the link is up
+	if (watchdog.Poll())
+	{
+		if (fps.IsPressFinger())
+		{
+			fps.CaptureFinger(false);
+			int id = fps.Identify1_N();
+			//Change to "if (id <3000)", if using GT-521F52
+			//Leave "if (id <200)", if using GT-521F32/GT-511C3
+			if (id <200)
+			{
+				Serial.print("Verified ID:");
+				Serial.println(id);
+			}
+			else
+			{
+				Serial.println("Finger not found");
+			}
+		}
+	}
+	delay(100);
+}
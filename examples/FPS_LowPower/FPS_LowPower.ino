@@ -0,0 +1,73 @@
+/*****************************************************************
+	FPS_LowPower.ino - Library example for controlling the GT-511C3 Finger Print Scanner (FPS)
+	Licensed for non-commercial use, must include this license message
+	basically, Feel free to hack away at it, but just give me credit for my work =)
+	TLDR; Wil Wheaton's Law
+
+	Description: This sketch identifies fingerprints like FPS_IDFinger, but keeps
+	the scanner's LED off while nobody is using it, for battery powered projects.
+	Power_Manager switches the LED on briefly twice a second to look for a finger
+	(or not at all if the scanner's touch output is wired to TOUCH_PIN), and the
+	sketch reports how long it took to wake and identify, plus the LED duty cycle.
+
+	This code should work with the any model of ADH-Tech's FPS as long as
+	you are within the minimum logic level threshold for the FPS serial UART.
+	This code has been tested with these models:
+
+              GT-521F52 [ https://www.sparkfun.com/products/14585 ]
+              GT-521F32 [ https://www.sparkfun.com/products/14518 ]
+              GT-511C3  [ https://www.sparkfun.com/products/11792 ]
+              GT-511C1R [ https://www.sparkfun.com/products/13007 ]
+
+	See the FPS_Enroll example for the hardware hookup with a 5V Arduino.
+*****************************************************************/
+
+#include "FPS_GT511C3.h"
+#include "SoftwareSerial.h"
+
+// set up software serial pins for Arduino's w/ Atmega328P's
+// FPS (TX) is connected to pin 4 (Arduino's Software RX)
+// FPS (RX) is connected through a converter to pin 5 (Arduino's Software TX)
+FPS_GT511C3 fps(4, 5); // (Arduino SS_RX = pin 4, Arduino SS_TX = pin 5)
+
+// GT-521Fxx touch output (through a level converter), -1 if not connected
+const int TOUCH_PIN = -1;
+
+Power_Manager power(fps);
+
+void setup()
+{
+	Serial.begin(9600); //set up Arduino's hardware serial UART
+	delay(100);
+	fps.Open();         //send serial command to initialize fps
+	power.TouchPin = TOUCH_PIN;
+	power.CheckInterval = 500;
+	power.Begin();      //LED stays off until a finger shows up
+}
+
+void loop()
+{
+	unsigned long started = millis();
+	if (power.Poll())
+	{
+		fps.CaptureFinger(false);
+		int id = fps.Identify1_N();
+		if (id <200) //<- change id value depending model you are using
+		{//if the fingerprint matches, provide the matching template ID
+			Serial.print("Verified ID:");
+			Serial.println(id);
+		}
+		else
+		{//if unable to recognize
+			Serial.println("Finger not found");
+		}
+		Serial.print("Wake ");
+		Serial.print(power.LastWakeMillis);
+		Serial.print(" ms, identify ");
+		Serial.print(millis() - started);
+		Serial.print(" ms, LED duty ");
+		Serial.print(power.DutyCycle());
+		Serial.println("%");
+		while (fps.IsPressFinger()) delay(100);
+	}
+}
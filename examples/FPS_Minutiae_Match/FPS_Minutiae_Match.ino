@@ -0,0 +1,131 @@
+/*****************************************************************
+	FPS_Minutiae_Match.ino - Library example for controlling the GT-511C3 Finger Print Scanner (FPS)
+	Licensed for non-commercial use, must include this license message
+	basically, Feel free to hack away at it, but just give me credit for my work =)
+	TLDR; Wil Wheaton's Law
+
+	Description: This sketch matches fingers on the arduino instead of the fps.
+	The captured image is turned into a Minutiae_Set while GetImage() downloads
+	it, and Minutiae_Matcher compares that against a small gallery kept in ram,
+	so the gallery is not limited by the fps database.
+	At startup it times the matcher on a synthetic gallery and prints how long a
+	scan of 100000 prints would take on this board.
+	Press a finger to add it to the gallery, or to identify it once the gallery
+	is full.
+
+	The image is 52116 bytes, so use the fastest baud rate your wiring allows:
+	about 4.5 seconds at 115200 baud, but close to a minute at 9600.
+
+	This code should work with the any model of ADH-Tech's FPS as long as
+	you are within the minimum logic level threshold for the FPS serial UART.
+	This code has been tested with these models:
+
+              GT-521F52 [ https://www.sparkfun.com/products/14585 ]
+              GT-521F32 [ https://www.sparkfun.com/products/14518 ]
+              GT-511C3  [ https://www.sparkfun.com/products/11792 ]
+              GT-511C1R [ https://www.sparkfun.com/products/13007 ]
+
+	See the FPS_Enroll example for the hardware hookup with a 5V Arduino.
+*****************************************************************/
+
+#include "FPS_GT511C3.h"
+#include "SoftwareSerial.h"
+
+// set up software serial pins for Arduino's w/ Atmega328P's
+// FPS (TX) is connected to pin 4 (Arduino's Software RX)
+// FPS (RX) is connected through a converter to pin 5 (Arduino's Software TX)
+FPS_GT511C3 fps(4, 5); // (Arduino SS_RX = pin 4, Arduino SS_TX = pin 5)
+
+// each set takes 121 bytes of ram, raise this on boards with more
+const int GALLERY_SIZE = 4;
+
+Minutiae_Set gallery[GALLERY_SIZE];
+int enrolled = 0;
+Minutiae_Set probe;
+Minutiae_Matcher matcher;
+
+void setup()
+{
+	Serial.begin(9600); //set up Arduino's hardware serial UART
+	delay(100);
+	Benchmark();
+	fps.Open();         //send serial command to initialize fps
+	//fps.ChangeBaudRate(115200); //uncomment to speed up the image download if your wiring allows
+	fps.SetLED(true);   //turn on LED so fps can see fingerprint
+}
+
+// Fills a set with random minutiae
+void MakeSynthetic(Minutiae_Set& set)
+{
+	set.Clear();
+	while (set.Count < Minutiae_Set::MAX_MINUTIAE) set.Add(random(129), random(101), random(16), 1);
+}
+
+// Times the matcher against synthetic sets of the largest size
+void Benchmark()
+{
+	const int ROUNDS = 20;
+	MakeSynthetic(probe);
+	unsigned long elapsed = 0;
+	for (int i = 0; i < ROUNDS; i++)
+	{
+		MakeSynthetic(gallery[0]);
+		unsigned long started = micros();
+		matcher.Score(probe, gallery[0]);
+		elapsed += micros() - started;
+	}
+	unsigned long each = elapsed / ROUNDS;
+	Serial.print("Score: ");
+	Serial.print(each);
+	Serial.println(" us per comparison");
+	// each us x 100000 / 1000000 s, in float since each * 100000 overflows from 42950 us on
+	Serial.print("100000 prints: ");
+	Serial.print(each / 10.0, 1);
+	Serial.println(" s");
+}
+
+void loop()
+{
+	if (fps.IsPressFinger())
+	{
+		Serial.println("Reading finger, please wait");
+		if (matcher.Capture(fps, probe, true) == false)
+		{
+			Serial.println("Not enough detail, please try again");
+		}
+		else if (enrolled < GALLERY_SIZE)
+		{
+			gallery[enrolled] = probe;
+			Serial.print("Added #");
+			Serial.print(enrolled);
+			Serial.print(" with ");
+			Serial.print(probe.Count);
+			Serial.println(" minutiae");
+			enrolled++;
+		}
+		else
+		{
+			int found = matcher.Identify(probe, gallery, enrolled);
+			if (found >= 0)
+			{
+				Serial.print("Verified #");
+				Serial.println(found);
+			}
+			else Serial.println("Finger not found");
+			Serial.print("Score ");
+			Serial.print(matcher.LastScore);
+			Serial.print(", capture ");
+			Serial.print(matcher.CaptureMillis);
+			Serial.print(" ms, match ");
+			Serial.print(matcher.MatchMillis);
+			Serial.println(" ms");
+		}
+		Serial.println("Remove finger");
+		while (fps.IsPressFinger()) delay(100);
+	}
+	else
+	{
+		Serial.println("Please press finger");
+	}
+	delay(100);
+}
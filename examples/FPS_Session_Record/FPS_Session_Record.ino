@@ -0,0 +1,83 @@
+/*****************************************************************
+	FPS_Session_Record.ino - Library example for controlling the GT-511C3 Finger Print Scanner (FPS)
+	Licensed for non-commercial use, must include this license message
+	basically, Feel free to hack away at it, but just give me credit for my work =)
+	TLDR; Wil Wheaton's Law
+
+	Description: This sketch records everything sent to and received from the
+	fps onto an SD card (SESSION.FPR) while it identifies fingers, so the
+	session can be replayed later without the scanner (FPS_Session_Replay),
+	or its command timings compared on a computer:
+	  python3 extras/session_stats.py SESSION.FPR [OTHER.FPR]
+	Send any character over Serial to close the file before removing the card.
+
+	This code should work with the any model of ADH-Tech's FPS as long as
+	you are within the minimum logic level threshold for the FPS serial UART.
+	This code has been tested with these models:
+
+              GT-521F52 [ https://www.sparkfun.com/products/14585 ]
+              GT-521F32 [ https://www.sparkfun.com/products/14518 ]
+              GT-511C3  [ https://www.sparkfun.com/products/11792 ]
+              GT-511C1R [ https://www.sparkfun.com/products/13007 ]
+
+	See the FPS_Enroll example for the hardware hookup with a 5V Arduino.
+*****************************************************************/
+
+#include "FPS_GT511C3.h"
+#include "SoftwareSerial.h"
+#include <SD.h>
+
+// set up software serial pins for Arduino's w/ Atmega328P's
+// FPS (TX) is connected to pin 4 (Arduino's Software RX)
+// FPS (RX) is connected through a converter to pin 5 (Arduino's Software TX)
+FPS_GT511C3 fps(4, 5); // (Arduino SS_RX = pin 4, Arduino SS_TX = pin 5)
+
+const int SD_CHIP_SELECT = 10;
+File file;
+Session_Recorder* recorder = NULL;
+
+void setup()
+{
+	Serial.begin(9600); //set up Arduino's hardware serial UART
+	delay(100);
+	if (SD.begin(SD_CHIP_SELECT) == false) Serial.println("SD card failed");
+	SD.remove("SESSION.FPR");
+	file = SD.open("SESSION.FPR", FILE_WRITE);
+	recorder = new Session_Recorder(file);
+	recorder->Begin();
+	fps.Recorder = recorder;
+	fps.Open();         //send serial command to initialize fps
+	fps.SetLED(true);   //turn on LED so fps can see fingerprint
+}
+
+void loop()
+{
+	if (Serial.available() && (fps.Recorder != NULL))
+	{
+		fps.Recorder = NULL;
+		file.close();
+		Serial.print("Recorded ");
+		Serial.print(recorder->Frames);
+		Serial.print(" frames, ");
+		Serial.print(recorder->Bytes);
+		Serial.println(" bytes");
+	}
+
+	if (fps.IsPressFinger())
+	{
+		fps.CaptureFinger(false);
+		int id = fps.Identify1_N();
+		//Change to "if (id <3000)", if using GT-521F52
+		//Leave "if (id <200)", if using GT-521F32/GT-511C3
+		if (id <200)
+		{
+			Serial.print("Verified ID:");
+			Serial.println(id);
+		}
+		else
+		{
+			Serial.println("Finger not found");
+		}
+	}
+	delay(100);
+}
@@ -0,0 +1,71 @@
+/*****************************************************************
+	FPS_Session_Replay.ino - Library example for controlling the GT-511C3 Finger Print Scanner (FPS)
+	Licensed for non-commercial use, must include this license message
+	basically, Feel free to hack away at it, but just give me credit for my work =)
+	TLDR; Wil Wheaton's Law
+
+	Description: This sketch pretends to be the fps. It plays back a session
+	recorded by FPS_Session_Record (SESSION.FPR on the SD card) to a second
+	board running the sketch under test, with the recorded timing, so field
+	problems can be reproduced on the bench without the scanner.
+	Record on the second board too, and compare the two recordings with
+	  python3 extras/session_stats.py SESSION.FPR NEW.FPR
+	to see whether a new library version changed any command timings.
+
+	Needs a board with a second hardware serial port (Serial1, e.g. a Mega).
+	Serial1 TX goes to the tested board's fps RX pin (4), Serial1 RX to its
+	fps TX pin (5), and the grounds are connected. Reset the tested board after
+	this one starts, so its Open() is the first thing the recording expects.
+
+	This code should work with the any model of ADH-Tech's FPS as long as
+	you are within the minimum logic level threshold for the FPS serial UART.
+	This code has been tested with these models:
+
+              GT-521F52 [ https://www.sparkfun.com/products/14585 ]
+              GT-521F32 [ https://www.sparkfun.com/products/14518 ]
+              GT-511C3  [ https://www.sparkfun.com/products/11792 ]
+              GT-511C1R [ https://www.sparkfun.com/products/13007 ]
+*****************************************************************/
+
+#include "FPS_GT511C3.h"
+#include <SD.h>
+
+const int SD_CHIP_SELECT = 53;
+// percent of the recorded delays, 100 = as recorded, 0 = as fast as possible
+const int SPEED = 100;
+
+void setup()
+{
+	Serial.begin(9600); //set up Arduino's hardware serial UART
+	Serial1.begin(9600); //the baud rate the session was recorded at
+	delay(100);
+	if (SD.begin(SD_CHIP_SELECT) == false)
+	{
+		Serial.println("SD card failed");
+		return;
+	}
+	File file = SD.open("SESSION.FPR");
+	Session_Player player(file, Serial1);
+	player.Speed = SPEED;
+	if (player.Begin() == false)
+	{
+		Serial.println("SESSION.FPR is not a recording");
+		return;
+	}
+	Serial.println("Replaying");
+	unsigned long started = millis();
+	while (player.Step());
+	file.close();
+
+	Serial.print(player.Frames);
+	Serial.print(" frames in ");
+	Serial.print(millis() - started);
+	Serial.print(" ms, ");
+	Serial.print(player.Mismatches);
+	Serial.println(" bytes differed from the recording");
+	if (player.TimedOut) Serial.println("Stopped waiting for the tested board");
+}
+
+void loop()
+{
+}
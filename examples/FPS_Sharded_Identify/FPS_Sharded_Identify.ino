@@ -0,0 +1,91 @@
+/*****************************************************************
+	FPS_Sharded_Identify.ino - Library example for controlling the GT-511C3 Finger Print Scanner (FPS)
+	Licensed for non-commercial use, must include this license message
+	basically, Feel free to hack away at it, but just give me credit for my work =)
+	TLDR; Wil Wheaton's Law
+
+	Description: This sketch identifies fingerprints across more people than one
+	scanner can hold, by splitting the database over several scanners (shards).
+	The finger is captured once on the first scanner, turned into a template with
+	MakeTemplate(), and that template is searched on each shard with
+	IdentifyTemplate1_N(). IDs are global: shard number * SHARD_CAPACITY + slot.
+
+	Use FPS_Template_Export to make a store from the existing scanners and
+	Shard_Set::Import to load a global store into the shards.
+
+	This code should work with the any model of ADH-Tech's FPS as long as
+	you are within the minimum logic level threshold for the FPS serial UART.
+	This code has been tested with these models:
+
+              GT-521F52 [ https://www.sparkfun.com/products/14585 ]
+              GT-521F32 [ https://www.sparkfun.com/products/14518 ]
+              GT-511C3  [ https://www.sparkfun.com/products/11792 ]
+              GT-511C1R [ https://www.sparkfun.com/products/13007 ]
+
+	See the FPS_Enroll example for the hardware hookup with a 5V Arduino,
+	each extra scanner needs its own pair of pins.
+*****************************************************************/
+
+#include "FPS_GT511C3.h"
+#include "SoftwareSerial.h"
+
+// the first scanner is the one people press their finger on
+FPS_GT511C3 fps1(4, 5); // (Arduino SS_RX = pin 4, Arduino SS_TX = pin 5)
+FPS_GT511C3 fps2(6, 7); // (Arduino SS_RX = pin 6, Arduino SS_TX = pin 7)
+
+FPS_GT511C3* shards[] = { &fps1, &fps2 };
+
+// GT-521F52 holds 3000 templates, GT-521F32/GT-511C3 hold 200
+const int SHARD_CAPACITY = 200; //<- change depending on model you are using
+
+Shard_Set shardset(shards, sizeof(shards) / sizeof(shards[0]), SHARD_CAPACITY);
+byte tmplt[FPS_GT511C3::TEMPLATE_SIZE];
+
+void setup()
+{
+	Serial.begin(9600); //set up Arduino's hardware serial UART
+	delay(100);
+	fps1.Open();        //send serial command to initialize each fps
+	fps2.Open();
+	fps1.SetLED(true);  //turn on LED so fps can see fingerprint
+}
+
+void loop()
+{
+	if (fps1.IsPressFinger())
+	{
+		long id = shardset.Identify(tmplt);
+		if (id >= 0)
+		{
+			Serial.print("Verified ID:");
+			Serial.print(id);
+			Serial.print(" (shard ");
+			Serial.print(shardset.LastShard);
+			Serial.println(")");
+		}
+		else if (id == -2)
+		{
+			Serial.println("Capture failed, try again");
+		}
+		else
+		{
+			Serial.println("Finger not found");
+		}
+		if (shardset.FailedShards != 0)
+		{
+			Serial.print("Shards not answering (bit mask): ");
+			Serial.println(shardset.FailedShards, BIN);
+		}
+		Serial.print("Capture ");
+		Serial.print(shardset.CaptureMillis);
+		Serial.print(" ms, search ");
+		Serial.print(shardset.SearchMillis);
+		Serial.println(" ms");
+		while (fps1.IsPressFinger()) delay(100);
+	}
+	else
+	{
+		Serial.println("Please press finger");
+	}
+	delay(100);
+}
@@ -0,0 +1,56 @@
+/*****************************************************************
+	FPS_Template_Export.ino - Library example for controlling the GT-511C3 Finger Print Scanner (FPS)
+	Licensed for non-commercial use, must include this license message
+	basically, Feel free to hack away at it, but just give me credit for my work =)
+	TLDR; Wil Wheaton's Law
+
+	Description: This sketch downloads every template from the scanner with
+	GetTemplate() and writes them out of the hardware serial port as a template
+	store file (see Template_Store in FPS_GT511C3.h). Capture the binary output on
+	the computer to back up the database, then load it into another scanner with
+	the FPS_Template_Provision example.
+
+	Nothing but the store file is printed, so the output can be saved as-is.
+
+	This code should work with the any model of ADH-Tech's FPS as long as
+	you are within the minimum logic level threshold for the FPS serial UART.
+	This code has been tested with these models:
+
+              GT-521F52 [ https://www.sparkfun.com/products/14585 ]
+              GT-521F32 [ https://www.sparkfun.com/products/14518 ]
+              GT-511C3  [ https://www.sparkfun.com/products/11792 ]
+              GT-511C1R [ https://www.sparkfun.com/products/13007 ]
+
+	See the FPS_Enroll example for the hardware hookup with a 5V Arduino.
+*****************************************************************/
+
+#include "FPS_GT511C3.h"
+#include "SoftwareSerial.h"
+
+// set up software serial pins for Arduino's w/ Atmega328P's
+// FPS (TX) is connected to pin 4 (Arduino's Software RX)
+// FPS (RX) is connected through a converter to pin 5 (Arduino's Software TX)
+FPS_GT511C3 fps(4, 5); // (Arduino SS_RX = pin 4, Arduino SS_TX = pin 5)
+
+// change both depending on the model you are using
+// GT-521F52 holds 3000 templates, GT-521F32/GT-511C3 hold 200, GT-511C1R holds 20
+const Template_Store::Models::Models_Enum MODEL = Template_Store::Models::GT521F32;
+const int CAPACITY = 200;
+
+byte tmplt[FPS_GT511C3::TEMPLATE_SIZE];
+Template_Store store(Serial);
+
+void setup()
+{
+	Serial.begin(115200); //set up Arduino's hardware serial UART
+	delay(100);
+	fps.Open();         //send serial command to initialize fps
+
+	store.Export(fps, MODEL, CAPACITY, tmplt);
+	Serial.flush();
+}
+
+void loop()
+{
+	delay(100000);
+}
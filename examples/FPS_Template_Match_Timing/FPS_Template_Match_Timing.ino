@@ -0,0 +1,88 @@
+/*****************************************************************
+	FPS_Template_Match_Timing.ino - Library example for controlling the GT-511C3 Finger Print Scanner (FPS)
+	Licensed for non-commercial use, must include this license message
+	basically, Feel free to hack away at it, but just give me credit for my work =)
+	TLDR; Wil Wheaton's Law
+
+	Description: This sketch times two ways of matching the same finger several
+	times (for example against several databases, or to re-check it later):
+	  1) CaptureFinger() + Identify1_N() every time
+	  2) CaptureTemplate() once, then IdentifyTemplate1_N() with the template
+	Keep your finger on the sensor while it runs, the results are printed in ms.
+
+	This code should work with the any model of ADH-Tech's FPS as long as
+	you are within the minimum logic level threshold for the FPS serial UART.
+	This code has been tested with these models:
+
+              GT-521F52 [ https://www.sparkfun.com/products/14585 ]
+              GT-521F32 [ https://www.sparkfun.com/products/14518 ]
+              GT-511C3  [ https://www.sparkfun.com/products/11792 ]
+              GT-511C1R [ https://www.sparkfun.com/products/13007 ]
+
+	See the FPS_Enroll example for the hardware hookup with a 5V Arduino.
+*****************************************************************/
+
+#include "FPS_GT511C3.h"
+#include "SoftwareSerial.h"
+
+// set up software serial pins for Arduino's w/ Atmega328P's
+// FPS (TX) is connected to pin 4 (Arduino's Software RX)
+// FPS (RX) is connected through a converter to pin 5 (Arduino's Software TX)
+FPS_GT511C3 fps(4, 5); // (Arduino SS_RX = pin 4, Arduino SS_TX = pin 5)
+
+// how many matches each way
+const int ROUNDS = 5;
+
+byte tmplt[FPS_GT511C3::TEMPLATE_SIZE];
+
+void setup()
+{
+	Serial.begin(9600); //set up Arduino's hardware serial UART
+	delay(100);
+	fps.Open();         //send serial command to initialize fps
+	fps.SetLED(true);   //turn on LED so fps can see fingerprint
+}
+
+void loop()
+{
+	Serial.println("Press and hold finger");
+	while (fps.IsPressFinger() == false) delay(100);
+
+	unsigned long started = millis();
+	for (int i = 0; i < ROUNDS; i++)
+	{
+		fps.CaptureFinger(false);
+		fps.Identify1_N();
+	}
+	unsigned long captureeach = millis() - started;
+
+	started = millis();
+	unsigned long capture = 0;
+	if (fps.CaptureTemplate(tmplt, false))
+	{
+		capture = millis() - started;
+		for (int i = 0; i < ROUNDS; i++) fps.IdentifyTemplate1_N(tmplt);
+	}
+	else
+	{
+		Serial.println("Could not make a template, try again");
+		return;
+	}
+	unsigned long captureonce = millis() - started;
+
+	Serial.print("Capture + Identify1_N x");
+	Serial.print(ROUNDS);
+	Serial.print(": ");
+	Serial.print(captureeach);
+	Serial.println(" ms");
+	Serial.print("CaptureTemplate once (");
+	Serial.print(capture);
+	Serial.print(" ms) + IdentifyTemplate1_N x");
+	Serial.print(ROUNDS);
+	Serial.print(": ");
+	Serial.print(captureonce);
+	Serial.println(" ms");
+
+	Serial.println("Remove finger");
+	while (fps.IsPressFinger()) delay(100);
+}
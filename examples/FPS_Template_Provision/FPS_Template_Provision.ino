@@ -0,0 +1,165 @@
+/*****************************************************************
+	FPS_Template_Provision.ino - Library example for controlling the GT-511C3 Finger Print Scanner (FPS)
+	Licensed for non-commercial use, must include this license message
+	basically, Feel free to hack away at it, but just give me credit for my work =)
+	TLDR; Wil Wheaton's Law
+
+	Description: This sketch loads a template database from a computer into the
+	scanner without anyone having to enroll again. The computer streams a template
+	store file (see Template_Store in FPS_GT511C3.h, FPS_Template_Export makes one)
+	over the Arduino's hardware serial port, and each template is uploaded into
+	its slot with SetTemplate().
+
+	Protocol (hardware serial, 115200 baud):
+	  Arduino -> computer  "HEADER"         send the 512 byte store header now
+	  Arduino -> computer  "SKIP <slot>"    slot is already enrolled, its record is not needed
+	  Arduino -> computer  "READY <slot>"   send the 512 byte record of that slot now
+	                                        (at offset 512 + slot * 512 in the file)
+	  Arduino -> computer  "OK <slot> <done>/<total> <templates/s>", "EMPTY <slot>"
+	                    or "DUP <slot> <duplicated id>" / "ERR <slot> <code>"
+	  Arduino -> computer  "DONE <done>/<total> <templates/s>"
+
+	If the transfer is interrupted, just reset the Arduino and run the sender again:
+	every slot is checked with CheckEnrolled() and the ones that are already enrolled
+	are skipped, so only the slots that are missing (wherever they are) are uploaded.
+
+	This code should work with the any model of ADH-Tech's FPS as long as
+	you are within the minimum logic level threshold for the FPS serial UART.
+	This code has been tested with these models:
+
+              GT-521F52 [ https://www.sparkfun.com/products/14585 ]
+              GT-521F32 [ https://www.sparkfun.com/products/14518 ]
+              GT-511C3  [ https://www.sparkfun.com/products/11792 ]
+              GT-511C1R [ https://www.sparkfun.com/products/13007 ]
+
+	See the FPS_Enroll example for the hardware hookup with a 5V Arduino.
+*****************************************************************/
+
+#include "FPS_GT511C3.h"
+#include "SoftwareSerial.h"
+
+// set up software serial pins for Arduino's w/ Atmega328P's
+// FPS (TX) is connected to pin 4 (Arduino's Software RX)
+// FPS (RX) is connected through a converter to pin 5 (Arduino's Software TX)
+FPS_GT511C3 fps(4, 5); // (Arduino SS_RX = pin 4, Arduino SS_TX = pin 5)
+
+// slot range to fill, clipped to the capacity in the store header
+// GT-521F52 holds 3000 templates (0-2999)
+// GT-521F32/GT-511C3 hold 200 templates (0-199)
+const int FIRST_SLOT = 0;
+int LAST_SLOT = 199; //<- change depending on model you are using
+
+// set to true to have the fps reject templates it already knows under another ID
+const bool DUPLICATE_CHECK = false;
+
+byte tmplt[FPS_GT511C3::TEMPLATE_SIZE];
+Template_Store store(Serial);
+
+void setup()
+{
+	Serial.begin(115200); //set up Arduino's hardware serial UART
+	Serial.setTimeout(10000);
+	delay(100);
+	fps.Open();         //send serial command to initialize fps
+
+	Provision();
+}
+
+void PrintRate(int done, unsigned long started)
+{
+	unsigned long elapsed = millis() - started;
+	Serial.print(done);
+	Serial.print("/");
+	Serial.print(LAST_SLOT - FIRST_SLOT + 1);
+	Serial.print(" ");
+	if (elapsed > 0) Serial.println((done * 1000.0) / elapsed); else Serial.println(0);
+}
+
+void Provision()
+{
+	Serial.println("HEADER");
+	if (store.ReadHeader() == false)
+	{
+		Serial.println("ERR header");
+		return;
+	}
+	if (LAST_SLOT >= store.Capacity) LAST_SLOT = store.Capacity - 1;
+
+	int done = 0;
+	unsigned long started = millis();
+	for (int slot = FIRST_SLOT; slot <= LAST_SLOT; slot++)
+	{
+		// skip the slots that were confirmed before an interruption, one by one, so a
+		// slot that failed in the middle does not make everything after it upload again
+		if (fps.CheckEnrolled(slot))
+		{
+			Serial.print("SKIP ");
+			Serial.println(slot);
+			continue;
+		}
+		Serial.print("READY ");
+		Serial.println(slot);
+		int recordslot;
+		Template_Store::RecordResults::RecordResults_Enum result = store.ReadRecord(recordslot, tmplt);
+		if (result == Template_Store::RecordResults::TRUNCATED)
+		{
+			Serial.println("TIMEOUT");
+			break;
+		}
+		if (result == Template_Store::RecordResults::EMPTY)
+		{
+			Serial.print("EMPTY ");
+			Serial.println(slot);
+			continue;
+		}
+		if ((result == Template_Store::RecordResults::BAD_CHECKSUM) || (recordslot != slot))
+		{
+			Serial.print("ERR ");
+			Serial.print(slot);
+			Serial.println(" bad record");
+			continue;
+		}
+
+		// 3000 is uploaded ok on every model, below that the template duplicated that ID
+		int iret = fps.SetTemplate(tmplt, slot, DUPLICATE_CHECK);
+		if (fps.LastResult.ACK)
+		{
+			// only count the slot once the fps confirms it is stored
+			if (fps.CheckEnrolled(slot))
+			{
+				done++;
+				Serial.print("OK ");
+				Serial.print(slot);
+				Serial.print(" ");
+				PrintRate(done, started);
+			}
+			else
+			{
+				Serial.print("ERR ");
+				Serial.print(slot);
+				Serial.println(" not enrolled");
+			}
+		}
+		else if (iret < 3000)
+		{
+			Serial.print("DUP ");
+			Serial.print(slot);
+			Serial.print(" ");
+			Serial.println(iret);
+		}
+		else
+		{
+			Serial.print("ERR ");
+			Serial.print(slot);
+			Serial.print(" ");
+			Serial.println(iret);
+		}
+	}
+	Serial.print("DONE ");
+	PrintRate(done, started);
+}
+
+void loop()
+{
+	delay(100000);
+}
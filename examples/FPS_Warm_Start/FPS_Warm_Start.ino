@@ -0,0 +1,96 @@
+/*****************************************************************
+	FPS_Warm_Start.ino - Library example for controlling the GT-511C3 Finger Print Scanner (FPS)
+	Licensed for non-commercial use, must include this license message
+	basically, Feel free to hack away at it, but just give me credit for my work =)
+	TLDR; Wil Wheaton's Law
+
+	Description: This sketch keeps a Warm_Start snapshot (baud rate, device info and
+	which IDs are enrolled) in EEPROM, so after a reset the scanner is ready after an
+	Open and a GetEnrollCount instead of a baud rate probe and a CheckEnrolled for
+	every ID. It prints how long startup took and whether the snapshot was used.
+	Send 'c' over the serial monitor to time a cold start (full scan) for comparison.
+	Enrollments and deletes made through fps are tracked by the snapshot, which is
+	saved again whenever it changed.
+
+	This code should work with the any model of ADH-Tech's FPS as long as
+	you are within the minimum logic level threshold for the FPS serial UART.
+	This code has been tested with these models:
+
+              GT-521F52 [ https://www.sparkfun.com/products/14585 ]
+              GT-521F32 [ https://www.sparkfun.com/products/14518 ]
+              GT-511C3  [ https://www.sparkfun.com/products/11792 ]
+              GT-511C1R [ https://www.sparkfun.com/products/13007 ]
+
+	See the FPS_Enroll example for the hardware hookup with a 5V Arduino.
+*****************************************************************/
+
+#include "FPS_GT511C3.h"
+#include "SoftwareSerial.h"
+
+// set up software serial pins for Arduino's w/ Atmega328P's
+// FPS (TX) is connected to pin 4 (Arduino's Software RX)
+// FPS (RX) is connected through a converter to pin 5 (Arduino's Software TX)
+FPS_GT511C3 fps(4, 5); // (Arduino SS_RX = pin 4, Arduino SS_TX = pin 5)
+
+//Change to "CAPACITY = 3000", if using GT-521F52 (the snapshot then takes 417 bytes of EEPROM)
+//Leave "CAPACITY = 200", if using GT-521F32/GT-511C3 (67 bytes of EEPROM)
+const int CAPACITY = 200;
+const int SNAPSHOT_ADDRESS = 0;
+
+byte bitmap[(CAPACITY + 7) / 8];
+Warm_Start snapshot(bitmap, CAPACITY);
+
+void setup()
+{
+	Serial.begin(9600); //set up Arduino's hardware serial UART
+	delay(100);
+	fps.ResponseTimeout = 2000;
+	snapshot.BaudRate = 38400;
+	bool loaded = snapshot.LoadEEPROM(SNAPSHOT_ADDRESS);
+	if (snapshot.Start(fps, loaded)) PrintStart();
+	else Serial.println("The scanner did not answer, check the wiring");
+	fps.Snapshot = &snapshot;
+	fps.SetLED(true);   //turn on LED so fps can see fingerprint
+}
+
+void loop()
+{
+	if (Serial.read() == 'c')
+	{
+		fps.SetLED(false);
+		if (snapshot.Start(fps, false)) PrintStart();
+		fps.SetLED(true);
+	}
+	// saves what changed (a few bytes) after an enrollment or a delete
+	if (snapshot.Changed()) snapshot.SaveEEPROM(SNAPSHOT_ADDRESS);
+
+	if (fps.IsPressFinger())
+	{
+		fps.CaptureFinger(false);
+		int id = fps.Identify1_N();
+//Change to "id < 3000", if using GT-521F52
+//Leave "id < 200", if using GT-521F32/GT-511C3
+		if (id <200)
+		{
+			Serial.print("Verified ID:");
+			Serial.println(id);
+		}
+		else
+		{
+			Serial.println("Finger not found");
+		}
+	}
+	delay(100);
+}
+
+// Prints how the last start went
+void PrintStart()
+{
+	Serial.print(snapshot.Warm ? "Warm start: " : "Cold start: ");
+	Serial.print(snapshot.StartMillis);
+	Serial.print(" ms, ");
+	Serial.print(snapshot.Count());
+	Serial.print(" enrolled, ");
+	Serial.print(snapshot.BaudRate);
+	Serial.println(" baud");
+}
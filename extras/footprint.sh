@@ -0,0 +1,39 @@
+#!/bin/sh
+#	footprint.sh - prints the flash/ram footprint (.text/.data/.bss) of every example sketch
+#	so size regressions in the library show up before they reach a board
+#
+#	Needs arduino-cli with the core for the board installed, for example:
+#	  arduino-cli core install arduino:avr
+#
+#	Usage: extras/footprint.sh [fqbn] [extra compiler flags...]
+#	  extras/footprint.sh                                   (Uno, default debug level)
+#	  extras/footprint.sh arduino:avr:uno -DFPS_DEBUG=0     (Uno, debug output compiled out)
+#	  extras/footprint.sh arduino:avr:mega -DFPS_DEBUG=0 -DFPS_RX_RING_SIZE=64
+
+FQBN=${1:-arduino:avr:uno}
+[ $# -gt 0 ] && shift
+FLAGS="$*"
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+BUILD=$(mktemp -d)
+trap 'rm -rf "$BUILD"' EXIT
+
+# avr-size ships with the avr-gcc toolchain that arduino-cli installs
+SIZE=$(command -v avr-size || find "$HOME/.arduino15/packages" -name avr-size -type f 2>/dev/null | head -n 1)
+if [ -z "$SIZE" ]; then
+	echo "avr-size not found, install the arduino:avr core" >&2
+	exit 1
+fi
+
+printf '%-32s %8s %8s %8s\n' "sketch" ".text" ".data" ".bss"
+for dir in "$ROOT"/examples/*/; do
+	name=$(basename "$dir")
+	out="$BUILD/$name"
+	if arduino-cli compile --fqbn "$FQBN" --library "$ROOT" \
+		--build-property "compiler.cpp.extra_flags=$FLAGS" \
+		--output-dir "$out" "$dir" > "$out.log" 2>&1; then
+		"$SIZE" "$out/$name.ino.elf" | awk -v n="$name" 'NR == 2 { printf "%-32s %8s %8s %8s\n", n, $1, $2, $3 }'
+	else
+		printf '%-32s %8s\n' "$name" "FAILED (see arduino-cli output)"
+		sed 's/^/    /' "$out.log" | tail -n 5
+	fi
+done
@@ -0,0 +1,116 @@
+/*
+	Arduino.h - the part of the Arduino core the library uses, for the host tests in extras/host
+	Time is virtual: it only moves when the code waits (delay), talks on a serial port, or
+	reads the clock, so a simulated hour runs in seconds and every run gives the same result.
+*/
+
+#ifndef HOST_ARDUINO_h
+#define HOST_ARDUINO_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+typedef uint8_t byte;
+typedef uint16_t word;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define FALLING 2
+#define RISING 3
+#define CHANGE 1
+#define LED_BUILTIN 13
+#define DEC 10
+#define HEX 16
+#define BIN 2
+
+// strings and tables stay where they are, there is only one address space
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define pgm_read_word(p) (*(const uint16_t*)(p))
+#define pgm_read_dword(p) (*(const uint32_t*)(p))
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+
+// the virtual clock, in microseconds since the start of the test
+extern unsigned long long host_micros;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// host_pins holds what digitalRead returns for each pin
+extern int host_pins[64];
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+#define digitalPinToInterrupt(p) (p)
+void attachInterrupt(uint8_t interrupt, void (*handler)(), int mode);
+void noInterrupts();
+void interrupts();
+long random(long howbig);
+long random(long howsmall, long howbig);
+
+class Print
+{
+	public:
+		virtual ~Print() {}
+		virtual size_t write(uint8_t b) = 0;
+		virtual size_t write(const uint8_t* buffer, size_t size);
+		size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+		size_t print(const __FlashStringHelper* s);
+		size_t print(const char* s);
+		size_t print(char c);
+		size_t print(int n, int base = DEC);
+		size_t print(unsigned int n, int base = DEC);
+		size_t print(long n, int base = DEC);
+		size_t print(unsigned long n, int base = DEC);
+		size_t print(double n, int digits = 2);
+		size_t println();
+		template <typename T> size_t println(T value) { size_t n = print(value); return n + println(); }
+		template <typename T> size_t println(T value, int format) { size_t n = print(value, format); return n + println(); }
+		virtual void flush() {}
+};
+
+class Stream : public Print
+{
+	public:
+		Stream() : _timeout(1000) {}
+		virtual int available() = 0;
+		virtual int read() = 0;
+		virtual int peek() = 0;
+		void setTimeout(unsigned long timeout) { _timeout = timeout; }
+		size_t readBytes(uint8_t* buffer, size_t length);
+		size_t readBytes(char* buffer, size_t length) { return readBytes((uint8_t*)buffer, length); }
+		long parseInt();
+
+	protected:
+		unsigned long _timeout;
+		int timedRead();
+};
+
+// Serial goes to stdout when host_serial_echo is set, and is dropped otherwise
+extern bool host_serial_echo;
+class HardwareSerial : public Stream
+{
+	public:
+		void begin(unsigned long /*baud*/) {}
+		void end() {}
+		int available() { return 0; }
+		int read() { return -1; }
+		int peek() { return -1; }
+		size_t write(uint8_t b);
+		using Print::write;
+		operator bool() { return true; }
+};
+extern HardwareSerial Serial;
+
+#endif
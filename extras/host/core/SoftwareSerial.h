@@ -0,0 +1,84 @@
+/*
+	SoftwareSerial.h - a software serial port wired to a simulated device, for the host tests
+	Like the real one it has a 64 byte receive buffer that drops bytes when it is full (see
+	overflow), write blocks for the time the byte takes on the wire, and available() and read()
+	take 2 and 3 us. Bytes sent at a baud rate the other side is not listening at are lost.
+*/
+
+#ifndef HOST_SOFTWARE_SERIAL_h
+#define HOST_SOFTWARE_SERIAL_h
+
+#include "Arduino.h"
+#include <deque>
+
+/*
+	Host_Link is the device end of a SoftwareSerial, found by the pin the port receives on
+	A device derives from it, takes what the sketch sends in Receive and answers with Send.
+*/
+class Host_Link
+{
+	public:
+		// Parameter: the SoftwareSerial rx pin the device's tx is wired to
+		Host_Link(uint8_t pin);
+		virtual ~Host_Link();
+
+		unsigned long Baud;				// the rate the device talks at (default 9600)
+		bool Connected;					// false while the device is unplugged or powered off (default true)
+
+		// Sends bytes to the sketch, back to back after anything still going out
+		// Parameter: us to wait before the first byte (counted from now)
+		void Send(const uint8_t* bytes, int length, unsigned long delaymicros);
+
+		// Called with each byte the sketch sent, when its stop bit is done
+		virtual void Receive(uint8_t b) = 0;
+
+		// Called before the port is used, so the device can act on the time (outages...)
+		virtual void Update() {}
+
+		// Returns: us one byte takes on the wire (start + 8 data + stop bits)
+		static unsigned long ByteMicros(unsigned long baud) { return 10000000UL / baud; }
+
+		static Host_Link* Find(uint8_t pin);
+
+		struct Byte
+		{
+			unsigned long long Arrives;		// when the stop bit is done
+			unsigned long Baud;
+			uint8_t Value;
+		};
+		std::deque<Byte> Outgoing;
+
+	private:
+		uint8_t _pin;
+};
+
+class SoftwareSerial : public Stream
+{
+	public:
+		SoftwareSerial(uint8_t rx, uint8_t tx);
+		~SoftwareSerial() {}
+		void begin(long baud);
+		void end();
+		bool listen() { return true; }
+		bool isListening() { return true; }
+		// Returns: True if a byte was dropped since the last call (and clears it)
+		bool overflow();
+		int available();
+		int read();
+		int peek();
+		size_t write(uint8_t b);
+		using Print::write;
+
+		static const int BUFFER_SIZE = 64;
+
+	private:
+		uint8_t _rx;
+		unsigned long _baud;
+		bool _overflow;
+		uint8_t _buffer[BUFFER_SIZE];
+		int _head;
+		int _count;
+		void Receive();
+};
+
+#endif
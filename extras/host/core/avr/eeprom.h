@@ -0,0 +1,25 @@
+/*
+	avr/eeprom.h - 4 KB of simulated EEPROM for the host tests
+	A byte write keeps the EEPROM busy for 3.3 ms, like on the ATmega. host_eeprom_power_cut
+	makes writes fail silently after that many more, to tear a write the way a power loss does.
+*/
+
+#ifndef HOST_AVR_EEPROM_h
+#define HOST_AVR_EEPROM_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define E2END 4095
+extern uint8_t host_eeprom[E2END + 1];
+extern unsigned long host_eeprom_writes;			// bytes actually written
+extern long host_eeprom_power_cut;					// writes left before power is lost, -1 for never
+
+bool eeprom_is_ready();
+uint8_t eeprom_read_byte(const uint8_t* address);
+void eeprom_write_byte(uint8_t* address, uint8_t value);
+void eeprom_update_byte(uint8_t* address, uint8_t value);
+void eeprom_read_block(void* destination, const void* source, size_t length);
+void eeprom_update_block(const void* source, void* destination, size_t length);
+
+#endif
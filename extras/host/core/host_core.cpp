@@ -0,0 +1,330 @@
+/*
+	host_core.cpp - the Arduino core for the host tests (see Arduino.h)
+*/
+
+#include "Arduino.h"
+#include "SoftwareSerial.h"
+#include "avr/eeprom.h"
+#include <stdio.h>
+
+// Time and pins
+unsigned long long host_micros = 0;
+
+// reading the clock takes a little time too, so a busy wait on it always ends
+unsigned long millis()
+{
+	host_micros += 1;
+	return (unsigned long)(host_micros / 1000);
+}
+
+unsigned long micros()
+{
+	host_micros += 1;
+	return (unsigned long)host_micros;
+}
+
+void delay(unsigned long ms)
+{
+	host_micros += (unsigned long long)ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+	host_micros += us;
+}
+
+int host_pins[64];
+
+void pinMode(uint8_t /*pin*/, uint8_t /*mode*/) {}
+void digitalWrite(uint8_t /*pin*/, uint8_t /*value*/) {}
+
+int digitalRead(uint8_t pin)
+{
+	return host_pins[pin & 63];
+}
+
+void attachInterrupt(uint8_t /*interrupt*/, void (* /*handler*/)(), int /*mode*/) {}
+void noInterrupts() {}
+void interrupts() {}
+
+long random(long howbig)
+{
+	return (howbig > 0) ? (rand() % howbig) : 0;
+}
+
+long random(long howsmall, long howbig)
+{
+	return (howbig > howsmall) ? howsmall + random(howbig - howsmall) : howsmall;
+}
+
+// Print / Stream / Serial
+size_t Print::write(const uint8_t* buffer, size_t size)
+{
+	size_t n = 0;
+	while (size-- > 0) n += write(*buffer++);
+	return n;
+}
+
+size_t Print::print(const __FlashStringHelper* s)
+{
+	return print(reinterpret_cast<const char*>(s));
+}
+
+size_t Print::print(const char* s)
+{
+	return write((const uint8_t*)s, strlen(s));
+}
+
+size_t Print::print(char c)
+{
+	return write((uint8_t)c);
+}
+
+size_t Print::print(int n, int base)
+{
+	return print((long)n, base);
+}
+
+size_t Print::print(unsigned int n, int base)
+{
+	return print((unsigned long)n, base);
+}
+
+size_t Print::print(long n, int base)
+{
+	if ((base == DEC) && (n < 0)) return print('-') + print((unsigned long)-n, base);
+	return print((unsigned long)n, base);
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+	char buffer[8 * sizeof(unsigned long) + 1];
+	char* p = buffer + sizeof(buffer) - 1;
+	*p = 0;
+	do
+	{
+		int digit = n % base;
+		*--p = (digit < 10) ? '0' + digit : 'A' + digit - 10;
+		n /= base;
+	} while (n > 0);
+	return print(p);
+}
+
+size_t Print::print(double n, int digits)
+{
+	char buffer[64];
+	snprintf(buffer, sizeof(buffer), "%.*f", digits, n);
+	return print(buffer);
+}
+
+size_t Print::println()
+{
+	return print("\r\n");
+}
+
+int Stream::timedRead()
+{
+	unsigned long started = millis();
+	do
+	{
+		int c = read();
+		if (c >= 0) return c;
+	} while (millis() - started < _timeout);
+	return -1;
+}
+
+size_t Stream::readBytes(uint8_t* buffer, size_t length)
+{
+	size_t count = 0;
+	while (count < length)
+	{
+		int c = timedRead();
+		if (c < 0) break;
+		buffer[count++] = (uint8_t)c;
+	}
+	return count;
+}
+
+long Stream::parseInt()
+{
+	int c;
+	while (((c = peek()) >= 0) && ((c < '0') || (c > '9')) && (c != '-')) read();
+	bool negative = (c == '-');
+	if (negative) read();
+	long value = 0;
+	while (((c = peek()) >= '0') && (c <= '9'))
+	{
+		value = value * 10 + (c - '0');
+		read();
+	}
+	return negative ? -value : value;
+}
+
+bool host_serial_echo = false;
+HardwareSerial Serial;
+
+size_t HardwareSerial::write(uint8_t b)
+{
+	if (host_serial_echo) putchar(b);
+	return 1;
+}
+
+// SoftwareSerial
+static Host_Link* host_links[64];
+
+Host_Link::Host_Link(uint8_t pin)
+{
+	_pin = pin & 63;
+	Baud = 9600;
+	Connected = true;
+	host_links[_pin] = this;
+}
+
+Host_Link::~Host_Link()
+{
+	if (host_links[_pin] == this) host_links[_pin] = NULL;
+}
+
+Host_Link* Host_Link::Find(uint8_t pin)
+{
+	return host_links[pin & 63];
+}
+
+void Host_Link::Send(const uint8_t* bytes, int length, unsigned long delaymicros)
+{
+	unsigned long long start = host_micros + delaymicros;
+	if (!Outgoing.empty() && (Outgoing.back().Arrives > start)) start = Outgoing.back().Arrives;
+	for (int i = 0; i < length; i++)
+	{
+		start += ByteMicros(Baud);
+		Byte b = { start, Baud, bytes[i] };
+		Outgoing.push_back(b);
+	}
+}
+
+SoftwareSerial::SoftwareSerial(uint8_t rx, uint8_t /*tx*/)
+{
+	_rx = rx;
+	_baud = 9600;
+	_overflow = false;
+	_head = 0;
+	_count = 0;
+}
+
+void SoftwareSerial::begin(long baud)
+{
+	Receive();
+	_baud = baud;
+}
+
+void SoftwareSerial::end()
+{
+	Receive();
+}
+
+bool SoftwareSerial::overflow()
+{
+	bool retval = _overflow;
+	_overflow = false;
+	return retval;
+}
+
+int SoftwareSerial::available()
+{
+	host_micros += 2;
+	Receive();
+	return _count;
+}
+
+int SoftwareSerial::read()
+{
+	host_micros += 3;
+	Receive();
+	if (_count == 0) return -1;
+	uint8_t b = _buffer[_head];
+	_head = (_head + 1) % BUFFER_SIZE;
+	_count--;
+	return b;
+}
+
+int SoftwareSerial::peek()
+{
+	Receive();
+	return (_count == 0) ? -1 : _buffer[_head];
+}
+
+size_t SoftwareSerial::write(uint8_t b)
+{
+	Receive();
+	host_micros += Host_Link::ByteMicros(_baud);
+	Host_Link* link = Host_Link::Find(_rx);
+	if (link == NULL) return 1;
+	link->Update();
+	if (link->Connected && (link->Baud == _baud)) link->Receive(b);
+	return 1;
+}
+
+// Takes what arrived until now into the buffer, as the pin change interrupt would have
+void SoftwareSerial::Receive()
+{
+	Host_Link* link = Host_Link::Find(_rx);
+	if (link == NULL) return;
+	link->Update();
+	while (!link->Outgoing.empty() && (link->Outgoing.front().Arrives <= host_micros))
+	{
+		Host_Link::Byte b = link->Outgoing.front();
+		link->Outgoing.pop_front();
+		// a wrong baud rate reads as framing errors, a dead device sends nothing
+		if ((b.Baud != _baud) || (link->Connected == false)) continue;
+		if (_count == BUFFER_SIZE)
+		{
+			_overflow = true;
+			continue;
+		}
+		_buffer[(_head + _count) % BUFFER_SIZE] = b.Value;
+		_count++;
+	}
+}
+
+// EEPROM
+uint8_t host_eeprom[E2END + 1];
+unsigned long host_eeprom_writes = 0;
+long host_eeprom_power_cut = -1;
+static unsigned long long host_eeprom_busy = 0;
+
+bool eeprom_is_ready()
+{
+	host_micros += 1;
+	return host_micros >= host_eeprom_busy;
+}
+
+uint8_t eeprom_read_byte(const uint8_t* address)
+{
+	return host_eeprom[(uintptr_t)address & E2END];
+}
+
+void eeprom_write_byte(uint8_t* address, uint8_t value)
+{
+	// the avr-libc routines wait for the previous write before starting the next
+	if (host_micros < host_eeprom_busy) host_micros = host_eeprom_busy;
+	host_eeprom_busy = host_micros + 3300;
+	if (host_eeprom_power_cut == 0) return;
+	if (host_eeprom_power_cut > 0) host_eeprom_power_cut--;
+	host_eeprom[(uintptr_t)address & E2END] = value;
+	host_eeprom_writes++;
+}
+
+void eeprom_update_byte(uint8_t* address, uint8_t value)
+{
+	if (eeprom_read_byte(address) != value) eeprom_write_byte(address, value);
+}
+
+void eeprom_read_block(void* destination, const void* source, size_t length)
+{
+	for (size_t i = 0; i < length; i++) ((uint8_t*)destination)[i] = eeprom_read_byte((const uint8_t*)source + i);
+}
+
+void eeprom_update_block(const void* source, void* destination, size_t length)
+{
+	for (size_t i = 0; i < length; i++) eeprom_update_byte((uint8_t*)destination + i, ((const uint8_t*)source)[i]);
+}
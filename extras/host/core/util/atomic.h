@@ -0,0 +1,12 @@
+/*
+	util/atomic.h - the host tests run the library on one thread, so an atomic block is just a block
+*/
+
+#ifndef HOST_UTIL_ATOMIC_h
+#define HOST_UTIL_ATOMIC_h
+
+#define ATOMIC_RESTORESTATE 0
+#define ATOMIC_FORCEON 1
+#define ATOMIC_BLOCK(type) for (int _atomic_once = 1; _atomic_once; _atomic_once = 0)
+
+#endif
@@ -0,0 +1,473 @@
+/*
+	fps_sim.cpp - a simulated GT-511C3 / GT-521Fxx for the host tests (see fps_sim.h)
+*/
+
+#include "fps_sim.h"
+
+// from the datasheet
+static const uint8_t CMD_OPEN = 0x01;
+static const uint8_t CMD_CLOSE = 0x02;
+static const uint8_t CMD_CHANGE_BAUD = 0x04;
+static const uint8_t CMD_LED = 0x12;
+static const uint8_t CMD_ENROLL_COUNT = 0x20;
+static const uint8_t CMD_CHECK_ENROLLED = 0x21;
+static const uint8_t CMD_ENROLL_START = 0x22;
+static const uint8_t CMD_ENROLL1 = 0x23;
+static const uint8_t CMD_ENROLL2 = 0x24;
+static const uint8_t CMD_ENROLL3 = 0x25;
+static const uint8_t CMD_IS_PRESS_FINGER = 0x26;
+static const uint8_t CMD_DELETE_ID = 0x40;
+static const uint8_t CMD_DELETE_ALL = 0x41;
+static const uint8_t CMD_VERIFY = 0x50;
+static const uint8_t CMD_IDENTIFY = 0x51;
+static const uint8_t CMD_VERIFY_TEMPLATE = 0x52;
+static const uint8_t CMD_IDENTIFY_TEMPLATE = 0x53;
+static const uint8_t CMD_CAPTURE = 0x60;
+static const uint8_t CMD_MAKE_TEMPLATE = 0x61;
+static const uint8_t CMD_GET_IMAGE = 0x62;
+static const uint8_t CMD_GET_TEMPLATE = 0x70;
+static const uint8_t CMD_SET_TEMPLATE = 0x71;
+
+static const unsigned long NACK_INVALID_POS = 0x1003;
+static const unsigned long NACK_IS_NOT_USED = 0x1004;
+static const unsigned long NACK_IS_ALREADY_USED = 0x1005;
+static const unsigned long NACK_COMM_ERR = 0x1006;
+static const unsigned long NACK_VERIFY_FAILED = 0x1007;
+static const unsigned long NACK_IDENTIFY_FAILED = 0x1008;
+static const unsigned long NACK_DB_IS_FULL = 0x1009;
+static const unsigned long NACK_DB_IS_EMPTY = 0x100A;
+static const unsigned long NACK_BAD_FINGER = 0x100C;
+static const unsigned long NACK_IS_NOT_SUPPORTED = 0x100E;
+static const unsigned long NACK_INVALID_PARAM = 0x1011;
+static const unsigned long NACK_FINGER_IS_NOT_PRESSED = 0x1012;
+
+Fps_Sim::Fps_Sim(uint8_t pin, int capacity) : Host_Link(pin)
+{
+	Capacity = capacity;
+	for (int i = 0; i < 24; i++) DeviceInfo[i] = (uint8_t)(0x40 + i);
+	Finger = false;
+	FingerID = 0;
+	for (int i = 0; i < 256; i++) Latency[i] = 5000;
+	Latency[CMD_IDENTIFY] = 100000;
+	Latency[CMD_IDENTIFY_TEMPLATE] = 100000;
+	Latency[CMD_VERIFY] = 50000;
+	Latency[CMD_VERIFY_TEMPLATE] = 50000;
+	Latency[CMD_ENROLL1] = 200000;
+	Latency[CMD_ENROLL2] = 200000;
+	Latency[CMD_ENROLL3] = 200000;
+	Latency[CMD_DELETE_ID] = 15000;
+	Latency[CMD_DELETE_ALL] = 50000;
+	CaptureMicros[0] = 60000;
+	CaptureMicros[1] = 150000;
+	GarbleResponses = 0;
+	GarbleData = 0;
+	Commands = 0;
+	for (int i = 0; i < 256; i++) CommandCounts[i] = 0;
+	PowerCycles = 0;
+	_templates.resize(capacity);
+	_outage = 0;
+	_powered = true;
+	LedOn = false;
+	_ledmicros = 0;
+	_ledsince = 0;
+	PowerOn();
+	PowerCycles = 0;
+}
+
+bool Fps_Sim::IsEnrolled(int id)
+{
+	return (id >= 0) && (id < Capacity) && !_templates[id].empty();
+}
+
+void Fps_Sim::Enroll(int id, int finger)
+{
+	_templates[id].resize(TEMPLATE_SIZE);
+	MakeTemplate(finger, &_templates[id][0]);
+}
+
+void Fps_Sim::Delete(int id)
+{
+	_templates[id].clear();
+}
+
+int Fps_Sim::Count()
+{
+	int count = 0;
+	for (int i = 0; i < Capacity; i++) count += IsEnrolled(i) ? 1 : 0;
+	return count;
+}
+
+// Made up from the finger number, the same finger always gives the same template
+void Fps_Sim::MakeTemplate(int finger, uint8_t* tmplt)
+{
+	uint32_t state = 0x9E3779B9u ^ (uint32_t)finger * 2654435761u;
+	for (int i = 0; i < TEMPLATE_SIZE; i++)
+	{
+		state = state * 1664525u + 1013904223u;
+		tmplt[i] = (uint8_t)(state >> 24);
+	}
+}
+
+void Fps_Sim::PowerOn()
+{
+	Baud = 9600;
+	SetLed(false);
+	_packet.clear();
+	_expectdata = 0;
+	_captured = -1;
+	_capturematches = false;
+	_enrolling = -1;
+	PowerCycles++;
+}
+
+unsigned long long Fps_Sim::LedMicros()
+{
+	return _ledmicros + (LedOn ? host_micros - _ledsince : 0);
+}
+
+void Fps_Sim::SetLed(bool on)
+{
+	if (on && !LedOn) _ledsince = host_micros;
+	if (!on && LedOn) _ledmicros += host_micros - _ledsince;
+	LedOn = on;
+}
+
+// Powers off and on as Outages says
+void Fps_Sim::Update()
+{
+	while (_outage < Outages.size())
+	{
+		const Outage& outage = Outages[_outage];
+		if (host_micros < outage.Off) break;
+		if (_powered)
+		{
+			_powered = false;
+			Connected = false;
+			// whatever was still on its way is lost
+			Outgoing.clear();
+		}
+		if (host_micros < outage.On) break;
+		_powered = true;
+		Connected = true;
+		PowerOn();
+		_outage++;
+	}
+}
+
+void Fps_Sim::Receive(uint8_t b)
+{
+	// a command instead of the data means the sketch gave up on the data phase
+	if ((_expectdata > 0) && _packet.empty() && (b == 0x55)) _expectdata = 0;
+	if (_expectdata > 0)
+	{
+		if (_packet.empty() && (b != 0x5A)) return;
+		_packet.push_back(b);
+		if ((int)_packet.size() < _expectdata + 6) return;
+		std::vector<uint8_t> packet;
+		packet.swap(_packet);
+		int length = _expectdata;
+		_expectdata = 0;
+		uint16_t sum = 0;
+		for (int i = 0; i < length + 4; i++) sum += packet[i];
+		if ((packet[1] != 0xA5) || ((sum & 0xFF) != packet[length + 4]) || ((sum >> 8) != packet[length + 5]))
+		{
+			Respond(_datacommand, false, NACK_COMM_ERR, Latency[_datacommand]);
+			return;
+		}
+		Data(&packet[4], length);
+		return;
+	}
+	if (_packet.empty() && (b != 0x55)) return;
+	_packet.push_back(b);
+	if (_packet.size() < 12) return;
+	std::vector<uint8_t> packet;
+	packet.swap(_packet);
+	uint16_t sum = 0;
+	for (int i = 0; i < 10; i++) sum += packet[i];
+	if ((packet[1] != 0xAA) || ((sum & 0xFF) != packet[10]) || ((sum >> 8) != packet[11]))
+	{
+		Respond(packet[8], false, NACK_COMM_ERR, Latency[0]);
+		return;
+	}
+	unsigned long parameter = packet[4] | (packet[5] << 8) | ((unsigned long)packet[6] << 16) | ((unsigned long)packet[7] << 24);
+	if (Lose && Lose(packet[8], parameter)) return;
+	Commands++;
+	CommandCounts[packet[8]]++;
+	Command(packet[8], parameter);
+}
+
+bool Fps_Sim::ValidID(unsigned long id)
+{
+	return id < (unsigned long)Capacity;
+}
+
+int Fps_Sim::FindTemplate(const uint8_t* tmplt, int except)
+{
+	for (int id = 0; id < Capacity; id++)
+	{
+		if ((id != except) && IsEnrolled(id) && (memcmp(&_templates[id][0], tmplt, TEMPLATE_SIZE) == 0)) return id;
+	}
+	return -1;
+}
+
+void Fps_Sim::Command(uint8_t command, unsigned long parameter)
+{
+	unsigned long latency = Latency[command];
+	bool finger = FingerHook ? FingerHook() : Finger;
+	uint8_t tmplt[TEMPLATE_SIZE];
+	switch (command)
+	{
+		case CMD_OPEN:
+			Respond(command, true, 0, latency);
+			if (parameter != 0) SendData(DeviceInfo, 24);
+			return;
+		case CMD_CLOSE:
+			Respond(command, true, 0, latency);
+			return;
+		case CMD_CHANGE_BAUD:
+			if ((parameter != 9600) && (parameter != 19200) && (parameter != 38400) && (parameter != 57600) && (parameter != 115200))
+			{
+				Respond(command, false, NACK_INVALID_PARAM, latency);
+				return;
+			}
+			// the ACK still goes out at the old rate
+			Respond(command, true, 0, latency);
+			Baud = parameter;
+			return;
+		case CMD_LED:
+			SetLed(parameter != 0);
+			Respond(command, true, 0, latency);
+			return;
+		case CMD_ENROLL_COUNT:
+			Respond(command, true, Count(), latency);
+			return;
+		case CMD_CHECK_ENROLLED:
+			if (!ValidID(parameter)) Respond(command, false, NACK_INVALID_POS, latency);
+			else if (IsEnrolled(parameter)) Respond(command, true, 0, latency);
+			else Respond(command, false, NACK_IS_NOT_USED, latency);
+			return;
+		case CMD_ENROLL_START:
+			_enrolling = -1;
+			if (Count() == Capacity) Respond(command, false, NACK_DB_IS_FULL, latency);
+			else if (!ValidID(parameter)) Respond(command, false, NACK_INVALID_POS, latency);
+			else if (IsEnrolled(parameter)) Respond(command, false, NACK_IS_ALREADY_USED, latency);
+			else
+			{
+				_enrolling = parameter;
+				Respond(command, true, 0, latency);
+			}
+			return;
+		case CMD_ENROLL1:
+		case CMD_ENROLL2:
+			if (_captured < 0) Respond(command, false, NACK_BAD_FINGER, latency);
+			else Respond(command, true, 0, latency);
+			return;
+		case CMD_ENROLL3:
+		{
+			if ((_captured < 0) || (_enrolling < 0))
+			{
+				Respond(command, false, NACK_BAD_FINGER, latency);
+				return;
+			}
+			MakeTemplate(_captured, tmplt);
+			// a finger that is already enrolled is reported by its ID
+			int duplicate = FindTemplate(tmplt, -1);
+			if (duplicate >= 0)
+			{
+				Respond(command, false, duplicate, latency);
+				return;
+			}
+			Enroll(_enrolling, _captured);
+			_enrolling = -1;
+			Respond(command, true, 0, latency);
+			return;
+		}
+		case CMD_IS_PRESS_FINGER:
+			Respond(command, true, finger ? 0 : NACK_FINGER_IS_NOT_PRESSED, latency);
+			return;
+		case CMD_DELETE_ID:
+			if (!ValidID(parameter)) Respond(command, false, NACK_INVALID_POS, latency);
+			else if (!IsEnrolled(parameter)) Respond(command, false, NACK_IS_NOT_USED, latency);
+			else
+			{
+				Delete(parameter);
+				Respond(command, true, 0, latency);
+			}
+			return;
+		case CMD_DELETE_ALL:
+			if (Count() == 0)
+			{
+				Respond(command, false, NACK_DB_IS_EMPTY, latency);
+				return;
+			}
+			for (int id = 0; id < Capacity; id++) Delete(id);
+			Respond(command, true, 0, latency);
+			return;
+		case CMD_VERIFY:
+			if (!ValidID(parameter)) Respond(command, false, NACK_INVALID_POS, latency);
+			else if (!IsEnrolled(parameter)) Respond(command, false, NACK_IS_NOT_USED, latency);
+			else
+			{
+				MakeTemplate(_captured, tmplt);
+				bool matched = (_captured >= 0) && _capturematches && (memcmp(&_templates[parameter][0], tmplt, TEMPLATE_SIZE) == 0);
+				Respond(command, matched, matched ? 0 : NACK_VERIFY_FAILED, latency);
+			}
+			return;
+		case CMD_IDENTIFY:
+		{
+			if (Count() == 0)
+			{
+				Respond(command, false, NACK_DB_IS_EMPTY, latency);
+				return;
+			}
+			int id = -1;
+			if ((_captured >= 0) && _capturematches)
+			{
+				MakeTemplate(_captured, tmplt);
+				id = FindTemplate(tmplt, -1);
+			}
+			if (id >= 0) Respond(command, true, id, latency);
+			else Respond(command, false, NACK_IDENTIFY_FAILED, latency);
+			return;
+		}
+		case CMD_CAPTURE:
+			if (finger == false)
+			{
+				_captured = -1;
+				Respond(command, false, NACK_FINGER_IS_NOT_PRESSED, latency);
+				return;
+			}
+			_captured = FingerID;
+			_capturematches = CaptureMatches ? CaptureMatches(parameter != 0) : true;
+			Respond(command, true, 0, CaptureMicros[(parameter != 0) ? 1 : 0]);
+			return;
+		case CMD_MAKE_TEMPLATE:
+			if (_captured < 0)
+			{
+				Respond(command, false, NACK_BAD_FINGER, latency);
+				return;
+			}
+			MakeTemplate(_captured, tmplt);
+			Respond(command, true, 0, latency);
+			SendData(tmplt, TEMPLATE_SIZE);
+			return;
+		case CMD_GET_IMAGE:
+		{
+			if (_captured < 0)
+			{
+				Respond(command, false, NACK_INVALID_PARAM, latency);
+				return;
+			}
+			Respond(command, true, 0, latency);
+			std::vector<uint8_t> image(IMAGE_WIDTH * IMAGE_HEIGHT);
+			for (int y = 0; y < IMAGE_HEIGHT; y++)
+			{
+				for (int x = 0; x < IMAGE_WIDTH; x++)
+				{
+					image[y * IMAGE_WIDTH + x] = Pixel ? Pixel(_captured, x, y) : (uint8_t)(128 + 100 * sin((x + 2 * y + _captured) / 3.0));
+				}
+			}
+			SendData(&image[0], image.size());
+			return;
+		}
+		case CMD_GET_TEMPLATE:
+			if (!ValidID(parameter)) Respond(command, false, NACK_INVALID_POS, latency);
+			else if (!IsEnrolled(parameter)) Respond(command, false, NACK_IS_NOT_USED, latency);
+			else
+			{
+				Respond(command, true, 0, latency);
+				SendData(&_templates[parameter][0], TEMPLATE_SIZE);
+			}
+			return;
+		case CMD_SET_TEMPLATE:
+		case CMD_VERIFY_TEMPLATE:
+			// the ID is checked before the template is sent
+			if (!ValidID(parameter & 0xFFFF))
+			{
+				Respond(command, false, NACK_INVALID_POS, latency);
+				return;
+			}
+			if ((command == CMD_VERIFY_TEMPLATE) && !IsEnrolled(parameter & 0xFFFF))
+			{
+				Respond(command, false, NACK_IS_NOT_USED, latency);
+				return;
+			}
+			// fall through
+		case CMD_IDENTIFY_TEMPLATE:
+			_expectdata = TEMPLATE_SIZE;
+			_datacommand = command;
+			_dataparameter = parameter;
+			Respond(command, true, 0, Latency[0]);
+			return;
+	}
+	Respond(command, false, NACK_IS_NOT_SUPPORTED, latency);
+}
+
+// The data phase of SetTemplate, VerifyTemplate1_1 and IdentifyTemplate1_N
+void Fps_Sim::Data(const uint8_t* payload, int length)
+{
+	unsigned long latency = Latency[_datacommand];
+	int id = _dataparameter & 0xFFFF;
+	if (_datacommand == CMD_SET_TEMPLATE)
+	{
+		// a non-zero upper word skips the duplicate check
+		int duplicate = ((_dataparameter >> 16) == 0) ? FindTemplate(payload, id) : -1;
+		if (duplicate >= 0)
+		{
+			Respond(_datacommand, false, duplicate, latency);
+			return;
+		}
+		_templates[id].assign(payload, payload + length);
+		Respond(_datacommand, true, 0, latency);
+	}
+	else if (_datacommand == CMD_VERIFY_TEMPLATE)
+	{
+		bool matched = memcmp(&_templates[id][0], payload, length) == 0;
+		Respond(_datacommand, matched, matched ? 0 : NACK_VERIFY_FAILED, latency);
+	}
+	else
+	{
+		int found = FindTemplate(payload, -1);
+		if (Count() == 0) Respond(_datacommand, false, NACK_DB_IS_EMPTY, latency);
+		else if (found < 0) Respond(_datacommand, false, NACK_IDENTIFY_FAILED, latency);
+		else Respond(_datacommand, true, found, latency);
+	}
+}
+
+void Fps_Sim::Respond(uint8_t /*command*/, bool ack, unsigned long parameter, unsigned long delaymicros)
+{
+	uint8_t response[12] = { 0x55, 0xAA, 0x01, 0x00,
+		(uint8_t)parameter, (uint8_t)(parameter >> 8), (uint8_t)(parameter >> 16), (uint8_t)(parameter >> 24),
+		(uint8_t)(ack ? 0x30 : 0x31), 0x00, 0, 0 };
+	uint16_t sum = 0;
+	for (int i = 0; i < 10; i++) sum += response[i];
+	response[10] = (uint8_t)sum;
+	response[11] = (uint8_t)(sum >> 8);
+	if (GarbleResponses > 0)
+	{
+		GarbleResponses--;
+		response[10] ^= 0x5A;
+	}
+	Send(response, 12, delaymicros);
+}
+
+void Fps_Sim::SendData(const uint8_t* payload, int length)
+{
+	std::vector<uint8_t> packet;
+	packet.reserve(length + 6);
+	packet.push_back(0x5A);
+	packet.push_back(0xA5);
+	packet.push_back(0x01);
+	packet.push_back(0x00);
+	packet.insert(packet.end(), payload, payload + length);
+	uint16_t sum = 0;
+	for (size_t i = 0; i < packet.size(); i++) sum += packet[i];
+	packet.push_back((uint8_t)sum);
+	packet.push_back((uint8_t)(sum >> 8));
+	if (GarbleData > 0)
+	{
+		GarbleData--;
+		packet[packet.size() - 2] ^= 0x5A;
+	}
+	Send(&packet[0], packet.size(), 0);
+}
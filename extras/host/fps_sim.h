@@ -0,0 +1,98 @@
+/*
+	fps_sim.h - a simulated GT-511C3 / GT-521Fxx for the host tests
+	It speaks the protocol from the datasheet (12 byte command and response packets, data
+	packets for templates, images and the device info), independently of the library:
+	  - Open with a non-zero parameter answers with the device info in a data packet
+	  - ChangeEBaudRate answers at the old rate, then listens and talks at the new one
+	  - after a power cycle (Outages) it is back at 9600 with the LED off
+	  - SetTemplate reports a duplicate as a NACK whose parameter is the matching ID
+	Every command takes Latency[command] us to answer (captures take CaptureMicros).
+	Templates are made up per finger, so the same finger always gives the same template.
+*/
+
+#ifndef FPS_SIM_h
+#define FPS_SIM_h
+
+#include "Arduino.h"
+#include "SoftwareSerial.h"
+#include <functional>
+#include <vector>
+
+class Fps_Sim : public Host_Link
+{
+	public:
+		// Parameter: the SoftwareSerial rx pin the scanner is wired to (the first FPS_GT511C3 argument)
+		// Parameter: number of IDs (200, or 3000 for a GT-521F52)
+		Fps_Sim(uint8_t pin, int capacity);
+
+		static const int TEMPLATE_SIZE = 498;
+		static const int IMAGE_WIDTH = 258;
+		static const int IMAGE_HEIGHT = 202;
+
+		int Capacity;
+		bool LedOn;
+		uint8_t DeviceInfo[24];
+
+		// The finger on the sensor
+		bool Finger;								// true while a finger is pressed (default false)
+		int FingerID;								// whose it is, which template it makes (default 0)
+		std::function<bool()> FingerHook;			// overrides Finger when set
+		std::function<bool(bool highquality)> CaptureMatches;	// false for a capture too poor to match (default: always matches)
+		std::function<uint8_t(int finger, int x, int y)> Pixel;	// the image GetImage sends
+
+		// Timing, in us
+		unsigned long Latency[256];					// from the last byte of a command (or its data) to the response
+		unsigned long CaptureMicros[2];				// CaptureFinger, fast and high quality
+
+		// Faults
+		int GarbleResponses;						// the next responses get a bad checksum
+		int GarbleData;								// the next data packets get a bad checksum
+		struct Outage
+		{
+			unsigned long long Off;					// us when the power goes
+			unsigned long long On;					// us when it is back
+		};
+		std::vector<Outage> Outages;				// in order
+		std::function<bool(uint8_t command, unsigned long parameter)> Lose;	// true to lose a command on the line (no answer)
+
+		// The database
+		bool IsEnrolled(int id);
+		void Enroll(int id, int finger);
+		void Delete(int id);
+		int Count();
+		static void MakeTemplate(int finger, uint8_t* tmplt);
+
+		// Statistics
+		unsigned long Commands;
+		unsigned long CommandCounts[256];
+		unsigned long PowerCycles;
+		unsigned long long LedMicros();				// total time the LED has been on
+
+		void Receive(uint8_t b);
+		void Update();
+
+	private:
+		std::vector<std::vector<uint8_t> > _templates;
+		std::vector<uint8_t> _packet;
+		int _expectdata;							// data packet payload the current command waits for, 0 for none
+		uint8_t _datacommand;
+		unsigned long _dataparameter;
+		int _captured;								// finger of the last capture, -1 for none
+		bool _capturematches;
+		int _enrolling;
+		bool _powered;
+		unsigned long long _ledmicros;
+		unsigned long long _ledsince;
+		void SetLed(bool on);
+		size_t _outage;
+
+		void Command(uint8_t command, unsigned long parameter);
+		void Data(const uint8_t* payload, int length);
+		void Respond(uint8_t command, bool ack, unsigned long parameter, unsigned long delaymicros);
+		void SendData(const uint8_t* payload, int length);
+		int FindTemplate(const uint8_t* tmplt, int except);
+		bool ValidID(unsigned long id);
+		void PowerOn();
+};
+
+#endif
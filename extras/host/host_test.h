@@ -0,0 +1,33 @@
+/*
+	host_test.h - checks for the host tests in extras/host
+	CHECK reports a failed condition and lets the test go on, HOST_TEST_RESULT is the exit code.
+*/
+
+#ifndef HOST_TEST_h
+#define HOST_TEST_h
+
+#include "Arduino.h"
+#include <stdio.h>
+#include <vector>
+
+static int host_failures = 0;
+
+#define CHECK(condition) do { if (!(condition)) { host_failures++; printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); } } while (0)
+#define HOST_TEST_RESULT() (printf("%s\n", (host_failures == 0) ? "PASS" : "FAIL"), (host_failures == 0) ? 0 : 1)
+
+// A Stream over a byte vector, for the sinks and sources the library writes to and reads from
+class Memory_Stream : public Stream
+{
+	public:
+		std::vector<uint8_t> Bytes;
+		size_t Position;
+
+		Memory_Stream() : Position(0) {}
+		int available() { return (int)(Bytes.size() - Position); }
+		int read() { return (Position < Bytes.size()) ? Bytes[Position++] : -1; }
+		int peek() { return (Position < Bytes.size()) ? Bytes[Position] : -1; }
+		size_t write(uint8_t b) { Bytes.push_back(b); return 1; }
+		using Print::write;
+};
+
+#endif
@@ -0,0 +1,25 @@
+#!/bin/sh
+# Builds and runs the host tests: the library against the simulated Arduino core in core/ and the
+# simulated scanner in fps_sim.cpp. No board is needed; time is virtual, so results are repeatable.
+#   extras/host/run.sh              run every test_*.cpp
+#   extras/host/run.sh test_link    run one
+# A test builds with -D__AVR__ (EEPROM, ATOMIC_BLOCK) unless it has a "// build:" line, whose
+# flags replace it; each "// build:" line is a separate build of the same test.
+cd "$(dirname "$0")" || exit 1
+CXX=${CXX:-g++}
+OUT=${TMPDIR:-/tmp}/fps_host_tests
+mkdir -p "$OUT"
+rc=0
+if [ $# -gt 0 ]; then tests="$*"; else tests=$(ls test_*.cpp | sed 's/\.cpp$//'); fi
+for t in $tests; do
+	t=${t%.cpp}
+	variants=$(sed -n 's#^// build:##p' "$t.cpp")
+	[ -n "$variants" ] || variants="-D__AVR__"
+	echo "$variants" | while read -r flags; do
+		echo "== $t $flags"
+		$CXX -std=gnu++11 -O2 -Wall -Wextra -I core -I ../../src $flags -o "$OUT/$t" \
+			"$t.cpp" fps_sim.cpp core/host_core.cpp ../../src/FPS_GT511C3.cpp || exit 1
+		"$OUT/$t" || exit 1
+	done || rc=1
+done
+exit $rc
@@ -0,0 +1,130 @@
+/*
+	test_badge_index.cpp - Badge_Index over a simulated scanner
+	Lookup must find every badge of a sorted table (and none that is not in it). Identify must read
+	the outcome from LastResult, so it works for both models: with a GT-521F52 (3000 IDs) a match in
+	slot 200 or above is a match, and a miss is -1 on either path, never the model's "not found" code.
+	Also checks the per path statistics and prints the mean time of each path.
+*/
+
+#include "host_test.h"
+#include "fps_sim.h"
+#include "FPS_GT511C3.h"
+#include <map>
+#include <stdlib.h>
+#include <vector>
+
+static void TestLookup()
+{
+	// 500 random badges, sorted, each with its own slot
+	srand(1);
+	std::map<uint32_t, uint16_t> table;
+	while (table.size() < 500) table[((uint32_t)rand() << 16) ^ (uint32_t)rand()] = (uint16_t)table.size();
+	std::vector<Badge_Entry> entries;
+	for (std::map<uint32_t, uint16_t>::iterator i = table.begin(); i != table.end(); ++i)
+	{
+		Badge_Entry entry = { i->first, i->second };
+		entries.push_back(entry);
+	}
+	Badge_Index index(&entries[0], (int)entries.size());
+	int wrong = 0;
+	for (std::map<uint32_t, uint16_t>::iterator i = table.begin(); i != table.end(); ++i)
+	{
+		if (index.Lookup(i->first) != i->second) wrong++;
+		if ((table.count(i->first + 1) == 0) && (index.Lookup(i->first + 1) != -1)) wrong++;
+		if ((table.count(i->first - 1) == 0) && (index.Lookup(i->first - 1) != -1)) wrong++;
+	}
+	CHECK(wrong == 0);
+	CHECK((table.count(0) == 0) && (index.Lookup(0) == -1));
+	CHECK((table.count(0xFFFFFFFFUL) == 0) && (index.Lookup(0xFFFFFFFFUL) == -1));
+
+	// a table of one, and an empty one
+	Badge_Entry one[] = { { 1001, 7 } };
+	Badge_Index single(one, 1);
+	CHECK(single.Lookup(1001) == 7);
+	CHECK((single.Lookup(1000) == -1) && (single.Lookup(1002) == -1));
+	Badge_Index empty(one, 0);
+	CHECK(empty.Lookup(1001) == -1);
+}
+
+static void TestIdentify(int capacity)
+{
+	printf("  %d IDs\n", capacity);
+	Fps_Sim sim(4, capacity);
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 500;
+	CHECK(fps.Open());
+	int high = capacity - 1;
+	int middle = capacity / 2 + 50;				// 150 or 1550
+	const Badge_Entry badges[] = { { 1001, 0 }, { 1002, 1 }, { 2040, (uint16_t)middle }, { 31337, (uint16_t)high } };
+	Badge_Index index(badges, 4);
+	CHECK(index.LastPath == Badge_Index::Paths::None);
+	sim.Enroll(0, 100);
+	sim.Enroll(1, 101);
+	sim.Enroll(middle, 102);
+	sim.Enroll(high, 103);
+	sim.Enroll(5, 104);							// someone without a badge
+	sim.Finger = true;
+
+	// the badge's finger
+	int badge[] = { 1001, 1002, 2040, 31337 };
+	int slot[] = { 0, 1, middle, high };
+	for (int i = 0; i < 4; i++)
+	{
+		sim.FingerID = 100 + i;
+		CHECK(fps.CaptureFinger(false));
+		CHECK(index.Identify(fps, badge[i]) == slot[i]);
+		CHECK(index.LastPath == Badge_Index::Paths::Verify);
+	}
+
+	// someone else's finger on a known badge, a finger that is not enrolled at all
+	sim.FingerID = 104;
+	CHECK(fps.CaptureFinger(false));
+	CHECK(index.Identify(fps, 31337) == -1);
+	CHECK(index.LastPath == Badge_Index::Paths::Verify);
+	sim.FingerID = 999;
+	CHECK(fps.CaptureFinger(false));
+	CHECK(index.Identify(fps, 1001) == -1);
+
+	// unknown badges fall back to the search of the whole database
+	sim.FingerID = 104;
+	CHECK(fps.CaptureFinger(false));
+	CHECK(index.Identify(fps, 5555) == 5);
+	CHECK(index.LastPath == Badge_Index::Paths::Identify);
+	sim.FingerID = 103;
+	CHECK(fps.CaptureFinger(false));
+	CHECK(index.Identify(fps, 5555) == high);
+	sim.FingerID = 999;
+	CHECK(fps.CaptureFinger(false));
+	CHECK(index.Identify(fps, 5555) == -1);
+	CHECK(index.LastPath == Badge_Index::Paths::Identify);
+
+	// the slot of a known badge has been deleted
+	sim.Delete(middle);
+	sim.FingerID = 102;
+	CHECK(fps.CaptureFinger(false));
+	CHECK(index.Identify(fps, 2040) == -1);
+
+	// no answer from the scanner, on either path
+	sim.FingerID = 100;
+	CHECK(fps.CaptureFinger(false));
+	sim.Connected = false;
+	CHECK(index.Identify(fps, 1001) == -1);
+	CHECK(index.Identify(fps, 5555) == -1);
+	sim.Connected = true;
+
+	CHECK(index.VerifyCount == 8);
+	CHECK(index.IdentifyCount == 4);
+	unsigned long verify = index.VerifyMillis / index.VerifyCount;
+	unsigned long identify = index.IdentifyMillis / index.IdentifyCount;
+	printf("    verify path: %lu checks, mean %lu ms; identify path: %lu searches, mean %lu ms\n", index.VerifyCount,
+		verify, index.IdentifyCount, identify);
+	CHECK(verify < identify);
+}
+
+int main()
+{
+	TestLookup();
+	TestIdentify(200);
+	TestIdentify(3000);
+	return HOST_TEST_RESULT();
+}
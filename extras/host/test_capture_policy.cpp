@@ -0,0 +1,222 @@
+/*
+	test_capture_policy.cpp - Capture_Policy against a failure model, and over a simulated scanner
+	The model: normal fingers match 85% fast and 95% high quality, dry fingers 30% fast and 85%
+	high; an attempt (capture + match) takes 450 ms fast and 1100 ms high, +-20%. Each row is
+	20000 unlocks by 200 users, retrying up to 10 times; it prints the mean and p99 time to unlock.
+	Over the simulator: a capture without a finger (or a match without an answer) is not counted
+	against the mode, and a user whose fast captures fail before Identify finds them gets a lower
+	fast match rate.
+*/
+
+#include "host_test.h"
+#include "fps_sim.h"
+#include "FPS_GT511C3.h"
+#include <algorithm>
+#include <random>
+
+struct Model_User
+{
+	double Fast;
+	double High;
+};
+
+struct Unlock_Times
+{
+	double Mean;
+	double P99;
+};
+
+static const double FAST_MILLIS = 450;
+static const double HIGH_MILLIS = 1100;
+static const int USERS = 200;
+static const int UNLOCKS = 20000;
+
+enum Policies { FIXED_FAST, FIXED_HIGH, ADAPTIVE, ADAPTIVE_USER };
+
+static Unlock_Times RunModel(const std::vector<Model_User>& users, Policies policy, const char* name)
+{
+	Capture_Policy cp;
+	byte table[USERS];
+	if (policy == ADAPTIVE_USER) cp.SetUserTable(table, USERS);
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<double> uniform(0, 1);
+	std::vector<double> times;
+	for (int e = 0; e < UNLOCKS; e++)
+	{
+		int u = rng() % users.size();
+		int id = (policy == ADAPTIVE_USER) ? u : -1;
+		double total = 0;
+		for (int attempt = 0; attempt < 10; attempt++)
+		{
+			bool high = (policy == FIXED_FAST) ? false : (policy == FIXED_HIGH) ? true : cp.ChooseHighQuality(id, attempt);
+			double ms = (high ? HIGH_MILLIS : FAST_MILLIS) * (0.8 + 0.4 * uniform(rng));
+			bool matched = uniform(rng) < (high ? users[u].High : users[u].Fast);
+			total += ms;
+			cp.Record(high, matched, (unsigned long)ms, id, attempt);
+			if (matched) break;
+		}
+		times.push_back(total);
+	}
+	std::sort(times.begin(), times.end());
+	double sum = 0;
+	for (size_t i = 0; i < times.size(); i++) sum += times[i];
+	Unlock_Times retval = { sum / times.size(), times[times.size() * 99 / 100] };
+	printf("    %-16s %5.0f / %5.0f\n", name, retval.Mean, retval.P99);
+	return retval;
+}
+
+static void TestModel(double dry)
+{
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<double> uniform(0, 1);
+	std::vector<Model_User> users;
+	for (int i = 0; i < USERS; i++)
+	{
+		Model_User user = { 0.85, 0.95 };
+		if (uniform(rng) < dry) user.Fast = 0.30, user.High = 0.85;
+		users.push_back(user);
+	}
+	printf("  %.0f%% dry users:    mean / p99 ms\n", dry * 100);
+	Unlock_Times fast = RunModel(users, FIXED_FAST, "fixed fast");
+	Unlock_Times high = RunModel(users, FIXED_HIGH, "fixed high");
+	Unlock_Times adaptive = RunModel(users, ADAPTIVE, "adaptive");
+	Unlock_Times user = RunModel(users, ADAPTIVE_USER, "adaptive+user");
+	// the policy never does much worse than the better fixed mode, and knowing dry users helps
+	CHECK(adaptive.Mean < 1.1 * std::min(fast.Mean, high.Mean));
+	CHECK(user.Mean < 1.1 * std::min(fast.Mean, high.Mean));
+	if (dry > 0)
+	{
+		CHECK(adaptive.P99 < fast.P99);
+		CHECK(user.Mean < adaptive.Mean);
+		CHECK(user.Mean < fast.Mean);
+	}
+}
+
+static void TestNoFinger()
+{
+	Fps_Sim sim(4, 200);
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 500;
+	CHECK(fps.Open());
+	sim.Enroll(5, 50);
+	sim.Finger = false;
+
+	// nobody on the sensor: the attempt ends, and the match rates are untouched
+	Capture_Policy cp;
+	CHECK(cp.Identify(fps, 3) == -1);
+	CHECK(cp.LastAttempts == 1);
+	CHECK(cp.Verify(fps, 5, 3) == 3);
+	CHECK(cp.LastAttempts == 1);
+	CHECK(cp.Fast.Attempts == 0);
+	CHECK(cp.High.Attempts == 0);
+	CHECK(cp.RetryFast.Attempts == 0);
+	CHECK(cp.RetryHigh.Attempts == 0);
+	CHECK(cp.Fast.MatchRate == 0.75f);
+
+	// a finger that is there gets counted
+	sim.Finger = true;
+	sim.FingerID = 50;
+	CHECK(cp.Identify(fps, 3) == 5);
+	CHECK(cp.Fast.Attempts == 1);
+
+	// a Verify1_1 whose answer is lost says nothing about the capture either
+	sim.Lose = [](uint8_t command, unsigned long) { return command == Command_Packet::Commands::Verify1_1; };
+	CHECK(cp.Verify(fps, 5, 3) == 4);
+	CHECK(cp.LastAttempts == 3);
+	CHECK(cp.Fast.Attempts + cp.High.Attempts + cp.RetryFast.Attempts + cp.RetryHigh.Attempts == 1);
+	sim.Lose = nullptr;
+}
+
+static void TestUserRate()
+{
+	Fps_Sim sim(4, 200);
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 500;
+	CHECK(fps.Open());
+	sim.Enroll(5, 50);
+	sim.Enroll(6, 60);
+	sim.Finger = true;
+
+	Capture_Policy cp;
+	cp.ExploreInterval = 0;
+	byte table[200];
+	cp.SetUserTable(table, 200);
+
+	// a dry finger: fast captures fail, high quality ones match
+	sim.FingerID = 50;
+	sim.CaptureMatches = [](bool highquality) { return highquality; };
+	CHECK(cp.Identify(fps, 5) == 5);
+	CHECK(cp.LastAttempts == 3);
+	CHECK(table[5] != 0);
+	CHECK(table[5] < (int)(cp.Fast.MatchRate * 255));
+
+	// a good finger matching on the first fast capture goes up
+	sim.FingerID = 60;
+	sim.CaptureMatches = nullptr;
+	cp.Fast.MatchRate = 0.9;
+	cp.High.Attempts = 1;
+	cp.High.MatchRate = 0.1;
+	cp.High.MeanMillis = cp.Fast.MeanMillis;
+	CHECK(cp.Identify(fps, 5) == 6);
+	CHECK(cp.LastAttempts == 1);
+	CHECK(table[6] > (int)(0.9 * 255));
+
+	// and Verify, which knows the user up front, keeps lowering a dry one
+	sim.FingerID = 50;
+	sim.CaptureMatches = [](bool highquality) { return highquality; };
+	int dry = table[5];
+	CHECK(cp.Verify(fps, 5, 5) == 0);
+	CHECK(table[5] < dry);
+}
+
+static void TestLargeDatabase()
+{
+	// a GT-521F52: IDs from 200 up are matches, and a miss is not one
+	Fps_Sim sim(4, 3000);
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 500;
+	CHECK(fps.Open());
+	sim.Enroll(200, 50);
+	sim.Enroll(2999, 60);
+	sim.Finger = true;
+
+	Capture_Policy cp;
+	cp.ExploreInterval = 0;
+	static byte table[3000];
+	cp.SetUserTable(table, 3000);
+
+	sim.FingerID = 60;
+	CHECK(cp.Identify(fps, 3) == 2999);
+	CHECK((cp.LastAttempts == 1) && (cp.Fast.Matches == 1));
+	CHECK(table[2999] != 0);
+	sim.FingerID = 50;
+	// each mode is tried once first
+	CHECK(cp.Identify(fps, 3) == 200);
+	CHECK((cp.LastAttempts == 1) && (cp.High.Matches == 1));
+
+	// someone who is not enrolled fails every attempt
+	sim.FingerID = 70;
+	CHECK(cp.Identify(fps, 3) == -1);
+	CHECK(cp.LastAttempts == 3);
+	CHECK(cp.Fast.Attempts + cp.RetryFast.Attempts + cp.RetryHigh.Attempts + cp.High.Attempts == 5);
+	CHECK(cp.Fast.Matches + cp.RetryFast.Matches + cp.RetryHigh.Matches + cp.High.Matches == 2);
+
+	// an Identify1_N whose answer is lost is not counted
+	sim.FingerID = 60;
+	sim.Lose = [](uint8_t command, unsigned long) { return command == Command_Packet::Commands::Identify1_N; };
+	CHECK(cp.Identify(fps, 2) == -1);
+	CHECK(cp.LastAttempts == 2);
+	CHECK(cp.Fast.Attempts + cp.RetryFast.Attempts + cp.RetryHigh.Attempts + cp.High.Attempts == 5);
+	sim.Lose = nullptr;
+}
+
+int main()
+{
+	TestModel(0.3);
+	TestModel(0.7);
+	TestModel(0);
+	TestNoFinger();
+	TestUserRate();
+	TestLargeDatabase();
+	return HOST_TEST_RESULT();
+}
@@ -0,0 +1,95 @@
+/*
+	test_checksum.cpp - Data_Checksum against a plain byte sum
+	Built twice: with __AVR__ for the unrolled loop, and without it for the 32 bit path that adds two
+	16 bit lanes at a time. Random data and all 0xFF bytes (the worst case for the lanes), lengths
+	around the 4 byte steps and the 256 word folds, every start alignment, and the data split into
+	random chunks (single bytes through Add(byte) included) must all give the plain sum.
+*/
+// build: -D__AVR__
+// build: -U__AVR__
+
+#include "host_test.h"
+#include "FPS_GT511C3.h"
+#include <stdlib.h>
+#include <vector>
+
+static word PlainSum(const byte* data, int length)
+{
+	unsigned long sum = 0;
+	for (int i = 0; i < length; i++) sum += data[i];
+	return (word)sum;
+}
+
+static unsigned long _cases = 0;
+static unsigned long _wrong = 0;
+
+static void Check(const byte* data, int length)
+{
+	word expected = PlainSum(data, length);
+
+	// in one go
+	Data_Checksum whole;
+	whole.Add(data, length);
+	_cases++;
+	if (whole.Value() != expected) _wrong++;
+
+	// split into chunks of random length, some of them a byte at a time
+	Data_Checksum split;
+	int done = 0;
+	while (done < length)
+	{
+		int chunk = 1 + rand() % ((rand() % 4 == 0) ? 8 : 2000);
+		if (chunk > length - done) chunk = length - done;
+		if (chunk == 1) split.Add(data[done]); else split.Add(data + done, chunk);
+		done += chunk;
+	}
+	_cases++;
+	if (split.Value() != expected) _wrong++;
+	if (split.Matches((byte)expected, (byte)(expected >> 8)) == false) _wrong++;
+}
+
+int main()
+{
+#if defined(__AVR__)
+	printf("unrolled loop (__AVR__)\n");
+#else
+	printf("32 bit lanes\n");
+#endif
+	srand(1);
+	std::vector<byte> random(70000);
+	std::vector<byte> ones(70000, 0xFF);
+	for (size_t i = 0; i < random.size(); i++) random[i] = (byte)rand();
+
+	int lengths[] = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 498, 499, 1023, 1024, 1025, 1027, 1028, 1029, 2047, 2048, 2051,
+		4095, 4096, 4100, 52116, 65535, 65536, 65537, 69992 };
+	for (unsigned int l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++)
+	{
+		for (int start = 0; start < 8; start++)
+		{
+			Check(&random[start], lengths[l]);
+			Check(&ones[start], lengths[l]);
+		}
+	}
+	for (int i = 0; i < 2000; i++)
+	{
+		int start = rand() % 8;
+		int length = rand() % 6000;
+		Check(&random[start], length);
+		Check(&ones[start], length);
+	}
+
+	// Reset starts over, and the sum wraps at 16 bits
+	Data_Checksum checksum;
+	checksum.Add(&ones[0], 300);
+	CHECK(checksum.Value() == (word)(300 * 255));
+	checksum.Reset();
+	CHECK(checksum.Value() == 0);
+	checksum.Add(&ones[1], 258);
+	CHECK(checksum.Value() == (word)(258 * 255));
+	CHECK(checksum.Matches((byte)(258 * 255), (byte)((258 * 255) >> 8)));
+	CHECK(checksum.Matches((byte)(258 * 255), (byte)((258 * 255) >> 8) + 1) == false);
+
+	printf("%lu sums, %lu wrong\n", _cases, _wrong);
+	CHECK(_wrong == 0);
+	return HOST_TEST_RESULT();
+}
@@ -0,0 +1,449 @@
+/*
+	test_expiry.cpp - Expiry_Scheduler over a simulated GT-521F52 at 9600 baud
+	The workload: 3000 IDs enrolled, 3000 expiries (2000 already due at the start, 1000 spread
+	over the hour), and one person at the door every 6 s on average (Poisson) for an hour, who
+	keeps the finger on until identified. It prints the identify latency from the finger going on,
+	without expiries, with every due DeleteID sent at once, and with the scheduler behind the
+	Power_Manager and behind the Command_Queue. Then it checks Save / Load (and the EEPROM
+	versions), deadlines across a wrap of the clock, which entries a Load drops, and what happens
+	between Poll(queue) and the queued DeleteID running (Save, Cancel, Schedule, a lost answer).
+*/
+
+#include "host_test.h"
+#include "fps_sim.h"
+#include "FPS_GT511C3.h"
+#include "avr/eeprom.h"
+#include <algorithm>
+#include <math.h>
+
+static const int IDS = 3000;
+static const unsigned long long HOUR = 3600ULL * 1000000ULL;
+
+// The door: people arrive, keep the finger on until identified (+200 ms), at most 10 s
+static std::vector<unsigned long long> _arrivals;
+static size_t _nextarrival;
+static unsigned long long _arrived;
+static unsigned long long _fingeruntil;
+static bool _finger;
+static std::vector<double> _latencies;
+
+static bool FingerOn()
+{
+	if (_finger && (host_micros > _fingeruntil)) _finger = false;
+	if ((_finger == false) && (_nextarrival < _arrivals.size()) && (host_micros >= _arrivals[_nextarrival]))
+	{
+		_arrived = _arrivals[_nextarrival++];
+		_finger = true;
+		_fingeruntil = host_micros + 10000000ULL;
+	}
+	return _finger;
+}
+
+static void Identified()
+{
+	_latencies.push_back((host_micros - _arrived) / 1000.0);
+	_fingeruntil = host_micros + 200000ULL;
+}
+
+static void IdentifyDone(byte /*operation*/, int /*parameter*/, int result, void* /*context*/)
+{
+	if (result >= 0) Identified();
+}
+
+static unsigned long Seconds()
+{
+	return (unsigned long)(host_micros / 1000000ULL);
+}
+
+struct Latency
+{
+	double Mean;
+	double P50;
+	double P99;
+	double Max;
+	unsigned long Deleted;
+	int Left;
+};
+
+enum Modes { NO_EXPIRIES, NAIVE, POWER, QUEUE_NO_EXPIRIES, QUEUE };
+
+static Latency Run(Modes mode, const char* name)
+{
+	Fps_Sim sim(4, IDS);
+	for (int i = 0; i < IDS; i++) sim.Enroll(i, 1000 + i);
+	sim.FingerID = 1000 + IDS - 1;
+	sim.FingerHook = FingerOn;
+
+	srand(42);
+	_arrivals.clear();
+	_nextarrival = 0;
+	_finger = false;
+	_latencies.clear();
+	unsigned long long started = host_micros;
+	for (unsigned long long t = started; ; )
+	{
+		t += (unsigned long long)(-log((rand() + 1.0) / (RAND_MAX + 2.0)) * 6e6);
+		if (t > started + HOUR) break;
+		_arrivals.push_back(t);
+	}
+
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 2000;
+	CHECK(fps.Open());
+	Power_Manager power(fps);
+	power.Begin();
+	Command_Queue queue(fps);
+	static Expiry_Scheduler::Entry heap[IDS];
+	Expiry_Scheduler expiry(fps, heap, IDS);
+	expiry.Clock = Seconds;
+	unsigned long now = Seconds();
+	if ((mode != NO_EXPIRIES) && (mode != QUEUE_NO_EXPIRIES))
+	{
+		for (int i = 0; i < IDS; i++) CHECK(expiry.Schedule(i, (i < 2000) ? now : now + (unsigned long)(rand() % 3600)));
+	}
+
+	size_t served = 0;
+	while (host_micros - started < HOUR + 60ULL * 1000000ULL)
+	{
+		FingerOn();
+		if ((mode == QUEUE) || (mode == QUEUE_NO_EXPIRIES))
+		{
+			if ((served != _nextarrival) && power.Poll() && queue.Submit(Command_Queue::Operations::Identify, 0, IdentifyDone, NULL, Command_Queue::Lanes::Urgent)) served = _nextarrival;
+			expiry.Poll(queue);
+			queue.Poll();
+		}
+		else
+		{
+			if (power.Poll() && (served != _nextarrival))
+			{
+				if (fps.CaptureFinger(false))
+				{
+					fps.Identify1_N();
+					Identified();
+					served = _nextarrival;
+				}
+			}
+			if (mode == POWER) expiry.Poll(power);
+			if (mode == NAIVE) while (expiry.Due()) expiry.Poll(true);
+		}
+		delay(1);
+	}
+
+	std::vector<double> sorted = _latencies;
+	std::sort(sorted.begin(), sorted.end());
+	double sum = 0;
+	for (size_t i = 0; i < sorted.size(); i++) sum += sorted[i];
+	Latency retval;
+	retval.Mean = sum / sorted.size();
+	retval.P50 = sorted[sorted.size() / 2];
+	retval.P99 = sorted[sorted.size() * 99 / 100];
+	retval.Max = sorted.back();
+	retval.Deleted = expiry.Deleted;
+	retval.Left = expiry.Count();
+	printf("  %-26s %4zu unlocks  mean %6.0f  p50 %6.0f  p99 %6.0f  max %6.0f ms  deleted %4lu, left %d\n",
+		name, sorted.size(), retval.Mean, retval.P50, retval.P99, retval.Max, retval.Deleted, retval.Left);
+	CHECK(sorted.size() > 500);
+	CHECK(sim.Count() == IDS - (int)retval.Deleted);
+	return retval;
+}
+
+static void TestWorkload()
+{
+	printf("  one hour at 9600 baud, %d IDs enrolled, identify latency in ms\n", IDS);
+	Latency none = Run(NO_EXPIRIES, "no expiries");
+	Latency naive = Run(NAIVE, "DeleteID as soon as due");
+	Latency power = Run(POWER, "scheduler + Power_Manager");
+	Latency queuenone = Run(QUEUE_NO_EXPIRIES, "queue, no expiries");
+	Latency queue = Run(QUEUE, "scheduler + Command_Queue");
+
+	CHECK(naive.Deleted == IDS);
+	// the 2000 already due hold up whoever comes first
+	CHECK(naive.Max > 10 * none.Max);
+	// the scheduler deletes everything within the hour, and nobody at the door notices
+	CHECK((power.Deleted == IDS) && (power.Left == 0));
+	CHECK((queue.Deleted == IDS) && (queue.Left == 0));
+	CHECK(power.Mean < 1.05 * none.Mean);
+	CHECK(power.P99 < 1.05 * none.P99);
+	CHECK(queue.Mean < 1.05 * queuenone.Mean);
+	CHECK(queue.P99 < 1.05 * queuenone.P99);
+}
+
+static unsigned long _clock;
+
+static unsigned long Clock()
+{
+	return _clock;
+}
+
+static void TestSaveLoad()
+{
+	Fps_Sim sim(4, 200);
+	for (int i = 0; i < 10; i++) sim.Enroll(i, 100 + i);
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 500;
+	byte bitmap[25];
+	Warm_Start snapshot(bitmap, 200);
+	CHECK(snapshot.Start(fps, false));
+	CHECK(snapshot.Valid);
+	fps.Snapshot = &snapshot;
+
+	Expiry_Scheduler::Entry heap[10];
+	Expiry_Scheduler expiry(fps, heap, 10);
+	for (int i = 0; i < 10; i++) CHECK(expiry.Schedule(i, 1000 + (i * 37) % 10));
+
+	// millis() deadlines would be meaningless after a reset, so there is nothing to save
+	Memory_Stream stream;
+	CHECK(expiry.Save(stream, snapshot) == false);
+	CHECK(stream.Bytes.empty());
+	CHECK(expiry.SaveEEPROM(0, snapshot) == false);
+	CHECK(expiry.Changed());
+
+	_clock = 1000;
+	expiry.Clock = Clock;
+	CHECK(expiry.Save(stream, snapshot));
+	CHECK(expiry.Changed() == false);
+	CHECK((int)stream.Bytes.size() == Expiry_Scheduler::Size(10));
+	CHECK(expiry.SaveEEPROM(64, snapshot));
+
+	// loaded back in deadline order
+	Expiry_Scheduler::Entry heap2[10];
+	Expiry_Scheduler loaded(fps, heap2, 10);
+	loaded.Clock = Clock;
+	CHECK(loaded.Load(stream, snapshot));
+	CHECK(loaded.Count() == 10);
+	Expiry_Scheduler::Entry heap3[10];
+	Expiry_Scheduler fromeeprom(fps, heap3, 10);
+	fromeeprom.Clock = Clock;
+	CHECK(fromeeprom.LoadEEPROM(64, snapshot));
+	CHECK(fromeeprom.Count() == 10);
+	_clock = 2000;
+	unsigned long last = 0;
+	for (int i = 0; i < 10; i++)
+	{
+		CHECK(loaded.NextDeadline() == fromeeprom.NextDeadline());
+		CHECK(loaded.NextDeadline() >= last);
+		last = loaded.NextDeadline();
+		CHECK(loaded.Due());
+		CHECK(loaded.Poll(true));
+		CHECK(fromeeprom.Cancel(heap3[0].ID));
+	}
+	CHECK(sim.Count() == 0);
+
+	// a damaged copy is refused
+	stream.Position = 0;
+	stream.Bytes[20] ^= 1;
+	CHECK(loaded.Load(stream, snapshot) == false);
+	CHECK(loaded.Count() == 0);
+	host_eeprom[64 + 20] ^= 1;
+	CHECK(fromeeprom.LoadEEPROM(64, snapshot) == false);
+}
+
+static void TestWrap()
+{
+	Fps_Sim sim(4, 200);
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 500;
+	CHECK(fps.Open());
+	for (int i = 0; i < 6; i++) sim.Enroll(i, 100 + i);
+
+	// deadlines on both sides of the clock wrapping around
+	Expiry_Scheduler::Entry heap[6];
+	Expiry_Scheduler expiry(fps, heap, 6);
+	expiry.Clock = Clock;
+	_clock = 0xFFFFFF00UL;
+	CHECK(expiry.Schedule(0, 0x00000050UL));
+	CHECK(expiry.Schedule(1, 0xFFFFFF80UL));
+	CHECK(expiry.Schedule(2, 0x00000010UL));
+	CHECK(expiry.Schedule(3, 0xFFFFFFF0UL));
+	CHECK(expiry.Schedule(4, 0x00001000UL));
+	CHECK(expiry.Schedule(5, 0xFFFFFF10UL));
+	CHECK(expiry.NextDeadline() == 0xFFFFFF10UL);
+	CHECK(expiry.Due() == false);
+
+	// before the wrap only the ones before it are due, in order
+	_clock = 0xFFFFFFF8UL;
+	int order[6];
+	int n = 0;
+	while (expiry.Due())
+	{
+		order[n++] = heap[0].ID;
+		CHECK(expiry.Poll(true));
+	}
+	CHECK(n == 3);
+	CHECK((order[0] == 5) && (order[1] == 1) && (order[2] == 3));
+
+	// after it, the rest
+	_clock = 0x00000060UL;
+	while (expiry.Due())
+	{
+		order[n++] = heap[0].ID;
+		CHECK(expiry.Poll(true));
+	}
+	CHECK(n == 5);
+	CHECK((order[3] == 2) && (order[4] == 0));
+	CHECK(expiry.Count() == 1);
+	CHECK(expiry.NextDeadline() == 0x00001000UL);
+}
+
+static void TestRestore()
+{
+	Fps_Sim sim(4, 200);
+	for (int i = 0; i < 6; i++) sim.Enroll(i, 100 + i);
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 500;
+	byte bitmap[25];
+	Warm_Start snapshot(bitmap, 200);
+	CHECK(snapshot.Start(fps, false));
+	fps.Snapshot = &snapshot;
+
+	Expiry_Scheduler::Entry heap[6];
+	Expiry_Scheduler expiry(fps, heap, 6);
+	expiry.Clock = Clock;
+	_clock = 0;
+	for (int i = 0; i < 6; i++) CHECK(expiry.Schedule(i, 100 + i));
+	Memory_Stream stream;
+	CHECK(expiry.Save(stream, snapshot));
+
+	// deleted by other means after the heap was saved
+	CHECK(fps.DeleteID(2));
+	CHECK(fps.DeleteID(4));
+
+	// a snapshot that holds nothing real (never loaded, started or scanned) drops nothing
+	byte emptybitmap[25];
+	Warm_Start empty(emptybitmap, 200);
+	empty.Generation = 12345;
+	CHECK(empty.Valid == false);
+	stream.Position = 0;
+	CHECK(expiry.Load(stream, empty));
+	CHECK(expiry.Count() == 6);
+	CHECK(expiry.Changed() == false);
+
+	// one that failed to load doesn't either
+	Memory_Stream garbage;
+	for (int i = 0; i < 100; i++) garbage.Bytes.push_back((uint8_t)i);
+	CHECK(empty.Load(garbage) == false);
+	CHECK(empty.Valid == false);
+	stream.Position = 0;
+	CHECK(expiry.Load(stream, empty));
+	CHECK(expiry.Count() == 6);
+
+	// the real one drops the two that are gone
+	CHECK(snapshot.Valid);
+	stream.Position = 0;
+	CHECK(expiry.Load(stream, snapshot));
+	CHECK(expiry.Count() == 4);
+	CHECK(expiry.Changed());
+	CHECK(expiry.Cancel(2) == false);
+	CHECK(expiry.Cancel(4) == false);
+	CHECK(expiry.NextDeadline() == 100);
+
+	// and so does a copy of it loaded from a file
+	Memory_Stream saved;
+	snapshot.Save(saved);
+	Warm_Start copy(emptybitmap, 200);
+	CHECK(copy.Load(saved));
+	CHECK(copy.Valid);
+	stream.Position = 0;
+	CHECK(expiry.Load(stream, copy));
+	CHECK(expiry.Count() == 4);
+}
+
+static int _leds;
+
+static void LedDone(byte /*operation*/, int /*parameter*/, int result, void* /*context*/)
+{
+	if (result == 1) _leds++;
+}
+
+// The window between Poll(queue) and the queued DeleteID running
+static void TestQueueWindow()
+{
+	Fps_Sim sim(4, 200);
+	for (int i = 0; i < 6; i++) sim.Enroll(i, 100 + i);
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 500;
+	CHECK(fps.Open());
+	byte bitmap[25];
+	Warm_Start snapshot(bitmap, 200);
+	CHECK(snapshot.Start(fps, false));
+	Command_Queue queue(fps);
+	Expiry_Scheduler::Entry heap[6];
+	Expiry_Scheduler expiry(fps, heap, 6);
+	expiry.Clock = Clock;
+	_clock = 0;
+	for (int i = 1; i <= 5; i++) CHECK(expiry.Schedule(i, 10 * i));
+	_clock = 100;
+
+	// the entry stays until the DeleteID has run, one at a time
+	CHECK(expiry.Poll(queue));
+	CHECK(expiry.Count() == 5);
+	CHECK(expiry.Poll(queue) == false);
+	CHECK(expiry.Poll(true) == false);
+	CHECK(queue.Pending(Command_Queue::Lanes::Housekeeping) == 1);
+
+	// saved in the window, then a reset before the queue ran: the expiry of 1 is not lost
+	Memory_Stream stream;
+	CHECK(expiry.Save(stream, snapshot));
+	{
+		Expiry_Scheduler::Entry heap2[6];
+		Expiry_Scheduler after(fps, heap2, 6);
+		after.Clock = Clock;
+		CHECK(after.Load(stream, snapshot));
+		CHECK(after.Count() == 5);
+		CHECK(after.NextDeadline() == 10);
+	}
+
+	// the queue runs it
+	CHECK(queue.Poll());
+	CHECK((expiry.Count() == 4) && (expiry.Deleted == 1) && (sim.IsEnrolled(1) == false));
+	CHECK(expiry.NextDeadline() == 20);
+
+	// 2 is enrolled again in the window: Cancel withdraws its DeleteID, and leaves the rest of the lane
+	CHECK(expiry.Poll(queue));
+	_leds = 0;
+	CHECK(queue.Submit(Command_Queue::Operations::SetLED, 1, LedDone, NULL, Command_Queue::Lanes::Housekeeping));
+	sim.Enroll(2, 999);
+	CHECK(expiry.Cancel(2));
+	CHECK(queue.Pending(Command_Queue::Lanes::Housekeeping) == 2);
+	CHECK(queue.Poll());
+	CHECK(_leds == 1);
+	CHECK(queue.Pending(Command_Queue::Lanes::Housekeeping) == 0);
+	CHECK(queue.Poll() == false);
+	CHECK(sim.IsEnrolled(2));
+	CHECK((expiry.Count() == 3) && (expiry.Deleted == 1));
+
+	// 3 gets a later expiry in the window: its DeleteID is withdrawn too
+	CHECK(expiry.Poll(queue));
+	CHECK(expiry.Schedule(3, 500));
+	CHECK(queue.Poll() == false);
+	CHECK(sim.IsEnrolled(3));
+	CHECK((expiry.Count() == 3) && (expiry.NextDeadline() == 40));
+
+	// a DeleteID without an answer leaves 4 due, and it goes on the next try
+	sim.Lose = [](uint8_t command, unsigned long) { return command == Command_Packet::Commands::DeleteID; };
+	CHECK(expiry.Poll(queue));
+	CHECK(queue.Poll());
+	sim.Lose = nullptr;
+	CHECK((expiry.Retries == 1) && (expiry.Count() == 3) && expiry.Due());
+	CHECK(expiry.Poll(queue));
+	CHECK(queue.Poll());
+	CHECK((expiry.Count() == 2) && (expiry.Deleted == 2) && (sim.IsEnrolled(4) == false));
+
+	// 5 was deleted by other means without a Cancel: the NACK ends its expiry all the same
+	sim.Delete(5);
+	CHECK(expiry.Poll(queue));
+	CHECK(queue.Poll());
+	CHECK((expiry.Count() == 1) && (expiry.Deleted == 2));
+	CHECK(expiry.Due() == false);
+	CHECK(sim.IsEnrolled(2) && sim.IsEnrolled(3));
+}
+
+int main()
+{
+	TestWorkload();
+	TestSaveLoad();
+	TestWrap();
+	TestRestore();
+	TestQueueWindow();
+	return HOST_TEST_RESULT();
+}
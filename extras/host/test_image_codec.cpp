@@ -0,0 +1,158 @@
+/*
+	test_image_codec.cpp - Image_Encoder / Image_Decoder on synthetic 258x202 ridge images
+	Checks the round trip is lossless (rows in order and at random), that a damaged record is
+	caught, and that GetImage streams a capture from the scanner through the encoder. Also decodes
+	from a seekable Stream, and prints how much of the record one row reads. Prints the compression
+	ratio and the encoder throughput on this machine (wall clock, not simulated).
+*/
+
+#include "host_test.h"
+#include "fps_sim.h"
+#include "FPS_GT511C3.h"
+#include <chrono>
+
+static const int W = Fps_Sim::IMAGE_WIDTH;
+static const int H = Fps_Sim::IMAGE_HEIGHT;
+
+// A record in a file: counts the bytes read and the seeks
+class File_Stream : public Memory_Stream
+{
+	public:
+		unsigned long Reads;
+		unsigned long Seeks;
+		bool SeekFails;
+		File_Stream() : Reads(0), Seeks(0), SeekFails(false) {}
+		int read() { Reads++; return Memory_Stream::read(); }
+};
+
+static bool SeekFile(unsigned long position, void* context)
+{
+	File_Stream* file = (File_Stream*)context;
+	if (file->SeekFails || (position > file->Bytes.size())) return false;
+	file->Seeks++;
+	file->Position = position;
+	return true;
+}
+
+static void TestStream(const std::vector<uint8_t>& image, std::vector<uint8_t>& record)
+{
+	uint8_t row[W];
+	File_Stream file;
+	file.Bytes = record;
+	Image_Decoder decoder(file, record.size(), SeekFile, &file);
+	CHECK(decoder.Valid && (decoder.Width == W) && (decoder.Height == H));
+	unsigned long opening = file.Reads;
+
+	// one row from the middle only reads the index entry and its group
+	int middle = H / 2;
+	file.Reads = 0;
+	CHECK(decoder.DecodeRow(middle, row) && (memcmp(row, &image[middle * W], W) == 0));
+	printf("stream: opening reads %lu bytes, row %d reads %lu of %lu bytes (%lu seeks)\n", opening, middle,
+		file.Reads, (unsigned long)record.size(), file.Seeks);
+	CHECK(file.Reads < record.size() / 8);
+
+	// in order it reads each byte once and never seeks
+	unsigned long seeks = file.Seeks;
+	file.Reads = 0;
+	bool lossless = true;
+	for (int y = middle + 1; y < H; y++) lossless &= decoder.DecodeRow(y, row) && (memcmp(row, &image[y * W], W) == 0);
+	CHECK(file.Seeks == seeks);
+	for (int y = 0; y < H; y++) lossless &= decoder.DecodeRow(y, row) && (memcmp(row, &image[y * W], W) == 0);
+	for (int i = 0; i < 50; i++)
+	{
+		int y = rand() % H;
+		lossless &= decoder.DecodeRow(y, row) && (memcmp(row, &image[y * W], W) == 0);
+	}
+	CHECK(lossless);
+
+	// a seek that fails is a row that fails, the next one starts over from its key row
+	file.SeekFails = true;
+	CHECK(decoder.DecodeRow(3, row) == false);
+	file.SeekFails = false;
+	CHECK(decoder.DecodeRow(3, row) && (memcmp(row, &image[3 * W], W) == 0));
+
+	// a file cut short is not a valid record
+	File_Stream cut;
+	cut.Bytes.assign(record.begin(), record.begin() + record.size() / 2);
+	Image_Decoder truncated(cut, record.size(), SeekFile, &cut);
+	CHECK(truncated.Valid == false);
+}
+
+// ridges inside a round finger on a light background, with +-4 of sensor noise
+static uint8_t RidgePixel(int finger, int x, int y)
+{
+	double frequency = 0.15 + 0.02 * finger;
+	double angle = finger * 0.3;
+	double r = hypot(x - 129.0, y - 101.0);
+	double v = 220;
+	if (r < 90) v = 128 + 90 * sin(frequency * (x * cos(angle) + y * sin(angle)) + 0.002 * r * r);
+	v += (rand() % 9) - 4;
+	if (v < 0) v = 0;
+	if (v > 255) v = 255;
+	return (uint8_t)v;
+}
+
+int main()
+{
+	std::vector<uint8_t> image(W * H);
+	srand(1);
+	double pixels = 0, compressed = 0, seconds = 0;
+	uint8_t row[W];
+	for (int finger = 0; finger < 20; finger++)
+	{
+		for (int y = 0; y < H; y++) for (int x = 0; x < W; x++) image[y * W + x] = RidgePixel(finger, x, y);
+		Memory_Stream record;
+		Image_Encoder encoder(record);
+		std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+		encoder.ImageStart(W, H);
+		for (int y = 0; y < H; y++) encoder.ImageRow(y, &image[y * W], W);
+		encoder.ImageEnd();
+		seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+		pixels += W * H;
+		compressed += record.Bytes.size();
+		CHECK(encoder.BytesWritten == record.Bytes.size());
+
+		Image_Decoder decoder(&record.Bytes[0], record.Bytes.size());
+		CHECK(decoder.Valid && (decoder.Width == W) && (decoder.Height == H));
+		bool lossless = true;
+		for (int y = 0; y < H; y++) lossless &= decoder.DecodeRow(y, row) && (memcmp(row, &image[y * W], W) == 0);
+		for (int i = 0; i < 50; i++)
+		{
+			int y = rand() % H;
+			lossless &= decoder.DecodeRow(y, row) && (memcmp(row, &image[y * W], W) == 0);
+		}
+		CHECK(lossless);
+		if (finger == 0) TestStream(image, record.Bytes);
+
+		// a flipped byte in the footer is caught
+		record.Bytes[record.Bytes.size() - 3] ^= 0xFF;
+		Image_Decoder damaged(&record.Bytes[0], record.Bytes.size());
+		CHECK(damaged.Valid == false);
+	}
+	double ratio = pixels / compressed;
+	printf("ratio %.2f, encoder %.1f MB/s\n", ratio, pixels / seconds / 1e6);
+	CHECK(ratio > 1.5);
+
+	// through the scanner: the image is encoded while it downloads
+	Fps_Sim sim(4, 200);
+	sim.Pixel = RidgePixel;
+	sim.Finger = true;
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 1000;
+	CHECK(fps.Open());
+	CHECK(fps.CaptureFinger(false));
+	srand(2);
+	for (int y = 0; y < H; y++) for (int x = 0; x < W; x++) image[y * W + x] = RidgePixel(0, x, y);
+	srand(2);
+	Memory_Stream record;
+	Image_Encoder encoder(record);
+	CHECK(fps.GetImage(encoder));
+	CHECK(encoder.PixelCount == (unsigned long)(W * H));
+	Image_Decoder decoder(&record.Bytes[0], record.Bytes.size());
+	CHECK(decoder.Valid);
+	bool lossless = true;
+	for (int y = 0; y < H; y++) lossless &= decoder.DecodeRow(y, row) && (memcmp(row, &image[y * W], W) == 0);
+	CHECK(lossless);
+
+	return HOST_TEST_RESULT();
+}
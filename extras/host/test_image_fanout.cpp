@@ -0,0 +1,176 @@
+/*
+	test_image_fanout.cpp - Image_Fanout over GetImage from a simulated scanner
+	Every handler must get the whole image once (ImageStart, every row in order, ImageEnd), in the
+	order they were added, all from the same row buffer. The per handler timings must add up to
+	what each handler spent. Then finds the longest a row may take in the handlers together before
+	bytes are lost, at 9600 and 115200 baud, with handlers that call fps.Pump() between their steps
+	and handlers that don't, and prints it next to the time a row takes to arrive.
+*/
+
+#include "host_test.h"
+#include "fps_sim.h"
+#include "FPS_GT511C3.h"
+
+static const int W = Fps_Sim::IMAGE_WIDTH;
+static const int H = Fps_Sim::IMAGE_HEIGHT;
+
+static uint8_t Pixel(int finger, int x, int y)
+{
+	return (uint8_t)(x * 7 + y * 13 + finger);
+}
+
+// Records the calls it gets, and spends Cost us on each row (in steps of 500 us, pumping the
+// link between them when Pumped is set)
+class Recorder : public Image_Row_Handler
+{
+	public:
+		static int Calls;
+		FPS_GT511C3* Pumped;
+		unsigned long Cost;
+		int Starts;
+		int Ends;
+		int Rows;
+		int Wrong;
+		int LastCall;
+		byte* Buffers[H];
+
+		Recorder() : Pumped(NULL), Cost(0), Starts(0), Ends(0), Rows(0), Wrong(0), LastCall(0) {}
+		void ImageStart(int width, int height)
+		{
+			Starts++;
+			Rows = 0;
+			Wrong = ((width == W) && (height == H)) ? 0 : 1;
+			LastCall = Calls++;
+		}
+		void ImageRow(int row, byte* pixels, int width)
+		{
+			if ((row != Rows) || (width != W)) Wrong++;
+			for (int x = 0; x < width; x++) Wrong += pixels[x] != Pixel(1, x, row);
+			if (row < H) Buffers[row] = pixels;
+			Rows = row + 1;
+			LastCall = Calls++;
+			for (unsigned long spent = 0; spent < Cost; spent += 500)
+			{
+				delayMicroseconds((Cost - spent < 500) ? Cost - spent : 500);
+				if (Pumped != NULL) Pumped->Pump();
+			}
+		}
+		void ImageEnd() { Ends++; LastCall = Calls++; }
+};
+int Recorder::Calls = 0;
+
+static void TestFanout()
+{
+	Fps_Sim sim(4, 200);
+	sim.Pixel = Pixel;
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 500;
+	CHECK(fps.Open());
+	CHECK(fps.ChangeBaudRate(115200));
+	sim.Finger = true;
+	sim.FingerID = 1;
+	CHECK(fps.CaptureFinger(false));
+
+	Image_Fanout fanout;
+	static Recorder recorders[Image_Fanout::MAX_HANDLERS + 1];
+	CHECK(fanout.Count() == 0);
+	for (int i = 0; i < Image_Fanout::MAX_HANDLERS; i++)
+	{
+		CHECK(fanout.Add(recorders[i]));
+		recorders[i].Cost = 100 * (i + 1);
+	}
+	CHECK(fanout.Add(recorders[Image_Fanout::MAX_HANDLERS]) == false);
+	CHECK(fanout.Count() == Image_Fanout::MAX_HANDLERS);
+
+	CHECK(fps.GetImage(fanout));
+	CHECK(fps.Rx.Overruns == 0);
+	int sharedbuffer = 0;
+	unsigned long sum = 0;
+	for (int i = 0; i < Image_Fanout::MAX_HANDLERS; i++)
+	{
+		Recorder& r = recorders[i];
+		CHECK((r.Starts == 1) && (r.Ends == 1) && (r.Rows == H) && (r.Wrong == 0));
+		// called in the order added: each one's last call (ImageEnd) right after the one before
+		if (i > 0) CHECK(r.LastCall == recorders[i - 1].LastCall + 1);
+		for (int row = 0; row < H; row++) sharedbuffer += r.Buffers[row] == recorders[0].Buffers[row];
+		// reading the clock takes 1 us on the host
+		CHECK(fanout.TotalMicros[i] == H * (r.Cost + 1));
+		CHECK(fanout.SlowestRowMicros[i] == r.Cost + 1);
+		sum += r.Cost + 1;
+	}
+	CHECK(recorders[Image_Fanout::MAX_HANDLERS].Starts == 0);
+	CHECK(sharedbuffer == Image_Fanout::MAX_HANDLERS * H);
+	CHECK(fanout.SlowestRowMicrosAll == sum);
+	printf("  %d handlers, %lu to %lu us per row each: SlowestRowMicrosAll %lu us\n", fanout.Count(),
+		recorders[0].Cost, recorders[Image_Fanout::MAX_HANDLERS - 1].Cost, fanout.SlowestRowMicrosAll);
+
+	// the statistics start over with the next image
+	for (int i = 0; i < Image_Fanout::MAX_HANDLERS; i++) recorders[i].Cost = 0;
+	CHECK(fps.GetImage(fanout));
+	CHECK(fanout.SlowestRowMicrosAll == (unsigned long)Image_Fanout::MAX_HANDLERS);
+	CHECK(fanout.TotalMicros[Image_Fanout::MAX_HANDLERS - 1] == (unsigned long)H);
+	CHECK(recorders[0].Starts == 2);
+}
+
+// Returns: true if an image came through whole with the handlers spending cost us per row
+static bool Survives(unsigned long baud, unsigned long cost, bool pumped)
+{
+	Fps_Sim sim(4, 200);
+	sim.Pixel = Pixel;
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 2000;
+	CHECK(fps.Open());
+	if (baud != 9600) CHECK(fps.ChangeBaudRate(baud));
+	sim.Finger = true;
+	sim.FingerID = 1;
+	CHECK(fps.CaptureFinger(false));
+	Image_Fanout fanout;
+	Recorder quality, archive;
+	quality.Cost = cost / 2;
+	archive.Cost = cost - cost / 2;
+	if (pumped) quality.Pumped = archive.Pumped = &fps;
+	fanout.Add(quality);
+	fanout.Add(archive);
+	bool retval = fps.GetImage(fanout) && (quality.Wrong == 0) && (archive.Wrong == 0);
+	CHECK(retval == (fps.Rx.Overruns == 0));
+	return retval;
+}
+
+// Finds the longest row time (to 100 us) the handlers may take
+static void Budget(unsigned long baud)
+{
+	unsigned long arrive = W * 10 * 1000000UL / baud;
+	unsigned long buffer = 64 * 10 * 1000000UL / baud;
+	unsigned long ring = (64 + FPS_RX_RING_SIZE) * 10 * 1000000UL / baud;
+	unsigned long byte = 10 * 1000000UL / baud;
+	unsigned long longest[2];
+	for (int pumped = 0; pumped < 2; pumped++)
+	{
+		unsigned long lo = 0;
+		unsigned long hi = arrive * 2;
+		CHECK(Survives(baud, lo, pumped));
+		CHECK(Survives(baud, hi, pumped) == false);
+		while (hi - lo > 100)
+		{
+			unsigned long mid = (lo + hi) / 2;
+			if (Survives(baud, mid, pumped)) lo = mid; else hi = mid;
+		}
+		longest[pumped] = lo;
+	}
+	printf("  %6lu baud: a row arrives in %lu us; the handlers may take %lu us per row (64 bytes: %lu us), %lu us if they pump (64 + %d bytes: %lu us)\n",
+		baud, arrive, longest[0], buffer, longest[1], FPS_RX_RING_SIZE, ring);
+	// the SoftwareSerial buffer sets the limit, not the row time
+	CHECK(longest[0] < arrive);
+	CHECK((longest[0] + 2 * byte >= buffer) && (longest[0] <= buffer + 2 * byte));
+	CHECK(longest[1] > longest[0]);
+	// what arrives between two pumps (500 us apart) has to fit in the 64 bytes as well
+	CHECK((longest[1] + 500 + 2 * byte >= ring) && (longest[1] <= ring + 2 * byte));
+}
+
+int main()
+{
+	TestFanout();
+	Budget(9600);
+	Budget(115200);
+	return HOST_TEST_RESULT();
+}
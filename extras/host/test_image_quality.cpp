@@ -0,0 +1,171 @@
+/*
+	test_image_quality.cpp - Image_Row_Handler and Image_Quality over GetImage from a simulated scanner
+	Checks the handler contract (ImageStart with the size, every row once and in order with the pixels
+	the scanner sent, ImageEnd once), and that the one pass scores of Image_Quality match the same
+	scores worked out from the whole image held in memory, for a good print, a blank sensor, a faint
+	print, a smudged print, a noisy one and one that covers a quarter of the sensor. Prints the
+	scores and the verdicts.
+*/
+
+#include "host_test.h"
+#include "fps_sim.h"
+#include "FPS_GT511C3.h"
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+static const int W = Fps_Sim::IMAGE_WIDTH;
+static const int H = Fps_Sim::IMAGE_HEIGHT;
+
+// Records every call and keeps the image
+class Recorder : public Image_Row_Handler
+{
+	public:
+		int Starts;
+		int Ends;
+		int Width;
+		int Height;
+		int NextRow;
+		int OutOfOrder;
+		std::vector<uint8_t> Pixels;
+
+		Recorder() : Starts(0), Ends(0), Width(0), Height(0), NextRow(0), OutOfOrder(0) {}
+		void ImageStart(int width, int height) { Starts++; Width = width; Height = height; NextRow = 0; Pixels.clear(); }
+		void ImageRow(int row, byte* pixels, int width)
+		{
+			if ((row != NextRow) || (width != Width)) OutOfOrder++;
+			NextRow = row + 1;
+			Pixels.insert(Pixels.end(), pixels, pixels + width);
+		}
+		void ImageEnd() { Ends++; }
+};
+
+// The scores from the whole image, the way the Image_Quality comment defines them
+static void Reference(const std::vector<uint8_t>& image, int& contrast, int& coverage, int& clarity)
+{
+	unsigned long histogram[16] = { 0 };
+	for (size_t i = 0; i < image.size(); i++) histogram[image[i] / 16]++;
+	unsigned long tail = image.size() / 20;
+	unsigned long count = 0;
+	int low = 0;
+	while ((low < 15) && (count + histogram[low] <= tail)) count += histogram[low++];
+	count = 0;
+	int high = 15;
+	while ((high > 0) && (count + histogram[high] <= tail)) count += histogram[high--];
+	contrast = (high > low) ? (high - low) * 16 : 0;
+
+	unsigned long segments = 0;
+	unsigned long texture = 0;
+	unsigned long steps = 0;
+	unsigned long stepcount = 0;
+	for (int y = 0; y < H; y++)
+	{
+		for (int x = 0; x + 8 <= W; x += 8)
+		{
+			const uint8_t* p = &image[y * W + x];
+			int lo = 255;
+			int hi = 0;
+			for (int i = 0; i < 8; i++)
+			{
+				if (p[i] < lo) lo = p[i];
+				if (p[i] > hi) hi = p[i];
+			}
+			segments++;
+			if (hi - lo < 40) continue;
+			texture++;
+			for (int i = 1; i < 8; i++) steps += abs(p[i] - p[i - 1]);
+			stepcount += 7;
+		}
+	}
+	coverage = (int)(texture * 100 / segments);
+	clarity = (stepcount > 0) ? (int)(steps / stepcount) : 0;
+}
+
+static void Score(const char* name, std::function<uint8_t(int finger, int x, int y)> pixel, bool passes)
+{
+	Fps_Sim sim(4, 200);
+	sim.Pixel = pixel;
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 500;
+	CHECK(fps.Open());
+	CHECK(fps.ChangeBaudRate(115200));
+	sim.Finger = true;
+	sim.FingerID = 1;
+	CHECK(fps.CaptureFinger(false));
+
+	// the handler contract, on its own
+	Recorder recorder;
+	CHECK(fps.GetImage(recorder));
+	CHECK((recorder.Starts == 1) && (recorder.Ends == 1));
+	CHECK((recorder.Width == W) && (recorder.Height == H));
+	CHECK((recorder.NextRow == H) && (recorder.OutOfOrder == 0));
+	int wrong = 0;
+	for (int y = 0; y < H; y++)
+	{
+		for (int x = 0; x < W; x++) wrong += recorder.Pixels[y * W + x] != pixel(1, x, y);
+	}
+	CHECK(wrong == 0);
+
+	// the one pass scores against the same scores from the whole image
+	Image_Quality quality;
+	CHECK(quality.Complete == false);
+	CHECK(fps.GetImage(quality));
+	CHECK(quality.Complete);
+	unsigned long total = 0;
+	for (int i = 0; i < 16; i++) total += quality.Histogram[i];
+	CHECK(total == (unsigned long)(W * H));
+	int contrast, coverage, clarity;
+	Reference(recorder.Pixels, contrast, coverage, clarity);
+	printf("  %-10s contrast %3d, coverage %3d%%, clarity %3d -> %s\n", name, quality.Contrast, quality.Coverage,
+		quality.Clarity, quality.Passed() ? "passed" : "rejected");
+	CHECK(quality.Contrast == contrast);
+	CHECK(quality.Coverage == coverage);
+	CHECK(quality.Clarity == clarity);
+	CHECK(quality.Passed() == passes);
+
+	// the same handler reused for another image starts over
+	CHECK(fps.GetImage(quality));
+	CHECK(quality.Contrast == contrast);
+	total = 0;
+	for (int i = 0; i < 16; i++) total += quality.Histogram[i];
+	CHECK(total == (unsigned long)(W * H));
+}
+
+static uint8_t Clip(double v)
+{
+	return (uint8_t)((v < 0) ? 0 : ((v > 255) ? 255 : v));
+}
+
+static uint8_t Noise(int x, int y)
+{
+	uint32_t h = (uint32_t)(x * 73856093) ^ (uint32_t)(y * 19349663);
+	h ^= h >> 13;
+	h *= 0x5BD1E995;
+	h ^= h >> 15;
+	return (uint8_t)h;
+}
+
+int main()
+{
+	Score("print", [](int finger, int x, int y) { return (uint8_t)(128 + 100 * sin((x + 2 * y + finger) / 3.0)); }, true);
+	Score("blank", [](int, int, int) { return (uint8_t)200; }, false);
+	Score("faint", [](int finger, int x, int y) { return (uint8_t)(128 + 12 * sin((x + 2 * y + finger) / 3.0)); }, false);
+	// ridges far apart: plenty of contrast and texture, but small steps between pixels
+	Score("smudged", [](int finger, int x, int y) { return (uint8_t)(128 + 100 * sin((x + 2 * y + finger) / 8.0)); }, false);
+	Score("noisy", [](int finger, int x, int y) { return Clip(128 + 80 * sin((x + 2 * y + finger) / 3.0) + (Noise(x, y) - 128) / 4.0); }, true);
+	// a print on a quarter of the sensor
+	Score("quarter", [](int finger, int x, int y) { return (x < W / 4) ? (uint8_t)(128 + 100 * sin((x + 2 * y + finger) / 3.0)) : (uint8_t)230; }, false);
+
+	// a garbled image still ends (ImageEnd is called before the checksum), GetImage says it is bad
+	Fps_Sim sim(4, 200);
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 500;
+	CHECK(fps.Open());
+	sim.Finger = true;
+	CHECK(fps.CaptureFinger(false));
+	sim.GarbleData = 1;
+	Recorder recorder;
+	CHECK(fps.GetImage(recorder) == false);
+	CHECK((recorder.Ends == 1) && (recorder.NextRow == H));
+	return HOST_TEST_RESULT();
+}
@@ -0,0 +1,150 @@
+/*
+	test_journal.cpp - Stream_Journal and EEPROM_Journal after power losses
+	A journal file can hold an entry cut short by a power loss, followed by the entries written
+	after the restart: ReadEntry must find its way back to them. The EEPROM ring must pick up
+	where it left off after a reset, after wrapping and after a torn write.
+*/
+
+#include "host_test.h"
+#include "FPS_GT511C3.h"
+
+static void LogMany(Access_Journal& journal, int count, int firstid)
+{
+	for (int i = 0; i < count; i++) journal.Log(Access_Entry::Kinds::Identify, firstid + i, 0, 60, 100);
+}
+
+// Reads every entry, returns the IDs
+static std::vector<int> ReadAll(Memory_Stream& file, unsigned long& skipped)
+{
+	std::vector<int> ids;
+	Access_Entry entry;
+	file.Position = 0;
+	skipped = 0;
+	while (Stream_Journal::ReadEntry(file, entry, skipped)) ids.push_back(entry.ID);
+	return ids;
+}
+
+static void TestStreamJournal()
+{
+	unsigned long skipped;
+	Memory_Stream file;
+	{
+		Stream_Journal journal(file);
+		LogMany(journal, 10, 0);
+	}
+	std::vector<int> ids = ReadAll(file, skipped);
+	CHECK((ids.size() == 10) && (skipped == 0));
+
+	// power lost 9 bytes into the 11th entry, then the sketch restarts and appends
+	Memory_Stream full;
+	{
+		Stream_Journal journal(full);
+		LogMany(journal, 11, 0);
+	}
+	file.Bytes.insert(file.Bytes.end(), full.Bytes.begin() + 10 * Access_Entry::SIZE, full.Bytes.begin() + 10 * Access_Entry::SIZE + 9);
+	{
+		Stream_Journal journal(file);
+		LogMany(journal, 10, 100);
+	}
+	ids = ReadAll(file, skipped);
+	CHECK(ids.size() == 20);
+	CHECK(skipped == 1);
+	bool inorder = (ids.size() == 20);
+	for (int i = 0; inorder && (i < 20); i++) inorder = (ids[i] == ((i < 10) ? i : 100 + i - 10));
+	CHECK(inorder);
+
+	// every possible tear length
+	for (int torn = 1; torn < Access_Entry::SIZE; torn++)
+	{
+		Memory_Stream tornfile;
+		tornfile.Bytes.assign(full.Bytes.begin(), full.Bytes.begin() + 10 * Access_Entry::SIZE + torn);
+		Stream_Journal journal(tornfile);
+		LogMany(journal, 5, 200);
+		ids = ReadAll(tornfile, skipped);
+		CHECK((ids.size() == 15) && (skipped == 1) && (ids.back() == 204));
+	}
+
+	// a damaged byte costs only the entry it is in
+	file.Bytes[3 * Access_Entry::SIZE + 5] ^= 0x55;
+	ids = ReadAll(file, skipped);
+	CHECK((ids.size() == 19) && (skipped == 2));
+}
+
+static void TestEEPROMJournal()
+{
+	memset(host_eeprom, 0xFF, sizeof(host_eeprom));
+	const int CAPACITY = 8;
+	Access_Entry entry;
+	{
+		EEPROM_Journal journal(64, CAPACITY);
+		CHECK(journal.Begin() == 0);
+		LogMany(journal, 3, 0);
+		journal.Flush();
+	}
+	// reset
+	{
+		EEPROM_Journal journal(64, CAPACITY);
+		CHECK(journal.Begin() == 3);
+		LogMany(journal, 2, 3);
+		journal.Flush();
+		journal.Rewind();
+		int expected = 0;
+		while (journal.Read(entry)) CHECK(entry.ID == expected++);
+		CHECK(expected == 5);
+	}
+	// wrap
+	{
+		EEPROM_Journal journal(64, CAPACITY);
+		CHECK(journal.Begin() == 5);
+		for (int i = 5; i < 20; i++)
+		{
+			LogMany(journal, 1, i);
+			journal.Flush();
+		}
+		journal.Rewind();
+		int expected = 20 - CAPACITY;
+		while (journal.Read(entry)) CHECK(entry.ID == expected++);
+		CHECK(expected == 20);
+	}
+	// power lost part way through an entry (only the bytes that change are written, about 5 here)
+	{
+		EEPROM_Journal journal(64, CAPACITY);
+		CHECK(journal.Begin() == CAPACITY);
+		host_eeprom_power_cut = 2;
+		LogMany(journal, 1, 20);
+		journal.Flush();
+		host_eeprom_power_cut = -1;
+	}
+	{
+		EEPROM_Journal journal(64, CAPACITY);
+		CHECK(journal.Begin() == CAPACITY - 1);
+		LogMany(journal, 1, 21);
+		journal.Flush();
+		journal.Rewind();
+		std::vector<int> ids;
+		while (journal.Read(entry)) ids.push_back(entry.ID);
+		// the torn entry (20) is lost and its slot taken by the next one
+		CHECK((ids.size() == CAPACITY) && (ids.front() == 13) && (ids[CAPACITY - 2] == 19) && (ids.back() == 21));
+	}
+	// the queue holds QUEUE_SIZE entries while the EEPROM is busy
+	{
+		EEPROM_Journal journal(64, CAPACITY);
+		journal.Begin();
+		LogMany(journal, EEPROM_Journal::QUEUE_SIZE + 3, 30);
+		CHECK(journal.Dropped == 3);
+		CHECK(journal.Logged == EEPROM_Journal::QUEUE_SIZE);
+		journal.Flush();
+	}
+	// nothing outside the ring was touched
+	bool outside = true;
+	for (int i = 0; i < 64; i++) outside &= (host_eeprom[i] == 0xFF);
+	for (int i = 64 + CAPACITY * Access_Entry::SIZE; i <= E2END; i++) outside &= (host_eeprom[i] == 0xFF);
+	CHECK(outside);
+}
+
+int main()
+{
+	TestStreamJournal();
+	TestEEPROMJournal();
+	return HOST_TEST_RESULT();
+}
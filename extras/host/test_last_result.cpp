@@ -0,0 +1,139 @@
+/*
+	test_last_result.cpp - LastResult over a simulated scanner at 9600 baud
+	Measures how long a sketch takes to find out why a command failed: before LastResult it had
+	to send a second command (IsPressFinger, GetEnrollCount), now it reads the error code the
+	first response already held. Also checks that a data phase that fails (checksum or timeout)
+	after an acknowledged command shows up in LastResult, and the raw parameter of IDs and errors.
+*/
+
+#include "host_test.h"
+#include "fps_sim.h"
+#include "FPS_GT511C3.h"
+
+static const int TRIES = 100;
+
+class Row_Counter : public Image_Row_Handler
+{
+	public:
+		int Rows;
+		Row_Counter() : Rows(0) {}
+		void ImageRow(int /*row*/, byte* /*pixels*/, int /*width*/) { Rows++; }
+};
+
+static void TestLatency(FPS_GT511C3& fps, Fps_Sim& sim)
+{
+	sim.Finger = false;
+
+	// capture with no finger: why did it fail?
+	unsigned long long started = host_micros;
+	for (int i = 0; i < TRIES; i++)
+	{
+		if (fps.CaptureFinger(false) == false) CHECK(fps.IsPressFinger() == false);
+	}
+	unsigned long asking = (unsigned long)((host_micros - started) / TRIES / 1000);
+	started = host_micros;
+	for (int i = 0; i < TRIES; i++)
+	{
+		if (fps.CaptureFinger(false) == false) CHECK(fps.LastResult.NoFinger());
+	}
+	unsigned long reading = (unsigned long)((host_micros - started) / TRIES / 1000);
+	printf("CaptureFinger with no finger: %lu ms -> %lu ms\n", asking, reading);
+	CHECK(reading < asking);
+	CHECK(fps.LastResult.Command == Command_Packet::Commands::CaptureFinger);
+	CHECK(fps.LastResult.Valid);
+
+	// identify on an empty database: no match, or nobody enrolled?
+	sim.Finger = true;
+	CHECK(fps.CaptureFinger(false));
+	started = host_micros;
+	for (int i = 0; i < TRIES; i++)
+	{
+		if (fps.Identify1_N() == 200) CHECK(fps.GetEnrollCount() == 0);
+	}
+	asking = (unsigned long)((host_micros - started) / TRIES / 1000);
+	started = host_micros;
+	for (int i = 0; i < TRIES; i++)
+	{
+		if (fps.Identify1_N() == 200) CHECK(fps.LastResult.Error == Response_Packet::ErrorCodes::NACK_DB_IS_EMPTY);
+	}
+	reading = (unsigned long)((host_micros - started) / TRIES / 1000);
+	printf("Identify1_N on an empty database: %lu ms -> %lu ms\n", asking, reading);
+	CHECK(reading < asking);
+}
+
+static void TestDataPhase(FPS_GT511C3& fps, Fps_Sim& sim)
+{
+	byte tmplt[Fps_Sim::TEMPLATE_SIZE];
+	byte info[FPS_GT511C3::DEVICE_INFO_SIZE];
+	sim.Enroll(3, 30);
+
+	// the template arrives with a bad checksum after the ACK
+	CHECK(fps.GetTemplate(3, tmplt) == 0);
+	CHECK(fps.LastResult.ACK && fps.LastResult.Valid);
+	sim.GarbleData = 1;
+	CHECK(fps.GetTemplate(3, tmplt) == 3);
+	CHECK(fps.LastResult.Command == Command_Packet::Commands::GetTemplate);
+	CHECK(fps.LastResult.ACK == false);
+	CHECK(fps.LastResult.Valid == false);
+	CHECK(fps.LastResult.Error == Response_Packet::ErrorCodes::INVALID);
+	// the whole 498 bytes at 9600 baud went by before the checksum, the response alone takes less
+	CHECK(fps.LastResult.Millis > 500);
+
+	// the device info of Open
+	sim.GarbleData = 1;
+	CHECK(fps.Open(info) == false);
+	CHECK(fps.LastResult.Command == Command_Packet::Commands::Open);
+	CHECK(fps.LastResult.Valid == false);
+	CHECK(fps.Open(info));
+	CHECK(fps.LastResult.Valid);
+
+	// an image cut off by a power loss times out
+	Row_Counter rows;
+	sim.Finger = true;
+	CHECK(fps.CaptureFinger(false));
+	Fps_Sim::Outage outage = { host_micros + 2000000, host_micros + 2500000 };
+	sim.Outages.push_back(outage);
+	CHECK(fps.GetImage(rows) == false);
+	CHECK(rows.Rows == Fps_Sim::IMAGE_HEIGHT);
+	CHECK(fps.LastResult.Command == Command_Packet::Commands::GetImage);
+	CHECK(fps.LastResult.ACK == false);
+	CHECK(fps.LastResult.Valid == false);
+	CHECK(fps.LastResult.Error == Response_Packet::ErrorCodes::INVALID);
+	delay(1000);
+	CHECK(fps.Open());
+	CHECK(sim.PowerCycles == 1);
+}
+
+static void TestParameter()
+{
+	// the raw parameter holds an ID above 255 whole, and the error code of a NACK
+	Fps_Sim sim(6, 3000);
+	FPS_GT511C3 fps(6, 7);
+	fps.ResponseTimeout = 500;
+	CHECK(fps.Open());
+	sim.Enroll(2999, 40);
+	sim.Finger = true;
+	sim.FingerID = 40;
+	CHECK(fps.CaptureFinger(false));
+	fps.Identify1_N();
+	CHECK(fps.LastResult.ACK);
+	CHECK(fps.LastResult.Parameter == 2999);
+	fps.SetLED(true);
+	CHECK(fps.LastResult.Parameter == 0);
+	sim.Delete(2999);
+	fps.Identify1_N();
+	CHECK(fps.LastResult.ACK == false);
+	CHECK(fps.LastResult.Parameter == Response_Packet::ErrorCodes::NACK_DB_IS_EMPTY);
+}
+
+int main()
+{
+	Fps_Sim sim(4, 200);
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 500;
+	CHECK(fps.Open());
+	TestLatency(fps, sim);
+	TestDataPhase(fps, sim);
+	TestParameter();
+	return HOST_TEST_RESULT();
+}
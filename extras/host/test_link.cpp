@@ -0,0 +1,84 @@
+/*
+	test_link.cpp - commands whose response timed out or arrived garbled
+	A missing or garbled response must read as a failure (not found, not pressed, comm error),
+	never as an answer: a timeout leaves a parameter of 0, which is a valid ID. Also checks that
+	ChangeBaudRate moves the scanner and the port to the new rate.
+*/
+
+#include "host_test.h"
+#include "fps_sim.h"
+#include "FPS_GT511C3.h"
+
+Fps_Sim sim(4, 200);
+FPS_GT511C3 fps(4, 5);
+byte tmplt[Fps_Sim::TEMPLATE_SIZE];
+
+// Runs the checks once with the scanner silent and once with every response garbled
+static void Check(const char* how)
+{
+	printf("%s\n", how);
+	unsigned long failures = fps.LinkFailures;
+	CHECK(fps.IsPressFinger() == false);
+	CHECK(fps.Identify1_N() == 200);
+	CHECK(fps.Verify1_1(0) == 4);
+	CHECK(fps.GetEnrollCount() == -1);
+	CHECK(fps.EnrollStart(5) == 4);
+	CHECK(fps.Enroll1() == 4);
+	CHECK(fps.Enroll2() == 4);
+	CHECK(fps.Enroll3() == 4);
+	CHECK(fps.SetTemplate(tmplt, 5, true) == 3002);
+	CHECK(fps.CheckEnrolled(0) == false);
+	CHECK(fps.LastResult.Valid == false);
+	CHECK(fps.LinkFailures - failures == 10);
+}
+
+int main()
+{
+	fps.ResponseTimeout = 300;
+	CHECK(fps.Open());
+	sim.Enroll(0, 10);
+	sim.Finger = true;
+	sim.FingerID = 10;
+	Fps_Sim::MakeTemplate(10, tmplt);
+
+	// the answers when the link works
+	CHECK(fps.IsPressFinger());
+	CHECK(fps.CaptureFinger(false));
+	CHECK(fps.Identify1_N() == 0);
+	CHECK(fps.GetEnrollCount() == 1);
+	CHECK(fps.SetTemplate(tmplt, 5, true) == 0);
+
+	sim.Connected = false;
+	unsigned long long started = host_micros;
+	Check("silent");
+	// each command gave up after ResponseTimeout
+	CHECK(host_micros - started < 10 * 315000ULL);
+	sim.Connected = true;
+
+	sim.GarbleResponses = 1000;
+	Check("garbled");
+	sim.GarbleResponses = 0;
+
+	// ChangeBaudRate
+	CHECK(fps.Open());
+	CHECK(fps.ChangeBaudRate(38400));
+	CHECK(sim.Baud == 38400);
+	CHECK(fps.BaudRate == 38400);
+	CHECK(sim.CommandCounts[Command_Packet::Commands::ChangeEBaudRate] == 1);
+	CHECK(fps.GetEnrollCount() == 1);
+	CHECK(fps.ChangeBaudRate(12345) == false);
+	CHECK(fps.ChangeBaudRate(9600));
+	CHECK((sim.Baud == 9600) && fps.Open());
+
+	// after a power cycle the scanner is back at 9600, DetectBaudRate finds it
+	CHECK(fps.ChangeBaudRate(115200));
+	sim.Outages.push_back(Fps_Sim::Outage());
+	sim.Outages.back().Off = host_micros + 1000;
+	sim.Outages.back().On = host_micros + 500000;
+	delay(600);
+	CHECK(fps.Open() == false);
+	CHECK(fps.DetectBaudRate() == 9600);
+	CHECK(sim.PowerCycles == 1);
+
+	return HOST_TEST_RESULT();
+}
@@ -0,0 +1,89 @@
+/*
+	test_link_watchdog.cpp - an hour of a scanner that keeps losing power, behind Link_Watchdog
+	The scanner drops off at random (every 2-10 s, for 0.5-8 s) and comes back at 9600 baud
+	with its LED off, while the sketch runs at 38400 with the LED on and asks for the enroll
+	count every 200 ms while the link is up. Every outage must be recovered with the baud
+	rate and LED put back. Prints the recovery times, counted from when the scanner is back.
+*/
+
+#include "host_test.h"
+#include "fps_sim.h"
+#include "FPS_GT511C3.h"
+
+static int changes = 0;
+
+static void StateChanged(Link_Watchdog::States::States_Enum /*from*/, Link_Watchdog::States::States_Enum /*to*/)
+{
+	changes++;
+}
+
+int main()
+{
+	const unsigned long long HOUR = 3600ULL * 1000000;
+	Fps_Sim sim(4, 200);
+	sim.Enroll(3, 30);
+	srand(42);
+	unsigned long long at = 0;
+	while (true)
+	{
+		Fps_Sim::Outage outage;
+		outage.Off = at + (2000 + rand() % 8000) * 1000ULL;
+		outage.On = outage.Off + (500 + rand() % 7500) * 1000ULL;
+		if (outage.On >= HOUR) break;
+		sim.Outages.push_back(outage);
+		at = outage.On;
+	}
+
+	FPS_GT511C3 fps(4, 5);
+	CHECK(fps.Open());
+	CHECK(fps.ChangeBaudRate(38400));
+	CHECK(fps.SetLED(true));
+	Link_Watchdog watchdog(fps);
+	watchdog.StateChanged = StateChanged;
+	CHECK(watchdog.Begin());
+
+	bool wasup = true;
+	unsigned long lastcommand = 0;
+	unsigned long badrestores = 0, wrongcounts = 0;
+	unsigned long long total = 0, longest = 0;
+	unsigned long recovered = 0;
+	size_t next = 0;	// the first outage not recovered from yet
+	while (host_micros < HOUR)
+	{
+		bool up = watchdog.Poll();
+		if (up && !wasup)
+		{
+			// the outage that ended last, before the link came back
+			size_t outage = next;
+			while ((outage + 1 < sim.Outages.size()) && (sim.Outages[outage + 1].On <= host_micros)) outage++;
+			if ((outage < sim.Outages.size()) && (sim.Outages[outage].On <= host_micros))
+			{
+				unsigned long long took = host_micros - sim.Outages[outage].On;
+				total += took;
+				if (took > longest) longest = took;
+				recovered += outage + 1 - next;
+				next = outage + 1;
+			}
+			if ((sim.Baud != 38400) || (sim.LedOn == false)) badrestores++;
+		}
+		wasup = up;
+		if (up && (millis() - lastcommand >= 200))
+		{
+			lastcommand = millis();
+			int count = fps.GetEnrollCount();
+			if ((count != 1) && (count != -1)) wrongcounts++;
+		}
+		delay(10);
+	}
+
+	printf("outages %u, watchdog failures %lu, recoveries %lu, state changes %d\n", (unsigned)sim.Outages.size(), watchdog.Failures, watchdog.Recoveries, changes);
+	printf("recovery after the scanner was back: mean %llu ms, max %llu ms\n", total / 1000 / (recovered ? recovered : 1), longest / 1000);
+	printf("restores with the wrong baud rate or LED: %lu\n", badrestores);
+	CHECK(sim.Outages.size() > 300);
+	CHECK(recovered == sim.Outages.size());
+	CHECK(watchdog.Recoveries == watchdog.Failures);
+	CHECK(badrestores == 0);
+	CHECK(wrongcounts == 0);
+	CHECK((sim.Baud == 38400) && sim.LedOn);
+	return HOST_TEST_RESULT();
+}
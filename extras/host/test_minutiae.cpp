@@ -0,0 +1,279 @@
+/*
+	test_minutiae.cpp - Minutiae_Set, Minutiae_Extractor and Minutiae_Matcher
+	The prints are drawn: one pixel wide dark ridges (at half resolution, so the extractor's 2x2
+	average gives them back exactly) with planted ridge endings and bifurcations. The extractor must
+	find every planted minutia, where it was planted and pointing the right way, and nothing else.
+	The matcher must score a shifted copy of a print by the minutiae the two share, find it among
+	50 prints, and reject prints that are not in the gallery. Capture goes through GetImage from a
+	simulated scanner. Prints the scores.
+*/
+
+#include "host_test.h"
+#include "fps_sim.h"
+#include "FPS_GT511C3.h"
+#include <stdlib.h>
+#include <vector>
+
+static const int W = 129;		// half resolution
+static const int H = 101;
+static const int MARGIN = 6;	// Minutiae_Extractor's default
+static const uint8_t LIGHT = 200;
+static const uint8_t DARK = 60;
+
+struct Planted
+{
+	int X;
+	int Y;
+	byte Kind;
+};
+
+struct Drawing
+{
+	uint8_t Pixels[H][W];
+	std::vector<Planted> Minutiae;		// the ones inside the scanned area
+};
+
+static void Plot(Drawing& print, int x, int y)
+{
+	if ((x >= 0) && (x < W) && (y >= 0) && (y < H)) print.Pixels[y][x] = DARK;
+}
+
+static void Plant(Drawing& print, int x, int y, byte kind)
+{
+	if ((x < MARGIN) || (x >= W - MARGIN) || (y < MARGIN) || (y >= H - MARGIN)) return;
+	Planted p = { x, y, kind };
+	print.Minutiae.push_back(p);
+}
+
+// Draws print number seed, moved by (dx, dy): vertical ridges 11 to 14 pixels apart, each of them cut
+// short (an ending, pointing away from the ridge) or with a gap (two endings), some splitting into two
+// branches that go down 5 pixels to each side (a bifurcation, its first branch is the ridge above)
+static void Draw(Drawing& print, int seed, int dx, int dy)
+{
+	memset(print.Pixels, LIGHT, sizeof(print.Pixels));
+	print.Minutiae.clear();
+	// srand(0) is srand(1)
+	srand(seed + 1);
+	bool split = false;
+	int spacing = 11 + rand() % 4;
+	for (int x = 6 + rand() % spacing; x < W - 8; x += spacing)
+	{
+		int top = -20;
+		int bottom = H + 20;
+		int kind = 1 + rand() % 4;
+		// a split ridge next to another one would run into it
+		if ((kind == 4) && split) kind = 3;
+		split = (kind == 4);
+		int a = 15 + rand() % 30;
+		int b = a + 12 + rand() % 35;
+		if (kind == 1) top = a;
+		if (kind == 2) bottom = b;
+		if (kind == 3)
+		{
+			for (int y = top; y <= a; y++) Plot(print, x + dx, y + dy);
+			Plant(print, x + dx, a + dy, 6);
+			top = b;
+		}
+		if (kind == 4)
+		{
+			for (int y = top; y < a; y++) Plot(print, x + dx, y + dy);
+			Plot(print, x + dx, a + dy);
+			Plant(print, x + dx, a + dy, Minutiae_Set::BIFURCATION | 2);
+			for (int side = -1; side <= 1; side += 2)
+			{
+				for (int i = 1; i <= 5; i++) Plot(print, x + dx + side * i, a + i + dy);
+				for (int y = a + 6; y < bottom; y++) Plot(print, x + dx + side * 5, y + dy);
+			}
+			continue;
+		}
+		for (int y = top; y <= bottom; y++) Plot(print, x + dx, y + dy);
+		if (top > 0) Plant(print, x + dx, top + dy, 2);
+		if (bottom < H) Plant(print, x + dx, bottom + dy, 6);
+	}
+}
+
+// Feeds a print to the extractor at full resolution, the way GetImage does
+static void Extract(const Drawing& print, Minutiae_Set& set)
+{
+	Minutiae_Extractor extractor(set);
+	byte row[Fps_Sim::IMAGE_WIDTH];
+	extractor.ImageStart(Fps_Sim::IMAGE_WIDTH, Fps_Sim::IMAGE_HEIGHT);
+	for (int y = 0; y < Fps_Sim::IMAGE_HEIGHT; y++)
+	{
+		for (int x = 0; x < Fps_Sim::IMAGE_WIDTH; x++) row[x] = print.Pixels[y / 2][(x / 2 < W) ? x / 2 : W - 1];
+		extractor.ImageRow(y, row, Fps_Sim::IMAGE_WIDTH);
+	}
+	extractor.ImageEnd();
+	CHECK(extractor.Complete);
+}
+
+// Returns: the number of planted minutiae that are not in the set exactly; extra gets the minutiae
+// in the set that were not planted
+static int Missing(const Drawing& print, const Minutiae_Set& set, int& extra)
+{
+	int retval = 0;
+	int matched = 0;
+	for (size_t i = 0; i < print.Minutiae.size(); i++)
+	{
+		const Planted& p = print.Minutiae[i];
+		bool found = false;
+		for (int j = 0; j < set.Count; j++) found |= (set.X[j] == p.X) && (set.Y[j] == p.Y) && (set.Kind[j] == p.Kind);
+		if (found) matched++; else retval++;
+	}
+	extra = set.Count - matched;
+	return retval;
+}
+
+static void TestSet()
+{
+	Minutiae_Set set;
+	set.Clear();
+	CHECK(set.Count == 0);
+	CHECK(set.Add(10, 10, 1, 4));
+	// closer than the spacing on both axes is the same minutia
+	CHECK(set.Add(13, 7, 2, 4) == false);
+	CHECK(set.Add(14, 10, 2, 4));
+	CHECK(set.Add(10, 14, 2, 4));
+	CHECK((set.Count == 3) && (set.X[1] == 14) && (set.Kind[1] == 2) && (set.Y[2] == 14));
+	while (set.Add((byte)(set.Count * 3), 50, 0, 1)) {}
+	CHECK(set.Count == Minutiae_Set::MAX_MINUTIAE);
+	set.Clear();
+	CHECK(set.Count == 0);
+}
+
+static const int PRINTS = 50;
+
+static void TestExtractor()
+{
+	int planted = 0;
+	int missing = 0;
+	int extras = 0;
+	int fewest = Minutiae_Set::MAX_MINUTIAE;
+	static Drawing print;
+	Minutiae_Set set;
+	for (int seed = 0; seed < PRINTS; seed++)
+	{
+		for (int shift = 0; shift < 3; shift++)
+		{
+			Draw(print, seed, (shift == 0) ? 0 : ((shift == 1) ? 5 : -7), (shift == 0) ? 0 : ((shift == 1) ? -6 : 4));
+			Extract(print, set);
+			int extra;
+			missing += Missing(print, set, extra);
+			extras += extra;
+			planted += (int)print.Minutiae.size();
+			if (set.Count < fewest) fewest = set.Count;
+		}
+	}
+	printf("  extractor: %d prints, %d minutiae planted, %d missed, %d extra, fewest in a print %d\n", PRINTS * 3,
+		planted, missing, extras, fewest);
+	CHECK(missing == 0);
+	CHECK(extras == 0);
+
+	// a blank sensor has none
+	memset(print.Pixels, LIGHT, sizeof(print.Pixels));
+	Extract(print, set);
+	CHECK(set.Count == 0);
+}
+
+static void TestMatcher()
+{
+	static Drawing print;
+	static Minutiae_Set gallery[PRINTS];
+	for (int i = 0; i < PRINTS; i++)
+	{
+		Draw(print, i, 0, 0);
+		Extract(print, gallery[i]);
+	}
+	Minutiae_Matcher matcher;
+	Minutiae_Set probe;
+
+	// a print against itself, and a copy moved across the sensor
+	CHECK(matcher.Score(gallery[3], gallery[3]) == gallery[3].Count);
+	int found = 0;
+	int lowest = Minutiae_Set::MAX_MINUTIAE;
+	int wrongscore = 0;
+	for (int i = 0; i < PRINTS; i++)
+	{
+		Draw(print, i, 6, -5);
+		Extract(print, probe);
+		// every minutia the moved copy still has lines up with the original
+		int shared = 0;
+		for (int j = 0; j < probe.Count; j++)
+		{
+			for (int k = 0; k < gallery[i].Count; k++)
+			{
+				shared += (probe.X[j] == gallery[i].X[k] + 6) && (probe.Y[j] + 5 == gallery[i].Y[k]) && (probe.Kind[j] == gallery[i].Kind[k]);
+			}
+		}
+		int score = matcher.Score(probe, gallery[i]);
+		if (score != shared) wrongscore++;
+		if (score < lowest) lowest = score;
+		if ((matcher.Identify(probe, gallery, PRINTS) == i) && (matcher.LastScore == score)) found++;
+	}
+
+	// prints that are not in the gallery
+	int rejected = 0;
+	int highest = 0;
+	for (int i = 0; i < PRINTS; i++)
+	{
+		Draw(print, 1000 + i, 0, 0);
+		Extract(print, probe);
+		if (matcher.Identify(probe, gallery, PRINTS) < 0) rejected++;
+		if (matcher.LastScore > highest) highest = matcher.LastScore;
+	}
+	printf("  matcher: moved copies score %d at least, %d of %d found; others score %d at most, %d of %d rejected (MinScore %d)\n",
+		lowest, found, PRINTS, highest, rejected, PRINTS, matcher.MinScore);
+	CHECK(wrongscore == 0);
+	CHECK(found == PRINTS);
+	CHECK(rejected == PRINTS);
+	CHECK(lowest >= matcher.MinScore);
+	CHECK(highest < matcher.MinScore);
+
+	// an empty gallery, an empty probe
+	CHECK(matcher.Identify(probe, gallery, 0) == -1);
+	probe.Clear();
+	CHECK(matcher.Score(probe, gallery[0]) == 0);
+	CHECK(matcher.Identify(probe, gallery, PRINTS) == -1);
+}
+
+static void TestCapture()
+{
+	static Drawing print;
+	Draw(print, 7, 0, 0);
+	Minutiae_Set enrolled;
+	Extract(print, enrolled);
+
+	Fps_Sim sim(4, 200);
+	sim.Pixel = [](int, int x, int y) { return print.Pixels[y / 2][(x / 2 < W) ? x / 2 : W - 1]; };
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 500;
+	CHECK(fps.Open());
+	CHECK(fps.ChangeBaudRate(115200));
+	Minutiae_Matcher matcher;
+	Minutiae_Set probe;
+
+	// no finger
+	CHECK(matcher.Capture(fps, probe, false) == false);
+	CHECK(probe.Count == 0);
+
+	sim.Finger = true;
+	CHECK(matcher.Capture(fps, probe, false));
+	CHECK(probe.Count == enrolled.Count);
+	CHECK(matcher.Score(probe, enrolled) == enrolled.Count);
+	printf("  capture at 115200 baud: %lu ms, %d minutiae\n", matcher.CaptureMillis, probe.Count);
+
+	// a garbled image, and a blank sensor (too few minutiae)
+	sim.GarbleData = 1;
+	CHECK(matcher.Capture(fps, probe, false) == false);
+	sim.Pixel = [](int, int, int) { return LIGHT; };
+	CHECK(matcher.Capture(fps, probe, false) == false);
+}
+
+int main()
+{
+	TestSet();
+	TestExtractor();
+	TestMatcher();
+	TestCapture();
+	return HOST_TEST_RESULT();
+}
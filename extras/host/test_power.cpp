@@ -0,0 +1,158 @@
+/*
+	test_power.cpp - Power_Manager on its own, over a simulated scanner at 9600 baud
+	Measures the LED duty while nobody is at the scanner (the time the scanner's LED was really on,
+	against DutyCycle() and the model in the Power_Manager comment), the delay from a finger landing
+	to Poll() saying it is ready, and the way back to idle once the finger is gone. Once polling
+	(with and without Close while idle) and once with the touch output wired to a pin.
+*/
+
+#include "host_test.h"
+#include "fps_sim.h"
+#include "FPS_GT511C3.h"
+#include <stdlib.h>
+
+static const int TOUCH_PIN = 9;
+static const uint8_t CMD_OPEN = 0x01;
+static const uint8_t CMD_CLOSE = 0x02;
+
+// Runs loop() for a while with nobody at the scanner
+static void Idle(Power_Manager& power, unsigned long ms)
+{
+	unsigned long started = millis();
+	while (millis() - started < ms)
+	{
+		CHECK(power.Poll() == false);
+		delay(1);
+	}
+}
+
+static void TestPolling(bool closewhenidle)
+{
+	printf("  polling every 500 ms, %s while idle\n", closewhenidle ? "Close" : "no Close");
+	Fps_Sim sim(4, 200);
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 500;
+	CHECK(fps.Open());
+	CHECK(fps.SetLED(true));
+	Power_Manager power(fps);
+	power.CloseWhenIdle = closewhenidle;
+	power.Begin();
+	CHECK((sim.LedOn == false) && (power.IsAwake() == false));
+
+	// nobody there for a minute
+	unsigned long long ledstarted = sim.LedMicros();
+	unsigned long long started = host_micros;
+	unsigned long opens = sim.CommandCounts[CMD_OPEN];
+	unsigned long closes = sim.CommandCounts[CMD_CLOSE];
+	Idle(power, 60000);
+	double measured = (sim.LedMicros() - ledstarted) * 100.0 / (host_micros - started);
+	double model = power.LastCheckMillis * 100.0 / power.CheckInterval;
+	unsigned long checks = sim.CommandCounts[Command_Packet::Commands::IsPressFinger];
+	printf("    idle: LED on %.2f%% (DutyCycle %.2f%%, model %.2f%%), check %lu ms, %lu checks\n", measured,
+		power.DutyCycle(), model, power.LastCheckMillis, checks);
+	CHECK((checks >= 110) && (checks <= 121));
+	CHECK(fabs(power.DutyCycle() - measured) < 0.5);
+	CHECK(fabs(model - measured) < measured / 5);
+	if (closewhenidle) CHECK((sim.CommandCounts[CMD_OPEN] - opens == checks) && (sim.CommandCounts[CMD_CLOSE] - closes == checks));
+	else CHECK((sim.CommandCounts[CMD_OPEN] == opens) && (sim.CommandCounts[CMD_CLOSE] == closes));
+
+	// fingers landing at random moments
+	srand(closewhenidle ? 1 : 2);
+	unsigned long total = 0;
+	unsigned long worst = 0;
+	unsigned long worstsleep = 0;
+	const int WAKES = 40;
+	for (int i = 0; i < WAKES; i++)
+	{
+		Idle(power, rand() % 1000);
+		sim.Finger = true;
+		unsigned long landed = millis();
+		while (power.Poll() == false) delay(1);
+		unsigned long delay = millis() - landed;
+		total += delay;
+		if (delay > worst) worst = delay;
+		CHECK(sim.LedOn && power.IsAwake());
+		// ready for a capture straight away
+		CHECK(fps.CaptureFinger(false));
+
+		// the finger goes, the LED stays on for IdleTimeout
+		CHECK(power.Poll());
+		sim.Finger = false;
+		unsigned long left = millis();
+		while (power.IsAwake()) power.Poll();
+		unsigned long sleep = millis() - left;
+		if (sleep > worstsleep) worstsleep = sleep;
+		CHECK(sleep >= power.IdleTimeout);
+		CHECK(sim.LedOn == false);
+	}
+	// the model: a check's LED time is about 2 round trips, and the Open takes one more
+	unsigned long open = closewhenidle ? power.LastCheckMillis / 2 : 0;
+	unsigned long mean = total / WAKES;
+	printf("    wake: mean %lu ms, worst %lu ms (model: mean %lu, worst %lu), back to idle after %lu ms at most\n", mean,
+		worst, power.CheckInterval / 2 + power.LastCheckMillis + open, power.CheckInterval + power.LastCheckMillis + open, worstsleep);
+	CHECK(power.Wakes == (unsigned long)WAKES);
+	CHECK(worst <= power.CheckInterval + power.LastCheckMillis + open + 5);
+	CHECK((mean > power.CheckInterval / 4) && (mean < power.CheckInterval * 3 / 4 + power.LastCheckMillis + open));
+	// after IdleTimeout: the last IsPressFinger, then the LED off and the Close
+	CHECK(worstsleep < power.IdleTimeout + 150);
+}
+
+static void TestTouchPin()
+{
+	printf("  touch output on pin %d\n", TOUCH_PIN);
+	Fps_Sim sim(4, 200);
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 500;
+	CHECK(fps.Open());
+	host_pins[TOUCH_PIN] = LOW;
+	Power_Manager power(fps);
+	power.TouchPin = TOUCH_PIN;
+	power.Begin();
+	CHECK(sim.LedOn == false);
+
+	// nobody there: not a single command, the LED stays off
+	unsigned long commands = sim.Commands;
+	unsigned long long led = sim.LedMicros();
+	Idle(power, 60000);
+	printf("    idle: %lu commands, LED on %llu us, DutyCycle %.2f%%\n", sim.Commands - commands, sim.LedMicros() - led, power.DutyCycle());
+	CHECK(sim.Commands == commands);
+	CHECK(sim.LedMicros() == led);
+	CHECK(power.DutyCycle() < 0.1);
+
+	// a finger: the touch output fires at once, the LED is brought up
+	sim.Finger = true;
+	host_pins[TOUCH_PIN] = HIGH;
+	unsigned long landed = millis();
+	while (power.Poll() == false) delay(1);
+	unsigned long wake = millis() - landed;
+	printf("    wake: %lu ms (LED ready after %lu ms)\n", wake, power.LastWakeMillis);
+	CHECK(sim.LedOn && power.IsAwake());
+	CHECK(power.LastWakeMillis > 0);
+	CHECK(wake < power.LastWakeMillis + 100);
+	CHECK(power.Wakes == 1);
+
+	// gone again
+	sim.Finger = false;
+	host_pins[TOUCH_PIN] = LOW;
+	while (power.IsAwake()) power.Poll();
+	CHECK(sim.LedOn == false);
+
+	// an inverted touch output
+	power.TouchActiveLevel = LOW;
+	host_pins[TOUCH_PIN] = HIGH;
+	commands = sim.Commands;
+	Idle(power, 5000);
+	CHECK(sim.Commands == commands);
+	sim.Finger = true;
+	host_pins[TOUCH_PIN] = LOW;
+	while (power.Poll() == false) delay(1);
+	CHECK(sim.LedOn && (power.Wakes == 2));
+}
+
+int main()
+{
+	TestPolling(true);
+	TestPolling(false);
+	TestTouchPin();
+	return HOST_TEST_RESULT();
+}
@@ -0,0 +1,104 @@
+/*
+	test_rx_baud.cpp - the highest baud rate a whole GetImage (52116 bytes) arrives at without loss
+	SoftwareSerial holds 64 bytes and the library only empties it into fps.Rx when it gets to run,
+	so a slow Image_Row_Handler overflows it at high rates. Each case is a handler that stalls for
+	a while per row, optionally calling fps.Pump() between steps. Built for every Rx ring size.
+	Also times a CheckEnrolled sweep over 3000 IDs at 115200, bound by how fast responses are read.
+*/
+// build: -D__AVR__ -DFPS_RX_RING_SIZE=64
+// build: -D__AVR__ -DFPS_RX_RING_SIZE=128
+// build: -D__AVR__ -DFPS_RX_RING_SIZE=256
+
+#include "host_test.h"
+#include "fps_sim.h"
+#include "FPS_GT511C3.h"
+#include <math.h>
+
+// the rates ChangeBaudRate takes, fastest first
+static const unsigned long BAUDS[] = { 115200, 57600, 38400, 19200, 9600 };
+
+class Slow_Handler : public Image_Row_Handler
+{
+	public:
+		FPS_GT511C3* Fps;
+		int Finger;
+		unsigned long StallMicros;
+		int Steps;
+		bool Pump;
+		unsigned long BadPixels;
+
+		void ImageRow(int row, byte* pixels, int width)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				if (pixels[x] != (uint8_t)(128 + 100 * sin((x + 2 * row + Finger) / 3.0))) BadPixels++;
+			}
+			for (int i = 0; i < Steps; i++)
+			{
+				delayMicroseconds(StallMicros / Steps);
+				if (Pump) Fps->Pump();
+			}
+		}
+};
+
+// Returns: true if the image arrived whole at this rate
+static bool Download(unsigned long baud, unsigned long stallmicros, int steps, bool pump)
+{
+	Fps_Sim sim(4, 200);
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 500;
+	if ((fps.Open() == false) || (fps.ChangeBaudRate(baud) == false)) return false;
+	sim.Finger = true;
+	sim.FingerID = 3;
+	if (fps.CaptureFinger(false) == false) return false;
+	Slow_Handler handler;
+	handler.Fps = &fps;
+	handler.Finger = 3;
+	handler.StallMicros = stallmicros;
+	handler.Steps = steps;
+	handler.Pump = pump;
+	handler.BadPixels = 0;
+	bool retval = fps.GetImage(handler);
+	return retval && (handler.BadPixels == 0) && (fps.Rx.Overruns == 0);
+}
+
+// Returns: the highest rate with no loss, 0 if none
+static unsigned long MaxBaud(const char* name, unsigned long stallmicros, int steps, bool pump)
+{
+	unsigned long retval = 0;
+	for (unsigned int i = 0; (i < sizeof(BAUDS) / sizeof(BAUDS[0])) && (retval == 0); i++)
+	{
+		if (Download(BAUDS[i], stallmicros, steps, pump)) retval = BAUDS[i];
+	}
+	printf("  ring %3d, %-28s max baud %lu\n", FPS_RX_RING_SIZE, name, retval);
+	return retval;
+}
+
+static void TestSweep()
+{
+	Fps_Sim sim(4, 3000);
+	for (int i = 0; i < 500; i++) sim.Enroll(i * 6, 100 + i);
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 500;
+	CHECK(fps.Open());
+	CHECK(fps.ChangeBaudRate(115200));
+	unsigned long long started = host_micros;
+	int found = 0;
+	for (int id = 0; id < 3000; id++)
+	{
+		if (fps.CheckEnrolled(id)) found++;
+	}
+	printf("  ring %3d, CheckEnrolled sweep of 3000 IDs at 115200: %.1f s\n", FPS_RX_RING_SIZE, (host_micros - started) / 1000000.0);
+	CHECK(found == 500);
+	CHECK(fps.Rx.Overruns == 0);
+}
+
+int main()
+{
+	CHECK(MaxBaud("handler 0 ms/row", 0, 1, false) == 115200);
+	CHECK(MaxBaud("handler 4 ms/row", 4000, 1, false) == 115200);
+	CHECK(MaxBaud("handler 4 ms/row, Pump x4", 4000, 4, true) == 115200);
+	CHECK(MaxBaud("handler 20 ms/row, Pump x16", 20000, 16, true) >= 57600);
+	TestSweep();
+	return HOST_TEST_RESULT();
+}
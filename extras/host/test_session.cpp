@@ -0,0 +1,153 @@
+/*
+	test_session.cpp - Session_Recorder and Session_Player timing
+	A session is recorded against the simulated scanner, whose response latencies are known:
+	each recorded delay must be the time from the end of the previous frame to the start of the
+	next one, not to its end. The recording is then replayed, and the player must start each
+	response that long after the command it answers (not a frame's wire time later).
+*/
+
+#include "host_test.h"
+#include "fps_sim.h"
+#include "FPS_GT511C3.h"
+
+struct Recorded_Frame
+{
+	byte Kind;
+	unsigned long Gap;
+	std::vector<uint8_t> Bytes;
+};
+
+static unsigned long ReadVarint(const std::vector<uint8_t>& data, size_t& pos)
+{
+	unsigned long value = 0;
+	for (int shift = 0; pos < data.size(); shift += 7)
+	{
+		uint8_t b = data[pos++];
+		value |= (unsigned long)(b & 0x7F) << shift;
+		if ((b & 0x80) == 0) break;
+	}
+	return value;
+}
+
+static std::vector<Recorded_Frame> Parse(const std::vector<uint8_t>& data)
+{
+	std::vector<Recorded_Frame> frames;
+	size_t pos = 5;
+	while (pos < data.size())
+	{
+		Recorded_Frame frame;
+		frame.Kind = data[pos++];
+		frame.Gap = ReadVarint(data, pos);
+		unsigned long length = ReadVarint(data, pos);
+		frame.Bytes.assign(data.begin() + pos, data.begin() + pos + length);
+		pos += length;
+		frames.push_back(frame);
+	}
+	return frames;
+}
+
+// Stands in for the library under test during the replay: what the library sent is already
+// waiting, what the player writes is timed like a blocking serial write
+class Replay_Link : public Stream
+{
+	public:
+		std::vector<uint8_t> Input;
+		size_t Position;
+		std::vector<unsigned long long> WriteTimes;
+		std::vector<unsigned long long> ReadTimes;
+
+		Replay_Link() : Position(0) {}
+		int available() { return (int)(Input.size() - Position); }
+		int read()
+		{
+			if (Position >= Input.size()) return -1;
+			ReadTimes.push_back(host_micros);
+			return Input[Position++];
+		}
+		int peek() { return (Position < Input.size()) ? Input[Position] : -1; }
+		size_t write(uint8_t /*b*/)
+		{
+			WriteTimes.push_back(host_micros);
+			host_micros += Host_Link::ByteMicros(9600);
+			return 1;
+		}
+		using Print::write;
+};
+
+int main()
+{
+	Fps_Sim sim(4, 200);
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 1000;
+	Memory_Stream recording;
+	Session_Recorder recorder(recording);
+	fps.Recorder = &recorder;
+	recorder.Begin();
+
+	sim.Enroll(7, 70);
+	sim.Finger = true;
+	sim.FingerID = 70;
+	CHECK(fps.Open());
+	CHECK(fps.SetLED(true));
+	CHECK(fps.CaptureFinger(false));
+	CHECK(fps.Identify1_N() == 7);
+	byte tmplt[Fps_Sim::TEMPLATE_SIZE];
+	CHECK(fps.GetTemplate(7, tmplt) == 0);
+	fps.Recorder = NULL;
+
+	CHECK(recording.Bytes[4] == Session_Recorder::FORMAT_VERSION);
+	std::vector<Recorded_Frame> frames = Parse(recording.Bytes);
+	CHECK(frames.size() == recorder.Frames);
+
+	// every response starts its latency after the command's last byte
+	int responses = 0;
+	for (size_t i = 1; i < frames.size(); i++)
+	{
+		if ((frames[i].Kind != (Session_Recorder::RECEIVED | Session_Recorder::COMMAND)) || (frames[i - 1].Kind != (Session_Recorder::SENT | Session_Recorder::COMMAND))) continue;
+		byte command = frames[i - 1].Bytes[8];
+		unsigned long latency = (command == 0x60) ? sim.CaptureMicros[0] : sim.Latency[command];
+		long error = (long)frames[i].Gap - (long)latency;
+		printf("command 0x%02X: recorded %lu us, answered after %lu us\n", command, frames[i].Gap, latency);
+		CHECK((error > -50) && (error < 100));
+		responses++;
+	}
+	CHECK(responses == 5);
+	// the template data follows right behind its response
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		if (frames[i].Kind == (Session_Recorder::RECEIVED | Session_Recorder::DATA)) CHECK(frames[i].Gap < 100);
+	}
+
+	// replay: the player reads the commands and times the responses
+	Replay_Link link;
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		if ((frames[i].Kind & Session_Recorder::RECEIVED) == 0) link.Input.insert(link.Input.end(), frames[i].Bytes.begin(), frames[i].Bytes.end());
+	}
+	recording.Position = 0;
+	Session_Player player(recording, link);
+	CHECK(player.Begin());
+	while (player.Step());
+	CHECK(player.Frames == frames.size());
+	CHECK(player.Mismatches == 0);
+	CHECK(player.TimedOut == false);
+
+	// the first response byte goes out the recorded delay after the last command byte was read
+	size_t read = 0, written = 0;
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		if (frames[i].Kind & Session_Recorder::RECEIVED)
+		{
+			if ((i > 0) && ((frames[i - 1].Kind & Session_Recorder::RECEIVED) == 0) && (frames[i].Kind == (Session_Recorder::RECEIVED | Session_Recorder::COMMAND)))
+			{
+				long played = (long)(link.WriteTimes[written] - link.ReadTimes[read - 1]);
+				long error = played - (long)frames[i].Gap;
+				CHECK((error >= 0) && (error < 100));
+			}
+			written += frames[i].Bytes.size();
+		}
+		else read += frames[i].Bytes.size();
+	}
+
+	return HOST_TEST_RESULT();
+}
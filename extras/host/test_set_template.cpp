@@ -0,0 +1,143 @@
+/*
+	test_set_template.cpp - SetTemplate against a simulated GT-521F52 (3000 IDs)
+	A duplicate is reported as a NACK whose parameter is the ID it matched. IDs above 255 have a
+	non-zero high byte, like the error codes, so they must still read as duplicates, and IDs 200-203
+	must not be taken for the result codes (3000-3003).
+	Also provisions a full 3000 ID store the way FPS_Template_Provision does, with a power loss in
+	the middle that leaves gaps, and checks that the second run only uploads the gaps.
+*/
+
+#include "host_test.h"
+#include "fps_sim.h"
+#include "FPS_GT511C3.h"
+
+// The loop of FPS_Template_Provision over a store held in memory: each slot that is not enrolled yet
+// is read from its offset in the store and uploaded
+// Returns: the number of templates uploaded
+static int Provision(FPS_GT511C3& fps, Memory_Stream& file, Template_Store& store, int& uploads)
+{
+	int done = 0;
+	byte tmplt[Fps_Sim::TEMPLATE_SIZE];
+	uploads = 0;
+	for (int slot = 0; slot < store.Capacity; slot++)
+	{
+		if (fps.CheckEnrolled(slot)) continue;
+		file.Position = Template_Store::HEADER_SIZE + (size_t)slot * Template_Store::RECORD_SIZE;
+		int recordslot;
+		if (store.ReadRecord(recordslot, tmplt) != Template_Store::RecordResults::OK) continue;
+		CHECK(recordslot == slot);
+		uploads++;
+		if ((fps.SetTemplate(tmplt, slot, false) == 3000) && fps.LastResult.ACK) done++;
+	}
+	return done;
+}
+
+static void TestProvision()
+{
+	const int CAPACITY = 3000;
+	// the scanner the store was exported from
+	Memory_Stream file;
+	{
+		Fps_Sim source(6, CAPACITY);
+		for (int i = 0; i < CAPACITY; i++) source.Enroll(i, 5000 + i);
+		FPS_GT511C3 fps(6, 7);
+		fps.ResponseTimeout = 1000;
+		CHECK(fps.Open());
+		byte tmplt[Fps_Sim::TEMPLATE_SIZE];
+		Template_Store store(file);
+		CHECK(store.Export(fps, Template_Store::Models::GT521F52, CAPACITY, tmplt) == CAPACITY);
+	}
+
+	Fps_Sim sim(8, CAPACITY);
+	FPS_GT511C3 fps(8, 9);
+	fps.ResponseTimeout = 1000;
+	CHECK(fps.Open());
+	// a slot enrolled by hand before provisioning is left alone
+	sim.Enroll(2, 42);
+
+	// first run: the scanner loses power for a while in the middle
+	Fps_Sim::Outage outage = { host_micros + 600000000ULL, host_micros + 605000000ULL };
+	sim.Outages.push_back(outage);
+	file.Position = 0;
+	Template_Store store(file);
+	CHECK(store.ReadHeader());
+	CHECK(store.Capacity == CAPACITY);
+	int uploads;
+	int first = Provision(fps, file, store, uploads);
+	int gaps = CAPACITY - sim.Count();
+	int firstgap = 0;
+	while (sim.IsEnrolled(firstgap)) firstgap++;
+	printf("  first run: %d of %d uploaded, %d gaps, first gap at %d\n", first, uploads, gaps, firstgap);
+	CHECK(sim.PowerCycles == 1);
+	CHECK(gaps > 0);
+	CHECK(first == uploads - gaps);
+	CHECK(firstgap < CAPACITY - gaps);
+
+	// second run: only the gaps are uploaded, not everything after the first one
+	unsigned long settemplates = sim.CommandCounts[Command_Packet::Commands::SetTemplate];
+	int second = Provision(fps, file, store, uploads);
+	printf("  second run: %d of %d uploaded (resuming after the first gap would upload %d)\n", second, uploads, CAPACITY - firstgap);
+	CHECK(second == gaps);
+	CHECK(uploads == gaps);
+	CHECK(sim.CommandCounts[Command_Packet::Commands::SetTemplate] - settemplates == (unsigned long)gaps);
+	CHECK(sim.Count() == CAPACITY);
+
+	// every slot holds the template of its record, the one enrolled by hand included
+	byte expected[Fps_Sim::TEMPLATE_SIZE];
+	byte tmplt[Fps_Sim::TEMPLATE_SIZE];
+	int wrong = 0;
+	for (int i = 0; i < CAPACITY; i++)
+	{
+		Fps_Sim::MakeTemplate((i == 2) ? 42 : 5000 + i, expected);
+		if ((fps.GetTemplate(i, tmplt) != 0) || (memcmp(tmplt, expected, sizeof(tmplt)) != 0)) wrong++;
+	}
+	CHECK(wrong == 0);
+}
+
+int main()
+{
+	Fps_Sim sim(4, 3000);
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 1000;
+	CHECK(fps.Open());
+
+	byte tmplt[Fps_Sim::TEMPLATE_SIZE];
+
+	// duplicates of IDs across the whole F52 range, including the ones whose low byte looks like an error code
+	int duplicates[] = { 6, 200, 201, 202, 203, 255, 256, 260, 262, 1000, 2999 };
+	for (unsigned int i = 0; i < sizeof(duplicates) / sizeof(duplicates[0]); i++)
+	{
+		sim.Enroll(duplicates[i], 100 + i);
+		Fps_Sim::MakeTemplate(100 + i, tmplt);
+		int result = fps.SetTemplate(tmplt, 2500, true);
+		if (result != duplicates[i]) printf("duplicate of %d returned %d\n", duplicates[i], result);
+		CHECK(result == duplicates[i]);
+		CHECK(!sim.IsEnrolled(2500));
+	}
+
+	// end to end: download a template, upload it to another ID with and without the duplicate check
+	CHECK(fps.GetTemplate(1000, tmplt) == 0);
+	CHECK(fps.SetTemplate(tmplt, 2000, true) == 1000);
+	CHECK(!sim.IsEnrolled(2000));
+	CHECK(fps.SetTemplate(tmplt, 2000, false) == 3000);
+	CHECK(sim.IsEnrolled(2000));
+
+	// a new finger uploads fine
+	Fps_Sim::MakeTemplate(42, tmplt);
+	CHECK(fps.SetTemplate(tmplt, 1500, true) == 3000);
+	CHECK(sim.IsEnrolled(1500));
+
+	// invalid position
+	CHECK(fps.SetTemplate(tmplt, 3000, true) == 3001);
+
+	// a garbled or missing answer is a communications error, never an ID
+	Fps_Sim::MakeTemplate(43, tmplt);
+	sim.GarbleResponses = 1;
+	CHECK(fps.SetTemplate(tmplt, 1501, true) == 3002);
+	sim.Connected = false;
+	CHECK(fps.SetTemplate(tmplt, 1502, true) == 3002);
+	sim.Connected = true;
+
+	TestProvision();
+	return HOST_TEST_RESULT();
+}
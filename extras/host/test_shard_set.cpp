@@ -0,0 +1,105 @@
+/*
+	test_shard_set.cpp - Shard_Set over three simulated scanners
+	Identify and Import read the outcome from LastResult, so they work for both models: with
+	GT-521F52 shards (3000 IDs) the "not found" return value of 3000 must not read as a match.
+*/
+
+#include "host_test.h"
+#include "fps_sim.h"
+#include "FPS_GT511C3.h"
+
+static void TestIdentify(int capacity)
+{
+	Fps_Sim sim0(4, capacity), sim1(6, capacity), sim2(8, capacity);
+	FPS_GT511C3 fps0(4, 5), fps1(6, 7), fps2(8, 9);
+	FPS_GT511C3* shards[] = { &fps0, &fps1, &fps2 };
+	for (int i = 0; i < 3; i++)
+	{
+		shards[i]->ResponseTimeout = 500;
+		CHECK(shards[i]->Open());
+	}
+	Shard_Set set(shards, 3, capacity);
+	byte tmplt[Fps_Sim::TEMPLATE_SIZE];
+
+	sim0.Finger = true;
+	sim0.FingerID = 77;
+
+	// nobody enrolled anywhere
+	CHECK(set.Identify(tmplt) == -1);
+	CHECK(set.FailedShards == 0);
+
+	// enrolled on the last shard, at a slot above 255
+	int slot = capacity - 1;
+	sim1.Enroll(0, 5);
+	sim2.Enroll(slot, 77);
+	CHECK(set.Identify(tmplt) == 2L * capacity + slot);
+	CHECK(set.LastShard == 2);
+	CHECK(set.FailedShards == 0);
+
+	// not enrolled, with shards that hold other fingers
+	sim2.Delete(slot);
+	sim2.Enroll(1, 6);
+	CHECK(set.Identify(tmplt) == -1);
+	CHECK(set.LastShard == -1);
+	CHECK(set.FailedShards == 0);
+
+	// a dead shard is reported and skipped
+	sim0.Enroll(3, 78);
+	sim2.Enroll(4, 77);
+	sim1.Connected = false;
+	CHECK(set.Identify(tmplt) == 2L * capacity + 4);
+	CHECK(set.FailedShards == (1 << 1));
+
+	// no finger
+	sim0.Finger = false;
+	CHECK(set.Identify(tmplt) == -2);
+}
+
+static void TestImport()
+{
+	const int SHARD = 200;
+	byte tmplt[Fps_Sim::TEMPLATE_SIZE];
+
+	// a store of 600 global slots, exported from one big scanner
+	Memory_Stream stream;
+	{
+		Fps_Sim source(10, 3 * SHARD);
+		FPS_GT511C3 fps(10, 11);
+		fps.ResponseTimeout = 500;
+		CHECK(fps.Open());
+		int slots[] = { 0, 199, 200, 310, 599 };
+		for (int i = 0; i < 5; i++) source.Enroll(slots[i], 1000 + i);
+		Template_Store store(stream);
+		CHECK(store.Export(fps, Template_Store::Models::GT521F52, 3 * SHARD, tmplt) == 5);
+	}
+
+	Fps_Sim sim0(4, SHARD), sim1(6, SHARD), sim2(8, SHARD);
+	FPS_GT511C3 fps0(4, 5), fps1(6, 7), fps2(8, 9);
+	FPS_GT511C3* shards[] = { &fps0, &fps1, &fps2 };
+	for (int i = 0; i < 3; i++)
+	{
+		shards[i]->ResponseTimeout = 500;
+		CHECK(shards[i]->Open());
+	}
+	Shard_Set set(shards, 3, SHARD);
+	Template_Store store(stream);
+	CHECK(set.Import(store, tmplt) == 5);
+	CHECK(sim0.IsEnrolled(0) && sim0.IsEnrolled(199) && (sim0.Count() == 2));
+	CHECK(sim1.IsEnrolled(0) && sim1.IsEnrolled(110) && (sim1.Count() == 2));
+	CHECK(sim2.IsEnrolled(199) && (sim2.Count() == 1));
+
+	// a shard that does not take the template is not counted
+	stream.Position = 0;
+	sim1.Connected = false;
+	for (int id = 0; id < SHARD; id++) { sim0.Delete(id); sim2.Delete(id); }
+	Template_Store again(stream);
+	CHECK(set.Import(again, tmplt) == 3);
+}
+
+int main()
+{
+	TestIdentify(200);
+	TestIdentify(3000);
+	TestImport();
+	return HOST_TEST_RESULT();
+}
@@ -0,0 +1,161 @@
+/*
+	test_signature.cpp - Template_Store::TemplateSignature and SignatureDistance
+	Nearly all copies of a template with a few bytes changed must land within the distance
+	FPS_Find_Duplicates uses (3), unrelated templates must not. Prints the distances seen for both. Also finds planted
+	near copies among the templates downloaded from a simulated scanner, like the example does.
+*/
+
+#include "host_test.h"
+#include "fps_sim.h"
+#include "FPS_GT511C3.h"
+#include <stdlib.h>
+
+static const int MAX_DISTANCE = 3;
+static const int FINGERS = 1000;
+
+static int PlainDistance(uint32_t a, uint32_t b)
+{
+	int count = 0;
+	for (int bit = 0; bit < 32; bit++) count += ((a >> bit) & 1) != ((b >> bit) & 1);
+	return count;
+}
+
+// Changes count bytes of the template to other values
+static void Mutate(byte* tmplt, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		int at = rand() % Fps_Sim::TEMPLATE_SIZE;
+		tmplt[at] ^= (byte)(1 + rand() % 255);
+	}
+}
+
+static void TestDistance()
+{
+	CHECK(Template_Store::SignatureDistance(0, 0) == 0);
+	CHECK(Template_Store::SignatureDistance(0, 0xFFFFFFFFUL) == 32);
+	CHECK(Template_Store::SignatureDistance(0x80000001UL, 0) == 2);
+	srand(1);
+	int wrong = 0;
+	for (int i = 0; i < 100000; i++)
+	{
+		uint32_t a = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+		uint32_t b = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+		if (Template_Store::SignatureDistance(a, b) != PlainDistance(a, b)) wrong++;
+	}
+	CHECK(wrong == 0);
+}
+
+static void TestCopies()
+{
+	srand(2);
+	byte tmplt[Fps_Sim::TEMPLATE_SIZE];
+	byte copy[Fps_Sim::TEMPLATE_SIZE];
+	int changes[] = { 1, 2, 5, 10, 25 };
+	for (unsigned int c = 0; c < sizeof(changes) / sizeof(changes[0]); c++)
+	{
+		int histogram[33] = { 0 };
+		int worst = 0;
+		for (int f = 0; f < FINGERS; f++)
+		{
+			Fps_Sim::MakeTemplate(f, tmplt);
+			memcpy(copy, tmplt, sizeof(copy));
+			Mutate(copy, changes[c]);
+			int distance = Template_Store::SignatureDistance(Template_Store::TemplateSignature(tmplt), Template_Store::TemplateSignature(copy));
+			histogram[distance]++;
+			if (distance > worst) worst = distance;
+		}
+		int within = 0;
+		for (int d = 0; d <= MAX_DISTANCE; d++) within += histogram[d];
+		printf("  %2d bytes changed: %4d of %d copies within %d bits, worst %d\n", changes[c], within, FINGERS, MAX_DISTANCE, worst);
+		// a bit whose votes were tied or nearly tied can flip for a single byte, so a few copies
+		// fall just outside, but nearly all of them are found
+		if (changes[c] <= 2) CHECK(within >= FINGERS * 98 / 100);
+		if (changes[c] <= 5) CHECK(within >= FINGERS * 9 / 10);
+		if (changes[c] <= 2) CHECK(worst <= MAX_DISTANCE + 2);
+	}
+
+	// the same template always gives the same signature
+	Fps_Sim::MakeTemplate(5, tmplt);
+	memcpy(copy, tmplt, sizeof(copy));
+	CHECK(Template_Store::TemplateSignature(tmplt) == Template_Store::TemplateSignature(copy));
+}
+
+static void TestUnrelated()
+{
+	static uint32_t signatures[FINGERS];
+	byte tmplt[Fps_Sim::TEMPLATE_SIZE];
+	for (int f = 0; f < FINGERS; f++)
+	{
+		Fps_Sim::MakeTemplate(f, tmplt);
+		signatures[f] = Template_Store::TemplateSignature(tmplt);
+	}
+	long pairs = 0;
+	long close = 0;
+	double total = 0;
+	for (int a = 0; a < FINGERS; a++)
+	{
+		for (int b = a + 1; b < FINGERS; b++)
+		{
+			int distance = Template_Store::SignatureDistance(signatures[a], signatures[b]);
+			total += distance;
+			if (distance <= MAX_DISTANCE) close++;
+			pairs++;
+		}
+	}
+	printf("  unrelated: %ld pairs, mean distance %.2f, %ld within %d bits\n", pairs, total / pairs, close, MAX_DISTANCE);
+	CHECK((total / pairs > 15) && (total / pairs < 17));
+	CHECK(close <= 5);
+}
+
+static void TestFindDuplicates()
+{
+	// 200 fingers, with near copies of 10 in 150, 20 in 151 and 30 in 199
+	Fps_Sim sim(4, 200);
+	for (int i = 0; i < 200; i++) sim.Enroll(i, 3000 + i);
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 500;
+	CHECK(fps.Open());
+	CHECK(fps.ChangeBaudRate(115200));
+	byte tmplt[Fps_Sim::TEMPLATE_SIZE];
+	srand(3);
+	int planted[][2] = { { 10, 150 }, { 20, 151 }, { 30, 199 } };
+	for (int i = 0; i < 3; i++)
+	{
+		CHECK(fps.GetTemplate(planted[i][0], tmplt) == 0);
+		Mutate(tmplt, 2);
+		CHECK(fps.DeleteID(planted[i][1]));
+		CHECK(fps.SetTemplate(tmplt, planted[i][1], false) == 3000);
+	}
+
+	uint32_t signatures[200];
+	for (int i = 0; i < 200; i++)
+	{
+		CHECK(fps.GetTemplate(i, tmplt) == 0);
+		signatures[i] = Template_Store::TemplateSignature(tmplt);
+	}
+	int found = 0;
+	int other = 0;
+	for (int a = 0; a < 200; a++)
+	{
+		for (int b = a + 1; b < 200; b++)
+		{
+			if (Template_Store::SignatureDistance(signatures[a], signatures[b]) > MAX_DISTANCE) continue;
+			bool isplanted = false;
+			for (int i = 0; i < 3; i++) isplanted |= (planted[i][0] == a) && (planted[i][1] == b);
+			if (isplanted) found++; else other++;
+		}
+	}
+	printf("  scanner of 200: %d of 3 planted copies found, %d other pairs\n", found, other);
+	CHECK(found == 3);
+	CHECK(other == 0);
+}
+
+int main()
+{
+	TestDistance();
+	TestCopies();
+	TestUnrelated();
+	TestFindDuplicates();
+	return HOST_TEST_RESULT();
+}
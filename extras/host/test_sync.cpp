@@ -0,0 +1,185 @@
+/*
+	test_sync.cpp - Template_Store::Sync against a simulated scanner (200 IDs)
+	Syncs a store onto an empty scanner, then a changed store with unchanged, replaced, deleted and
+	new slots, while some of the DeleteID and SetTemplate commands are lost on the line. A slot whose
+	delete or upload failed must count as Failed and be marked for the next sync (which fixes it),
+	even when CheckEnrolled still finds the old template in it. Also checks that TemplateHash never
+	gives the two manifest markers, 0 (empty) and 0xFFFFFFFF (check again).
+*/
+
+#include "host_test.h"
+#include "fps_sim.h"
+#include "FPS_GT511C3.h"
+#include <map>
+
+static const int CAPACITY = 200;
+static const uint8_t CMD_DELETE_ID = 0x40;
+static const uint8_t CMD_SET_TEMPLATE = 0x71;
+
+// Exports a scanner holding the given fingers (slot -> finger) into a store
+static void MakeStore(Memory_Stream& file, std::map<int, int>& fingers)
+{
+	Fps_Sim source(6, CAPACITY);
+	for (std::map<int, int>::iterator i = fingers.begin(); i != fingers.end(); ++i) source.Enroll(i->first, i->second);
+	FPS_GT511C3 fps(6, 7);
+	fps.ResponseTimeout = 300;
+	CHECK(fps.Open());
+	byte tmplt[Fps_Sim::TEMPLATE_SIZE];
+	Template_Store store(file);
+	CHECK(store.Export(fps, Template_Store::Models::GT511C3, CAPACITY, tmplt) == (int)fingers.size());
+	file.Position = 0;
+}
+
+static void Sync(FPS_GT511C3& fps, Memory_Stream& file, Memory_Stream* manifestIn, Memory_Stream& manifestOut, Template_Store::SyncResults& results)
+{
+	byte tmplt[Fps_Sim::TEMPLATE_SIZE];
+	Template_Store store(file);
+	if (manifestIn != NULL) manifestIn->Position = 0;
+	manifestOut.Bytes.clear();
+	manifestOut.Position = 0;
+	CHECK(store.Sync(fps, manifestIn, &manifestOut, tmplt, results));
+	CHECK(manifestOut.Bytes.size() == CAPACITY * 4);
+	printf("  uploaded %d, deleted %d, unchanged %d, failed %d, %lu bytes sent\n", results.Uploaded,
+		results.Deleted, results.Unchanged, results.Failed, results.BytesSent);
+}
+
+static uint32_t ManifestHash(Memory_Stream& manifest, int slot)
+{
+	return (uint32_t)manifest.Bytes[slot * 4] | ((uint32_t)manifest.Bytes[slot * 4 + 1] << 8) |
+		((uint32_t)manifest.Bytes[slot * 4 + 2] << 16) | ((uint32_t)manifest.Bytes[slot * 4 + 3] << 24);
+}
+
+// Returns: the number of slots on the scanner that do not hold the finger the store has for them
+static int Mismatches(Fps_Sim& sim, std::map<int, int>& fingers)
+{
+	int retval = 0;
+	byte expected[Fps_Sim::TEMPLATE_SIZE];
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 300;
+	byte tmplt[Fps_Sim::TEMPLATE_SIZE];
+	for (int i = 0; i < CAPACITY; i++)
+	{
+		if (fingers.count(i) == 0)
+		{
+			if (sim.IsEnrolled(i)) retval++;
+			continue;
+		}
+		Fps_Sim::MakeTemplate(fingers[i], expected);
+		if ((fps.GetTemplate(i, tmplt) != 0) || (memcmp(tmplt, expected, sizeof(tmplt)) != 0)) retval++;
+	}
+	return retval;
+}
+
+static void TestSync()
+{
+	Fps_Sim sim(4, CAPACITY);
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 300;
+	CHECK(fps.Open());
+	Template_Store::SyncResults results;
+
+	// first sync, no manifest yet
+	std::map<int, int> fingers;
+	for (int i = 0; i < 20; i++) fingers[i] = 100 + i;
+	Memory_Stream file1;
+	MakeStore(file1, fingers);
+	Memory_Stream manifest1;
+	Sync(fps, file1, NULL, manifest1, results);
+	CHECK(results.Uploaded == 20);
+	CHECK(results.Failed == 0);
+	CHECK(results.Unchanged == CAPACITY - 20);
+	CHECK(Mismatches(sim, fingers) == 0);
+
+	// the store changes: 5-7 replaced, 8-9 removed, 20-21 added
+	for (int i = 5; i <= 7; i++) fingers[i] = 200 + i;
+	fingers.erase(8);
+	fingers.erase(9);
+	fingers[20] = 120;
+	fingers[21] = 121;
+	Memory_Stream file2;
+	MakeStore(file2, fingers);
+	// someone enrolled 21 behind the manifest's back
+	sim.Enroll(21, 999);
+	// the DeleteID of 6 is lost, so its old template stays, and the uploads of 7 and 21 are lost
+	sim.Lose = [](uint8_t command, unsigned long parameter)
+	{
+		return ((command == CMD_DELETE_ID) && (parameter == 6)) ||
+			((command == CMD_SET_TEMPLATE) && (((parameter & 0xFFFF) == 7) || ((parameter & 0xFFFF) == 21)));
+	};
+	Memory_Stream manifest2;
+	Sync(fps, file2, &manifest1, manifest2, results);
+	sim.Lose = nullptr;
+	CHECK(results.Uploaded == 2);
+	CHECK(results.Deleted == 2);
+	CHECK(results.Failed == 3);
+	CHECK(results.Unchanged == CAPACITY - 7);
+	// 6 and 21 still hold a template (not the store's), they are failures all the same
+	CHECK(sim.IsEnrolled(6) && sim.IsEnrolled(21));
+	CHECK(!sim.IsEnrolled(7) && !sim.IsEnrolled(8) && !sim.IsEnrolled(9));
+	CHECK(ManifestHash(manifest2, 6) == 0xFFFFFFFF);
+	CHECK(ManifestHash(manifest2, 7) == 0xFFFFFFFF);
+	CHECK(ManifestHash(manifest2, 21) == 0xFFFFFFFF);
+	CHECK(ManifestHash(manifest2, 8) == 0);
+	CHECK(Mismatches(sim, fingers) == 3);
+
+	// the next sync fixes the three
+	file2.Position = 0;
+	Memory_Stream manifest3;
+	Sync(fps, file2, &manifest2, manifest3, results);
+	CHECK(results.Uploaded == 3);
+	CHECK(results.Failed == 0);
+	CHECK(results.Deleted == 0);
+	CHECK(results.Unchanged == CAPACITY - 3);
+	CHECK(Mismatches(sim, fingers) == 0);
+
+	// and then there is nothing left to do
+	file2.Position = 0;
+	Memory_Stream manifest4;
+	Sync(fps, file2, &manifest3, manifest4, results);
+	CHECK(results.Unchanged == CAPACITY);
+	CHECK(results.BytesSent == 0);
+	CHECK(manifest4.Bytes == manifest3.Bytes);
+}
+
+static void TestHashMarkers()
+{
+	// FNV-1a runs backwards one byte at a time: find a template whose plain hash is 0xFFFFFFFF by
+	// trying four bytes before the last until the state before the final byte lines up with it
+	const uint32_t PRIME = 16777619UL;
+	uint32_t inverse = PRIME;
+	for (int i = 0; i < 5; i++) inverse *= 2 - PRIME * inverse;
+	uint32_t beforelast = 0xFFFFFFFFUL * inverse;
+
+	byte tmplt[Fps_Sim::TEMPLATE_SIZE];
+	Fps_Sim::MakeTemplate(7, tmplt);
+	const int N = Fps_Sim::TEMPLATE_SIZE;
+	uint32_t prefix = 2166136261UL;
+	for (int i = 0; i < N - 5; i++) prefix = (prefix ^ tmplt[i]) * PRIME;
+	bool found = false;
+	uint32_t tail = 0;
+	do
+	{
+		uint32_t hash = prefix;
+		for (int i = 0; i < 4; i++) hash = (hash ^ ((tail >> (8 * i)) & 0xFF)) * PRIME;
+		if ((hash ^ beforelast) < 0x100)
+		{
+			for (int i = 0; i < 4; i++) tmplt[N - 5 + i] = (byte)(tail >> (8 * i));
+			tmplt[N - 1] = (byte)(hash ^ beforelast);
+			found = true;
+		}
+		tail++;
+	} while ((found == false) && (tail != 0));
+	CHECK(found);
+	uint32_t plain = 2166136261UL;
+	for (int i = 0; i < N; i++) plain = (plain ^ tmplt[i]) * PRIME;
+	CHECK(plain == 0xFFFFFFFF);
+	printf("  a template whose FNV-1a is 0xFFFFFFFF gets TemplateHash %08lX\n", (unsigned long)Template_Store::TemplateHash(tmplt));
+	CHECK(Template_Store::TemplateHash(tmplt) == 0xFFFFFFFE);
+}
+
+int main()
+{
+	TestSync();
+	TestHashMarkers();
+	return HOST_TEST_RESULT();
+}
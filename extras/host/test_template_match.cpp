@@ -0,0 +1,147 @@
+/*
+	test_template_match.cpp - CaptureTemplate, VerifyTemplate1_1 and VerifyTemplateAny over a simulated scanner
+	CaptureTemplate must give the template of the finger on the sensor (and false with no finger, or
+	when the download is garbled). VerifyTemplate1_1 must give each of its return codes, for IDs above
+	255 on a GT-521F52 too. VerifyTemplateAny must stop at the first match and give -1 for none, even
+	when 200 is one of the IDs. Also prints the time of one capture matched against several IDs,
+	against a capture and Verify1_1 for each ID, at 9600 and 115200 baud.
+*/
+
+#include "host_test.h"
+#include "fps_sim.h"
+#include "FPS_GT511C3.h"
+
+static const uint8_t CMD_CAPTURE = 0x60;
+static const uint8_t CMD_VERIFY_TEMPLATE = 0x52;
+
+static void TestCaptureTemplate()
+{
+	Fps_Sim sim(4, 200);
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 500;
+	CHECK(fps.Open());
+	byte tmplt[Fps_Sim::TEMPLATE_SIZE];
+	byte expected[Fps_Sim::TEMPLATE_SIZE];
+
+	// no finger
+	CHECK(fps.CaptureTemplate(tmplt, false) == false);
+
+	// the finger's template, in both qualities
+	sim.Finger = true;
+	sim.FingerID = 42;
+	Fps_Sim::MakeTemplate(42, expected);
+	memset(tmplt, 0, sizeof(tmplt));
+	CHECK(fps.CaptureTemplate(tmplt, false));
+	CHECK(memcmp(tmplt, expected, sizeof(tmplt)) == 0);
+	memset(tmplt, 0, sizeof(tmplt));
+	CHECK(fps.CaptureTemplate(tmplt, true));
+	CHECK(memcmp(tmplt, expected, sizeof(tmplt)) == 0);
+
+	// a garbled download is not a template
+	sim.GarbleData = 1;
+	CHECK(fps.CaptureTemplate(tmplt, false) == false);
+	CHECK(fps.CaptureTemplate(tmplt, false));
+	CHECK(memcmp(tmplt, expected, sizeof(tmplt)) == 0);
+}
+
+static void TestVerifyTemplate(int capacity)
+{
+	Fps_Sim sim(4, capacity);
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 500;
+	CHECK(fps.Open());
+	int high = capacity - 1;
+	sim.Enroll(0, 10);
+	if (capacity > 200) sim.Enroll(200, 11);
+	sim.Enroll(high, 12);
+	byte tmplt[Fps_Sim::TEMPLATE_SIZE];
+	sim.Finger = true;
+	sim.FingerID = 12;
+	CHECK(fps.CaptureTemplate(tmplt, false));
+
+	CHECK(fps.VerifyTemplate1_1(high, tmplt) == 0);
+	CHECK(fps.LastResult.ACK);
+	CHECK(fps.VerifyTemplate1_1(0, tmplt) == 3);
+	CHECK(fps.VerifyTemplate1_1(1, tmplt) == 2);
+	CHECK(fps.VerifyTemplate1_1(capacity, tmplt) == 1);
+	if (capacity > 200) CHECK(fps.VerifyTemplate1_1(200, tmplt) == 3);
+	else CHECK(fps.VerifyTemplate1_1(200, tmplt) == 1);
+
+	// the template is not taken: no answer, or a garbled one to the command or to the data
+	sim.Connected = false;
+	CHECK(fps.VerifyTemplate1_1(high, tmplt) == 4);
+	sim.Connected = true;
+	sim.GarbleResponses = 1;
+	CHECK(fps.VerifyTemplate1_1(high, tmplt) == 4);
+	CHECK(fps.VerifyTemplate1_1(high, tmplt) == 0);
+	sim.Lose = [](uint8_t command, unsigned long) { return command == CMD_VERIFY_TEMPLATE; };
+	CHECK(fps.VerifyTemplate1_1(high, tmplt) == 4);
+	sim.Lose = nullptr;
+	CHECK(fps.VerifyTemplate1_1(high, tmplt) == 0);
+
+	// the first match in the list; 200 is a slot like any other on a GT-521F52
+	int ids[] = { 0, 1, 200, high };
+	CHECK(fps.VerifyTemplateAny(tmplt, ids, 4) == high);
+	CHECK(fps.VerifyTemplateAny(tmplt, ids, 3) == -1);
+	if (capacity > 200)
+	{
+		sim.FingerID = 11;
+		CHECK(fps.CaptureTemplate(tmplt, false));
+		CHECK(fps.VerifyTemplateAny(tmplt, ids, 4) == 200);
+	}
+	sim.FingerID = 999;
+	CHECK(fps.CaptureTemplate(tmplt, false));
+	CHECK(fps.VerifyTemplateAny(tmplt, ids, 4) == -1);
+	CHECK(fps.VerifyTemplateAny(tmplt, ids, 0) == -1);
+}
+
+// One capture matched against count IDs, against count captures each with a Verify1_1
+static void Timing(unsigned long baud, int count)
+{
+	Fps_Sim sim(4, 200);
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 1000;
+	CHECK(fps.Open());
+	if (baud != 9600) CHECK(fps.ChangeBaudRate(baud));
+	int ids[8];
+	for (int i = 0; i < count; i++)
+	{
+		ids[i] = 10 + i;
+		sim.Enroll(ids[i], 100 + i);
+	}
+	sim.Finger = true;
+	sim.FingerID = 100 + count - 1;
+
+	unsigned long captures = sim.CommandCounts[CMD_CAPTURE];
+	unsigned long started = millis();
+	byte tmplt[Fps_Sim::TEMPLATE_SIZE];
+	CHECK(fps.CaptureTemplate(tmplt, false));
+	CHECK(fps.VerifyTemplateAny(tmplt, ids, count) == ids[count - 1]);
+	unsigned long once = millis() - started;
+	CHECK(sim.CommandCounts[CMD_CAPTURE] - captures == 1);
+
+	captures = sim.CommandCounts[CMD_CAPTURE];
+	started = millis();
+	int found = -1;
+	for (int i = 0; (i < count) && (found < 0); i++)
+	{
+		CHECK(fps.CaptureFinger(false));
+		if (fps.Verify1_1(ids[i]) == 0) found = ids[i];
+	}
+	unsigned long each = millis() - started;
+	CHECK(found == ids[count - 1]);
+	CHECK(sim.CommandCounts[CMD_CAPTURE] - captures == (unsigned long)count);
+	printf("  %6lu baud, %d IDs: capture once %4lu ms, capture each time %4lu ms\n", baud, count, once, each);
+}
+
+int main()
+{
+	TestCaptureTemplate();
+	TestVerifyTemplate(200);
+	TestVerifyTemplate(3000);
+	Timing(9600, 1);
+	Timing(9600, 8);
+	Timing(115200, 1);
+	Timing(115200, 8);
+	return HOST_TEST_RESULT();
+}
@@ -0,0 +1,199 @@
+/*
+	test_warm_start.cpp - Warm_Start over a simulated scanner, run at 38400 baud like the example
+	Prints the time to ready and the commands sent for a cold start (no snapshot), a warm start
+	after an arduino reset (the scanner is still at 38400), a warm start after a power cycle (the
+	scanner is back at 9600 and has to be moved to 38400 again), and the fallbacks to a scan.
+	Also checks Scan and Validate on their own, and what SaveEEPROM writes.
+*/
+
+#include "host_test.h"
+#include "fps_sim.h"
+#include "FPS_GT511C3.h"
+#include "avr/eeprom.h"
+#include <set>
+
+static const unsigned long BAUD = 38400;
+static const int SNAPSHOT_ADDRESS = 0;
+
+static unsigned long long _started;
+static unsigned long _commands;
+
+static void Mark(Fps_Sim& sim)
+{
+	_started = host_micros;
+	_commands = sim.Commands;
+}
+
+static void Report(const char* what, Fps_Sim& sim, Warm_Start& snapshot)
+{
+	printf("    %-32s %8.0f ms %6lu commands  warm=%d\n", what, (host_micros - _started) / 1000.0,
+		sim.Commands - _commands, snapshot.Warm);
+}
+
+static void PowerCycle(Fps_Sim& sim)
+{
+	Fps_Sim::Outage outage = { host_micros + 1000, host_micros + 100000 };
+	sim.Outages.push_back(outage);
+	delay(200);
+	sim.Update();
+}
+
+static void TestStarts(int capacity, int enrolled, bool spread)
+{
+	printf("  %d IDs, %d enrolled (%s), %lu baud\n", capacity, enrolled, spread ? "spread" : "low IDs", BAUD);
+	Fps_Sim sim(4, capacity);
+	for (int i = 0; i < FPS_GT511C3::DEVICE_INFO_SIZE; i++) sim.DeviceInfo[i] = i * 7 + 1;
+	std::set<int> ids;
+	srand(1);
+	while ((int)ids.size() < enrolled) ids.insert(spread ? rand() % capacity : (int)ids.size());
+	for (std::set<int>::iterator i = ids.begin(); i != ids.end(); ++i) sim.Enroll(*i, 1000 + *i);
+	for (int i = 0; i <= E2END; i++) host_eeprom[i] = 0xFF;
+
+	byte bitmap[375];
+	// first boot: nothing saved
+	{
+		FPS_GT511C3 fps(4, 5);
+		fps.ResponseTimeout = 2000;
+		Warm_Start snapshot(bitmap, capacity);
+		snapshot.BaudRate = BAUD;
+		Mark(sim);
+		CHECK(snapshot.Start(fps, false));
+		Report("cold start (no snapshot)", sim, snapshot);
+		CHECK(snapshot.Warm == false);
+		CHECK(snapshot.Count() == enrolled);
+		CHECK(sim.Baud == BAUD);
+		host_eeprom_writes = 0;
+		snapshot.SaveEEPROM(SNAPSHOT_ADDRESS);
+		CHECK(host_eeprom_writes <= (unsigned long)Warm_Start::Size(capacity));
+		CHECK(snapshot.Changed() == false);
+
+		// one delete, and only the bytes that changed are written again
+		if (enrolled > 0)
+		{
+			fps.Snapshot = &snapshot;
+			int id = *ids.begin();
+			CHECK(fps.DeleteID(id));
+			CHECK(snapshot.Changed());
+			host_eeprom_writes = 0;
+			snapshot.SaveEEPROM(SNAPSHOT_ADDRESS);
+			CHECK(host_eeprom_writes <= 6);
+			sim.Enroll(id, 1000 + id);
+			snapshot.SetEnrolled(id, true);
+			snapshot.SaveEEPROM(SNAPSHOT_ADDRESS);
+		}
+	}
+	// arduino reset: the scanner is still at 38400
+	{
+		FPS_GT511C3 fps(4, 5);
+		fps.ResponseTimeout = 2000;
+		Warm_Start snapshot(bitmap, capacity);
+		bool loaded = snapshot.LoadEEPROM(SNAPSHOT_ADDRESS);
+		CHECK(loaded);
+		CHECK(snapshot.BaudRate == BAUD);
+		Mark(sim);
+		CHECK(snapshot.Start(fps, loaded));
+		Report("warm start (arduino reset)", sim, snapshot);
+		CHECK(snapshot.Warm);
+		CHECK(snapshot.Count() == enrolled);
+	}
+	// power cycle: the scanner is back at 9600
+	{
+		PowerCycle(sim);
+		CHECK(sim.Baud == 9600);
+		FPS_GT511C3 fps(4, 5);
+		fps.ResponseTimeout = 2000;
+		Warm_Start snapshot(bitmap, capacity);
+		bool loaded = snapshot.LoadEEPROM(SNAPSHOT_ADDRESS);
+		Mark(sim);
+		CHECK(snapshot.Start(fps, loaded));
+		Report("warm start (power cycle)", sim, snapshot);
+		CHECK(snapshot.Warm);
+		CHECK(sim.Baud == BAUD);
+		// and the scanner answers at 38400
+		CHECK(fps.GetEnrollCount() == enrolled);
+		CHECK(fps.LastResult.ACK);
+	}
+	// enrolled behind the snapshot's back: the count is off, so it scans
+	{
+		int extra = 0;
+		while (ids.count(extra)) extra++;
+		sim.Enroll(extra, 1000 + extra);
+		FPS_GT511C3 fps(4, 5);
+		fps.ResponseTimeout = 2000;
+		Warm_Start snapshot(bitmap, capacity);
+		bool loaded = snapshot.LoadEEPROM(SNAPSHOT_ADDRESS);
+		Mark(sim);
+		CHECK(snapshot.Start(fps, loaded));
+		Report("stale snapshot (scans)", sim, snapshot);
+		CHECK(snapshot.Warm == false);
+		CHECK(snapshot.IsEnrolled(extra));
+		CHECK(snapshot.Count() == enrolled + 1);
+		sim.Delete(extra);
+	}
+	// another scanner: the device info is off, so it scans
+	{
+		FPS_GT511C3 fps(4, 5);
+		fps.ResponseTimeout = 2000;
+		Warm_Start snapshot(bitmap, capacity);
+		bool loaded = snapshot.LoadEEPROM(SNAPSHOT_ADDRESS);
+		sim.DeviceInfo[20] ^= 1;
+		Mark(sim);
+		CHECK(snapshot.Start(fps, loaded));
+		Report("other scanner (scans)", sim, snapshot);
+		CHECK(snapshot.Warm == false);
+		CHECK(snapshot.DeviceInfo[20] == sim.DeviceInfo[20]);
+		CHECK(snapshot.Count() == enrolled);
+	}
+}
+
+static void TestScanValidate()
+{
+	Fps_Sim sim(4, 200);
+	sim.Enroll(0, 10);
+	sim.Enroll(150, 11);
+	sim.Enroll(199, 12);
+	byte bitmap[25];
+
+	// Scan finds the scanner at 9600 and moves it to 38400
+	FPS_GT511C3 fps(4, 5);
+	fps.ResponseTimeout = 500;
+	Warm_Start snapshot(bitmap, 200);
+	snapshot.BaudRate = BAUD;
+	CHECK(snapshot.Scan(fps));
+	CHECK(sim.Baud == BAUD);
+	CHECK(snapshot.Count() == 3);
+	CHECK(snapshot.IsEnrolled(150) && snapshot.IsEnrolled(199));
+	CHECK(snapshot.Validate(fps));
+
+	// Validate after a power cycle moves it to 38400 again
+	PowerCycle(sim);
+	CHECK(sim.Baud == 9600);
+	CHECK(snapshot.Validate(fps));
+	CHECK(sim.Baud == BAUD);
+
+	// Scan finds it at 38400 too
+	Warm_Start other(bitmap, 200);
+	other.BaudRate = BAUD;
+	CHECK(other.Scan(fps));
+	CHECK(other.Count() == 3);
+
+	// a delete that keeps the snapshot out of date is caught by the count
+	sim.Delete(0);
+	CHECK(other.Validate(fps) == false);
+
+	// nobody answers
+	sim.Connected = false;
+	Warm_Start dead(bitmap, 200);
+	CHECK(dead.Scan(fps) == false);
+	CHECK(dead.Start(fps, false) == false);
+}
+
+int main()
+{
+	TestStarts(3000, 500, true);
+	TestStarts(3000, 50, false);
+	TestStarts(200, 150, true);
+	TestStarts(200, 0, true);
+	TestScanValidate();
+	return HOST_TEST_RESULT();
+}
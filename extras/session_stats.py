@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+#	session_stats.py - prints the per-command response times in session recordings made with
+#	Session_Recorder (see the FPS_Session_Record example), so a new library version or a new
+#	site can be compared against a known good recording
+#
+#	Usage: extras/session_stats.py RECORDING [OTHER_RECORDING]
+#	  with two recordings, the median of the second is shown next to the first
+
+import sys
+
+COMMANDS = {
+	0x01: "Open", 0x02: "Close", 0x03: "UsbInternalCheck", 0x04: "ChangeBaudRate",
+	0x05: "SetIAPMode", 0x12: "CmosLed", 0x20: "GetEnrollCount", 0x21: "CheckEnrolled",
+	0x22: "EnrollStart", 0x23: "Enroll1", 0x24: "Enroll2", 0x25: "Enroll3",
+	0x26: "IsPressFinger", 0x40: "DeleteID", 0x41: "DeleteAll", 0x50: "Verify1_1",
+	0x51: "Identify1_N", 0x52: "VerifyTemplate1_1", 0x53: "IdentifyTemplate1_N",
+	0x60: "CaptureFinger", 0x61: "MakeTemplate", 0x62: "GetImage", 0x63: "GetRawImage",
+	0x70: "GetTemplate", 0x71: "SetTemplate",
+}
+
+RECEIVED = 0x80
+DATA = 0x01
+
+
+# returns None for the position if the data ends inside the varint
+def varint(data, pos):
+	value = 0
+	shift = 0
+	while pos < len(data):
+		b = data[pos]
+		pos += 1
+		value |= (b & 0x7F) << shift
+		shift += 7
+		if b & 0x80 == 0:
+			return value, pos
+	return value, None
+
+
+# version 1 gaps ran to the end of each frame, version 2 to its start (see Session_Recorder)
+def frames(path):
+	with open(path, "rb") as f:
+		data = f.read()
+	if len(data) < 5 or data[0:4] != b"FPSR" or data[4] not in (1, 2):
+		sys.exit(path + ": not a session recording")
+	pos = 5
+	while pos < len(data):
+		kind = data[pos]
+		gap, pos = varint(data, pos + 1)
+		if pos is None:
+			break	# the recording was cut short
+		length, pos = varint(data, pos)
+		if pos is None or pos + length > len(data):
+			break
+		yield kind, gap, data[pos:pos + length]
+		pos += length
+
+
+# microseconds from each command being sent to its response, per command
+def response_times(path):
+	times = {}
+	command = None
+	elapsed = 0
+	for kind, gap, payload in frames(path):
+		elapsed += gap
+		if kind == 0 and len(payload) == 12:
+			command = payload[8]
+			elapsed = 0
+		elif kind == RECEIVED and command is not None:
+			times.setdefault(command, []).append(elapsed)
+			command = None
+	return times
+
+
+def percentile(values, p):
+	values = sorted(values)
+	return values[min(len(values) - 1, (len(values) * p) // 100)]
+
+
+def main():
+	if len(sys.argv) < 2:
+		sys.exit("usage: session_stats.py RECORDING [OTHER_RECORDING]")
+	first = response_times(sys.argv[1])
+	other = response_times(sys.argv[2]) if len(sys.argv) > 2 else None
+
+	header = "%-20s %6s %9s %9s %9s %9s" % ("command", "count", "p50 ms", "p90 ms", "p99 ms", "max ms")
+	if other is not None:
+		header += " %9s %8s" % ("other p50", "change")
+	print(header)
+	for command in sorted(set(first) | set(other or {})):
+		name = COMMANDS.get(command, "0x%02X" % command)
+		values = first.get(command)
+		if values:
+			line = "%-20s %6d %9.1f %9.1f %9.1f %9.1f" % (name, len(values),
+				percentile(values, 50) / 1000.0, percentile(values, 90) / 1000.0,
+				percentile(values, 99) / 1000.0, max(values) / 1000.0)
+		else:
+			line = "%-20s %6d %9s %9s %9s %9s" % (name, 0, "-", "-", "-", "-")
+		if other is not None:
+			if other.get(command):
+				median = percentile(other[command], 50)
+				line += " %9.1f" % (median / 1000.0)
+				if values:
+					line += " %+7.0f%%" % ((median - percentile(values, 50)) * 100.0 / max(1, percentile(values, 50)))
+			else:
+				line += " %9s" % "-"
+		print(line)
+
+
+if __name__ == "__main__":
+	main()
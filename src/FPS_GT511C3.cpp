@@ -41,8 +41,8 @@ byte* Command_Packet::GetPacketBytes()
 	return packetbytes;
 }
 
-// Converts the int to bytes and puts them into the paramter array
-void Command_Packet::ParameterFromInt(int i)
+// Converts the int to bytes and puts them into the paramter array (long, so baud rates above 32767 fit on AVR)
+void Command_Packet::ParameterFromInt(long i)
 {
 	Parameter[0] = (i & 0x000000ff);
 	Parameter[1] = (i & 0x0000ff00) >> 8;
@@ -92,21 +92,29 @@ Command_Packet::Command_Packet()
 // creates and parses a response packet from the finger print scanner
 Response_Packet::Response_Packet(byte* buffer, bool UseSerialDebug)
 {
-	CheckParsing(buffer[0], COMMAND_START_CODE_1, COMMAND_START_CODE_1, "COMMAND_START_CODE_1", UseSerialDebug);
-	CheckParsing(buffer[1], COMMAND_START_CODE_2, COMMAND_START_CODE_2, "COMMAND_START_CODE_2", UseSerialDebug);
-	CheckParsing(buffer[2], COMMAND_DEVICE_ID_1, COMMAND_DEVICE_ID_1, "COMMAND_DEVICE_ID_1", UseSerialDebug);
-	CheckParsing(buffer[3], COMMAND_DEVICE_ID_2, COMMAND_DEVICE_ID_2, "COMMAND_DEVICE_ID_2", UseSerialDebug);
-	CheckParsing(buffer[8], 0x30, 0x31, "AckNak_LOW", UseSerialDebug);
+	bool garbled = false;
+	garbled |= CheckParsing(buffer[0], COMMAND_START_CODE_1, COMMAND_START_CODE_1, FPS_DEBUG_NAME("COMMAND_START_CODE_1"), UseSerialDebug);
+	garbled |= CheckParsing(buffer[1], COMMAND_START_CODE_2, COMMAND_START_CODE_2, FPS_DEBUG_NAME("COMMAND_START_CODE_2"), UseSerialDebug);
+	garbled |= CheckParsing(buffer[2], COMMAND_DEVICE_ID_1, COMMAND_DEVICE_ID_1, FPS_DEBUG_NAME("COMMAND_DEVICE_ID_1"), UseSerialDebug);
+	garbled |= CheckParsing(buffer[3], COMMAND_DEVICE_ID_2, COMMAND_DEVICE_ID_2, FPS_DEBUG_NAME("COMMAND_DEVICE_ID_2"), UseSerialDebug);
+	garbled |= CheckParsing(buffer[8], 0x30, 0x31, FPS_DEBUG_NAME("AckNak_LOW"), UseSerialDebug);
 	if (buffer[8] == 0x30) ACK = true; else ACK = false;
-	CheckParsing(buffer[9], 0x00, 0x00, "AckNak_HIGH", UseSerialDebug);
+	garbled |= CheckParsing(buffer[9], 0x00, 0x00, FPS_DEBUG_NAME("AckNak_HIGH"), UseSerialDebug);
 
 	word checksum = CalculateChecksum(buffer, 10);
 	byte checksum_low = GetLowByte(checksum);
 	byte checksum_high = GetHighByte(checksum);
-	CheckParsing(buffer[10], checksum_low, checksum_low, "Checksum_LOW", UseSerialDebug);
-	CheckParsing(buffer[11], checksum_high, checksum_high, "Checksum_HIGH", UseSerialDebug);
+	garbled |= CheckParsing(buffer[10], checksum_low, checksum_low, FPS_DEBUG_NAME("Checksum_LOW"), UseSerialDebug);
+	garbled |= CheckParsing(buffer[11], checksum_high, checksum_high, FPS_DEBUG_NAME("Checksum_HIGH"), UseSerialDebug);
 
 	Error = ErrorCodes::ParseFromBytes(buffer[5], buffer[4]);
+	// a garbled packet can't be trusted to be an ACK
+	Valid = !garbled;
+	if (garbled)
+	{
+		ACK = false;
+		Error = ErrorCodes::INVALID;
+	}
 
 	ParameterBytes[0] = buffer[4];
 	ParameterBytes[1] = buffer[5];
@@ -171,12 +179,9 @@ int Response_Packet::IntFromParameter()
 // calculates the checksum from the bytes in the packet
 word Response_Packet::CalculateChecksum(byte* buffer, int length)
 {
-	word checksum = 0;
-	for (int i=0; i<length; i++)
-	{
-		checksum +=buffer[i];
-	}
-	return checksum;
+	Data_Checksum checksum;
+	checksum.Add(buffer, length);
+	return checksum.Value();
 }
 
 // Returns the high byte from a word
@@ -192,20 +197,22 @@ byte Response_Packet::GetLowByte(word w)
 }
 
 // checks to see if the byte is the proper value, and logs it to the serial channel if not
-bool Response_Packet::CheckParsing(byte b, byte propervalue, byte alternatevalue, const char* varname, bool UseSerialDebug)
+bool Response_Packet::CheckParsing(byte b, byte propervalue, byte alternatevalue, const __FlashStringHelper* varname, bool UseSerialDebug)
 {
 	bool retval = (b != propervalue) && (b != alternatevalue);
+#if FPS_DEBUG
 	if ((UseSerialDebug) && (retval))
 	{
-		Serial.print("Response_Packet parsing error ");
+		Serial.print(F("Response_Packet parsing error "));
 		Serial.print(varname);
-		Serial.print(" ");
+		Serial.print(F(" "));
 		Serial.print(propervalue, HEX);
-		Serial.print(" || ");
+		Serial.print(F(" || "));
 		Serial.print(alternatevalue, HEX);
-		Serial.print(" != ");
+		Serial.print(F(" != "));
 		Serial.println(b, HEX);
 	}
+#endif  //FPS_DEBUG
   return retval;
 }
 #ifndef __GNUC__
@@ -213,13 +220,98 @@ bool Response_Packet::CheckParsing(byte b, byte propervalue, byte alternatevalue
 #endif  //__GNUC__
 
 #ifndef __GNUC__
-#pragma region -= Data_Packet =-
+#pragma region -= Command_Result Definitions =-
 #endif  //__GNUC__
-//void Data_Packet::StartNewPacket()
-//{
-//	Data_Packet::NextPacketID = 0;
-//	Data_Packet::CheckSum = 0;
-//}
+Command_Result::Command_Result()
+{
+	Command = Command_Packet::Commands::NotSet;
+	ACK = false;
+	Valid = false;
+	Error = Response_Packet::ErrorCodes::NO_ERROR;
+	Parameter = 0;
+	Millis = 0;
+}
+
+// Returns: true if the command failed because no finger was on the sensor
+bool Command_Result::NoFinger()
+{
+	return (ACK == false) && (Error == Response_Packet::ErrorCodes::NACK_FINGER_IS_NOT_PRESSED);
+}
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
+
+#ifndef __GNUC__
+#pragma region -= Data_Checksum Definitions =-
+#endif  //__GNUC__
+Data_Checksum::Data_Checksum()
+{
+	_sum = 0;
+}
+
+void Data_Checksum::Reset()
+{
+	_sum = 0;
+}
+
+void Data_Checksum::Add(byte b)
+{
+	_sum += b;
+}
+
+void Data_Checksum::Add(const byte* data, int length)
+{
+	word sum = _sum;
+#if defined(__AVR__)
+	// unrolled so the pointer stays in a register pair and the loop test runs once per 4 bytes
+	while (length >= 4)
+	{
+		sum += data[0];
+		sum += data[1];
+		sum += data[2];
+		sum += data[3];
+		data += 4;
+		length -= 4;
+	}
+#else
+	// 32 bit cores add 4 bytes per step: even and odd bytes go into two 16 bit lanes each
+	// a lane can take 257 words before it could overflow, so fold every 256
+	while (length >= 4)
+	{
+		int words = length / 4;
+		if (words > 256) words = 256;
+		uint32_t even = 0;
+		uint32_t odd = 0;
+		for (int i = 0; i < words; i++)
+		{
+			uint32_t w;
+			memcpy(&w, data, 4);
+			even += w & 0x00FF00FFUL;
+			odd += (w >> 8) & 0x00FF00FFUL;
+			data += 4;
+		}
+		length -= words * 4;
+		sum += (word)(even & 0xFFFF) + (word)(even >> 16) + (word)(odd & 0xFFFF) + (word)(odd >> 16);
+	}
+#endif
+	while (length > 0)
+	{
+		sum += *data++;
+		length--;
+	}
+	_sum = sum;
+}
+
+word Data_Checksum::Value()
+{
+	return _sum;
+}
+
+// Returns: True if the two bytes (low, high) match the checksum
+bool Data_Checksum::Matches(byte low, byte high)
+{
+	return (low == (byte)(_sum & 0x00FF)) && (high == (byte)((_sum >> 8) & 0x00FF));
+}
 #ifndef __GNUC__
 #pragma endregion
 #endif  //__GNUC__
@@ -239,6 +331,18 @@ FPS_GT511C3::FPS_GT511C3(uint8_t rx, uint8_t tx)
 	pin_TX = tx;
 	_serial.begin(9600);
 	this->UseSerialDebug = false;
+	this->Recorder = NULL;
+	this->Journal = NULL;
+	this->Snapshot = NULL;
+	ResponseTimeout = 0;
+	LinkFailures = 0;
+	BaudRate = 9600;
+	LedOn = false;
+	_capturemillis = 0;
+	_commandstarted = 0;
+	_enrollingid = -1;
+	_lastcommand = Command_Packet::Commands::NotSet;
+	_datatimedout = false;
 };
 
 // destructor
@@ -254,12 +358,21 @@ FPS_GT511C3::~FPS_GT511C3()
 #pragma region -= Device Commands =-
 #endif  //__GNUC__
 //Initialises the device and gets ready for commands
-void FPS_GT511C3::Open()
+// Returns: True if the fps answered
+bool FPS_GT511C3::Open()
+{
+	return Open(NULL);
+}
+
+// Initialises the device and reads its device info
+// Parameter: where to put the device info (DEVICE_INFO_SIZE bytes), NULL for none
+// Returns: True if the fps answered (and the device info checked out)
+bool FPS_GT511C3::Open(byte* info)
 {
-	if (UseSerialDebug) Serial.println("FPS - Open");
+	FPS_DEBUG_PRINTLN("FPS - Open");
 	Command_Packet* cp = new Command_Packet();
 	cp->Command = Command_Packet::Commands::Open;
-	cp->Parameter[0] = 0x00;
+	cp->Parameter[0] = (info != NULL) ? 0x01 : 0x00;
 	cp->Parameter[1] = 0x00;
 	cp->Parameter[2] = 0x00;
 	cp->Parameter[3] = 0x00;
@@ -267,15 +380,53 @@ void FPS_GT511C3::Open()
 	delete cp;
 	SendCommand(packetbytes, 12);
 	Response_Packet* rp = GetResponse();
+	bool retval = rp->ACK;
+	// a non-zero parameter asks for the device info in a data phase
+	if (retval && (info != NULL)) retval = GetData(info, DEVICE_INFO_SIZE);
 	delete rp;
 	delete packetbytes;
+	return retval;
+}
+
+// Opens the fps at a baud rate it is expected to be running at, with a short ResponseTimeout
+// Returns: True if the fps answered at that rate
+bool FPS_GT511C3::OpenAt(unsigned long baud, byte* info)
+{
+	unsigned long timeout = ResponseTimeout;
+	// an Open is answered within a few ms, no need to wait long for a wrong rate
+	if ((ResponseTimeout == 0) || (ResponseTimeout > 200)) ResponseTimeout = 200;
+	_serial.end();
+	_serial.begin(baud);
+	Rx.Clear();
+	BaudRate = baud;
+	bool retval = Open(info);
+	ResponseTimeout = timeout;
+	return retval;
+}
+
+// Finds the baud rate the fps answers at (after it was reset or lost power) and opens it
+// Returns: the baud rate, 0 if the fps did not answer at any of them
+unsigned long FPS_GT511C3::DetectBaudRate()
+{
+	FPS_DEBUG_PRINTLN("FPS - DetectBaudRate");
+	const unsigned long rates[] = { 9600, 19200, 38400, 57600, 115200 };
+	unsigned long retval = 0;
+	for (int i = 0; i < 5; i++)
+	{
+		if (OpenAt(rates[i], NULL))
+		{
+			retval = rates[i];
+			break;
+		}
+	}
+	return retval;
 }
 
 // According to the DataSheet, this does nothing...
 // Implemented it for completeness.
 void FPS_GT511C3::Close()
 {
-	if (UseSerialDebug) Serial.println("FPS - Close");
+	FPS_DEBUG_PRINTLN("FPS - Close");
 	Command_Packet* cp = new Command_Packet();
 	cp->Command = Command_Packet::Commands::Close;
 	cp->Parameter[0] = 0x00;
@@ -299,14 +450,15 @@ bool FPS_GT511C3::SetLED(bool on)
 	cp->Command = Command_Packet::Commands::CmosLed;
 	if (on)
 	{
-		if (UseSerialDebug) Serial.println("FPS - LED on");
+		FPS_DEBUG_PRINTLN("FPS - LED on");
 		cp->Parameter[0] = 0x01;
 	}
 	else
 	{
-		if (UseSerialDebug) Serial.println("FPS - LED off");
+		FPS_DEBUG_PRINTLN("FPS - LED off");
 		cp->Parameter[0] = 0x00;
 	}
+	LedOn = on;
 	cp->Parameter[1] = 0x00;
 	cp->Parameter[2] = 0x00;
 	cp->Parameter[3] = 0x00;
@@ -330,9 +482,9 @@ bool FPS_GT511C3::ChangeBaudRate(unsigned long baud)
 	if ((baud == 9600) || (baud == 19200) || (baud == 38400) || (baud == 57600) || (baud == 115200))
 	{
 
-		if (UseSerialDebug) Serial.println("FPS - ChangeBaudRate");
+		FPS_DEBUG_PRINTLN("FPS - ChangeBaudRate");
 		Command_Packet* cp = new Command_Packet();
-		cp->Command = Command_Packet::Commands::Open;
+		cp->Command = Command_Packet::Commands::ChangeEBaudRate;
 		cp->ParameterFromInt(baud);
 		byte* packetbytes = cp->GetPacketBytes();
 		delete cp;
@@ -343,6 +495,8 @@ bool FPS_GT511C3::ChangeBaudRate(unsigned long baud)
 		{
 			_serial.end();
 			_serial.begin(baud);
+			Rx.Clear();
+			BaudRate = baud;
 		}
 		delete rp;
 		delete packetbytes;
@@ -352,10 +506,10 @@ bool FPS_GT511C3::ChangeBaudRate(unsigned long baud)
 }
 
 // Gets the number of enrolled fingerprints
-// Return: The total number of enrolled fingerprints
+// Return: The total number of enrolled fingerprints, -1 if the fps did not answer properly
 int FPS_GT511C3::GetEnrollCount()
 {
-	if (UseSerialDebug) Serial.println("FPS - GetEnrolledCount");
+	FPS_DEBUG_PRINTLN("FPS - GetEnrolledCount");
 	Command_Packet* cp = new Command_Packet();
 	cp->Command = Command_Packet::Commands::GetEnrollCount;
 	cp->Parameter[0] = 0x00;
@@ -368,6 +522,7 @@ int FPS_GT511C3::GetEnrollCount()
 	Response_Packet* rp = GetResponse();
 
 	int retval = rp->IntFromParameter();
+	if (rp->Valid == false) retval = -1;
 	delete rp;
 	delete packetbytes;
 	return retval;
@@ -379,7 +534,7 @@ int FPS_GT511C3::GetEnrollCount()
 // Return: True if the ID number is enrolled, false if not
 bool FPS_GT511C3::CheckEnrolled(int id)
 {
-	if (UseSerialDebug) Serial.println("FPS - CheckEnrolled");
+	FPS_DEBUG_PRINTLN("FPS - CheckEnrolled");
 	Command_Packet* cp = new Command_Packet();
 	cp->Command = Command_Packet::Commands::CheckEnrolled;
 	cp->ParameterFromInt(id);
@@ -402,9 +557,10 @@ bool FPS_GT511C3::CheckEnrolled(int id)
 //	1 - Database is full
 //	2 - Invalid Position
 //	3 - Position(ID) is already used
+//	4 - Communications error (no proper answer)
 int FPS_GT511C3::EnrollStart(int id)
 {
-	if (UseSerialDebug) Serial.println("FPS - EnrollStart");
+	FPS_DEBUG_PRINTLN("FPS - EnrollStart");
 	Command_Packet* cp = new Command_Packet();
 	cp->Command = Command_Packet::Commands::EnrollStart;
 	cp->ParameterFromInt(id);
@@ -419,7 +575,9 @@ int FPS_GT511C3::EnrollStart(int id)
 		if (rp->Error == Response_Packet::ErrorCodes::NACK_DB_IS_FULL) retval = 1;
 		if (rp->Error == Response_Packet::ErrorCodes::NACK_INVALID_POS) retval = 2;
 		if (rp->Error == Response_Packet::ErrorCodes::NACK_IS_ALREADY_USED) retval = 3;
+		if (rp->Valid == false) retval = 4;
 	}
+	_enrollingid = (rp->ACK) ? id : -1;
 	delete rp;
 	return retval;
 }
@@ -430,9 +588,10 @@ int FPS_GT511C3::EnrollStart(int id)
 //	1 - Enroll Failed
 //	2 - Bad finger
 //	3 - ID in use
+//	4 - Communications error (no proper answer)
 int FPS_GT511C3::Enroll1()
 {
-	if (UseSerialDebug) Serial.println("FPS - Enroll1");
+	FPS_DEBUG_PRINTLN("FPS - Enroll1");
 	Command_Packet* cp = new Command_Packet();
 	cp->Command = Command_Packet::Commands::Enroll1;
 	byte* packetbytes = cp->GetPacketBytes();
@@ -449,8 +608,11 @@ int FPS_GT511C3::Enroll1()
 		if (rp->Error == Response_Packet::ErrorCodes::NACK_ENROLL_FAILED) retval = 1;
 		if (rp->Error == Response_Packet::ErrorCodes::NACK_BAD_FINGER) retval = 2;
 	}
+	if (rp->ACK) retval = 0;
+	// a timed out or garbled answer has no ID in it
+	if (rp->Valid == false) retval = 4;
 	delete rp;
-	if (rp->ACK) return 0; else return retval;
+	return retval;
 }
 
 // Gets the Second scan of an enrollment
@@ -459,9 +621,10 @@ int FPS_GT511C3::Enroll1()
 //	1 - Enroll Failed
 //	2 - Bad finger
 //	3 - ID in use
+//	4 - Communications error (no proper answer)
 int FPS_GT511C3::Enroll2()
 {
-	if (UseSerialDebug) Serial.println("FPS - Enroll2");
+	FPS_DEBUG_PRINTLN("FPS - Enroll2");
 	Command_Packet* cp = new Command_Packet();
 	cp->Command = Command_Packet::Commands::Enroll2;
 	byte* packetbytes = cp->GetPacketBytes();
@@ -478,8 +641,11 @@ int FPS_GT511C3::Enroll2()
 		if (rp->Error == Response_Packet::ErrorCodes::NACK_ENROLL_FAILED) retval = 1;
 		if (rp->Error == Response_Packet::ErrorCodes::NACK_BAD_FINGER) retval = 2;
 	}
+	if (rp->ACK) retval = 0;
+	// a timed out or garbled answer has no ID in it
+	if (rp->Valid == false) retval = 4;
 	delete rp;
-	if (rp->ACK) return 0; else return retval;
+	return retval;
 }
 
 // Gets the Third scan of an enrollment
@@ -489,9 +655,10 @@ int FPS_GT511C3::Enroll2()
 //	1 - Enroll Failed
 //	2 - Bad finger
 //	3 - ID in use
+//	4 - Communications error (no proper answer)
 int FPS_GT511C3::Enroll3()
 {
-	if (UseSerialDebug) Serial.println("FPS - Enroll3");
+	FPS_DEBUG_PRINTLN("FPS - Enroll3");
 	Command_Packet* cp = new Command_Packet();
 	cp->Command = Command_Packet::Commands::Enroll3;
 	byte* packetbytes = cp->GetPacketBytes();
@@ -508,15 +675,19 @@ int FPS_GT511C3::Enroll3()
 		if (rp->Error == Response_Packet::ErrorCodes::NACK_ENROLL_FAILED) retval = 1;
 		if (rp->Error == Response_Packet::ErrorCodes::NACK_BAD_FINGER) retval = 2;
 	}
+	if (rp->ACK) retval = 0;
+	// a timed out or garbled answer has no ID in it
+	if (rp->Valid == false) retval = 4;
+	if ((Snapshot != NULL) && rp->ACK) Snapshot->SetEnrolled(_enrollingid, true);
 	delete rp;
-	if (rp->ACK) return 0; else return retval;
+	return retval;
 }
 
 // Checks to see if a finger is pressed on the FPS
-// Return: true if finger pressed, false if not
+// Return: true if finger pressed, false if not (or if the fps did not answer properly)
 bool FPS_GT511C3::IsPressFinger()
 {
-	if (UseSerialDebug) Serial.println("FPS - IsPressFinger");
+	FPS_DEBUG_PRINTLN("FPS - IsPressFinger");
 	Command_Packet* cp = new Command_Packet();
 	cp->Command = Command_Packet::Commands::IsPressFinger;
 	byte* packetbytes = cp->GetPacketBytes();
@@ -528,7 +699,7 @@ bool FPS_GT511C3::IsPressFinger()
 	pval += rp->ParameterBytes[1];
 	pval += rp->ParameterBytes[2];
 	pval += rp->ParameterBytes[3];
-	if (pval == 0) retval = true;
+	if ((pval == 0) && rp->Valid) retval = true;
 	delete rp;
 	delete packetbytes;
 	return retval;
@@ -540,7 +711,7 @@ bool FPS_GT511C3::IsPressFinger()
 // Returns: true if successful, false if position invalid
 bool FPS_GT511C3::DeleteID(int id)
 {
-	if (UseSerialDebug) Serial.println("FPS - DeleteID");
+	FPS_DEBUG_PRINTLN("FPS - DeleteID");
 	Command_Packet* cp = new Command_Packet();
 	cp->Command = Command_Packet::Commands::DeleteID;
 	cp->ParameterFromInt(id);
@@ -549,6 +720,7 @@ bool FPS_GT511C3::DeleteID(int id)
 	SendCommand(packetbytes, 12);
 	Response_Packet* rp = GetResponse();
 	bool retval = rp->ACK;
+	if ((Snapshot != NULL) && retval) Snapshot->SetEnrolled(id, false);
 	delete rp;
 	delete packetbytes;
 	return retval;
@@ -558,13 +730,14 @@ bool FPS_GT511C3::DeleteID(int id)
 // Returns: true if successful, false if db is empty
 bool FPS_GT511C3::DeleteAll()
 {
-	if (UseSerialDebug) Serial.println("FPS - DeleteAll");
+	FPS_DEBUG_PRINTLN("FPS - DeleteAll");
 	Command_Packet* cp = new Command_Packet();
 	cp->Command = Command_Packet::Commands::DeleteAll;
 	byte* packetbytes = cp->GetPacketBytes();
 	SendCommand(packetbytes, 12);
 	Response_Packet* rp = GetResponse();
 	bool retval = rp->ACK;
+	if ((Snapshot != NULL) && retval) Snapshot->Clear();
 	delete rp;
 	delete packetbytes;
 	delete cp;
@@ -579,9 +752,11 @@ bool FPS_GT511C3::DeleteAll()
 //	1 - Invalid Position
 //	2 - ID is not in use
 //	3 - Verified FALSE (not the correct finger)
+//	4 - Communications error (the response timed out or arrived garbled)
 int FPS_GT511C3::Verify1_1(int id)
 {
-	if (UseSerialDebug) Serial.println("FPS - Verify1_1");
+	FPS_DEBUG_PRINTLN("FPS - Verify1_1");
+	unsigned long started = millis();
 	Command_Packet* cp = new Command_Packet();
 	cp->Command = Command_Packet::Commands::Verify1_1;
 	cp->ParameterFromInt(id);
@@ -596,7 +771,10 @@ int FPS_GT511C3::Verify1_1(int id)
 		if (rp->Error == Response_Packet::ErrorCodes::NACK_INVALID_POS) retval = 1;
 		if (rp->Error == Response_Packet::ErrorCodes::NACK_IS_NOT_USED) retval = 2;
 		if (rp->Error == Response_Packet::ErrorCodes::NACK_VERIFY_FAILED) retval = 3;
+		if (rp->Valid == false) retval = 4;
 	}
+	if (Journal != NULL) Journal->Log(Access_Entry::Kinds::Verify, id, rp->ACK ? Response_Packet::ErrorCodes::NO_ERROR : rp->Error, _capturemillis, millis() - started);
+	_capturemillis = 0;
 	delete rp;
 	delete packetbytes;
 	return retval;
@@ -607,12 +785,13 @@ int FPS_GT511C3::Verify1_1(int id)
 //	Verified against the specified ID (found, and here is the ID number)
 //           0-2999, if using GT-521F52
 //           0-199, if using GT-521F32/GT-511C3
-//      Failed to find the fingerprint in the database
+//      Failed to find the fingerprint in the database (or the fps did not answer properly)
 // 	     3000, if using GT-521F52
 //           200, if using GT-521F32/GT-511C3
 int FPS_GT511C3::Identify1_N()
 {
-	if (UseSerialDebug) Serial.println("FPS - Identify1_N");
+	FPS_DEBUG_PRINTLN("FPS - Identify1_N");
+	unsigned long started = millis();
 	Command_Packet* cp = new Command_Packet();
 	cp->Command = Command_Packet::Commands::Identify1_N;
 	byte* packetbytes = cp->GetPacketBytes();
@@ -622,7 +801,9 @@ int FPS_GT511C3::Identify1_N()
 	int retval = rp->IntFromParameter();
 //Change to "retval > 3000" and "retval = 3000", if using GT-521F52
 //Leave "reval > 200" and "retval = 200", if using GT-521F32/GT-511C3
-	if (retval > 200) retval = 200;
+	if ((retval > 200) || (retval < 0) || (rp->Valid == false)) retval = 200;
+	if (Journal != NULL) Journal->Log(Access_Entry::Kinds::Identify, retval, rp->ACK ? Response_Packet::ErrorCodes::NO_ERROR : rp->Error, _capturemillis, millis() - started);
+	_capturemillis = 0;
 	delete rp;
 	delete packetbytes;
 	return retval;
@@ -634,7 +815,8 @@ int FPS_GT511C3::Identify1_N()
 // Returns: True if ok, false if no finger pressed
 bool FPS_GT511C3::CaptureFinger(bool highquality)
 {
-	if (UseSerialDebug) Serial.println("FPS - CaptureFinger");
+	FPS_DEBUG_PRINTLN("FPS - CaptureFinger");
+	unsigned long started = millis();
 	Command_Packet* cp = new Command_Packet();
 	cp->Command = Command_Packet::Commands::CaptureFinger;
 	if (highquality)
@@ -652,8 +834,245 @@ bool FPS_GT511C3::CaptureFinger(bool highquality)
 	bool retval = rp->ACK;
 	delete rp;
 	delete packetbytes;
+	// kept for the journal entry of the Verify1_1 / Identify1_N that follows
+	_capturemillis = millis() - started;
+	return retval;
+
+}
+
+// Uploads a template to the fps
+// Parameter: the template (498 bytes)
+// Parameter: 0-2999, if using GT-521F52 (the ID number to upload)
+//            0-199, if using GT-521F32/GT-511C3 (the ID number to upload)
+// Parameter: Check for duplicate fingerprints already on fps
+// Returns:
+//	0-2999 - ID duplicated (the ID the template matched)
+//	3000 - Uploaded ok (no duplicate if enabled)
+//	3001 - Invalid position
+//	3002 - Communications error
+//	3003 - Device error
+int FPS_GT511C3::SetTemplate(byte* tmplt, int id, bool duplicateCheck)
+{
+	FPS_DEBUG_PRINTLN("FPS - SetTemplate");
+	Command_Packet* cp = new Command_Packet();
+	cp->Command = Command_Packet::Commands::SetTemplate;
+	cp->ParameterFromInt(id);
+	// a non-zero upper word tells the fps to skip the duplicate check
+	if (duplicateCheck == false) cp->Parameter[2] = 0x01;
+	byte* packetbytes = cp->GetPacketBytes();
+	delete cp;
+	SendCommand(packetbytes, 12);
+	delete packetbytes;
+	Response_Packet* rp = GetResponse();
+	// the codes sit above the highest ID of every model, so they never collide with a duplicate
+	int retval = 3000;
+	if (rp->ACK)
+	{
+		// the fps accepted the ID, so send the template in the data phase
+		delete rp;
+		SendData(tmplt, TEMPLATE_SIZE);
+		rp = GetResponse();
+	}
+	if (rp->ACK == false)
+	{
+		retval = 3002;
+		if (rp->Error == Response_Packet::ErrorCodes::NACK_INVALID_POS) retval = 3001;
+		if (rp->Error == Response_Packet::ErrorCodes::NACK_COMM_ERR) retval = 3002;
+		if (rp->Error == Response_Packet::ErrorCodes::NACK_DEV_ERR) retval = 3003;
+		// a duplicate is reported with the ID it matched instead of an error code, decided on the
+		// raw parameter: the error codes start at 0x1001 and IDs end at 2999, so an ID above 255
+		// (a GT-521F52) must not be taken for the error in its low byte
+		int parameter = rp->IntFromParameter();
+		if (rp->Valid && (parameter >= 0) && (parameter < Response_Packet::ErrorCodes::NACK_TIMEOUT)) retval = parameter;
+	}
+	if ((Snapshot != NULL) && rp->ACK) Snapshot->SetEnrolled(id, true);
+	delete rp;
+	return retval;
+}
+
+// Downloads a template from the fps
+// Parameter: 0-2999, if using GT-521F52 (the ID number to download)
+//            0-199, if using GT-521F32/GT-511C3 (the ID number to download)
+// Parameter: buffer that receives the template (498 bytes)
+// Returns:
+//	0 - ACK Download ok
+//	1 - Invalid position
+//	2 - ID not used (no template to download)
+//	3 - Communications error (data checksum did not match)
+int FPS_GT511C3::GetTemplate(int id, byte* tmplt)
+{
+	FPS_DEBUG_PRINTLN("FPS - GetTemplate");
+	Command_Packet* cp = new Command_Packet();
+	cp->Command = Command_Packet::Commands::GetTemplate;
+	cp->ParameterFromInt(id);
+	byte* packetbytes = cp->GetPacketBytes();
+	delete cp;
+	SendCommand(packetbytes, 12);
+	delete packetbytes;
+	Response_Packet* rp = GetResponse();
+	int retval = 0;
+	if (rp->ACK == false)
+	{
+		retval = 2;
+		if (rp->Error == Response_Packet::ErrorCodes::NACK_INVALID_POS) retval = 1;
+		if (rp->Error == Response_Packet::ErrorCodes::NACK_IS_NOT_USED) retval = 2;
+	}
+	else
+	{
+		if (GetData(tmplt, TEMPLATE_SIZE) == false) retval = 3;
+	}
+	delete rp;
+	return retval;
+}
+
+// Downloads the image of the last CaptureFinger, 258x202 (52116 bytes)
+// The image is never held in ram, each row is handed to the handler as it arrives
+// Parameter: the handler that receives the rows
+// Returns: True if the whole image arrived and its checksum matched
+bool FPS_GT511C3::GetImage(Image_Row_Handler& handler)
+{
+	FPS_DEBUG_PRINTLN("FPS - GetImage");
+	Command_Packet* cp = new Command_Packet();
+	cp->Command = Command_Packet::Commands::GetImage;
+	byte* packetbytes = cp->GetPacketBytes();
+	delete cp;
+	SendCommand(packetbytes, 12);
+	delete packetbytes;
+	Response_Packet* rp = GetResponse();
+	bool retval = rp->ACK;
+	delete rp;
+	if (retval) retval = GetDataRows(handler, IMAGE_WIDTH, IMAGE_HEIGHT);
+	return retval;
+}
+
+// Makes a template from the last CaptureFinger and downloads it, without storing it on the fps
+// Parameter: buffer that receives the template (498 bytes)
+// Returns:
+//	0 - ACK Template made
+//	1 - Bad finger
+//	2 - Communications error
+int FPS_GT511C3::MakeTemplate(byte* tmplt)
+{
+	FPS_DEBUG_PRINTLN("FPS - MakeTemplate");
+	Command_Packet* cp = new Command_Packet();
+	cp->Command = Command_Packet::Commands::MakeTemplate;
+	byte* packetbytes = cp->GetPacketBytes();
+	delete cp;
+	SendCommand(packetbytes, 12);
+	delete packetbytes;
+	Response_Packet* rp = GetResponse();
+	int retval = 0;
+	if (rp->ACK == false)
+	{
+		retval = 2;
+		if (rp->Error == Response_Packet::ErrorCodes::NACK_BAD_FINGER) retval = 1;
+	}
+	else
+	{
+		if (GetData(tmplt, TEMPLATE_SIZE) == false) retval = 2;
+	}
+	delete rp;
+	return retval;
+}
+
+// Uploads a template and checks it against a specific ID
+// Parameter: 0-2999, if using GT-521F52 (id number to be checked)
+//            0-199, if using GT-521F32/GT-511C3 (id number to be checked)
+// Parameter: the template (498 bytes), from MakeTemplate or GetTemplate
+// Returns:
+//	0 - Verified OK (the correct finger)
+//	1 - Invalid Position
+//	2 - ID is not in use
+//	3 - Verified FALSE (not the correct finger)
+//	4 - Communications error (the fps did not take the template)
+int FPS_GT511C3::VerifyTemplate1_1(int id, byte* tmplt)
+{
+	FPS_DEBUG_PRINTLN("FPS - VerifyTemplate1_1");
+	Command_Packet* cp = new Command_Packet();
+	cp->Command = Command_Packet::Commands::VerifyTemplate1_1;
+	cp->ParameterFromInt(id);
+	byte* packetbytes = cp->GetPacketBytes();
+	delete cp;
+	SendCommand(packetbytes, 12);
+	delete packetbytes;
+	Response_Packet* rp = GetResponse();
+	int retval = 0;
+	if (rp->ACK)
+	{
+		// the ID is checked before the data phase, the template after it
+		delete rp;
+		SendData(tmplt, TEMPLATE_SIZE);
+		rp = GetResponse();
+	}
+	if (rp->ACK == false)
+	{
+		retval = 4;
+		if (rp->Error == Response_Packet::ErrorCodes::NACK_INVALID_POS) retval = 1;
+		if (rp->Error == Response_Packet::ErrorCodes::NACK_IS_NOT_USED) retval = 2;
+		if (rp->Error == Response_Packet::ErrorCodes::NACK_VERIFY_FAILED) retval = 3;
+	}
+	delete rp;
 	return retval;
+}
+
+// Captures the currently pressed finger and downloads its template, so it can be matched
+// any number of times (against any fps) without capturing again
+// Each match uploads the template, which below 115200 baud takes longer than a new capture
+// Parameter: buffer that receives the template (498 bytes)
+// Parameter: true for high quality image(slower), false for low quality image (faster)
+// Returns: True if ok, false if no finger pressed or the template could not be made
+bool FPS_GT511C3::CaptureTemplate(byte* tmplt, bool highquality)
+{
+	if (CaptureFinger(highquality) == false) return false;
+	return MakeTemplate(tmplt) == 0;
+}
+
+// Checks a template against each of a list of IDs, in order, stopping at the first match
+// Returns: the first ID that verified OK, or -1 if none did
+int FPS_GT511C3::VerifyTemplateAny(byte* tmplt, const int* ids, int count)
+{
+	for (int i=0; i < count; i++)
+	{
+		if (VerifyTemplate1_1(ids[i], tmplt) == 0) return ids[i];
+	}
+	return -1;
+}
 
+// Uploads a template and checks it against all enrolled fingerprints
+// Parameter: the template (498 bytes), from MakeTemplate or GetTemplate
+// Returns:
+//	Verified against the specified ID (found, and here is the ID number)
+//           0-2999, if using GT-521F52
+//           0-199, if using GT-521F32/GT-511C3
+//      Failed to find the fingerprint in the database
+//           3000, if using GT-521F52
+//           200, if using GT-521F32/GT-511C3
+//      Communications error (the fps did not take the template)
+//           3001, if using GT-521F52
+//           201, if using GT-521F32/GT-511C3
+int FPS_GT511C3::IdentifyTemplate1_N(byte* tmplt)
+{
+	FPS_DEBUG_PRINTLN("FPS - IdentifyTemplate1_N");
+	Command_Packet* cp = new Command_Packet();
+	cp->Command = Command_Packet::Commands::IdentifyTemplate1_N;
+	byte* packetbytes = cp->GetPacketBytes();
+	delete cp;
+	SendCommand(packetbytes, 12);
+	delete packetbytes;
+	Response_Packet* rp = GetResponse();
+//Change to "retval = 3001" and "retval = 3000", if using GT-521F52
+//Leave "retval = 201" and "retval = 200", if using GT-521F32/GT-511C3
+	int retval = 201;
+	if (rp->ACK)
+	{
+		delete rp;
+		SendData(tmplt, TEMPLATE_SIZE);
+		rp = GetResponse();
+		if (rp->ACK) retval = rp->IntFromParameter();
+		else if ((rp->Error == Response_Packet::ErrorCodes::NACK_IDENTIFY_FAILED) || (rp->Error == Response_Packet::ErrorCodes::NACK_DB_IS_EMPTY)) retval = 200;
+	}
+	delete rp;
+	return retval;
 }
 #ifndef __GNUC__
 #pragma endregion
@@ -662,18 +1081,6 @@ bool FPS_GT511C3::CaptureFinger(bool highquality)
 #ifndef __GNUC__
 #pragma region -= Not imlemented commands =-
 #endif  //__GNUC__
-// Gets an image that is 258x202 (52116 bytes) and returns it in 407 Data_Packets
-// Use StartDataDownload, and then GetNextDataPacket until done
-// Returns: True (device confirming download starting)
-	// Not implemented due to memory restrictions on the arduino
-	// may revisit this if I find a need for it
-//bool FPS_GT511C3::GetImage()
-//{
-	// Not implemented due to memory restrictions on the arduino
-	// may revisit this if I find a need for it
-	//return false;
-//}
-
 // Gets an image that is qvga 160x120 (19200 bytes) and returns it in 150 Data_Packets
 // Use StartDataDownload, and then GetNextDataPacket until done
 // Returns: True (device confirming download starting)
@@ -686,62 +1093,7 @@ bool FPS_GT511C3::CaptureFinger(bool highquality)
 	//return false;
 //}
 
-// Gets a template from the fps (498 bytes) in 4 Data_Packets
-// Use StartDataDownload, and then GetNextDataPacket until done
-// Parameter: 0-199 ID number
-// Returns:
-//	0 - ACK Download starting
-//	1 - Invalid position
-//	2 - ID not used (no template to download
-	// Not implemented due to memory restrictions on the arduino
-	// may revisit this if I find a need for it
-//int FPS_GT511C3::GetTemplate(int id)
-//{
-	// Not implemented due to memory restrictions on the arduino
-	// may revisit this if I find a need for it
-	//return false;
-//}
-
-// Uploads a template to the fps
-// Parameter: the template (498 bytes)
-// Parameter: the ID number to upload
-// Parameter: Check for duplicate fingerprints already on fps
-// Returns:
-//	0-199 - ID duplicated
-//	200 - Uploaded ok (no duplicate if enabled)
-//	201 - Invalid position
-//	202 - Communications error
-//	203 - Device error
-	// Not implemented due to memory restrictions on the arduino
-	// may revisit this if I find a need for it
-//int FPS_GT511C3::SetTemplate(byte* tmplt, int id, bool duplicateCheck)
-//{
-	// Not implemented due to memory restrictions on the arduino
-	// may revisit this if I find a need for it
-	//return -1;
-//}
-
-// resets the Data_Packet class, and gets ready to download
-	// Not implemented due to memory restrictions on the arduino
-	// may revisit this if I find a need for it
-//void FPS_GT511C3::StartDataDownload()
-//{
-	// Not implemented due to memory restrictions on the arduino
-	// may revisit this if I find a need for it
-//}
-
-// Returns the next data packet
-	// Not implemented due to memory restrictions on the arduino
-	// may revisit this if I find a need for it
-//Data_Packet GetNextDataPacket()
-//{
-//	return 0;
-//}
-
 // Commands that are not implemented (and why)
-// VerifyTemplate1_1 - Couldn't find a good reason to implement this on an arduino
-// IdentifyTemplate1_N - Couldn't find a good reason to implement this on an arduino
-// MakeTemplate - Couldn't find a good reason to implement this on an arduino
 // UsbInternalCheck - not implemented - Not valid config for arduino
 // GetDatabaseStart - historical command, no longer supported
 // GetDatabaseEnd - historical command, no longer supported
@@ -760,73 +1112,2946 @@ bool FPS_GT511C3::CaptureFinger(bool highquality)
 // Sends the command to the software serial channel
 void FPS_GT511C3::SendCommand(byte cmd[], int length)
 {
+	_commandstarted = millis();
+	_lastcommand = cmd[8];
 	_serial.write(cmd, length);
+	if (Recorder != NULL)
+	{
+		// every exchange starts here, and the rate only changes after a command's response
+		Recorder->BaudRate = BaudRate;
+		Recorder->Frame(Session_Recorder::SENT | Session_Recorder::COMMAND, cmd, length);
+	}
+#if FPS_DEBUG
 	if (UseSerialDebug)
 	{
-		Serial.print("FPS - SEND: ");
+		Serial.print(F("FPS - SEND: "));
 		SendToSerial(cmd, length);
 		Serial.println();
 	}
+#endif  //FPS_DEBUG
+};
+
+// Sends a data packet (used for the data phase of template/image transfers) to the software serial channel
+void FPS_GT511C3::SendData(byte data[], int length)
+{
+	byte header[4];
+	header[0] = Data_Packet::DATA_START_CODE_1;
+	header[1] = Data_Packet::DATA_START_CODE_2;
+	header[2] = Data_Packet::DATA_DEVICE_ID_1;
+	header[3] = Data_Packet::DATA_DEVICE_ID_2;
+	Data_Checksum checksum;
+	checksum.Add(header, 4);
+	checksum.Add(data, length);
+	byte footer[2];
+	footer[0] = (byte)(checksum.Value() & 0x00FF);
+	footer[1] = (byte)((checksum.Value() >> 8) & 0x00FF);
+
+	_serial.write(header, 4);
+	_serial.write(data, length);
+	_serial.write(footer, 2);
+	if (Recorder != NULL)
+	{
+		Recorder->Start(Session_Recorder::SENT | Session_Recorder::DATA, length + 6);
+		Recorder->Add(header, 4);
+		Recorder->Add(data, length);
+		Recorder->Add(footer, 2);
+	}
+#if FPS_DEBUG
+	if (UseSerialDebug)
+	{
+		Serial.print(F("FPS - SEND DATA: "));
+		Serial.print(length);
+		Serial.print(F(" bytes, checksum "));
+		SendToSerial(footer, 2);
+		Serial.println();
+	}
+#endif  //FPS_DEBUG
 };
 
 // Gets the response to the command from the software serial channel (and waits for it)
 Response_Packet* FPS_GT511C3::GetResponse()
 {
-	byte firstbyte = 0;
-	bool done = false;
+	byte* resp = new byte[12];
+	for (int i=0; i < 12; i++) resp[i] = 0;
+	bool timedout = false;
+	unsigned long started = millis();
 	_serial.listen();
-	while (done == false)
+	while (timedout == false)
 	{
-		firstbyte = (byte)_serial.read();
-		if (firstbyte == Response_Packet::COMMAND_START_CODE_1)
+		if ((Rx.Available() > 0) || (Pump() > 0))
 		{
-			done = true;
+			resp[0] = Rx.Get();
+			if (resp[0] == Response_Packet::COMMAND_START_CODE_1) break;
 		}
+		else timedout = TimedOut(started);
 	}
-	byte* resp = new byte[12];
-	resp[0] = firstbyte;
-	for (int i=1; i < 12; i++)
+	for (int i=1; (i < 12) && (timedout == false); i++)
 	{
-		while (_serial.available() == false) delay(10);
-		resp[i]= (byte) _serial.read();
+		// no delay() while waiting, a data packet can follow right behind the response
+		while ((Rx.Available() == 0) && (Pump() == 0) && (timedout == false))
+		{
+			timedout = TimedOut(started);
+		}
+		if (timedout == false) resp[i]= Rx.Get();
 	}
-	Response_Packet* rp = new Response_Packet(resp, UseSerialDebug);
-	delete resp;
-	if (UseSerialDebug)
+	// a response that never (fully) arrived parses as garbled, so it reads as a failed command
+	if ((Recorder != NULL) && (timedout == false)) Recorder->Frame(Session_Recorder::RECEIVED | Session_Recorder::COMMAND, resp, 12);
+	Response_Packet* rp = new Response_Packet(resp, UseSerialDebug && (timedout == false));
+	delete[] resp;
+	if (rp->Valid == false) LinkFailures++;
+	LastResult.Command = (Command_Packet::Commands::Commands_Enum)_lastcommand;
+	LastResult.ACK = rp->ACK;
+	LastResult.Valid = rp->Valid;
+	if (rp->ACK) LastResult.Error = Response_Packet::ErrorCodes::NO_ERROR;
+	else LastResult.Error = rp->Error;
+	LastResult.Parameter = 0;
+	for (int i=3; i >= 0; i--) LastResult.Parameter = (LastResult.Parameter << 8) + rp->ParameterBytes[i];
+	LastResult.Millis = millis() - _commandstarted;
+#if FPS_DEBUG
+	if (UseSerialDebug && timedout)
 	{
-		Serial.print("FPS - RECV: ");
+		Serial.println(F("FPS - RECV timed out"));
+	}
+	else if (UseSerialDebug)
+	{
+		Serial.print(F("FPS - RECV: "));
 		SendToSerial(rp->RawBytes, 12);
 		Serial.println();
 		Serial.println();
 	}
+#endif  //FPS_DEBUG
 	return rp;
 };
 
+// Gets a data packet (the data phase of template/image transfers) from the software serial channel (and waits for it)
+// Returns: true if the data checksum matched
+bool FPS_GT511C3::GetData(byte data[], int length)
+{
+	Data_Checksum checksum;
+	GetDataHeader(checksum);
+	// checksum each chunk while it is still fresh instead of going over the whole buffer at the end
+	const int CHUNK = 32;
+	for (int start=0; start < length; start += CHUNK)
+	{
+		int end = start + CHUNK;
+		if (end > length) end = length;
+		ReadData(data + start, end - start);
+		checksum.Add(data + start, end - start);
+		if (Recorder != NULL) Recorder->Frame(Session_Recorder::RECEIVED | Session_Recorder::DATA, data + start, end - start);
+	}
+	return GetDataChecksum(checksum);
+}
+
+// Gets a data packet holding an image, handing it to the handler one row at a time
+// Returns: true if the data checksum matched
+bool FPS_GT511C3::GetDataRows(Image_Row_Handler& handler, int width, int height)
+{
+	byte row[IMAGE_WIDTH];
+	if (width > IMAGE_WIDTH) return false;
+	Data_Checksum checksum;
+	GetDataHeader(checksum);
+	handler.ImageStart(width, height);
+	for (int r=0; r < height; r++)
+	{
+		ReadData(row, width);
+		checksum.Add(row, width);
+		if (Recorder != NULL) Recorder->Frame(Session_Recorder::RECEIVED | Session_Recorder::DATA, row, width);
+		handler.ImageRow(r, row, width);
+	}
+	handler.ImageEnd();
+	return GetDataChecksum(checksum);
+}
+
+// Waits for the start of a data packet and adds its header to the checksum
+void FPS_GT511C3::GetDataHeader(Data_Checksum& checksum)
+{
+	byte firstbyte = 0;
+	_datatimedout = false;
+	unsigned long started = millis();
+	_serial.listen();
+	while (_datatimedout == false)
+	{
+		if ((Rx.Available() > 0) || (Pump() > 0))
+		{
+			firstbyte = Rx.Get();
+			if (firstbyte == Data_Packet::DATA_START_CODE_1) break;
+		}
+		else if (TimedOut(started))
+		{
+			// the rest of the transfer is skipped, see ReadData
+			_datatimedout = true;
+			LinkFailures++;
+		}
+	}
+	byte header[4];
+	header[0] = firstbyte;
+	ReadData(header + 1, 3);
+	checksum.Add(header, 4);
+	if (Recorder != NULL) Recorder->Frame(Session_Recorder::RECEIVED | Session_Recorder::DATA, header, 4);
+}
+
+// Reads the checksum at the end of a data packet and compares it to the one calculated while receiving
+// Returns: true if the data checksum matched
+bool FPS_GT511C3::GetDataChecksum(Data_Checksum& checksum)
+{
+	byte footer[2];
+	ReadData(footer, 2);
+	bool retval = checksum.Matches(footer[0], footer[1]) && (_datatimedout == false);
+	if (Recorder != NULL) Recorder->Frame(Session_Recorder::RECEIVED | Session_Recorder::DATA, footer, 2);
+	if (retval == false)
+	{
+		// the command was acknowledged, but what it was for (the template, image or info) never made it
+		LastResult.ACK = false;
+		LastResult.Valid = false;
+		LastResult.Error = Response_Packet::ErrorCodes::INVALID;
+		LastResult.Millis = millis() - _commandstarted;
+	}
+#if FPS_DEBUG
+	if (UseSerialDebug)
+	{
+		Serial.print(F("FPS - RECV DATA checksum "));
+		SendToSerial(footer, 2);
+		if (retval == false) Serial.print(F(" MISMATCH"));
+		Serial.println();
+	}
+#endif  //FPS_DEBUG
+	return retval;
+}
+
+// Reads part of the data phase out of Rx, a span at a time
+// no delay() while waiting here, the data phase is longer than the serial buffer
+// Returns: True if it all arrived, what didn't is 0 once the fps has stopped sending for ResponseTimeout ms
+bool FPS_GT511C3::ReadData(byte* data, int length)
+{
+	int done = 0;
+	unsigned long started = millis();
+	while ((done < length) && (_datatimedout == false))
+	{
+		Pump();
+		int count = Rx.Read(data + done, length - done);
+		if (count > 0)
+		{
+			done += count;
+			started = millis();
+		}
+		else if (TimedOut(started))
+		{
+			_datatimedout = true;
+			LinkFailures++;
+		}
+	}
+	for (; done < length; done++) data[done] = 0;
+	return _datatimedout == false;
+}
+
+// Moves what the fps has sent from the SoftwareSerial buffer into Rx
+// Returns: the bytes waiting in Rx
+int FPS_GT511C3::Pump()
+{
+	int count = _serial.available();
+	if (count > Rx.Free()) count = Rx.Free();
+	for (; count > 0; count--) Rx.Put((byte)_serial.read());
+	// SoftwareSerial drops what arrives while its own buffer is full
+	if (_serial.overflow()) Rx.Overruns++;
+	return Rx.Available();
+}
+
+// Returns: True if ResponseTimeout (when set) has passed since started
+bool FPS_GT511C3::TimedOut(unsigned long started)
+{
+	return (ResponseTimeout > 0) && (millis() - started >= ResponseTimeout);
+}
+
 // sends the bye aray to the serial debugger in our hex format EX: "00 AF FF 10 00 13"
 void FPS_GT511C3::SendToSerial(byte data[], int length)
 {
   boolean first=true;
-  Serial.print("\"");
+  Serial.print(F("\""));
   for(int i=0; i<length; i++)
   {
-	if (first) first=false; else Serial.print(" ");
+	if (first) first=false; else Serial.print(F(" "));
 	serialPrintHex(data[i]);
   }
-  Serial.print("\"");
+  Serial.print(F("\""));
 }
 
 // sends a byte to the serial debugger in the hex format we want EX "0F"
 void FPS_GT511C3::serialPrintHex(byte data)
 {
-  char tmp[16];
-  sprintf(tmp, "%.2X",data);
-  Serial.print(tmp);
+  if (data < 0x10) Serial.print(F("0"));
+  Serial.print(data, HEX);
+}
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
+
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
+
+
+
+#ifndef __GNUC__
+#pragma region -= Template_Store Definitions =-
+#endif  //__GNUC__
+Template_Store::Template_Store(Stream& stream)
+	: _stream(stream)
+{
+	Model = Models::Unknown;
+	Capacity = 0;
+}
+
+// Writes the header, querying the fps for which slots are in use
+void Template_Store::WriteHeader(FPS_GT511C3& fps, Models::Models_Enum model, int capacity)
+{
+	Model = model;
+	Capacity = capacity;
+	_stream.write((const uint8_t*)"FPST", 4);
+	_stream.write(FORMAT_VERSION);
+	_stream.write((byte)model);
+	WriteWord(capacity);
+	WriteWord(RECORD_SIZE);
+	WriteZeros(6);
+	// the bitmap is built 8 slots at a time so it never has to be held in ram
+	int written = 16;
+	for (int slot = 0; slot < capacity; slot += 8)
+	{
+		byte b = 0;
+		for (int bit = 0; (bit < 8) && (slot + bit < capacity); bit++)
+		{
+			if (fps.CheckEnrolled(slot + bit)) b |= (1 << bit);
+		}
+		_stream.write(b);
+		written++;
+	}
+	WriteZeros(HEADER_SIZE - written);
+}
+
+// Reads and validates the header, filling in Model and Capacity
+// Returns: true if the header is valid
+bool Template_Store::ReadHeader()
+{
+	byte header[16];
+	if (ReadBytes(header, 16) == false) return false;
+	if ((header[0] != 'F') || (header[1] != 'P') || (header[2] != 'S') || (header[3] != 'T')) return false;
+	if (header[4] != FORMAT_VERSION) return false;
+	if ((header[8] + (header[9] << 8)) != RECORD_SIZE) return false;
+	Model = (Models::Models_Enum)header[5];
+	Capacity = header[6] + (header[7] << 8);
+	// the bitmap is only needed for random access, records carry their own slot number
+	byte skip;
+	for (int i = 16; i < HEADER_SIZE; i++)
+	{
+		if (ReadBytes(&skip, 1) == false) return false;
+	}
+	return true;
+}
+
+// Writes the record for the given slot, pass a null template for an empty slot
+void Template_Store::WriteRecord(int slot, byte* tmplt)
+{
+	if (tmplt != NULL)
+	{
+		_stream.write(tmplt, FPS_GT511C3::TEMPLATE_SIZE);
+		WriteWord(slot);
+		WriteWord(TemplateChecksum(tmplt));
+	}
+	else
+	{
+		WriteZeros(FPS_GT511C3::TEMPLATE_SIZE);
+		WriteWord(0xFFFF);
+		WriteWord(0);
+	}
+	WriteZeros(RECORD_SIZE - FPS_GT511C3::TEMPLATE_SIZE - 4);
+}
+
+// Reads the next record into tmplt (498 bytes), slot receives the slot number
+Template_Store::RecordResults::RecordResults_Enum Template_Store::ReadRecord(int& slot, byte* tmplt)
+{
+	byte trailer[RECORD_SIZE - FPS_GT511C3::TEMPLATE_SIZE];
+	if (ReadBytes(tmplt, FPS_GT511C3::TEMPLATE_SIZE) == false) return RecordResults::TRUNCATED;
+	if (ReadBytes(trailer, sizeof(trailer)) == false) return RecordResults::TRUNCATED;
+	word s = trailer[0] + (trailer[1] << 8);
+	word checksum = trailer[2] + (trailer[3] << 8);
+	if (s == 0xFFFF)
+	{
+		slot = -1;
+		return RecordResults::EMPTY;
+	}
+	slot = s;
+	if (checksum != TemplateChecksum(tmplt)) return RecordResults::BAD_CHECKSUM;
+	return RecordResults::OK;
+}
+
+// Downloads every slot from the fps into the store (header included)
+// Returns: the number of templates exported
+int Template_Store::Export(FPS_GT511C3& fps, Models::Models_Enum model, int capacity, byte* tmplt)
+{
+	WriteHeader(fps, model, capacity);
+	int count = 0;
+	for (int slot = 0; slot < capacity; slot++)
+	{
+		if (fps.GetTemplate(slot, tmplt) == 0)
+		{
+			WriteRecord(slot, tmplt);
+			count++;
+		}
+		else
+		{
+			WriteRecord(slot, NULL);
+		}
+	}
+	return count;
+}
+
+// Uploads every template in the store (header included) to the same slot on the fps
+// Returns: the number of templates imported, or -1 if the header is invalid
+int Template_Store::Import(FPS_GT511C3& fps, bool duplicateCheck, byte* tmplt)
+{
+	if (ReadHeader() == false) return -1;
+	int count = 0;
+	for (int i = 0; i < Capacity; i++)
+	{
+		int slot;
+		RecordResults::RecordResults_Enum result = ReadRecord(slot, tmplt);
+		if (result == RecordResults::TRUNCATED) break;
+		if (result != RecordResults::OK) continue;
+		if (fps.SetTemplate(tmplt, slot, duplicateCheck) == 3000) count++;
+	}
+	return count;
+}
+
+// Brings the fps in line with the store (header included) by only touching slots that changed
+// Returns: true if the whole store was read
+bool Template_Store::Sync(FPS_GT511C3& fps, Stream* manifestIn, Print* manifestOut, byte* tmplt, SyncResults& results)
+{
+	// bytes on the fps link: a command and its response are 12 bytes each,
+	// a template data packet is 4 header + 498 + 2 checksum
+	const unsigned long COMMAND_BYTES = 24;
+	const unsigned long UPLOAD_BYTES = COMMAND_BYTES + 504 + 12;
+	const uint32_t UNKNOWN = 0xFFFFFFFF;
+
+	results.Uploaded = 0;
+	results.Deleted = 0;
+	results.Unchanged = 0;
+	results.Failed = 0;
+	results.BytesSent = 0;
+	results.BytesSaved = 0;
+	if (ReadHeader() == false) return false;
+
+	unsigned long fullreload = COMMAND_BYTES;
+	for (int i = 0; i < Capacity; i++)
+	{
+		int slot;
+		RecordResults::RecordResults_Enum result = ReadRecord(slot, tmplt);
+		if (result == RecordResults::TRUNCATED) return false;
+
+		uint32_t oldhash = UNKNOWN;
+		if (manifestIn != NULL)
+		{
+			byte b[4];
+			if ((int)manifestIn->readBytes(b, 4) == 4)
+			{
+				oldhash = (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+			}
+		}
+
+		uint32_t newhash = oldhash;
+		if ((result == RecordResults::BAD_CHECKSUM) || ((result == RecordResults::OK) && (slot != i)))
+		{
+			// leave the slot alone and make sure the next sync looks at it again
+			results.Failed++;
+			newhash = UNKNOWN;
+		}
+		else if (result == RecordResults::OK)
+		{
+			fullreload += UPLOAD_BYTES;
+			newhash = TemplateHash(tmplt);
+			if (newhash == oldhash)
+			{
+				results.Unchanged++;
+			}
+			else
+			{
+				// SetTemplate will not replace a template that is already there
+				bool cleared = true;
+				if (oldhash != 0)
+				{
+					// an ID that was not in use is as good as deleted (no manifest, or it went away)
+					cleared = fps.DeleteID(i) || (fps.LastResult.Error == Response_Packet::ErrorCodes::NACK_IS_NOT_USED);
+					results.BytesSent += COMMAND_BYTES;
+				}
+				bool uploaded = false;
+				if (cleared)
+				{
+					// the upload only counts when the fps acknowledged the template itself, the slot
+					// may still hold an old one otherwise
+					uploaded = (fps.SetTemplate(tmplt, i, false) == 3000);
+					results.BytesSent += UPLOAD_BYTES + COMMAND_BYTES;
+					if (uploaded) uploaded = fps.CheckEnrolled(i);
+				}
+				if (uploaded)
+				{
+					results.Uploaded++;
+				}
+				else
+				{
+					results.Failed++;
+					newhash = UNKNOWN;
+				}
+			}
+		}
+		else
+		{
+			// empty in the store
+			newhash = 0;
+			if (oldhash == 0)
+			{
+				results.Unchanged++;
+			}
+			else
+			{
+				bool enrolled = true;
+				if (oldhash == UNKNOWN)
+				{
+					// without a manifest, only delete what is actually there
+					enrolled = fps.CheckEnrolled(i);
+					results.BytesSent += COMMAND_BYTES;
+				}
+				if (enrolled)
+				{
+					fps.DeleteID(i);
+					results.BytesSent += COMMAND_BYTES * 2;
+					if (fps.CheckEnrolled(i) == false)
+					{
+						results.Deleted++;
+					}
+					else
+					{
+						results.Failed++;
+						newhash = UNKNOWN;
+					}
+				}
+				else
+				{
+					results.Unchanged++;
+				}
+			}
+		}
+
+		if (manifestOut != NULL)
+		{
+			manifestOut->write((byte)(newhash & 0xFF));
+			manifestOut->write((byte)((newhash >> 8) & 0xFF));
+			manifestOut->write((byte)((newhash >> 16) & 0xFF));
+			manifestOut->write((byte)((newhash >> 24) & 0xFF));
+		}
+	}
+	results.BytesSaved = (long)fullreload - (long)results.BytesSent;
+	return true;
+}
+
+// 32 bit content hash (FNV-1a) of a template, never 0 so 0 can mark an empty slot, and never
+// 0xFFFFFFFF so it can mark a slot in an unknown state
+uint32_t Template_Store::TemplateHash(byte* tmplt)
+{
+	uint32_t hash = 2166136261UL;
+	for (int i = 0; i < FPS_GT511C3::TEMPLATE_SIZE; i++)
+	{
+		hash ^= tmplt[i];
+		hash *= 16777619UL;
+	}
+	if (hash == 0) hash = 1;
+	if (hash == 0xFFFFFFFFUL) hash = 0xFFFFFFFEUL;
+	return hash;
+}
+
+// 32 bit similarity signature (SimHash) of a template
+uint32_t Template_Store::TemplateSignature(byte* tmplt)
+{
+	// every (position, value) pair votes on each of the 32 bits
+	// templates sharing most bytes share most votes, so their signatures land close together
+	int votes[32];
+	for (int bit = 0; bit < 32; bit++) votes[bit] = 0;
+	for (int i = 0; i < FPS_GT511C3::TEMPLATE_SIZE; i++)
+	{
+		uint32_t feature = ((uint32_t)i << 8) | tmplt[i];
+		feature ^= feature >> 16;
+		feature *= 0x7FEB352DUL;
+		feature ^= feature >> 15;
+		feature *= 0x846CA68BUL;
+		feature ^= feature >> 16;
+		for (int bit = 0; bit < 32; bit++)
+		{
+			if (feature & 1) votes[bit]++; else votes[bit]--;
+			feature >>= 1;
+		}
+	}
+	uint32_t signature = 0;
+	for (int bit = 0; bit < 32; bit++)
+	{
+		if (votes[bit] > 0) signature |= ((uint32_t)1 << bit);
+	}
+	return signature;
+}
+
+// Number of bits that differ between two signatures, 0-32
+int Template_Store::SignatureDistance(uint32_t a, uint32_t b)
+{
+	uint32_t x = a ^ b;
+	int count = 0;
+	while (x != 0)
+	{
+		x &= x - 1;
+		count++;
+	}
+	return count;
+}
+
+// Checksum of a template, calculated using byte addition like the data phase
+word Template_Store::TemplateChecksum(byte* tmplt)
+{
+	Data_Checksum checksum;
+	checksum.Add(tmplt, FPS_GT511C3::TEMPLATE_SIZE);
+	return checksum.Value();
+}
+
+void Template_Store::WriteWord(word w)
+{
+	_stream.write((byte)(w & 0x00FF));
+	_stream.write((byte)((w >> 8) & 0x00FF));
+}
+
+void Template_Store::WriteZeros(int count)
+{
+	for (int i = 0; i < count; i++) _stream.write((byte)0);
+}
+
+// reads from the stream, honoring its timeout
+bool Template_Store::ReadBytes(byte* buffer, int length)
+{
+	return (int)_stream.readBytes(buffer, length) == length;
+}
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
+
+
+#ifndef __GNUC__
+#pragma region -= Image_Quality Definitions =-
+#endif  //__GNUC__
+Image_Quality::Image_Quality()
+{
+	MinContrast = 80;
+	MinCoverage = 40;
+	MinClarity = 12;
+	TextureThreshold = 40;
+	ImageStart(0, 0);
+}
+
+// Returns: True if the capture is good enough to match
+bool Image_Quality::Passed()
+{
+	return Complete && (Contrast >= MinContrast) && (Coverage >= MinCoverage) && (Clarity >= MinClarity);
+}
+
+void Image_Quality::ImageStart(int /*width*/, int /*height*/)
+{
+	for (int i = 0; i < 16; i++) Histogram[i] = 0;
+	Contrast = 0;
+	Coverage = 0;
+	Clarity = 0;
+	Complete = false;
+	_segments = 0;
+	_texturesegments = 0;
+	_gradient = 0;
+	_gradientcount = 0;
+}
+
+void Image_Quality::ImageRow(int /*row*/, byte* pixels, int width)
+{
+	for (int start = 0; start + SEGMENT <= width; start += SEGMENT)
+	{
+		byte lo = 255;
+		byte hi = 0;
+		word gradient = 0;
+		byte previous = pixels[start];
+		for (int i = start; i < start + SEGMENT; i++)
+		{
+			byte p = pixels[i];
+			Histogram[p >> 4]++;
+			if (p < lo) lo = p;
+			if (p > hi) hi = p;
+			gradient += (p > previous) ? (p - previous) : (previous - p);
+			previous = p;
+		}
+		_segments++;
+		if (hi - lo >= TextureThreshold)
+		{
+			_texturesegments++;
+			_gradient += gradient;
+			_gradientcount += SEGMENT - 1;
+		}
+	}
+	// leftover pixels at the end of the row still count towards the histogram
+	for (int i = width - (width % SEGMENT); i < width; i++) Histogram[pixels[i] >> 4]++;
+}
+
+void Image_Quality::ImageEnd()
+{
+	unsigned long total = 0;
+	for (int i = 0; i < 16; i++) total += Histogram[i];
+	if (total > 0)
+	{
+		// darkest and lightest 5%, to the nearest histogram block
+		unsigned long tail = total / 20;
+		unsigned long count = 0;
+		int low = 0;
+		while ((low < 15) && (count + Histogram[low] <= tail)) count += Histogram[low++];
+		count = 0;
+		int high = 15;
+		while ((high > 0) && (count + Histogram[high] <= tail)) count += Histogram[high--];
+		Contrast = (high > low) ? ((high - low) * 16) : 0;
+	}
+	if (_segments > 0) Coverage = (_texturesegments * 100) / _segments;
+	if (_gradientcount > 0) Clarity = _gradient / _gradientcount;
+	Complete = true;
 }
 #ifndef __GNUC__
 #pragma endregion
 #endif  //__GNUC__
 
+
+#ifndef __GNUC__
+#pragma region -= Image_Fanout Definitions =-
+#endif  //__GNUC__
+Image_Fanout::Image_Fanout()
+{
+	_count = 0;
+	ImageStart(0, 0);
+}
+
+// Returns: True if added, false if there are already MAX_HANDLERS
+bool Image_Fanout::Add(Image_Row_Handler& handler)
+{
+	if (_count >= MAX_HANDLERS) return false;
+	_handlers[_count++] = &handler;
+	return true;
+}
+
+int Image_Fanout::Count()
+{
+	return _count;
+}
+
+void Image_Fanout::ImageStart(int width, int height)
+{
+	SlowestRowMicrosAll = 0;
+	for (int i = 0; i < MAX_HANDLERS; i++)
+	{
+		SlowestRowMicros[i] = 0;
+		TotalMicros[i] = 0;
+	}
+	for (int i = 0; i < _count; i++) _handlers[i]->ImageStart(width, height);
+}
+
+void Image_Fanout::ImageRow(int row, byte* pixels, int width)
+{
+	unsigned long rowstarted = micros();
+	unsigned long started = rowstarted;
+	for (int i = 0; i < _count; i++)
+	{
+		_handlers[i]->ImageRow(row, pixels, width);
+		unsigned long now = micros();
+		unsigned long elapsed = now - started;
+		TotalMicros[i] += elapsed;
+		if (elapsed > SlowestRowMicros[i]) SlowestRowMicros[i] = elapsed;
+		started = now;
+	}
+	unsigned long elapsed = started - rowstarted;
+	if (elapsed > SlowestRowMicrosAll) SlowestRowMicrosAll = elapsed;
+}
+
+void Image_Fanout::ImageEnd()
+{
+	for (int i = 0; i < _count; i++) _handlers[i]->ImageEnd();
+}
 #ifndef __GNUC__
 #pragma endregion
 #endif  //__GNUC__
 
+
+#ifndef __GNUC__
+#pragma region -= Image_Encoder / Image_Decoder Definitions =-
+#endif  //__GNUC__
+Image_Encoder::Image_Encoder(Print& out)
+	: _out(out)
+{
+	BytesWritten = 0;
+	PixelCount = 0;
+	_groups = 0;
+	_bits = 0;
+	_bitcount = 0;
+}
+
+void Image_Encoder::ImageStart(int width, int height)
+{
+	BytesWritten = 0;
+	PixelCount = 0;
+	_groups = 0;
+	_checksum.Reset();
+	_bits = 0;
+	_bitcount = 0;
+	WriteByte('F');
+	WriteByte('P');
+	WriteByte('S');
+	WriteByte('I');
+	WriteByte(FORMAT_VERSION);
+	WriteByte(GROUP_ROWS);
+	WriteByte(width & 0xFF);
+	WriteByte((width >> 8) & 0xFF);
+	WriteByte(height & 0xFF);
+	WriteByte((height >> 8) & 0xFF);
+	WriteByte(0);
+	WriteByte(0);
+}
+
+void Image_Encoder::ImageRow(int row, byte* pixels, int width)
+{
+	if ((width > MAX_WIDTH) || (row >= MAX_HEIGHT)) return;
+	bool keyrow = (row % GROUP_ROWS) == 0;
+	if (keyrow) _groupoffsets[_groups++] = BytesWritten;
+
+	// first pass picks the Rice parameter from the average code size
+	unsigned long sum = 0;
+	for (int i = 0; i < width; i++)
+	{
+		byte prediction;
+		if (keyrow) prediction = (i == 0) ? 128 : pixels[i - 1];
+		else prediction = (i == 0) ? _previous[0] : Predict(pixels[i - 1], _previous[i], _previous[i - 1]);
+		sum += ZigZag(pixels[i] - prediction);
+	}
+	int k = 0;
+	while ((k < 7) && (((unsigned long)width << (k + 1)) <= sum)) k++;
+
+	WriteBits(k, 3);
+	for (int i = 0; i < width; i++)
+	{
+		byte prediction;
+		if (keyrow) prediction = (i == 0) ? 128 : pixels[i - 1];
+		else prediction = (i == 0) ? _previous[0] : Predict(pixels[i - 1], _previous[i], _previous[i - 1]);
+		byte code = ZigZag(pixels[i] - prediction);
+		word q = code >> k;
+		if (q < ESCAPE)
+		{
+			// unary quotient, then the k low bits
+			WriteBits((1 << q) - 1, q);
+			WriteBits(0, 1);
+			WriteBits(code & ((1 << k) - 1), k);
+		}
+		else
+		{
+			// quotient too long, send the code as is
+			WriteBits((1 << ESCAPE) - 1, ESCAPE);
+			WriteBits(code, 8);
+		}
+	}
+	FlushBits();
+	_checksum.Add(pixels, width);
+	for (int i = 0; i < width; i++) _previous[i] = pixels[i];
+	PixelCount += width;
+}
+
+void Image_Encoder::ImageEnd()
+{
+	unsigned long indexoffset = BytesWritten;
+	for (int i = 0; i < _groups; i++) WriteLong(_groupoffsets[i]);
+	WriteByte(_checksum.Value() & 0xFF);
+	WriteByte((_checksum.Value() >> 8) & 0xFF);
+	WriteByte(_groups & 0xFF);
+	WriteByte((_groups >> 8) & 0xFF);
+	WriteLong(indexoffset);
+	WriteByte('F');
+	WriteByte('P');
+	WriteByte('S');
+	WriteByte('E');
+}
+
+// Median edge detector, picks left or up at an edge and a plane fit otherwise
+byte Image_Encoder::Predict(byte left, byte up, byte upleft)
+{
+	byte lo = (left < up) ? left : up;
+	byte hi = (left < up) ? up : left;
+	if (upleft >= hi) return lo;
+	if (upleft <= lo) return hi;
+	return left + up - upleft;
+}
+
+// Maps the prediction error (-128 to 127, as a byte) to 0-255 with small errors first
+byte Image_Encoder::ZigZag(byte residual)
+{
+	return (residual & 0x80) ? (byte)(((~residual) << 1) | 1) : (byte)(residual << 1);
+}
+
+byte Image_Encoder::UnZigZag(byte code)
+{
+	return (code & 1) ? (byte)~(code >> 1) : (byte)(code >> 1);
+}
+
+void Image_Encoder::WriteBits(word value, int count)
+{
+	// most significant bit first
+	while (count > 0)
+	{
+		count--;
+		_bits = (_bits << 1) | ((value >> count) & 1);
+		_bitcount++;
+		if (_bitcount == 8)
+		{
+			WriteByte(_bits);
+			_bits = 0;
+			_bitcount = 0;
+		}
+	}
+}
+
+void Image_Encoder::FlushBits()
+{
+	if (_bitcount > 0) WriteBits(0, 8 - _bitcount);
+}
+
+void Image_Encoder::WriteByte(byte b)
+{
+	_out.write(b);
+	BytesWritten++;
+}
+
+void Image_Encoder::WriteLong(unsigned long l)
+{
+	for (int i = 0; i < 4; i++) WriteByte((l >> (i * 8)) & 0xFF);
+}
+
+Image_Decoder::Image_Decoder(const byte* record, unsigned long length)
+{
+	_record = record;
+	_source = NULL;
+	_seek = NULL;
+	_context = NULL;
+	_length = length;
+	ReadHeader();
+}
+
+Image_Decoder::Image_Decoder(Stream& source, unsigned long length, SeekCallback seek, void* context)
+{
+	_record = NULL;
+	_source = &source;
+	_seek = seek;
+	_context = context;
+	_length = length;
+	ReadHeader();
+}
+
+// Reads and checks the header and the footer, the rows and the index are read when needed
+void Image_Decoder::ReadHeader()
+{
+	Valid = false;
+	Width = 0;
+	Height = 0;
+	Checksum = 0;
+	_groups = 0;
+	_indexoffset = 0;
+	_nextrow = -1;
+	_position = 0;
+	_bits = 0;
+	_bitcount = 0;
+	_overrun = false;
+	// an unknown position, so the first read always seeks
+	_sourceposition = 0xFFFFFFFFUL;
+	if (_length < (unsigned long)(Image_Encoder::HEADER_SIZE + Image_Encoder::FOOTER_SIZE)) return;
+	byte header[Image_Encoder::HEADER_SIZE];
+	byte footer[Image_Encoder::FOOTER_SIZE];
+	if (Read(0, header, Image_Encoder::HEADER_SIZE) == false) return;
+	if (Read(_length - Image_Encoder::FOOTER_SIZE, footer, Image_Encoder::FOOTER_SIZE) == false) return;
+	if ((header[0] != 'F') || (header[1] != 'P') || (header[2] != 'S') || (header[3] != 'I')) return;
+	if ((header[4] != Image_Encoder::FORMAT_VERSION) || (header[5] != Image_Encoder::GROUP_ROWS)) return;
+	if ((footer[8] != 'F') || (footer[9] != 'P') || (footer[10] != 'S') || (footer[11] != 'E')) return;
+	Width = header[6] + (header[7] << 8);
+	Height = header[8] + (header[9] << 8);
+	Checksum = footer[0] + (footer[1] << 8);
+	_groups = footer[2] + (footer[3] << 8);
+	for (int i = 7; i >= 4; i--) _indexoffset = (_indexoffset << 8) | footer[i];
+	if ((Width > Image_Encoder::MAX_WIDTH) || (Height > Image_Encoder::MAX_HEIGHT)) return;
+	if (_groups != (Height + Image_Encoder::GROUP_ROWS - 1) / Image_Encoder::GROUP_ROWS) return;
+	if (_indexoffset + (unsigned long)_groups * 4 + Image_Encoder::FOOTER_SIZE != _length) return;
+	Valid = true;
+}
+
+// Decodes one row into pixels (Width bytes)
+// Returns: True if the row was decoded
+bool Image_Decoder::DecodeRow(int row, byte* pixels)
+{
+	if ((Valid == false) || (row < 0) || (row >= Height)) return false;
+	if (row != _nextrow)
+	{
+		// jump to the key row of the group, then decode forward from there
+		int group = row / Image_Encoder::GROUP_ROWS;
+		_nextrow = -1;
+		if (ReadLong(_indexoffset + (unsigned long)group * 4, _position) == false) return false;
+		_nextrow = group * Image_Encoder::GROUP_ROWS;
+	}
+	while (_nextrow <= row)
+	{
+		if (DecodeNextRow(pixels) == false) return false;
+	}
+	return true;
+}
+
+// Decodes the row at _nextrow, pixels holds the row above on entry
+bool Image_Decoder::DecodeNextRow(byte* pixels)
+{
+	bool keyrow = (_nextrow % Image_Encoder::GROUP_ROWS) == 0;
+	_bitcount = 0;
+	int k = ReadBits(3);
+	byte upleft = 0;
+	_overrun = false;
+	for (int i = 0; i < Width; i++)
+	{
+		word q = 0;
+		while ((q < 16) && (ReadBits(1) == 1)) q++;
+		byte code;
+		if (q < 16) code = (q << k) | ReadBits(k);
+		else code = ReadBits(8);
+
+		byte up = pixels[i];
+		byte prediction;
+		if (keyrow) prediction = (i == 0) ? 128 : pixels[i - 1];
+		else prediction = (i == 0) ? up : Image_Encoder::Predict(pixels[i - 1], up, upleft);
+		pixels[i] = prediction + Image_Encoder::UnZigZag(code);
+		upleft = up;
+	}
+	if (_overrun)
+	{
+		// start over from a key row next time
+		_nextrow = -1;
+		return false;
+	}
+	_nextrow++;
+	return true;
+}
+
+word Image_Decoder::ReadBits(int count)
+{
+	word value = 0;
+	while (count > 0)
+	{
+		if (_bitcount == 0)
+		{
+			// rows end where the index starts, running past it means the record is damaged
+			if ((_position >= _indexoffset) || (Read(_position, &_bits, 1) == false)) _overrun = true;
+			_position++;
+			_bitcount = 8;
+		}
+		_bitcount--;
+		value = (value << 1) | ((_bits >> _bitcount) & 1);
+		count--;
+	}
+	return value;
+}
+
+bool Image_Decoder::ReadLong(unsigned long offset, unsigned long& l)
+{
+	byte b[4];
+	if (Read(offset, b, 4) == false) return false;
+	l = 0;
+	for (int i = 3; i >= 0; i--) l = (l << 8) | b[i];
+	return true;
+}
+
+// Reads count bytes of the record from offset, seeking the source only when it is elsewhere
+// Returns: True if all of them were read
+bool Image_Decoder::Read(unsigned long offset, byte* buffer, int count)
+{
+	if (offset + count > _length) return false;
+	if (_record != NULL)
+	{
+		memcpy(buffer, _record + offset, count);
+		return true;
+	}
+	if (offset != _sourceposition)
+	{
+		if (_seek(offset, _context) == false) return false;
+		_sourceposition = offset;
+	}
+	int got = _source->readBytes(buffer, count);
+	_sourceposition += got;
+	return got == count;
+}
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
+
+
+#ifndef __GNUC__
+#pragma region -= Minutiae Definitions =-
+#endif  //__GNUC__
+void Minutiae_Set::Clear()
+{
+	Count = 0;
+}
+
+// Adds a minutia, unless there is no room or another one is closer than spacing
+// Returns: True if it was added
+bool Minutiae_Set::Add(byte x, byte y, byte kind, byte spacing)
+{
+	if (Count >= MAX_MINUTIAE) return false;
+	for (int i = 0; i < Count; i++)
+	{
+		int dx = (int)X[i] - x;
+		int dy = (int)Y[i] - y;
+		if ((dx < spacing) && (dx > -spacing) && (dy < spacing) && (dy > -spacing)) return false;
+	}
+	X[Count] = x;
+	Y[Count] = y;
+	Kind[Count] = kind;
+	Count++;
+	return true;
+}
+
+Minutiae_Extractor::Minutiae_Extractor(Minutiae_Set& result) : _result(result)
+{
+	Margin = 6;
+	Spacing = 4;
+	Complete = false;
+	_width = 0;
+	_height = 0;
+	_rows = 0;
+	_newest = 0;
+}
+
+void Minutiae_Extractor::ImageStart(int width, int height)
+{
+	_width = width / 2;
+	if (_width > MAX_WIDTH) _width = MAX_WIDTH;
+	_height = height / 2;
+	_rows = 0;
+	_newest = 0;
+	Complete = false;
+	_result.Clear();
+}
+
+void Minutiae_Extractor::ImageRow(int row, byte* pixels, int /*width*/)
+{
+	if ((row & 1) == 0)
+	{
+		for (int i = 0; i < _width; i++) _half[i] = ((word)pixels[i * 2] + pixels[i * 2 + 1]) >> 1;
+		return;
+	}
+	if ((row >> 1) >= _height) return;
+	for (int i = 0; i < _width; i++) _half[i] = (_half[i] + (((word)pixels[i * 2] + pixels[i * 2 + 1]) >> 1)) >> 1;
+
+	_newest = (_newest + 1) % 3;
+	Binarise(_bits[_newest]);
+	_rows++;
+	// the middle of the last three rows has a full neighbourhood
+	if (_rows >= 3) Scan(_rows - 2);
+}
+
+void Minutiae_Extractor::ImageEnd()
+{
+	Complete = true;
+}
+
+// Ridges are darker than the average of the pixels around them
+void Minutiae_Extractor::Binarise(byte* bits)
+{
+	for (int i = 0; i < ROW_BYTES; i++) bits[i] = 0;
+	word sum = 0;
+	int count = 0;
+	for (int i = 0; (i < WINDOW) && (i < _width); i++)
+	{
+		sum += _half[i];
+		count++;
+	}
+	for (int x = 0; x < _width; x++)
+	{
+		if (x + WINDOW < _width)
+		{
+			sum += _half[x + WINDOW];
+			count++;
+		}
+		if (x - WINDOW - 1 >= 0)
+		{
+			sum -= _half[x - WINDOW - 1];
+			count--;
+		}
+		if ((word)_half[x] * count + count * 4 < sum) bits[x >> 3] |= (1 << (x & 7));
+	}
+}
+
+// Looks for minutiae on row y, the middle of the three rows kept
+void Minutiae_Extractor::Scan(int y)
+{
+	if ((y < Margin) || (y >= _height - Margin)) return;
+	const byte* above = _bits[(_newest + 1) % 3];
+	const byte* middle = _bits[(_newest + 2) % 3];
+	const byte* below = _bits[_newest];
+	for (int x = Margin; x < _width - Margin; x++)
+	{
+		if ((middle[x >> 3] & (1 << (x & 7))) == 0) continue;
+		int l = x - 1;
+		int r = x + 1;
+		// neighbours counter clockwise, starting on the right
+		byte ring = 0;
+		if (middle[r >> 3] & (1 << (r & 7))) ring |= 0x01;
+		if (above[r >> 3] & (1 << (r & 7))) ring |= 0x02;
+		if (above[x >> 3] & (1 << (x & 7))) ring |= 0x04;
+		if (above[l >> 3] & (1 << (l & 7))) ring |= 0x08;
+		if (middle[l >> 3] & (1 << (l & 7))) ring |= 0x10;
+		if (below[l >> 3] & (1 << (l & 7))) ring |= 0x20;
+		if (below[x >> 3] & (1 << (x & 7))) ring |= 0x40;
+		if (below[r >> 3] & (1 << (r & 7))) ring |= 0x80;
+
+		int neighbours = 0;
+		int runs = 0;
+		int first = -1;
+		for (int i = 0; i < 8; i++)
+		{
+			bool on = ring & (1 << i);
+			bool previous = ring & (1 << ((i + 7) & 7));
+			if (on) neighbours++;
+			if (on && !previous)
+			{
+				runs++;
+				if (first < 0) first = i;
+			}
+		}
+		// an ending points away from the ridge it ends
+		if ((runs == 1) && (neighbours <= 2)) _result.Add(x, y, (first + 4) & 7, Spacing);
+		else if ((runs == 3) && (neighbours == 3)) _result.Add(x, y, Minutiae_Set::BIFURCATION | first, Spacing);
+	}
+}
+
+Minutiae_Matcher::Minutiae_Matcher()
+{
+	MinScore = 8;
+	LastScore = 0;
+	CaptureMillis = 0;
+	MatchMillis = 0;
+}
+
+// Returns: how well the two sets line up (0 - MAX_MINUTIAE)
+int Minutiae_Matcher::Score(const Minutiae_Set& probe, const Minutiae_Set& candidate)
+{
+	byte votes[BINS * BINS];
+	memset(votes, 0, sizeof(votes));
+	int best = 0;
+	for (int i = 0; i < probe.Count; i++)
+	{
+		int px = probe.X[i] - MAX_SHIFT;
+		int py = probe.Y[i] - MAX_SHIFT;
+		byte pk = probe.Kind[i];
+		for (int j = 0; j < candidate.Count; j++)
+		{
+			byte ck = candidate.Kind[j];
+			if ((pk ^ ck) & Minutiae_Set::BIFURCATION) continue;
+			// directions may differ by one step either way
+			byte turn = (pk - ck) & 7;
+			if ((turn > 1) && (turn < 7)) continue;
+			int dx = candidate.X[j] - px;
+			int dy = candidate.Y[j] - py;
+			if ((dx < 0) || (dx > 2 * MAX_SHIFT) || (dy < 0) || (dy > 2 * MAX_SHIFT)) continue;
+			byte& v = votes[(dy >> BIN_SHIFT) * BINS + (dx >> BIN_SHIFT)];
+			if (v < 255) v++;
+			if (v > best) best = v;
+		}
+	}
+	// a minutia can only pair up once
+	if (best > probe.Count) best = probe.Count;
+	if (best > candidate.Count) best = candidate.Count;
+	return best;
+}
+
+// Scores the probe against every set in the gallery
+// Returns: the index of the best match, or -1 if none scored MinScore
+int Minutiae_Matcher::Identify(const Minutiae_Set& probe, const Minutiae_Set* gallery, int count)
+{
+	unsigned long started = millis();
+	int retval = -1;
+	LastScore = 0;
+	for (int i = 0; i < count; i++)
+	{
+		int score = Score(probe, gallery[i]);
+		if (score > LastScore)
+		{
+			LastScore = score;
+			retval = i;
+		}
+	}
+	if (LastScore < MinScore) retval = -1;
+	MatchMillis = millis() - started;
+	return retval;
+}
+
+// Captures the currently pressed finger and extracts its minutiae from the image
+// Returns: True if ok, false if no finger, the download failed or too few minutiae were found
+bool Minutiae_Matcher::Capture(FPS_GT511C3& fps, Minutiae_Set& result, bool highquality)
+{
+	unsigned long started = millis();
+	result.Clear();
+	bool retval = false;
+	if (fps.CaptureFinger(highquality))
+	{
+		Minutiae_Extractor extractor(result);
+		retval = fps.GetImage(extractor) && extractor.Complete && (result.Count >= MinScore);
+	}
+	CaptureMillis = millis() - started;
+	return retval;
+}
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
+
+
+#ifndef __GNUC__
+#pragma region -= Session_Recorder / Session_Player Definitions =-
+#endif  //__GNUC__
+Session_Recorder::Session_Recorder(Print& out) : _out(out)
+{
+	BaudRate = 9600;
+	Frames = 0;
+	Bytes = 0;
+	_last = micros();
+}
+
+// Writes the recording header and starts the clock
+void Session_Recorder::Begin()
+{
+	const byte magic[4] = { 'F', 'P', 'S', 'R' };
+	Bytes += _out.write(magic, 4);
+	Bytes += _out.write(FORMAT_VERSION);
+	Frames = 0;
+	_last = micros();
+}
+
+// Writes a whole frame
+void Session_Recorder::Frame(byte kind, const byte* bytes, unsigned long length)
+{
+	Start(kind, length);
+	Add(bytes, length);
+}
+
+// Writes a frame in pieces, Start then Add until length bytes have been added
+void Session_Recorder::Start(byte kind, unsigned long length)
+{
+	// stamped before writing, so the time spent writing lands in the next frame's delay
+	unsigned long now = micros();
+	// the frame is complete now, its first byte crossed the link 10 bits per byte earlier
+	unsigned long started = now - length * (10000000UL / BaudRate);
+	// (bytes that waited in the receive buffer can make it look like it started before the last one ended)
+	long gap = (long)(started - _last);
+	if (gap < 0) gap = 0;
+	Bytes += _out.write(kind);
+	WriteVarint(gap);
+	WriteVarint(length);
+	_last = now;
+	Frames++;
+}
+
+void Session_Recorder::Add(const byte* bytes, unsigned long length)
+{
+	Bytes += _out.write(bytes, length);
+}
+
+void Session_Recorder::WriteVarint(unsigned long value)
+{
+	while (value >= 0x80)
+	{
+		Bytes += _out.write((byte)(value | 0x80));
+		value >>= 7;
+	}
+	Bytes += _out.write((byte)value);
+}
+
+// Parameter: the recording
+// Parameter: the port that the library under test talks to
+Session_Player::Session_Player(Stream& recording, Stream& link) : _recording(recording), _link(link)
+{
+	Speed = 100;
+	Timeout = 5000;
+	Frames = 0;
+	Mismatches = 0;
+	TimedOut = false;
+	_last = micros();
+}
+
+// Reads the recording header
+// Returns: True if it is a recording this version can play
+bool Session_Player::Begin()
+{
+	const char* magic = "FPSR";
+	for (int i = 0; i < 4; i++)
+	{
+		if (ReadRecording() != magic[i]) return false;
+	}
+	int version = ReadRecording();
+	if ((version < 1) || (version > Session_Recorder::FORMAT_VERSION)) return false;
+	Frames = 0;
+	Mismatches = 0;
+	TimedOut = false;
+	_last = micros();
+	return true;
+}
+
+// Plays the next frame
+// Returns: True if there are more frames, false at the end (or on a timeout)
+bool Session_Player::Step()
+{
+	int kind = ReadRecording();
+	unsigned long gap;
+	unsigned long length;
+	if ((kind < 0) || !ReadVarint(gap) || !ReadVarint(length)) return false;
+
+	if (kind & Session_Recorder::RECEIVED)
+	{
+		// the fps starts answering after the recorded delay, counted from the end of the previous frame
+		unsigned long wait = (gap / 100) * Speed + ((gap % 100) * Speed) / 100;
+		while (micros() - _last < wait);
+		for (unsigned long i = 0; i < length; i++)
+		{
+			int b = ReadRecording();
+			if (b < 0) return false;
+			_link.write((byte)b);
+		}
+	}
+	else
+	{
+		for (unsigned long i = 0; i < length; i++)
+		{
+			int expected = ReadRecording();
+			if (expected < 0) return false;
+			unsigned long started = millis();
+			while (_link.available() == false)
+			{
+				if (millis() - started >= Timeout)
+				{
+					TimedOut = true;
+					return false;
+				}
+			}
+			if (_link.read() != expected) Mismatches++;
+		}
+	}
+	_last = micros();
+	Frames++;
+	return true;
+}
+
+bool Session_Player::ReadVarint(unsigned long& value)
+{
+	value = 0;
+	for (int shift = 0; shift < 32; shift += 7)
+	{
+		int b = ReadRecording();
+		if (b < 0) return false;
+		value |= (unsigned long)(b & 0x7F) << shift;
+		if ((b & 0x80) == 0) return true;
+	}
+	return false;
+}
+
+// Returns: the next byte of the recording, or -1 at the end
+int Session_Player::ReadRecording()
+{
+	if (_recording.available() == false) return -1;
+	return _recording.read();
+}
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
+
+
+#ifndef __GNUC__
+#pragma region -= Access_Journal Definitions =-
+#endif  //__GNUC__
+// entries are stored straight from memory, so the layout must not get padded
+static_assert(sizeof(Access_Entry) == Access_Entry::SIZE, "Access_Entry must be 16 bytes");
+
+// Sets the checksum
+void Access_Entry::Seal()
+{
+	const byte* bytes = (const byte*)this;
+	byte sum = 0;
+	for (int i = 0; i < SIZE - 1; i++) sum += bytes[i];
+	// inverted, so blank EEPROM (all 0xFF) and zeroed memory never check out
+	Checksum = ~sum;
+}
+
+// Returns: True if the checksum matches (not blank, not torn)
+bool Access_Entry::IsValid()
+{
+	byte checksum = Checksum;
+	Seal();
+	bool retval = (checksum == Checksum);
+	Checksum = checksum;
+	return retval;
+}
+
+// Returns: True if the entry is a match (ID found, or verified OK)
+bool Access_Entry::Granted()
+{
+	return Error == Response_Packet::ErrorCodes::NO_ERROR;
+}
+
+Access_Journal::Access_Journal()
+{
+	Clock = NULL;
+	Logged = 0;
+	Dropped = 0;
+	LastLogMicros = 0;
+	_sequence = 0;
+}
+
+// Adds an entry
+// Returns: True if it was stored (or queued to be)
+bool Access_Journal::Log(Access_Entry::Kinds::Kinds_Enum kind, int id, word error, unsigned long capturemillis, unsigned long matchmillis)
+{
+	unsigned long started = micros();
+	Access_Entry entry;
+	entry.Time = (Clock != NULL) ? Clock() : millis();
+	// the sequence moves on even if the entry is dropped, so the gap shows in the journal
+	entry.Sequence = _sequence++;
+	entry.ID = id;
+	entry.Error = error;
+	entry.CaptureMillis = (capturemillis > 0xFFFF) ? 0xFFFF : capturemillis;
+	entry.MatchMillis = (matchmillis > 0xFFFF) ? 0xFFFF : matchmillis;
+	entry.Kind = kind;
+	entry.Seal();
+	bool retval = Write(entry);
+	if (retval) Logged++; else Dropped++;
+	LastLogMicros = micros() - started;
+	return retval;
+}
+
+Stream_Journal::Stream_Journal(Print& out) : _out(out)
+{
+}
+
+bool Stream_Journal::Write(const Access_Entry& entry)
+{
+	return _out.write((const byte*)&entry, Access_Entry::SIZE) == Access_Entry::SIZE;
+}
+
+// Reads the next entry of a journal file
+// Returns: True if an entry was read, false at the end
+bool Stream_Journal::ReadEntry(Stream& in, Access_Entry& entry, unsigned long& skipped)
+{
+	byte* bytes = (byte*)&entry;
+	int count = 0;
+	bool resyncing = false;
+	while (true)
+	{
+		// a partial entry at the end is a write that was cut short
+		for (; count < Access_Entry::SIZE; count++)
+		{
+			if (in.available() == 0) return false;
+			bytes[count] = in.read();
+		}
+		if (entry.IsValid() && ((entry.Kind == Access_Entry::Kinds::Verify) || (entry.Kind == Access_Entry::Kinds::Identify))) return true;
+		// a write cut short in the middle of the file (then appended to after a restart) shifts
+		// every entry after it, so look for the next one a byte further on instead of 16
+		if (resyncing == false) skipped++;
+		resyncing = true;
+		memmove(bytes, bytes + 1, Access_Entry::SIZE - 1);
+		count = Access_Entry::SIZE - 1;
+	}
+}
+
+#if defined(__AVR__)
+// Parameter: first EEPROM address to use
+// Parameter: number of entries in the ring (16 bytes each)
+EEPROM_Journal::EEPROM_Journal(int start, int capacity)
+{
+	_start = start;
+	_capacity = capacity;
+	_reading = 0;
+	_readslot = 0;
+	_queuehead = 0;
+	_queuetail = 0;
+	_written = 0;
+	_writeslot = 0;
+}
+
+// Finds the newest entry, call once before logging
+// Returns: the number of valid entries in the ring
+int EEPROM_Journal::Begin()
+{
+	int count = 0;
+	int newest = -1;
+	uint16_t sequence = 0;
+	Access_Entry entry;
+	for (int slot = 0; slot < _capacity; slot++)
+	{
+		ReadSlot(slot, entry);
+		if (entry.IsValid() == false) continue;
+		count++;
+		// sequence numbers wrap, so compare the difference rather than the values
+		if ((newest < 0) || ((int16_t)(entry.Sequence - sequence) > 0))
+		{
+			newest = slot;
+			sequence = entry.Sequence;
+		}
+	}
+	_sequence = (newest < 0) ? 0 : sequence + 1;
+	_queuehead = 0;
+	_queuetail = 0;
+	_written = 0;
+	_writeslot = (newest + 1) % _capacity;
+	return count;
+}
+
+// Writes queued entries a byte at a time while the EEPROM is free, call from loop()
+// Returns: True if nothing is left to write
+bool EEPROM_Journal::Poll()
+{
+	while (_queuetail != _queuehead)
+	{
+		if (eeprom_is_ready() == false) return false;
+		// bytes go out in order, so the checksum (the last byte) lands last
+		const byte* bytes = (const byte*)&_queue[_queuetail & (QUEUE_SIZE - 1)];
+		uint8_t* address = (uint8_t*)(uintptr_t)(_start + _writeslot * Access_Entry::SIZE + _written);
+		if (eeprom_read_byte(address) != bytes[_written]) eeprom_write_byte(address, bytes[_written]);
+		_written++;
+		if (_written == Access_Entry::SIZE)
+		{
+			_written = 0;
+			_queuetail++;
+			_writeslot = (_writeslot + 1) % _capacity;
+		}
+	}
+	return true;
+}
+
+// Waits until every queued entry has been written
+void EEPROM_Journal::Flush()
+{
+	while (Poll() == false);
+}
+
+// Reads the ring from the oldest entry to the newest, skipping blank or torn entries
+void EEPROM_Journal::Rewind()
+{
+	// the slot after the newest entry is the oldest one (or blank)
+	_readslot = _writeslot;
+	_reading = _capacity;
+}
+
+// Returns: True if an entry was read, false after the newest
+bool EEPROM_Journal::Read(Access_Entry& entry)
+{
+	while (_reading > 0)
+	{
+		ReadSlot(_readslot, entry);
+		_readslot = (_readslot + 1) % _capacity;
+		_reading--;
+		if (entry.IsValid()) return true;
+	}
+	return false;
+}
+
+bool EEPROM_Journal::Write(const Access_Entry& entry)
+{
+	if ((byte)(_queuehead - _queuetail) >= QUEUE_SIZE) return false;
+	_queue[_queuehead & (QUEUE_SIZE - 1)] = entry;
+	_queuehead++;
+	// starts the first byte right away if the EEPROM is free
+	Poll();
+	return true;
+}
+
+void EEPROM_Journal::ReadSlot(int slot, Access_Entry& entry)
+{
+	eeprom_read_block(&entry, (const void*)(uintptr_t)(_start + slot * Access_Entry::SIZE), Access_Entry::SIZE);
+}
+#endif  //__AVR__
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
+
+
+#ifndef __GNUC__
+#pragma region -= Shard_Set Definitions =-
+#endif  //__GNUC__
+// Parameter: the scanners, the first one is used to capture
+// Parameter: templates per scanner (3000 for GT-521F52, 200 for GT-521F32/GT-511C3)
+Shard_Set::Shard_Set(FPS_GT511C3** shards, int count, int shardcapacity)
+{
+	_shards = shards;
+	_count = (count > MAX_SHARDS) ? MAX_SHARDS : count;
+	ShardCapacity = shardcapacity;
+	LastShard = -1;
+	FailedShards = 0;
+	CaptureMillis = 0;
+	SearchMillis = 0;
+}
+
+// Captures the finger on the first scanner and searches every shard for it
+// Returns: the global ID, -1 if not found, -2 if the capture failed
+long Shard_Set::Identify(byte* tmplt)
+{
+	LastShard = -1;
+	FailedShards = 0;
+	unsigned long started = millis();
+	bool captured = _shards[0]->CaptureTemplate(tmplt, false);
+	CaptureMillis = millis() - started;
+	SearchMillis = 0;
+	if (captured == false) return -2;
+
+	started = millis();
+	long retval = -1;
+	for (int i = 0; i < _count; i++)
+	{
+		_shards[i]->IdentifyTemplate1_N(tmplt);
+		// read from LastResult, the return value's "not found" and error codes depend on the model
+		Command_Result& result = _shards[i]->LastResult;
+		if (result.ACK)
+		{
+			LastShard = i;
+			retval = (long)i * ShardCapacity + (long)result.Parameter;
+			break;
+		}
+		if ((result.Error != Response_Packet::ErrorCodes::NACK_IDENTIFY_FAILED) && (result.Error != Response_Packet::ErrorCodes::NACK_DB_IS_EMPTY)) FailedShards |= (1 << i);
+	}
+	SearchMillis = millis() - started;
+	return retval;
+}
+
+// Loads a template store (global slot numbers) into the shards
+// Returns: the number of templates loaded, or -1 if the header is invalid
+long Shard_Set::Import(Template_Store& store, byte* tmplt)
+{
+	if (store.ReadHeader() == false) return -1;
+	long count = 0;
+	for (long i = 0; i < store.Capacity; i++)
+	{
+		int slot;
+		Template_Store::RecordResults::RecordResults_Enum result = store.ReadRecord(slot, tmplt);
+		if (result == Template_Store::RecordResults::TRUNCATED) break;
+		if (result != Template_Store::RecordResults::OK) continue;
+		int shard = slot / ShardCapacity;
+		if (shard >= _count) continue;
+		_shards[shard]->SetTemplate(tmplt, slot % ShardCapacity, false);
+		if (_shards[shard]->LastResult.ACK) count++;
+	}
+	return count;
+}
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
+
+#ifndef __GNUC__
+#pragma region -= Badge_Index Definitions =-
+#endif  //__GNUC__
+Badge_Index::Badge_Index(const Badge_Entry* entries, int count)
+{
+	_entries = entries;
+	_count = count;
+	LastPath = Paths::None;
+	LastMillis = 0;
+	VerifyCount = 0;
+	VerifyMillis = 0;
+	IdentifyCount = 0;
+	IdentifyMillis = 0;
+}
+
+// Finds the slot for a badge
+// Returns: the slot, or -1 if the badge is not in the table
+int Badge_Index::Lookup(uint32_t badge)
+{
+	int lo = 0;
+	int hi = _count - 1;
+	while (lo <= hi)
+	{
+		int mid = lo + (hi - lo) / 2;
+		uint32_t b = pgm_read_dword(&_entries[mid].Badge);
+		if (b == badge) return pgm_read_word(&_entries[mid].Slot);
+		if (b < badge) lo = mid + 1; else hi = mid - 1;
+	}
+	return -1;
+}
+
+// Checks the captured finger against the badge's slot, falling back to Identify1_N if the badge is not in the table
+// Returns: the matching ID, or -1 if the finger does not match (or the fps did not answer)
+int Badge_Index::Identify(FPS_GT511C3& fps, uint32_t badge)
+{
+	unsigned long started = millis();
+	int slot = Lookup(badge);
+	int retval;
+	if (slot >= 0)
+	{
+		LastPath = Paths::Verify;
+		fps.Verify1_1(slot);
+		retval = fps.LastResult.ACK ? slot : -1;
+		LastMillis = millis() - started;
+		VerifyCount++;
+		VerifyMillis += LastMillis;
+	}
+	else
+	{
+		LastPath = Paths::Identify;
+		fps.Identify1_N();
+		// read from LastResult, the return value's "not found" code depends on the model
+		retval = fps.LastResult.ACK ? (int)fps.LastResult.Parameter : -1;
+		LastMillis = millis() - started;
+		IdentifyCount++;
+		IdentifyMillis += LastMillis;
+	}
+	return retval;
+}
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
+
+#ifndef __GNUC__
+#pragma region -= Power_Manager Definitions =-
+#endif  //__GNUC__
+Power_Manager::Power_Manager(FPS_GT511C3& fps)
+	: _fps(fps)
+{
+	CheckInterval = 500;
+	IdleTimeout = 3000;
+	TouchPin = -1;
+	TouchActiveLevel = HIGH;
+	CloseWhenIdle = true;
+	LastCheckMillis = 0;
+	LastWakeMillis = 0;
+	LedOnMillis = 0;
+	Wakes = 0;
+	_awake = false;
+	_started = 0;
+	_ledon = 0;
+	_ledoff = 0;
+	_lastcheck = 0;
+	_lastfinger = 0;
+}
+
+// Starts in the idle state (LED off)
+void Power_Manager::Begin()
+{
+	if (TouchPin >= 0) pinMode(TouchPin, INPUT);
+	_started = millis();
+	// the LED state is unknown, so switch it off and start counting from here
+	_awake = true;
+	_ledon = _started;
+	Sleep();
+	LedOnMillis = 0;
+}
+
+// Call from loop()
+// Returns: True when a finger is on the sensor and the LED is on, ready for CaptureFinger
+bool Power_Manager::Poll()
+{
+	unsigned long now = millis();
+	if (_awake)
+	{
+		if (_fps.IsPressFinger())
+		{
+			_lastfinger = millis();
+			return true;
+		}
+		if (now - _lastfinger >= IdleTimeout) Sleep();
+		return false;
+	}
+
+	if (TouchPin >= 0)
+	{
+		// the touch output costs nothing to watch, so the LED stays off until it fires
+		if (TouchActive() == false) return false;
+		unsigned long detected = millis();
+		Wake();
+		LastWakeMillis = millis() - detected;
+		Wakes++;
+		_lastfinger = millis();
+		return _fps.IsPressFinger();
+	}
+
+	if (now - _lastcheck < CheckInterval) return false;
+	_lastcheck = now;
+
+	// short presence check with the LED on just long enough for IsPressFinger
+	if (CloseWhenIdle) _fps.Open();
+	LedOn();
+	bool pressed = _fps.IsPressFinger();
+	if (pressed == false)
+	{
+		LedOff();
+		LastCheckMillis = _ledoff - _ledon;
+		if (CloseWhenIdle) _fps.Close();
+		return false;
+	}
+	// the LED is already on, so waking is immediate
+	_awake = true;
+	LastWakeMillis = 0;
+	Wakes++;
+	_lastfinger = millis();
+	return true;
+}
+
+// Returns: True while the LED is on
+bool Power_Manager::IsAwake()
+{
+	return _awake;
+}
+
+// Percentage of the time since Begin that the LED was on
+float Power_Manager::DutyCycle()
+{
+	unsigned long elapsed = millis() - _started;
+	unsigned long on = LedOnMillis;
+	if (_awake) on += millis() - _ledon;
+	if (elapsed == 0) return 0;
+	return (on * 100.0) / elapsed;
+}
+
+void Power_Manager::Sleep()
+{
+	if (_awake == false) return;
+	LedOff();
+	if (CloseWhenIdle) _fps.Close();
+	_awake = false;
+	_lastcheck = millis();
+}
+
+void Power_Manager::Wake()
+{
+	if (_awake) return;
+	if (CloseWhenIdle) _fps.Open();
+	LedOn();
+	_awake = true;
+}
+
+// The LED switches when the fps takes the command, about halfway through the round trip
+// (the command and its answer are both 12 bytes)
+void Power_Manager::LedOn()
+{
+	unsigned long sent = millis();
+	_fps.SetLED(true);
+	_ledon = sent + (millis() - sent) / 2;
+}
+
+void Power_Manager::LedOff()
+{
+	unsigned long sent = millis();
+	_fps.SetLED(false);
+	_ledoff = sent + (millis() - sent) / 2;
+	LedOnMillis += _ledoff - _ledon;
+}
+
+bool Power_Manager::TouchActive()
+{
+	return digitalRead(TouchPin) == TouchActiveLevel;
+}
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
+
+#ifndef __GNUC__
+#pragma region -= Command_Queue Definitions =-
+#endif  //__GNUC__
+Command_Queue::Command_Queue(FPS_GT511C3& fps) : _fps(fps)
+{
+	for (int i = 0; i < LANE_COUNT; i++)
+	{
+		_head[i] = 0;
+		_tail[i] = 0;
+		Completed[i] = 0;
+		_dropped[i] = 0;
+		LastWaitMillis[i] = 0;
+		MaxWaitMillis[i] = 0;
+	}
+}
+
+// Queues a request, safe to call from an interrupt handler
+// Returns: True if queued, false if the lane is full
+bool Command_Queue::Submit(Operations::Operations_Enum operation, int parameter, Callback done, void* context, Lanes::Lanes_Enum lane)
+{
+	byte head = _head[lane];
+	if ((byte)(head - _tail[lane]) >= LANE_SIZE)
+	{
+		_dropped[lane]++;
+		return false;
+	}
+	Request& request = _requests[lane][head & (LANE_SIZE - 1)];
+	request.Operation = operation;
+	request.Parameter = parameter;
+	request.Done = done;
+	request.Context = context;
+	request.Submitted = millis();
+	// the request must be complete before Poll can see it
+	__asm__ __volatile__ ("" ::: "memory");
+	_head[lane] = head + 1;
+	return true;
+}
+
+// Returns: the requests a lane refused because it was full
+unsigned long Command_Queue::Dropped(Lanes::Lanes_Enum lane)
+{
+#if defined(__AVR__)
+	// 4 bytes take several loads, an interrupt could count in between
+	unsigned long retval;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { retval = _dropped[lane]; }
+	return retval;
+#else
+	return __atomic_load_n(&_dropped[lane], __ATOMIC_RELAXED);
+#endif  //__AVR__
+}
+
+// Runs the oldest request in the most urgent lane, call from loop()
+// Returns: True if a request was run
+bool Command_Queue::Poll()
+{
+	for (int lane = 0; lane < LANE_COUNT; lane++)
+	{
+		byte tail = _tail[lane];
+		while ((tail != _head[lane]) && (_requests[lane][tail & (LANE_SIZE - 1)].Operation == WITHDRAWN)) _tail[lane] = ++tail;
+		if (tail == _head[lane]) continue;
+		// copied out, so the slot can be reused as soon as it is released
+		Request request = _requests[lane][tail & (LANE_SIZE - 1)];
+		__asm__ __volatile__ ("" ::: "memory");
+		_tail[lane] = tail + 1;
+
+		unsigned long wait = millis() - request.Submitted;
+		LastWaitMillis[lane] = wait;
+		if (wait > MaxWaitMillis[lane]) MaxWaitMillis[lane] = wait;
+		int result = Run(request);
+		Completed[lane]++;
+		if (request.Done != NULL) request.Done(request.Operation, request.Parameter, result, request.Context);
+		return true;
+	}
+	return false;
+}
+
+// Returns: the number of requests waiting in a lane
+byte Command_Queue::Pending(Lanes::Lanes_Enum lane)
+{
+	return _head[lane] - _tail[lane];
+}
+
+// Withdraws the requests waiting in a lane that report to done with context
+// Returns: the number of requests withdrawn
+byte Command_Queue::Withdraw(Lanes::Lanes_Enum lane, Callback done, void* context)
+{
+	byte retval = 0;
+	// Submit only writes the slot at head, so the ones before it can be changed from loop()
+	byte head = _head[lane];
+	for (byte i = _tail[lane]; i != head; i++)
+	{
+		Request& request = _requests[lane][i & (LANE_SIZE - 1)];
+		if ((request.Operation == WITHDRAWN) || (request.Done != done) || (request.Context != context)) continue;
+		request.Operation = WITHDRAWN;
+		retval++;
+	}
+	return retval;
+}
+
+int Command_Queue::Run(const Request& request)
+{
+	switch (request.Operation)
+	{
+		case Operations::IsPressFinger:
+			return _fps.IsPressFinger() ? 1 : 0;
+		case Operations::SetLED:
+			return _fps.SetLED(request.Parameter != 0) ? 1 : 0;
+		case Operations::GetEnrollCount:
+			return _fps.GetEnrollCount();
+		case Operations::CheckEnrolled:
+			return _fps.CheckEnrolled(request.Parameter) ? 1 : 0;
+		case Operations::DeleteID:
+			return _fps.DeleteID(request.Parameter) ? 1 : 0;
+		case Operations::Identify:
+			if (_fps.CaptureFinger(false) == false) return -1;
+			return _fps.Identify1_N();
+		case Operations::Verify:
+			if (_fps.CaptureFinger(false) == false) return -1;
+			return _fps.Verify1_1(request.Parameter);
+	}
+	return -1;
+}
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
+
+#ifndef __GNUC__
+#pragma region -= Link_Watchdog Definitions =-
+#endif  //__GNUC__
+Link_Watchdog::Link_Watchdog(FPS_GT511C3& fps) : _fps(fps)
+{
+	ResponseTimeout = 2000;
+	HeartbeatInterval = 5000;
+	RetryInterval = 1000;
+	StateChanged = NULL;
+	State = States::Up;
+	Failures = 0;
+	Recoveries = 0;
+	LastRecoveryMillis = 0;
+	TotalRecoveryMillis = 0;
+	_failures = 0;
+	_lastcheck = 0;
+	_downsince = 0;
+	_lastattempt = 0;
+	_baud = 9600;
+	_ledon = false;
+}
+
+unsigned long Link_Watchdog::MeanRecoveryMillis()
+{
+	if (Recoveries == 0) return 0;
+	return TotalRecoveryMillis / Recoveries;
+}
+
+// Sets the fps timeout and checks the link
+// Returns: True if the fps answered
+bool Link_Watchdog::Begin()
+{
+	_fps.ResponseTimeout = ResponseTimeout;
+	_baud = _fps.BaudRate;
+	_ledon = _fps.LedOn;
+	_failures = _fps.LinkFailures;
+	_lastcheck = millis();
+	State = States::Up;
+	_fps.Open();
+	Poll();
+	return State == States::Up;
+}
+
+// Call from loop()
+// Returns: True while the link is up
+bool Link_Watchdog::Poll()
+{
+	unsigned long now = millis();
+	if (State == States::Up)
+	{
+		// what to put back later, taken while the link is still good
+		_baud = _fps.BaudRate;
+		_ledon = _fps.LedOn;
+		if ((_fps.LinkFailures == _failures) && (HeartbeatInterval > 0) && (now - _lastcheck >= HeartbeatInterval))
+		{
+			_lastcheck = now;
+			_fps.Open();
+		}
+		if (_fps.LinkFailures != _failures)
+		{
+			Failures++;
+			_downsince = millis();
+			// the first attempt is made on the next Poll
+			_lastattempt = _downsince - RetryInterval;
+			ChangeState(States::Down);
+		}
+	}
+	else if (now - _lastattempt >= RetryInterval)
+	{
+		_lastattempt = now;
+		if (Reopen())
+		{
+			LastRecoveryMillis = millis() - _downsince;
+			TotalRecoveryMillis += LastRecoveryMillis;
+			Recoveries++;
+			_lastcheck = millis();
+			ChangeState(States::Up);
+		}
+	}
+	return State == States::Up;
+}
+
+void Link_Watchdog::ChangeState(States::States_Enum to)
+{
+	// failures from before (or during) the change are dealt with
+	_failures = _fps.LinkFailures;
+	States::States_Enum from = State;
+	State = to;
+	if (StateChanged != NULL) StateChanged(from, to);
+}
+
+// Finds the fps again and puts the baud rate and LED back
+// Returns: True if all of it worked
+bool Link_Watchdog::Reopen()
+{
+	unsigned long found = _fps.DetectBaudRate();
+	if (found == 0) return false;
+	// after losing power the fps is back at 9600
+	if ((found != _baud) && (_fps.ChangeBaudRate(_baud) == false)) return false;
+	return _fps.SetLED(_ledon);
+}
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
+
+#ifndef __GNUC__
+#pragma region -= Capture_Policy Definitions =-
+#endif  //__GNUC__
+// Returns: the expected ms to unlock, retrying in this mode until it matches
+float Capture_Policy::Mode_Stats::ExpectedMillis()
+{
+	// a mode that never matches would take forever, but keep it comparable
+	float rate = (MatchRate < 0.01) ? 0.01 : MatchRate;
+	return MeanMillis / rate;
+}
+
+void Capture_Policy::Mode_Stats::Record(bool matched, unsigned long millis)
+{
+	// recent attempts count most (about the last 32)
+	if (Attempts == 0) MeanMillis = millis;
+	else MeanMillis += ((float)millis - MeanMillis) / 32;
+	MatchRate += ((matched ? 1.0 : 0.0) - MatchRate) / 32;
+	Attempts++;
+	if (matched) Matches++;
+}
+
+Capture_Policy::Capture_Policy()
+{
+	ExploreInterval = 50;
+	Reset(Fast, 0.75);
+	Reset(High, 0.9);
+	Reset(RetryFast, 0.5);
+	Reset(RetryHigh, 0.8);
+	LastAttempts = 0;
+	LastUnlockMillis = 0;
+	_users = NULL;
+	_usercount = 0;
+	_attempts = 0;
+}
+
+void Capture_Policy::Reset(Mode_Stats& stats, float matchrate)
+{
+	stats.Attempts = 0;
+	stats.Matches = 0;
+	stats.MatchRate = matchrate;
+	stats.MeanMillis = 0;
+}
+
+// Keeps a fast match rate per user
+void Capture_Policy::SetUserTable(byte* table, int count)
+{
+	_users = table;
+	_usercount = count;
+	// 0 is "not seen yet"
+	for (int i = 0; i < count; i++) _users[i] = 0;
+}
+
+// Returns: True if the next capture should be high quality
+bool Capture_Policy::ChooseHighQuality(int id, int attempt)
+{
+	Mode_Stats& fast = (attempt == 0) ? Fast : RetryFast;
+	Mode_Stats& high = (attempt == 0) ? High : RetryHigh;
+	// try each mode once before trusting the estimates
+	if (fast.Attempts == 0) return false;
+	if (high.Attempts == 0) return true;
+
+	float fastmillis = fast.ExpectedMillis();
+	if ((_users != NULL) && (id >= 0) && (id < _usercount) && (_users[id] != 0))
+	{
+		float rate = _users[id] / 255.0;
+		if (rate < 0.01) rate = 0.01;
+		fastmillis = fast.MeanMillis / rate;
+	}
+	bool retval = high.ExpectedMillis() < fastmillis;
+	if ((ExploreInterval > 0) && ((_attempts % ExploreInterval) == (unsigned long)(ExploreInterval - 1))) retval = !retval;
+	return retval;
+}
+
+// Records how an attempt went
+void Capture_Policy::Record(bool highquality, bool matched, unsigned long millis, int id, int attempt)
+{
+	_attempts++;
+	if (highquality)
+	{
+		((attempt == 0) ? High : RetryHigh).Record(matched, millis);
+		return;
+	}
+	((attempt == 0) ? Fast : RetryFast).Record(matched, millis);
+	RecordUser(id, matched);
+}
+
+// Updates a user's fast match rate
+void Capture_Policy::RecordUser(int id, bool matched)
+{
+	if ((_users == NULL) || (id < 0) || (id >= _usercount)) return;
+	// a user's first fast attempt starts from the device rate, 1 - 255 after that
+	int rate = (_users[id] == 0) ? (int)(Fast.MatchRate * 255) : _users[id];
+	rate += (((matched ? 255 : 0) - rate) / 4);
+	_users[id] = (rate < 1) ? 1 : rate;
+}
+
+// Captures and identifies until a match, the finger is lifted or the attempts run out
+// Returns: the ID found, or -1 if not found
+int Capture_Policy::Identify(FPS_GT511C3& fps, int maxattempts)
+{
+	unsigned long started = millis();
+	int retval = -1;
+	// who failed is only known once they match, so their failed fast attempts are counted then
+	int fastfailures = 0;
+	for (LastAttempts = 0; LastAttempts < maxattempts; )
+	{
+		bool high = ChooseHighQuality(-1, LastAttempts);
+		unsigned long attempt = millis();
+		if (fps.CaptureFinger(high) == false)
+		{
+			// a capture without a finger (or without an answer) says nothing about the mode
+			LastAttempts++;
+			if (fps.LastResult.NoFinger()) break;
+			continue;
+		}
+		fps.Identify1_N();
+		// read from LastResult, the return value's "not found" code depends on the model
+		if (fps.LastResult.Valid == false)
+		{
+			// neither does a lost answer
+			LastAttempts++;
+			continue;
+		}
+		bool matched = fps.LastResult.ACK;
+		int id = (int)fps.LastResult.Parameter;
+		Record(high, matched, millis() - attempt, -1, LastAttempts);
+		LastAttempts++;
+		if (matched)
+		{
+			for (; fastfailures > 0; fastfailures--) RecordUser(id, false);
+			if (high == false) RecordUser(id, true);
+			retval = id;
+			break;
+		}
+		if (high == false) fastfailures++;
+		if (fps.IsPressFinger() == false) break;
+	}
+	LastUnlockMillis = millis() - started;
+	return retval;
+}
+
+// Captures and verifies until a match, the finger is lifted or the attempts run out
+// Returns: as Verify1_1 (0 for a match)
+int Capture_Policy::Verify(FPS_GT511C3& fps, int id, int maxattempts)
+{
+	unsigned long started = millis();
+	int retval = 3;
+	for (LastAttempts = 0; LastAttempts < maxattempts; )
+	{
+		bool high = ChooseHighQuality(id, LastAttempts);
+		unsigned long attempt = millis();
+		retval = 3;
+		if (fps.CaptureFinger(high) == false)
+		{
+			// a capture without a finger (or without an answer) says nothing about the mode
+			LastAttempts++;
+			if (fps.LastResult.NoFinger()) break;
+			continue;
+		}
+		retval = fps.Verify1_1(id);
+		// an unknown or empty ID won't get better with another capture, and says nothing about the capture
+		if ((retval == 1) || (retval == 2)) break;
+		// neither does a lost answer
+		if (retval == 4)
+		{
+			LastAttempts++;
+			continue;
+		}
+		Record(high, retval == 0, millis() - attempt, id, LastAttempts);
+		LastAttempts++;
+		if (retval == 0) break;
+		if (fps.IsPressFinger() == false) break;
+	}
+	LastUnlockMillis = millis() - started;
+	return retval;
+}
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
+
+#ifndef __GNUC__
+#pragma region -= Warm_Start Definitions =-
+#endif  //__GNUC__
+// Parameter: ram for the bitmap, BitmapSize(capacity) bytes
+// Parameter: number of IDs the fps holds
+Warm_Start::Warm_Start(byte* bitmap, int capacity)
+{
+	_bitmap = bitmap;
+	Capacity = capacity;
+	BaudRate = 9600;
+	Generation = 0;
+	_savedgeneration = 0;
+	for (int i=0; i < FPS_GT511C3::DEVICE_INFO_SIZE; i++) DeviceInfo[i] = 0;
+	for (int i=0; i < BitmapSize(capacity); i++) _bitmap[i] = 0;
+	Warm = false;
+	Valid = false;
+	StartMillis = 0;
+}
+
+int Warm_Start::BitmapSize(int capacity)
+{
+	return (capacity + 7) / 8;
+}
+
+int Warm_Start::Size(int capacity)
+{
+	return HEADER_SIZE + BitmapSize(capacity) + 2;
+}
+
+bool Warm_Start::IsEnrolled(int id)
+{
+	if ((id < 0) || (id >= Capacity)) return false;
+	return (_bitmap[id / 8] & (1 << (id % 8))) != 0;
+}
+
+void Warm_Start::SetEnrolled(int id, bool enrolled)
+{
+	if ((id < 0) || (id >= Capacity) || (IsEnrolled(id) == enrolled)) return;
+	_bitmap[id / 8] ^= (byte)(1 << (id % 8));
+	Generation++;
+}
+
+void Warm_Start::Clear()
+{
+	for (int i=0; i < BitmapSize(Capacity); i++) _bitmap[i] = 0;
+	Generation++;
+}
+
+// Returns: the number of IDs marked as enrolled
+int Warm_Start::Count()
+{
+	int retval = 0;
+	for (int i=0; i < BitmapSize(Capacity); i++)
+	{
+		// clears the lowest set bit until none are left
+		for (byte b = _bitmap[i]; b != 0; b &= b - 1) retval++;
+	}
+	return retval;
+}
+
+// Returns: True if it changed since it was last loaded or saved
+bool Warm_Start::Changed()
+{
+	return Generation != _savedgeneration;
+}
+
+// Gets the fps ready: uses the snapshot if it matches the fps, scans the fps if not
+// Returns: True if the fps is ready
+bool Warm_Start::Start(FPS_GT511C3& fps, bool loaded)
+{
+	unsigned long started = millis();
+	Warm = loaded && Validate(fps);
+	bool retval = Warm || Scan(fps);
+	if (retval) Valid = true;
+	StartMillis = millis() - started;
+	return retval;
+}
+
+// Opens the fps at BaudRate and checks the device info and the enroll count
+// Returns: True if the snapshot matches the fps
+bool Warm_Start::Validate(FPS_GT511C3& fps)
+{
+	byte info[FPS_GT511C3::DEVICE_INFO_SIZE];
+	bool opened = fps.OpenAt(BaudRate, info);
+	// the fps is back at 9600 after a power cycle
+	if ((opened == false) && (BaudRate != 9600)) opened = fps.OpenAt(9600, info) && fps.ChangeBaudRate(BaudRate);
+	if (opened == false) return false;
+	for (int i=0; i < FPS_GT511C3::DEVICE_INFO_SIZE; i++)
+	{
+		if (info[i] != DeviceInfo[i]) return false;
+	}
+	int count = fps.GetEnrollCount();
+	return fps.LastResult.ACK && (count == Count());
+}
+
+// Finds the baud rate, moves the fps to BaudRate and checks every ID with CheckEnrolled
+// Returns: True if the fps answered
+bool Warm_Start::Scan(FPS_GT511C3& fps)
+{
+	unsigned long baud = fps.DetectBaudRate();
+	if (baud == 0) return false;
+	if ((baud != BaudRate) && (fps.ChangeBaudRate(BaudRate) == false)) BaudRate = baud;
+	if (fps.Open(DeviceInfo) == false) return false;
+	int count = fps.GetEnrollCount();
+	if (fps.LastResult.ACK == false) return false;
+	for (int i=0; i < BitmapSize(Capacity); i++) _bitmap[i] = 0;
+	// the sweep can stop as soon as every enrolled ID was found
+	int found = 0;
+	for (int id=0; (id < Capacity) && (found < count); id++)
+	{
+		if (fps.CheckEnrolled(id))
+		{
+			_bitmap[id / 8] |= (byte)(1 << (id % 8));
+			found++;
+		}
+	}
+	Generation++;
+	Valid = true;
+	return true;
+}
+
+void Warm_Start::Save(Print& out)
+{
+	byte header[HEADER_SIZE];
+	GetHeader(header);
+	word checksum = Checksum(header);
+	out.write(header, HEADER_SIZE);
+	out.write(_bitmap, BitmapSize(Capacity));
+	out.write((byte)(checksum & 0xFF));
+	out.write((byte)(checksum >> 8));
+	_savedgeneration = Generation;
+}
+
+// Returns: True if a valid snapshot for the same capacity was read
+bool Warm_Start::Load(Stream& in)
+{
+	byte header[HEADER_SIZE];
+	if ((int)in.readBytes(header, HEADER_SIZE) != HEADER_SIZE) return false;
+	if (CheckHeader(header) == false) return false;
+	byte checksum[2];
+	bool retval = ((int)in.readBytes(_bitmap, BitmapSize(Capacity)) == BitmapSize(Capacity));
+	retval = retval && (in.readBytes(checksum, 2) == 2);
+	retval = retval && (Checksum(header) == (word)(checksum[0] | (checksum[1] << 8)));
+	if (retval) SetHeader(header);
+	else for (int i=0; i < BitmapSize(Capacity); i++) _bitmap[i] = 0;
+	Valid = retval;
+	return retval;
+}
+
+#if defined(__AVR__)
+void Warm_Start::SaveEEPROM(int address)
+{
+	byte header[HEADER_SIZE];
+	GetHeader(header);
+	word checksum = Checksum(header);
+	eeprom_update_block(header, (void*)(uintptr_t)address, HEADER_SIZE);
+	eeprom_update_block(_bitmap, (void*)(uintptr_t)(address + HEADER_SIZE), BitmapSize(Capacity));
+	eeprom_update_block(&checksum, (void*)(uintptr_t)(address + HEADER_SIZE + BitmapSize(Capacity)), 2);
+	_savedgeneration = Generation;
+}
+
+// Returns: True if a valid snapshot for the same capacity was read, nothing is changed if not
+bool Warm_Start::LoadEEPROM(int address)
+{
+	byte header[HEADER_SIZE];
+	eeprom_read_block(header, (const void*)(uintptr_t)address, HEADER_SIZE);
+	if (CheckHeader(header) == false) return false;
+	// checks the bitmap where it is before taking it
+	Data_Checksum checksum;
+	checksum.Add(header, HEADER_SIZE);
+	for (int i=0; i < BitmapSize(Capacity); i++) checksum.Add(eeprom_read_byte((const uint8_t*)(uintptr_t)(address + HEADER_SIZE + i)));
+	word saved;
+	eeprom_read_block(&saved, (const void*)(uintptr_t)(address + HEADER_SIZE + BitmapSize(Capacity)), 2);
+	if (checksum.Value() != saved) return false;
+	eeprom_read_block(_bitmap, (const void*)(uintptr_t)(address + HEADER_SIZE), BitmapSize(Capacity));
+	SetHeader(header);
+	Valid = true;
+	return true;
+}
+#endif  //__AVR__
+
+void Warm_Start::GetHeader(byte* header)
+{
+	for (int i=0; i < HEADER_SIZE; i++) header[i] = 0;
+	header[0] = 'F';
+	header[1] = 'P';
+	header[2] = 'S';
+	header[3] = 'W';
+	header[4] = FORMAT_VERSION;
+	header[6] = (byte)(Capacity & 0xFF);
+	header[7] = (byte)(Capacity >> 8);
+	for (int i=0; i < 4; i++)
+	{
+		header[8 + i] = (byte)(BaudRate >> (i * 8));
+		header[12 + i] = (byte)(Generation >> (i * 8));
+	}
+	for (int i=0; i < FPS_GT511C3::DEVICE_INFO_SIZE; i++) header[16 + i] = DeviceInfo[i];
+}
+
+bool Warm_Start::CheckHeader(const byte* header)
+{
+	if ((header[0] != 'F') || (header[1] != 'P') || (header[2] != 'S') || (header[3] != 'W')) return false;
+	if (header[4] != FORMAT_VERSION) return false;
+	return (header[6] | (header[7] << 8)) == Capacity;
+}
+
+void Warm_Start::SetHeader(const byte* header)
+{
+	BaudRate = 0;
+	Generation = 0;
+	for (int i=3; i >= 0; i--)
+	{
+		BaudRate = (BaudRate << 8) | header[8 + i];
+		Generation = (Generation << 8) | header[12 + i];
+	}
+	for (int i=0; i < FPS_GT511C3::DEVICE_INFO_SIZE; i++) DeviceInfo[i] = header[16 + i];
+	_savedgeneration = Generation;
+}
+
+word Warm_Start::Checksum(const byte* header)
+{
+	Data_Checksum checksum;
+	checksum.Add(header, HEADER_SIZE);
+	checksum.Add(_bitmap, BitmapSize(Capacity));
+	return checksum.Value();
+}
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
+
+#ifndef __GNUC__
+#pragma region -= Expiry_Scheduler Definitions =-
+#endif  //__GNUC__
+// Parameter: ram for the heap, room for capacity entries
+Expiry_Scheduler::Expiry_Scheduler(FPS_GT511C3& fps, Entry* heap, int capacity) : _fps(fps)
+{
+	_heap = heap;
+	_capacity = capacity;
+	_count = 0;
+	_changed = false;
+	_queuedid = -1;
+	_queue = NULL;
+	Clock = NULL;
+	Deleted = 0;
+	Retries = 0;
+	LastDeleteMillis = 0;
+}
+
+// Schedules the expiry of an ID, or moves it if it already had one
+// Returns: True if scheduled, false if the heap is full
+bool Expiry_Scheduler::Schedule(int id, unsigned long deadline)
+{
+	// a new deadline makes the queued DeleteID of the old one wrong
+	Withdraw(id);
+	int i = Find(id);
+	if (i >= 0)
+	{
+		_heap[i].Deadline = deadline;
+		SiftUp(i);
+		SiftDown(i);
+	}
+	else
+	{
+		if (_count == _capacity) return false;
+		_heap[_count].Deadline = deadline;
+		_heap[_count].ID = id;
+		SiftUp(_count++);
+	}
+	_changed = true;
+	return true;
+}
+
+// Returns: True if the ID had an expiry
+bool Expiry_Scheduler::Cancel(int id)
+{
+	Withdraw(id);
+	int i = Find(id);
+	if (i < 0) return false;
+	RemoveAt(i);
+	return true;
+}
+
+int Expiry_Scheduler::Count()
+{
+	return _count;
+}
+
+unsigned long Expiry_Scheduler::NextDeadline()
+{
+	return _heap[0].Deadline;
+}
+
+bool Expiry_Scheduler::Due()
+{
+	return (_count > 0) && (Before(Now(), _heap[0].Deadline) == false);
+}
+
+// Deletes the next due ID if the scanner is idle
+// Returns: True if an ID was deleted
+bool Expiry_Scheduler::Poll(bool idle)
+{
+	if ((idle == false) || (_queuedid >= 0) || (Due() == false)) return false;
+	bool retval = _fps.DeleteID(_heap[0].ID);
+	LastDeleteMillis = _fps.LastResult.Millis;
+	if (retval || _fps.LastResult.Valid)
+	{
+		// a NACK means there was nothing left to delete, so the expiry is done either way
+		RemoveAt(0);
+		if (retval) Deleted++;
+	}
+	else Retries++;
+	return retval;
+}
+
+bool Expiry_Scheduler::Poll(Power_Manager& power)
+{
+	return Poll(power.IsAwake() == false);
+}
+
+// Queues the DeleteID of the next due ID if the queue is empty
+// The entry stays in the heap until the DeleteID has run (see Done)
+// Returns: True if it was queued
+bool Expiry_Scheduler::Poll(Command_Queue& queue)
+{
+	if ((_queuedid >= 0) || (Due() == false)) return false;
+	if ((queue.Pending(Command_Queue::Lanes::Urgent) > 0) || (queue.Pending(Command_Queue::Lanes::Housekeeping) > 0)) return false;
+	if (queue.Submit(Command_Queue::Operations::DeleteID, _heap[0].ID, Done, this, Command_Queue::Lanes::Housekeeping) == false) return false;
+	_queuedid = _heap[0].ID;
+	_queue = &queue;
+	return true;
+}
+
+// Called by the Command_Queue once the DeleteID has run
+void Expiry_Scheduler::Done(byte /*operation*/, int parameter, int result, void* context)
+{
+	Expiry_Scheduler* scheduler = (Expiry_Scheduler*)context;
+	scheduler->_queuedid = -1;
+	scheduler->LastDeleteMillis = scheduler->_fps.LastResult.Millis;
+	if ((result != 1) && (scheduler->_fps.LastResult.Valid == false))
+	{
+		// no answer, so it is still due
+		scheduler->Retries++;
+		return;
+	}
+	// a NACK means there was nothing left to delete, so the expiry is done either way
+	if (result == 1) scheduler->Deleted++;
+	int i = scheduler->Find(parameter);
+	if (i >= 0) scheduler->RemoveAt(i);
+}
+
+// Returns: True if it changed since it was last loaded or saved
+bool Expiry_Scheduler::Changed()
+{
+	return _changed;
+}
+
+int Expiry_Scheduler::Size(int capacity)
+{
+	return HEADER_SIZE + capacity * ENTRY_SIZE + 2;
+}
+
+// Returns: True if saved, false without a Clock
+bool Expiry_Scheduler::Save(Print& out, Warm_Start& snapshot)
+{
+	if (Clock == NULL) return false;
+	byte header[HEADER_SIZE];
+	GetHeader(header, snapshot);
+	Data_Checksum checksum;
+	checksum.Add(header, HEADER_SIZE);
+	out.write(header, HEADER_SIZE);
+	byte bytes[ENTRY_SIZE];
+	for (int i=0; i < _count; i++)
+	{
+		GetEntry(_heap[i], bytes);
+		checksum.Add(bytes, ENTRY_SIZE);
+		out.write(bytes, ENTRY_SIZE);
+	}
+	word value = checksum.Value();
+	out.write((byte)(value & 0xFF));
+	out.write((byte)(value >> 8));
+	_changed = false;
+	return true;
+}
+
+// Returns: True if a valid heap was read, if not the heap is left empty
+bool Expiry_Scheduler::Load(Stream& in, Warm_Start& snapshot)
+{
+	Withdraw(_queuedid);
+	_count = 0;
+	byte header[HEADER_SIZE];
+	if ((int)in.readBytes(header, HEADER_SIZE) != HEADER_SIZE) return false;
+	unsigned long generation;
+	int count = CheckHeader(header, generation);
+	if (count < 0) return false;
+	Data_Checksum checksum;
+	checksum.Add(header, HEADER_SIZE);
+	byte bytes[ENTRY_SIZE];
+	for (int i=0; i < count; i++)
+	{
+		if ((int)in.readBytes(bytes, ENTRY_SIZE) != ENTRY_SIZE) return false;
+		checksum.Add(bytes, ENTRY_SIZE);
+		SetEntry(_heap[i], bytes);
+	}
+	if ((int)in.readBytes(bytes, 2) != 2) return false;
+	if (checksum.Matches(bytes[0], bytes[1]) == false) return false;
+	_count = count;
+	Restore(generation, snapshot);
+	return true;
+}
+
+#if defined(__AVR__)
+// Only the bytes that changed are written, a delete moves about log n entries
+// Returns: True if saved, false without a Clock
+bool Expiry_Scheduler::SaveEEPROM(int address, Warm_Start& snapshot)
+{
+	if (Clock == NULL) return false;
+	byte header[HEADER_SIZE];
+	GetHeader(header, snapshot);
+	Data_Checksum checksum;
+	checksum.Add(header, HEADER_SIZE);
+	eeprom_update_block(header, (void*)(uintptr_t)address, HEADER_SIZE);
+	byte bytes[ENTRY_SIZE];
+	for (int i=0; i < _count; i++)
+	{
+		GetEntry(_heap[i], bytes);
+		checksum.Add(bytes, ENTRY_SIZE);
+		eeprom_update_block(bytes, (void*)(uintptr_t)(address + HEADER_SIZE + i * ENTRY_SIZE), ENTRY_SIZE);
+	}
+	word value = checksum.Value();
+	eeprom_update_block(&value, (void*)(uintptr_t)(address + HEADER_SIZE + _count * ENTRY_SIZE), 2);
+	_changed = false;
+	return true;
+}
+
+// Returns: True if a valid heap was read, nothing is changed if not
+bool Expiry_Scheduler::LoadEEPROM(int address, Warm_Start& snapshot)
+{
+	byte header[HEADER_SIZE];
+	eeprom_read_block(header, (const void*)(uintptr_t)address, HEADER_SIZE);
+	unsigned long generation;
+	int count = CheckHeader(header, generation);
+	if (count < 0) return false;
+	// checks the entries where they are before taking them
+	Data_Checksum checksum;
+	checksum.Add(header, HEADER_SIZE);
+	for (int i=0; i < count * ENTRY_SIZE; i++) checksum.Add(eeprom_read_byte((const uint8_t*)(uintptr_t)(address + HEADER_SIZE + i)));
+	word saved;
+	eeprom_read_block(&saved, (const void*)(uintptr_t)(address + HEADER_SIZE + count * ENTRY_SIZE), 2);
+	if (checksum.Value() != saved) return false;
+	Withdraw(_queuedid);
+	byte bytes[ENTRY_SIZE];
+	for (int i=0; i < count; i++)
+	{
+		eeprom_read_block(bytes, (const void*)(uintptr_t)(address + HEADER_SIZE + i * ENTRY_SIZE), ENTRY_SIZE);
+		SetEntry(_heap[i], bytes);
+	}
+	_count = count;
+	Restore(generation, snapshot);
+	return true;
+}
+#endif  //__AVR__
+
+unsigned long Expiry_Scheduler::Now()
+{
+	return (Clock != NULL) ? Clock() : millis();
+}
+
+// Returns: True if deadline a comes before b, also across a wrap of the clock
+bool Expiry_Scheduler::Before(unsigned long a, unsigned long b)
+{
+	return (int32_t)((uint32_t)a - (uint32_t)b) < 0;
+}
+
+int Expiry_Scheduler::Find(int id)
+{
+	for (int i=0; i < _count; i++)
+	{
+		if (_heap[i].ID == id) return i;
+	}
+	return -1;
+}
+
+void Expiry_Scheduler::RemoveAt(int i)
+{
+	_count--;
+	if (i < _count)
+	{
+		// the last entry fills the hole and moves to where it belongs
+		_heap[i] = _heap[_count];
+		SiftDown(i);
+		SiftUp(i);
+	}
+	_changed = true;
+}
+
+void Expiry_Scheduler::SiftUp(int i)
+{
+	while (i > 0)
+	{
+		int parent = (i - 1) / 2;
+		if (Before(_heap[i].Deadline, _heap[parent].Deadline) == false) break;
+		Entry entry = _heap[parent];
+		_heap[parent] = _heap[i];
+		_heap[i] = entry;
+		i = parent;
+	}
+}
+
+void Expiry_Scheduler::SiftDown(int i)
+{
+	for (;;)
+	{
+		int smallest = 2 * i + 1;
+		if (smallest >= _count) break;
+		if ((smallest + 1 < _count) && Before(_heap[smallest + 1].Deadline, _heap[smallest].Deadline)) smallest++;
+		if (Before(_heap[smallest].Deadline, _heap[i].Deadline) == false) break;
+		Entry entry = _heap[smallest];
+		_heap[smallest] = _heap[i];
+		_heap[i] = entry;
+		i = smallest;
+	}
+}
+
+void Expiry_Scheduler::GetHeader(byte* header, Warm_Start& snapshot)
+{
+	header[0] = 'F';
+	header[1] = 'P';
+	header[2] = 'S';
+	header[3] = 'X';
+	header[4] = FORMAT_VERSION;
+	header[5] = 0;
+	header[6] = (byte)(_count & 0xFF);
+	header[7] = (byte)(_count >> 8);
+	for (int i=0; i < 4; i++) header[8 + i] = (byte)(snapshot.Generation >> (i * 8));
+}
+
+// Returns: the number of entries, -1 if the header is not valid
+int Expiry_Scheduler::CheckHeader(const byte* header, unsigned long& generation)
+{
+	if ((header[0] != 'F') || (header[1] != 'P') || (header[2] != 'S') || (header[3] != 'X')) return -1;
+	if (header[4] != FORMAT_VERSION) return -1;
+	int count = header[6] | (header[7] << 8);
+	if ((count < 0) || (count > _capacity)) return -1;
+	generation = 0;
+	for (int i=3; i >= 0; i--) generation = (generation << 8) | header[8 + i];
+	return count;
+}
+
+void Expiry_Scheduler::GetEntry(const Entry& entry, byte* bytes)
+{
+	for (int i=0; i < 4; i++) bytes[i] = (byte)(entry.Deadline >> (i * 8));
+	bytes[4] = (byte)(entry.ID & 0xFF);
+	bytes[5] = (byte)(entry.ID >> 8);
+}
+
+void Expiry_Scheduler::SetEntry(Entry& entry, const byte* bytes)
+{
+	entry.Deadline = 0;
+	for (int i=3; i >= 0; i--) entry.Deadline = (entry.Deadline << 8) | bytes[i];
+	entry.ID = bytes[4] | (bytes[5] << 8);
+}
+
+// Drops the entries of IDs deleted after the heap was saved, then puts the heap back in order
+// A snapshot that was never loaded or scanned knows nothing, so nothing is dropped then
+// Withdraws the queued DeleteID if it is the one of the ID
+void Expiry_Scheduler::Withdraw(int id)
+{
+	if ((_queuedid < 0) || (id != _queuedid)) return;
+	_queue->Withdraw(Command_Queue::Lanes::Housekeeping, Done, this);
+	_queuedid = -1;
+}
+
+void Expiry_Scheduler::Restore(unsigned long generation, Warm_Start& snapshot)
+{
+	_changed = false;
+	if (snapshot.Valid && (generation != snapshot.Generation))
+	{
+		int kept = 0;
+		for (int i=0; i < _count; i++)
+		{
+			if (snapshot.IsEnrolled(_heap[i].ID)) _heap[kept++] = _heap[i];
+		}
+		_changed = (kept != _count);
+		_count = kept;
+	}
+	for (int i = _count / 2 - 1; i >= 0; i--) SiftDown(i);
+}
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
@@ -11,6 +11,34 @@
 
 #include "Arduino.h"
 #include "SoftwareSerial.h"
+#if defined(__AVR__)
+#include <avr/eeprom.h>
+#include <util/atomic.h>
+#endif  //__AVR__
+
+// Debug output level
+// 1 - UseSerialDebug prints every command and packet (the text is kept in flash, not ram)
+// 0 - all debug output is compiled out, UseSerialDebug does nothing (smallest build)
+// Change it here, or define FPS_DEBUG in your build flags
+#ifndef FPS_DEBUG
+#define FPS_DEBUG 1
+#endif  //FPS_DEBUG
+
+// Size of the ring the fps link is received into, a power of two (see FPS_GT511C3::Pump)
+// Raise it if Rx.Overruns goes up during GetImage / GetTemplate, each fps object takes this much ram
+// Change it here, or define FPS_RX_RING_SIZE in your build flags
+#ifndef FPS_RX_RING_SIZE
+#define FPS_RX_RING_SIZE 128
+#endif  //FPS_RX_RING_SIZE
+
+#if FPS_DEBUG
+#define FPS_DEBUG_PRINTLN(s) do { if (UseSerialDebug) Serial.println(F(s)); } while (0)
+// a name that only the debug output uses, so it is not linked in when that is compiled out
+#define FPS_DEBUG_NAME(s) F(s)
+#else
+#define FPS_DEBUG_PRINTLN(s)
+#define FPS_DEBUG_NAME(s) NULL
+#endif  //FPS_DEBUG
 #ifndef __GNUC__
 #pragma region -= Command_Packet =-
 #endif  //__GNUC__
@@ -63,7 +91,7 @@ class Command_Packet
 		Commands::Commands_Enum Command;
 		byte Parameter[4];								// Parameter 4 bytes, changes meaning depending on command							
 		byte* GetPacketBytes();							// returns the bytes to be transmitted
-		void ParameterFromInt(int i);
+		void ParameterFromInt(long i);
 
 		Command_Packet();
 
@@ -115,13 +143,14 @@ class Response_Packet
 					NACK_CAPTURE_CANCELED		= 0x1010,	// Obsolete, The capturing is canceled
 					NACK_INVALID_PARAM			= 0x1011,	// Invalid parameter
 					NACK_FINGER_IS_NOT_PRESSED	= 0x1012,	// Finger is not pressed
-					INVALID						= 0XFFFF	// Used when parsing fails
+					INVALID						= 0XFFFF	// Used when parsing fails, or when no response arrived in time
 				};
 
 				static Errors_Enum ParseFromBytes(byte high, byte low);
 		};
 		Response_Packet(byte* buffer, bool UseSerialDebug);
 		ErrorCodes::Errors_Enum Error;
+		bool Valid;										// false if the packet was garbled (then ACK is false too)
 		byte RawBytes[12];
 		byte ParameterBytes[4];
 		byte ResponseBytes[2];
@@ -133,7 +162,7 @@ class Response_Packet
 		int IntFromParameter();
 
 	private: 
-		bool CheckParsing(byte b, byte propervalue, byte alternatevalue, const char* varname, bool UseSerialDebug);
+		bool CheckParsing(byte b, byte propervalue, byte alternatevalue, const __FlashStringHelper* varname, bool UseSerialDebug);
 		word CalculateChecksum(byte* buffer, int length);
 		byte GetHighByte(word w);						
 		byte GetLowByte(word w);
@@ -143,239 +172,1846 @@ class Response_Packet
 #endif  //__GNUC__
 
 #ifndef __GNUC__
-#pragma region -= Data_Packet =- 
+#pragma region -= Rx_Ring =-
 #endif  //__GNUC__
-// Data Mule packet for receiving large data(in 128 byte pieces) from the FPS
-// This class can only transmit one packet at a time
-//class Data_Packet
-//{
-//public:
-//	static int CheckSum;
-//	int PacketID;
-//	int ValidByteLength;
-//	byte Data[128];
-//	void StartNewPacket();
-//	bool IsLastPacket;
-//private:
-//	static int NextPacketID;
-//};
+/*
+	Rx_Ring is a single producer / single consumer byte ring that needs no locks: only the
+	producer moves the head and only the consumer moves the tail, so the producer can be an
+	interrupt routine while the consumer reads. SIZE must be a power of two (up to 32768), the
+	indexes run freely and are masked, so all SIZE bytes are usable.
+	The consumer takes whole spans (Span and Consume, or Read) instead of a byte per call.
+*/
+template <int SIZE>
+class Rx_Ring
+{
+	static_assert((SIZE > 0) && (SIZE <= 32768) && ((SIZE & (SIZE - 1)) == 0), "Rx_Ring SIZE must be a power of two");
+
+	public:
+		Rx_Ring() : Overruns(0), _head(0), _tail(0) {}
+
+		// Bytes the producer had to drop because the ring was full
+		// (FPS_GT511C3::Pump adds one each time the SoftwareSerial buffer before it overflowed)
+		volatile unsigned long Overruns;
+
+		// Producer side
+		// Returns: True if the byte was stored, false (and Overruns is increased) if the ring was full
+		bool Put(byte b)
+		{
+			uint16_t head = _head;
+			if ((uint16_t)(head - Load(_tail)) >= SIZE)
+			{
+				Overruns++;
+				return false;
+			}
+			_buffer[head & (SIZE - 1)] = b;
+			Store(_head, head + 1);
+			return true;
+		}
+
+		// Producer side
+		// Returns: the bytes that can be Put without an overrun
+		int Free()
+		{
+			return SIZE - (uint16_t)(_head - Load(_tail));
+		}
+
+		// Consumer side
+		// Returns: the bytes waiting to be read
+		int Available()
+		{
+			return (uint16_t)(Load(_head) - _tail);
+		}
+
+		// Consumer side
+		// Parameter: set to the oldest unread byte
+		// Returns: how many bytes can be read from there in one piece (0 if the ring is empty)
+		int Span(const byte*& data)
+		{
+			uint16_t available = Load(_head) - _tail;
+			uint16_t start = _tail & (SIZE - 1);
+			if (available > SIZE - start) available = SIZE - start;
+			data = _buffer + start;
+			return available;
+		}
+
+		// Consumer side, frees bytes from the start of the Span once they were used
+		void Consume(int count)
+		{
+			Store(_tail, _tail + count);
+		}
+
+		// Consumer side, only call when Available
+		byte Get()
+		{
+			byte b = _buffer[_tail & (SIZE - 1)];
+			Store(_tail, _tail + 1);
+			return b;
+		}
+
+		// Consumer side, copies up to count bytes a span at a time
+		// Returns: the number of bytes copied
+		int Read(byte* data, int count)
+		{
+			int retval = 0;
+			const byte* span;
+			int length;
+			while ((retval < count) && ((length = Span(span)) > 0))
+			{
+				if (length > count - retval) length = count - retval;
+				memcpy(data + retval, span, length);
+				Consume(length);
+				retval += length;
+			}
+			return retval;
+		}
+
+		// Consumer side, drops everything that was not read yet
+		void Clear()
+		{
+			Store(_tail, Load(_head));
+		}
+
+	private:
+		byte _buffer[SIZE];
+		volatile uint16_t _head;
+		volatile uint16_t _tail;
+
+		// The other side's index is read and the own one written in one piece, and in order
+		// with the buffer (an interrupt can't see half of a 16 bit index on AVR)
+		static uint16_t Load(volatile uint16_t& index)
+		{
+#if defined(__AVR__)
+			uint16_t retval;
+			ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { retval = index; }
+			return retval;
+#else
+			return __atomic_load_n(&index, __ATOMIC_ACQUIRE);
+#endif  //__AVR__
+		}
+		static void Store(volatile uint16_t& index, uint16_t value)
+		{
+#if defined(__AVR__)
+			ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { index = value; }
+#else
+			__atomic_store_n(&index, value, __ATOMIC_RELEASE);
+#endif  //__AVR__
+		}
+};
 #ifndef __GNUC__
 #pragma endregion
 #endif  //__GNUC__
 
-
+#ifndef __GNUC__
+#pragma region -= Command_Result =-
+#endif  //__GNUC__
 /*
-	Object for controlling the GT-511C3 Finger Print Scanner (FPS)
+	Command_Result is the whole outcome of the last command (see FPS_GT511C3::LastResult),
+	so a sketch can tell why a command failed without asking the fps again.
+	It is a plain value kept inside the fps object, nothing is allocated to fill it.
 */
-class FPS_GT511C3
+class Command_Result
 {
- 
- public:
-	// Enables verbose debug output using hardware Serial 
-	bool UseSerialDebug;
+	public:
+		Command_Result();
+		Command_Packet::Commands::Commands_Enum Command;	// the command that was sent
+		bool ACK;											// true if the fps acknowledged it
+		bool Valid;											// false if the response timed out or arrived garbled
+		Response_Packet::ErrorCodes::Errors_Enum Error;		// NO_ERROR on ACK, the fps error code on NACK, INVALID if not Valid
+		unsigned long Parameter;							// the raw response parameter (the ID, the count, the error code...)
+		unsigned long Millis;								// ms from sending the command to its (last) response
 
+		// Returns: true if the command failed because no finger was on the sensor
+		bool NoFinger();
+};
 #ifndef __GNUC__
-	#pragma region -= Constructor/Destructor =-
+#pragma endregion
 #endif  //__GNUC__
-	// Creates a new object to interface with the fingerprint scanner
-	FPS_GT511C3(uint8_t rx, uint8_t tx);
-	
-	// destructor
-	~FPS_GT511C3();
+
 #ifndef __GNUC__
-	#pragma endregion
+#pragma region -= Data_Packet =- 
 #endif  //__GNUC__
+/*
+	Data_Packet describes the framing of the data phase that follows some commands (templates, images)
+	The payload is streamed straight to/from the caller's buffer, so only the framing lives here
+*/
+class Data_Packet
+{
+	public:
+		static const byte DATA_START_CODE_1 = 0x5A;	// Static byte to mark the beginning of a data packet	-	never changes
+		static const byte DATA_START_CODE_2 = 0xA5;	// Static byte to mark the beginning of a data packet	-	never changes
+		static const byte DATA_DEVICE_ID_1 = 0x01;	// Device ID Byte 1 (lesser byte)						-	theoretically never changes
+		static const byte DATA_DEVICE_ID_2 = 0x00;	// Device ID Byte 2 (greater byte)						-	theoretically never changes
+};
 
+/*
+	Data_Checksum adds up bytes the way the fps does (16 bit byte addition), a chunk at a time
+	so a transfer can be checked as it arrives. Chunks can be split anywhere.
+*/
+class Data_Checksum
+{
+	public:
+		Data_Checksum();
+		void Reset();
+		void Add(byte b);
+		void Add(const byte* data, int length);
+		word Value();
+		// Returns: True if the two bytes (low, high) match the checksum
+		bool Matches(byte low, byte high);
 
+	private:
+		word _sum;
+};
 #ifndef __GNUC__
-	#pragma region -= Device Commands =-
+#pragma endregion
 #endif  //__GNUC__
-	//Initialises the device and gets ready for commands
-	void Open();
 
-	// Does not actually do anything (according to the datasheet)
-	// I implemented open, so had to do closed too... lol
-	void Close();
+class FPS_GT511C3;
+class Warm_Start;
 
-	// Turns on or off the LED backlight
-	// LED must be on to see fingerprints
-	// Parameter: true turns on the backlight, false turns it off
-	// Returns: True if successful, false if not
-	bool SetLED(bool on);
-	
-	// Changes the baud rate of the connection
-	// Parameter: 9600 - 115200
-	// Returns: True if success, false if invalid baud
-	// NOTE: Untested (don't have a logic level changer and a voltage divider is too slow)
-	bool ChangeBaudRate(unsigned long baud);
+#ifndef __GNUC__
+#pragma region -= Template_Store =-
+#endif  //__GNUC__
+/*
+	Template_Store reads and writes a template database in a fixed-stride format,
+	so it can live on an SD card or be streamed to/from a computer over serial
 
-	// Gets the number of enrolled fingerprints
-	// Return: The total number of enrolled fingerprints
-	int GetEnrollCount();
+	Layout (all values little endian, same as the fps):
+	  Header, 512 bytes:
+	    0-3    "FPST"
+	    4      format version (1)
+	    5      model (Models_Enum)
+	    6-7    capacity (number of slots)
+	    8-9    record size (512)
+	    10-15  reserved (0)
+	    16-    occupancy bitmap, bit (slot % 8) of byte (slot / 8), rest of header is 0
+	  Records, 512 bytes each, record N at offset 512 + N * 512 for every slot:
+	    0-497    template
+	    498-499  slot number, 0xFFFF if the slot is empty
+	    500-501  checksum of the template (byte addition, same as the data phase)
+	    502-511  reserved (0)
+	512 byte records keep every template sector aligned, so a computer can mmap the
+	file and index it directly while the arduino only ever holds one template in ram
+*/
+class Template_Store
+{
+	public:
+		class Models
+		{
+			public:
+				enum Models_Enum
+				{
+					Unknown		= 0x00,
+					GT511C1R	= 0x01,		// 20 templates
+					GT511C3		= 0x02,		// 200 templates
+					GT521F32	= 0x03,		// 200 templates
+					GT521F52	= 0x04		// 3000 templates
+				};
+		};
 
-	// checks to see if the ID number is in use or not
-	// Parameter: 0-2999, if using GT-521F52
-        //            0-199, if using GT-521F32/GT-511C3
-	// Return: True if the ID number is enrolled, false if not
-	bool CheckEnrolled(int id);
+		class RecordResults
+		{
+			public:
+				enum RecordResults_Enum
+				{
+					OK			= 0,		// template read and checksum matched
+					EMPTY		= 1,		// slot holds no template
+					BAD_CHECKSUM= 2,		// template is corrupt
+					TRUNCATED	= 3			// stream ended (or timed out) mid record
+				};
+		};
 
-	// Starts the Enrollment Process
-	// Parameter: 0-2999, if using GT-521F52
-        //            0-199, if using GT-521F32/GT-511C3
-	// Return:
-	//	0 - ACK
-	//	1 - Database is full
-	//	2 - Invalid Position
-	//	3 - Position(ID) is already used
-	int EnrollStart(int id);
+		static const int HEADER_SIZE = 512;
+		static const int RECORD_SIZE = 512;
+		static const byte FORMAT_VERSION = 1;
 
-	// Gets the first scan of an enrollment
-	// Return: 
-	//	0 - ACK
-	//	1 - Enroll Failed
-	//	2 - Bad finger
-	//	3 - ID in use
-	int Enroll1();
+		Models::Models_Enum Model;
+		int Capacity;
 
-	// Gets the Second scan of an enrollment
-	// Return: 
-	//	0 - ACK
-	//	1 - Enroll Failed
-	//	2 - Bad finger
-	//	3 - ID in use
-	int Enroll2();
+		Template_Store(Stream& stream);
 
-	// Gets the Third scan of an enrollment
-	// Finishes Enrollment
-	// Return: 
-	//	0 - ACK
-	//	1 - Enroll Failed
-	//	2 - Bad finger
-	//	3 - ID in use
-	int Enroll3();
+		// Writes the header, querying the fps for which slots are in use
+		void WriteHeader(FPS_GT511C3& fps, Models::Models_Enum model, int capacity);
+		// Reads and validates the header, filling in Model and Capacity
+		// Returns: true if the header is valid
+		bool ReadHeader();
 
-	// Checks to see if a finger is pressed on the FPS
-	// Return: true if finger pressed, false if not
-	bool IsPressFinger();
+		// Writes the record for the given slot, pass a null template for an empty slot
+		void WriteRecord(int slot, byte* tmplt);
+		// Reads the next record into tmplt (498 bytes), slot receives the slot number
+		RecordResults::RecordResults_Enum ReadRecord(int& slot, byte* tmplt);
 
-	// Deletes the specified ID (enrollment) from the database
-	// Returns: true if successful, false if position invalid
-	bool DeleteID(int ID);
+		// Downloads every slot from the fps into the store (header included)
+		// Parameter: buffer of 498 bytes to use while transferring
+		// Returns: the number of templates exported
+		int Export(FPS_GT511C3& fps, Models::Models_Enum model, int capacity, byte* tmplt);
+		// Uploads every template in the store (header included) to the same slot on the fps
+		// Parameter: buffer of 498 bytes to use while transferring
+		// Returns: the number of templates imported, or -1 if the header is invalid
+		int Import(FPS_GT511C3& fps, bool duplicateCheck, byte* tmplt);
 
-	// Deletes all IDs (enrollments) from the database
-	// Returns: true if successful, false if db is empty
-	bool DeleteAll();
+		// Counters from Sync, byte counts are what crossed the fps serial link
+		class SyncResults
+		{
+			public:
+				int Uploaded;					// changed or new templates sent with SetTemplate
+				int Deleted;					// slots removed from the store, cleared with DeleteID
+				int Unchanged;					// slots skipped because the manifest matched
+				int Failed;						// slots whose DeleteID or SetTemplate failed, or that did not verify with CheckEnrolled (retried next sync)
+				unsigned long BytesSent;		// bytes this sync exchanged with the fps
+				long BytesSaved;				// bytes a full reload (DeleteAll + SetTemplate for every template) would have cost on top
+		};
 
-	// Checks the currently pressed finger against a specific ID
-	// Parameter: 0-2999, if using GT-521F52 (id number to be checked)
-        //            0-199, if using GT-521F32/GT-511C3 (id number to be checked)
-	// Returns:
-	//	0 - Verified OK (the correct finger)
-	//	1 - Invalid Position
-	//	2 - ID is not in use
-	//	3 - Verified FALSE (not the correct finger)
-	int Verify1_1(int id);
+		// Brings the fps in line with the store (header included) by only touching slots that changed
+		// The manifest is 4 bytes per slot (little endian TemplateHash, 0 = empty) describing what the fps held
+		// after the last sync. Pass NULL for manifestIn when there is none yet, every slot is then checked.
+		// The updated manifest is written to manifestOut (may be NULL), save it for the next sync.
+		// Parameter: buffer of 498 bytes to use while transferring
+		// Returns: true if the whole store was read
+		bool Sync(FPS_GT511C3& fps, Stream* manifestIn, Print* manifestOut, byte* tmplt, SyncResults& results);
 
-	// Checks the currently pressed finger against all enrolled fingerprints
-	// Returns:
-	//	Verified against the specified ID (found, and here is the ID number)
-        //           0-2999, if using GT-521F52
-        //           0-199, if using GT-521F32/GT-511C3
-        //      Failed to find the fingerprint in the database
-        // 	     3000, if using GT-521F52
-        //           200, if using GT-521F32/GT-511C3
-	int Identify1_N();
+		static word TemplateChecksum(byte* tmplt);
+		// 32 bit content hash (FNV-1a) of a template, never 0 (an empty slot) or 0xFFFFFFFF (a slot to check again)
+		static uint32_t TemplateHash(byte* tmplt);
+		// 32 bit similarity signature (SimHash) of a template, copies of a template that
+		// differ in a few bytes end up only a few bits apart (see SignatureDistance)
+		static uint32_t TemplateSignature(byte* tmplt);
+		// Number of bits that differ between two signatures, 0-32
+		static int SignatureDistance(uint32_t a, uint32_t b);
 
-	// Captures the currently pressed finger into onboard ram
-	// Parameter: true for high quality image(slower), false for low quality image (faster)
-	// Generally, use high quality for enrollment, and low quality for verification/identification
-	// Returns: True if ok, false if no finger pressed
-	bool CaptureFinger(bool highquality);
+	private:
+		Stream& _stream;
+		void WriteWord(word w);
+		void WriteZeros(int count);
+		bool ReadBytes(byte* buffer, int length);
+};
 #ifndef __GNUC__
-	#pragma endregion
+#pragma endregion
 #endif  //__GNUC__
 
 #ifndef __GNUC__
-	#pragma region -= Not implemented commands =-
+#pragma region -= Image_Row_Handler =-
+#endif  //__GNUC__
+/*
+	Image_Row_Handler receives an image one row at a time while it downloads from the fps
+	Keep the work per row short, the rest of the image keeps arriving in the meantime
+*/
+class Image_Row_Handler
+{
+	public:
+		// Called before the first row
+		virtual void ImageStart(int /*width*/, int /*height*/) {}
+		// Called for every row in order, pixels is only valid during the call
+		virtual void ImageRow(int row, byte* pixels, int width) = 0;
+		// Called after the last row, before the checksum has been checked
+		virtual void ImageEnd() {}
+		virtual ~Image_Row_Handler() {}
+};
+#ifndef __GNUC__
+#pragma endregion
 #endif  //__GNUC__
-	// Gets an image that is 258x202 (52116 bytes) and returns it in 407 Data_Packets
-	// Use StartDataDownload, and then GetNextDataPacket until done
-	// Returns: True (device confirming download starting)
-	// Not implemented due to memory restrictions on the arduino
-	// may revisit this if I find a need for it
-	//bool GetImage();
 
-	// Gets an image that is qvga 160x120 (19200 bytes) and returns it in 150 Data_Packets
-	// Use StartDataDownload, and then GetNextDataPacket until done
-	// Returns: True (device confirming download starting)
-	// Not implemented due to memory restrictions on the arduino
-	// may revisit this if I find a need for it
-	//bool GetRawImage();
+#ifndef __GNUC__
+#pragma region -= Image_Quality =-
+#endif  //__GNUC__
+/*
+	Image_Quality scores a capture while GetImage downloads it, so the verdict is
+	ready as soon as the last row lands. Uses one pass and no image buffer.
+	  Contrast  - spread between the darkest and lightest 5% of pixels (0-255)
+	  Coverage  - percentage of the image with ridge texture (0-100)
+	  Clarity   - average step between neighbouring pixels in the ridge texture (0-255)
+*/
+class Image_Quality : public Image_Row_Handler
+{
+	public:
+		Image_Quality();
 
-	// Gets a template from the fps (498 bytes) in 4 Data_Packets
-	// Use StartDataDownload, and then GetNextDataPacket until done
-	// Parameter: 0-199 ID number
-	// Returns: 
-	//	0 - ACK Download starting
-	//	1 - Invalid position
-	//	2 - ID not used (no template to download
-	// Not implemented due to memory restrictions on the arduino
-	// may revisit this if I find a need for it
-	//int GetTemplate(int id);
+		// Thresholds for Passed(), change to tune
+		int MinContrast;
+		int MinCoverage;
+		int MinClarity;
+		// A segment counts as ridge texture if its darkest and lightest pixel are this far apart
+		int TextureThreshold;
 
-	// Uploads a template to the fps 
-	// Parameter: the template (498 bytes)
-	// Parameter: the ID number to upload
-	// Parameter: Check for duplicate fingerprints already on fps
-	// Returns: 
-	//	0-199 - ID duplicated
-	//	200 - Uploaded ok (no duplicate if enabled)
-	//	201 - Invalid position
-	//	202 - Communications error
-	//	203 - Device error
-	// Not implemented due to memory restrictions on the arduino
-	// may revisit this if I find a need for it
-	//int SetTemplate(byte* tmplt, int id, bool duplicateCheck);
+		// Results, valid once Complete is true
+		word Histogram[16];				// pixel count for each block of 16 grey levels
+		int Contrast;
+		int Coverage;
+		int Clarity;
+		bool Complete;
 
-	// Commands that are not implemented (and why)
-	// VerifyTemplate1_1 - Couldn't find a good reason to implement this on an arduino
-	// IdentifyTemplate1_N - Couldn't find a good reason to implement this on an arduino
-	// MakeTemplate - Couldn't find a good reason to implement this on an arduino
-	// UsbInternalCheck - not implemented - Not valid config for arduino
-	// GetDatabaseStart - historical command, no longer supported
-	// GetDatabaseEnd - historical command, no longer supported
-	// UpgradeFirmware - Data Sheet says not supported
-	// UpgradeISOCDImage - Data Sheet says not supported
-	// SetIAPMode - for upgrading firmware (which is not supported)
-	// Ack and Nack	are listed as a commands for some unknown reason... not implemented
+		// Returns: True if the capture is good enough to match
+		bool Passed();
+
+		void ImageStart(int width, int height);
+		void ImageRow(int row, byte* pixels, int width);
+		void ImageEnd();
+
+	private:
+		static const int SEGMENT = 8;	// pixels per texture segment
+		unsigned long _segments;
+		unsigned long _texturesegments;
+		unsigned long _gradient;
+		unsigned long _gradientcount;
+};
 #ifndef __GNUC__
-  #pragma endregion
+#pragma endregion
 #endif  //__GNUC__
 
 #ifndef __GNUC__
-	#pragma endregion
+#pragma region -= Image_Fanout =-
 #endif  //__GNUC__
+/*
+	Image_Fanout hands every row of one GetImage to several handlers (quality check, archive,
+	preview...), all reading the same row buffer, so nothing is copied and the image is only
+	downloaded once. Handlers are called in the order they were added.
+	The time each handler spends per row is measured: the row time of all of them together
+	has to stay under the time the SoftwareSerial buffer takes to fill (64 * 10 / baud seconds),
+	or bytes are lost. Handlers that call fps.Pump() between their steps get the room in Rx
+	as well, (64 + FPS_RX_RING_SIZE) * 10 / baud seconds, less what arrives between two calls.
+*/
+class Image_Fanout : public Image_Row_Handler
+{
+	public:
+		static const int MAX_HANDLERS = 8;
 
-	void serialPrintHex(byte data);
-	void SendToSerial(byte data[], int length);
+		Image_Fanout();
 
-	// resets the Data_Packet class, and gets ready to download
-	// Not implemented due to memory restrictions on the arduino
-	// may revisit this if I find a need for it
-	//void StartDataDownload();
+		// Returns: True if added, false if there are already MAX_HANDLERS
+		bool Add(Image_Row_Handler& handler);
+		int Count();
 
-	// Returns the next data packet 
-	// Not implemented due to memory restrictions on the arduino
-	// may revisit this if I find a need for it
-	//Data_Packet GetNextDataPacket();
+		// Statistics for the last image, per handler (in the order added)
+		unsigned long SlowestRowMicros[MAX_HANDLERS];
+		unsigned long TotalMicros[MAX_HANDLERS];
+		// Slowest row of all the handlers together
+		unsigned long SlowestRowMicrosAll;
 
-private:
-	 void SendCommand(byte cmd[], int length);
-	 Response_Packet* GetResponse();
-	 uint8_t pin_RX,pin_TX;
-	 SoftwareSerial _serial;
+		void ImageStart(int width, int height);
+		void ImageRow(int row, byte* pixels, int width);
+		void ImageEnd();
+
+	private:
+		Image_Row_Handler* _handlers[MAX_HANDLERS];
+		int _count;
 };
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
+
+#ifndef __GNUC__
+#pragma region -= Image_Encoder / Image_Decoder =-
+#endif  //__GNUC__
+/*
+	Image_Encoder compresses an image (losslessly) while GetImage downloads it and
+	writes the archive record out as it goes, using a fixed amount of ram (one row)
 
+	Each pixel is predicted from its neighbours (left, above, above-left), and the
+	prediction error is Rice coded with a parameter picked per row. Every 16th row
+	is a key row that only looks left, so Image_Decoder can jump to any row.
 
-#endif
+	Record layout (all values little endian):
+	  0-3    "FPSI"
+	  4      format version (1)
+	  5      rows per group (16)
+	  6-7    width
+	  8-9    height
+	  10-11  reserved (0)
+	  12-    rows, each starting on a byte: 3 bit Rice parameter, then one code per pixel
+	  index  offset of each group's key row from the start of the record, 4 bytes each
+	  footer (last 12 bytes): checksum of the pixels (byte addition), group count,
+	         offset of the index (4 bytes), "FPSE"
+*/
+class Image_Encoder : public Image_Row_Handler
+{
+	public:
+		static const int MAX_WIDTH = 258;
+		static const int MAX_HEIGHT = 202;
+		static const int GROUP_ROWS = 16;
+		static const int HEADER_SIZE = 12;
+		static const int FOOTER_SIZE = 12;
+		static const byte FORMAT_VERSION = 1;
+
+		Image_Encoder(Print& out);
+
+		// Size of the record written so far, and of the image it holds
+		unsigned long BytesWritten;
+		unsigned long PixelCount;
+
+		void ImageStart(int width, int height);
+		void ImageRow(int row, byte* pixels, int width);
+		void ImageEnd();
+
+		// helpers shared with Image_Decoder
+		static byte Predict(byte left, byte up, byte upleft);
+		static byte ZigZag(byte residual);
+		static byte UnZigZag(byte code);
+
+	private:
+		static const int MAX_GROUPS = (MAX_HEIGHT + GROUP_ROWS - 1) / GROUP_ROWS;
+		static const int ESCAPE = 16;
+		Print& _out;
+		byte _previous[MAX_WIDTH];
+		unsigned long _groupoffsets[MAX_GROUPS];
+		int _groups;
+		Data_Checksum _checksum;
+		byte _bits;
+		int _bitcount;
+		void WriteBits(word value, int count);
+		void FlushBits();
+		void WriteByte(byte b);
+		void WriteLong(unsigned long l);
+};
+
+/*
+	Image_Decoder reads back a record made by Image_Encoder, one row at a time
+	Rows can be read in any order, reading them in order is fastest
+	The record can be in memory, or in a file (or anything else that is a Stream and can seek):
+	only the header, the footer, one index entry per jump and the rows asked for are read, so
+	the record never has to fit in ram
+*/
+class Image_Decoder
+{
+	public:
+		// Moves the source to a byte offset from the start of the record
+		// Returns: True if the source is now there
+		typedef bool (*SeekCallback)(unsigned long position, void* context);
 
+		// Parameter: the record in memory, and its length
+		Image_Decoder(const byte* record, unsigned long length);
+		// Parameter: the source the record is read from, and the record's length
+		// Parameter: function that seeks the source (for an SD File: return ((File*)context)->seek(position);)
+		// Parameter: passed to the seek function unchanged
+		Image_Decoder(Stream& source, unsigned long length, SeekCallback seek, void* context);
+
+		// Header values, Valid is false if the record is damaged or not an image record
+		bool Valid;
+		int Width;
+		int Height;
+		word Checksum;
+
+		// Decodes one row into pixels (Width bytes)
+		// The buffer must hold the previously decoded row when reading rows in order
+		// Returns: True if the row was decoded
+		bool DecodeRow(int row, byte* pixels);
+
+	private:
+		const byte* _record;
+		Stream* _source;
+		SeekCallback _seek;
+		void* _context;
+		unsigned long _sourceposition;	// where the source is, reading on from there needs no seek
+		unsigned long _length;
+		unsigned long _indexoffset;
+		int _groups;
+		int _nextrow;
+		unsigned long _position;
+		byte _bits;
+		int _bitcount;
+		bool _overrun;
+		void ReadHeader();
+		bool Read(unsigned long offset, byte* buffer, int count);
+		word ReadBits(int count);
+		bool ReadLong(unsigned long offset, unsigned long& l);
+		bool DecodeNextRow(byte* pixels);
+};
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
+
+#ifndef __GNUC__
+#pragma region -= Minutiae_Set / Minutiae_Extractor / Minutiae_Matcher =-
+#endif  //__GNUC__
+/*
+	Minutiae_Set holds the ridge endings and bifurcations found in one image
+	The fields are kept as separate arrays (every X, then every Y, then every kind),
+	so the matcher reads each one straight through. Coordinates are at half
+	resolution (129x101) so they fit in a byte.
+*/
+class Minutiae_Set
+{
+	public:
+		static const int MAX_MINUTIAE = 40;
+		static const byte BIFURCATION = 0x08;
+
+		byte Count;
+		byte X[MAX_MINUTIAE];
+		byte Y[MAX_MINUTIAE];
+		byte Kind[MAX_MINUTIAE];	// BIFURCATION bit, plus the direction in bits 0-2 (0 = right, counter clockwise in 45 degree steps)
+
+		void Clear();
+		// Adds a minutia, unless there is no room or another one is closer than spacing
+		// Returns: True if it was added
+		bool Add(byte x, byte y, byte kind, byte spacing);
+};
+
+/*
+	Minutiae_Extractor finds minutiae while GetImage downloads the image, without an image buffer
+	Each pair of rows is halved (2x2 average) and split into ridge/valley against the local
+	average, and the last three of those rows are kept as bits. A ridge pixel with one thin
+	ridge leaving it is an ending, one with three separate thin ridges is a bifurcation.
+	This is a light extractor meant for matching against prints taken on the same scanner,
+	it does not thin the ridges or estimate the orientation field.
+*/
+class Minutiae_Extractor : public Image_Row_Handler
+{
+	public:
+		// Parameter: the set to fill, it is cleared when the image starts
+		Minutiae_Extractor(Minutiae_Set& result);
+
+		int Margin;		// half resolution pixels skipped at each edge, where ridges are cut off
+		byte Spacing;	// minutiae closer than this (half resolution pixels) are counted once
+		bool Complete;	// true once the whole image has been scanned
+
+		void ImageStart(int width, int height);
+		void ImageRow(int row, byte* pixels, int width);
+		void ImageEnd();
+
+	private:
+		static const int MAX_WIDTH = 129;				// half of FPS_GT511C3::IMAGE_WIDTH
+		static const int ROW_BYTES = (MAX_WIDTH + 7) / 8;
+		static const int WINDOW = 4;					// pixels each side used for the local average
+		Minutiae_Set& _result;
+		byte _half[MAX_WIDTH];
+		byte _bits[3][ROW_BYTES];
+		byte _newest;
+		int _width;
+		int _height;
+		int _rows;
+		void Binarise(byte* bits);
+		void Scan(int y);
+};
+
+/*
+	Minutiae_Matcher compares minutiae sets on the arduino, as an alternative to Identify1_N
+	for galleries kept off the fps (on an SD card, or sent over by a host)
+	Every pair of minutiae of the same type and a similar direction votes for the shift
+	between the two prints; the score is the vote count of the most popular shift.
+*/
+class Minutiae_Matcher
+{
+	public:
+		Minutiae_Matcher();
+
+		// Lowest score that counts as a match, and the fewest minutiae a capture needs
+		int MinScore;
+
+		// Returns: how well the two sets line up (0 - MAX_MINUTIAE)
+		int Score(const Minutiae_Set& probe, const Minutiae_Set& candidate);
+
+		// Scores the probe against every set in the gallery
+		// Returns: the index of the best match, or -1 if none scored MinScore
+		int Identify(const Minutiae_Set& probe, const Minutiae_Set* gallery, int count);
+
+		// Captures the currently pressed finger and extracts its minutiae from the image
+		// The image is 52116 bytes, use a fast baud rate (ChangeBaudRate)
+		// Parameter: true for high quality image(slower), false for low quality image (faster)
+		// Returns: True if ok, false if no finger, the download failed or too few minutiae were found
+		bool Capture(FPS_GT511C3& fps, Minutiae_Set& result, bool highquality);
+
+		// Statistics
+		int LastScore;					// best score in the last Identify
+		unsigned long CaptureMillis;	// last Capture, image download included
+		unsigned long MatchMillis;		// last Identify
+
+	private:
+		static const int MAX_SHIFT = 64;	// largest shift between two prints (half resolution pixels)
+		static const int BIN_SHIFT = 3;		// shifts are counted in blocks of 8 pixels
+		static const int BINS = ((2 * MAX_SHIFT) >> BIN_SHIFT) + 1;
+};
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
+
+#ifndef __GNUC__
+#pragma region -= Session_Recorder / Session_Player =-
+#endif  //__GNUC__
+/*
+	Session_Recorder writes everything sent to and received from the fps, with timestamps,
+	so a session from the field can be replayed later (Session_Player, extras/session_stats.py)
+	Attach it with fps.Recorder = &recorder; writing it takes time, so record to something
+	fast (a buffered SD file) and prefer a low baud rate if images are transferred.
+
+	Recording layout:
+	  0-3    "FPSR"
+	  4      format version (2)
+	  5-     frames, each:
+	           kind (bit 7 set if received from the fps, bit 0 set for the data phase)
+	           microseconds from the end of the previous frame to the start of this one (varint)
+	           (version 1 counted to the end of this one, so it included the frame's wire time)
+	           length (varint)
+	           the bytes
+	  a varint is 7 bits per byte, lowest first, bit 7 set on every byte but the last
+*/
+class Session_Recorder
+{
+	public:
+		static const byte SENT = 0x00;
+		static const byte RECEIVED = 0x80;
+		static const byte COMMAND = 0x00;
+		static const byte DATA = 0x01;
+		static const byte FORMAT_VERSION = 2;
+
+		Session_Recorder(Print& out);
+
+		// The link rate, to tell when a frame started from when its last byte went through
+		// (kept up to date by FPS_GT511C3, default 9600)
+		unsigned long BaudRate;
+
+		// Writes the recording header and starts the clock
+		void Begin();
+
+		// Writes a whole frame, call it once the last byte has been sent or received
+		// Parameter: SENT or RECEIVED, plus COMMAND or DATA
+		void Frame(byte kind, const byte* bytes, unsigned long length);
+
+		// Writes a frame in pieces, Start then Add until length bytes have been added
+		void Start(byte kind, unsigned long length);
+		void Add(const byte* bytes, unsigned long length);
+
+		// Statistics
+		unsigned long Frames;
+		unsigned long Bytes;			// bytes written to out
+
+	private:
+		Print& _out;
+		unsigned long _last;
+		void WriteVarint(unsigned long value);
+};
+
+/*
+	Session_Player stands in for the fps, answering the library under test from a recording
+	Wire the link port to where the fps would be. Every sent frame in the recording is
+	read from the link and compared, and every received frame is written back after the
+	same delay as in the recording (scaled by Speed).
+	The link baud rate is not changed, so replay recordings made at one baud rate.
+	Version 1 recordings play too, their delays still hold each frame's wire time.
+*/
+class Session_Player
+{
+	public:
+		// Parameter: the recording
+		// Parameter: the port that the library under test talks to
+		Session_Player(Stream& recording, Stream& link);
+
+		int Speed;						// percent of the recorded delays, 100 = as recorded, 0 = no delays (default 100)
+		unsigned long Timeout;			// ms to wait for each byte the library should send (default 5000)
+
+		// Reads the recording header
+		// Returns: True if it is a recording this version can play
+		bool Begin();
+
+		// Plays the next frame
+		// Returns: True if there are more frames, false at the end (or on a timeout)
+		bool Step();
+
+		// Statistics
+		unsigned long Frames;
+		unsigned long Mismatches;		// sent bytes that differed from the recording
+		bool TimedOut;
+
+	private:
+		Stream& _recording;
+		Stream& _link;
+		unsigned long _last;
+		bool ReadVarint(unsigned long& value);
+		int ReadRecording();
+};
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
+
+#ifndef __GNUC__
+#pragma region -= Access_Journal =-
+#endif  //__GNUC__
+/*
+	Access_Entry is one access event, 16 bytes, stored as is (little endian)
+	The checksum is written last, so an entry cut short by a power loss does not check out
+	and is skipped when reading.
+*/
+class Access_Entry
+{
+	public:
+		class Kinds
+		{
+			public:
+				enum Kinds_Enum
+				{
+					Verify		= 1,	// Verify1_1, ID is the one checked
+					Identify	= 2		// Identify1_N, ID is the one found (200/3000 if none)
+				};
+		};
+
+		static const int SIZE = 16;
+
+		uint32_t Time;					// from the journal's Clock, millis() by default
+		uint16_t Sequence;				// counts up by one per entry
+		int16_t ID;
+		uint16_t Error;					// Response_Packet::ErrorCodes, NO_ERROR if the fps acknowledged
+		uint16_t CaptureMillis;			// CaptureFinger before it, 0 if none
+		uint16_t MatchMillis;			// the Verify1_1 / Identify1_N itself
+		uint8_t Kind;
+		uint8_t Checksum;
+
+		// Sets the checksum
+		void Seal();
+		// Returns: True if the checksum matches (not blank, not torn)
+		bool IsValid();
+		// Returns: True if the entry is a match (ID found, or verified OK)
+		bool Granted();
+};
+
+/*
+	Access_Journal records every Verify1_1 and Identify1_N outcome (set fps.Journal) without
+	holding up the door. Log builds the entry, Write stores it, both in constant time.
+*/
+class Access_Journal
+{
+	public:
+		Access_Journal();
+
+		// Time source for the entries (an RTC, for example), NULL for millis()
+		unsigned long (*Clock)();
+
+		// Statistics
+		unsigned long Logged;
+		unsigned long Dropped;			// entries Write could not take
+		unsigned long LastLogMicros;	// time the last Log took
+
+		// Adds an entry
+		// Returns: True if it was stored (or queued to be)
+		bool Log(Access_Entry::Kinds::Kinds_Enum kind, int id, word error, unsigned long capturemillis, unsigned long matchmillis);
+
+		virtual ~Access_Journal() {}
+
+	protected:
+		uint16_t _sequence;
+		virtual bool Write(const Access_Entry& entry) = 0;
+};
+
+/*
+	Stream_Journal appends entries to a file (or anything else that is a Print)
+	Read them back with ReadEntry, which skips entries that do not check out.
+*/
+class Stream_Journal : public Access_Journal
+{
+	public:
+		Stream_Journal(Print& out);
+
+		// Reads the next entry of a journal file, finding its way back to the entries after a torn one
+		// Parameter: skipped is increased for every run of bytes that did not check out
+		// Returns: True if an entry was read, false at the end
+		static bool ReadEntry(Stream& in, Access_Entry& entry, unsigned long& skipped);
+
+	protected:
+		bool Write(const Access_Entry& entry);
+
+	private:
+		Print& _out;
+};
+
+#if defined(__AVR__)
+/*
+	EEPROM_Journal keeps the newest entries in a ring in EEPROM, so each cell is written once
+	per lap of the ring (wear levelling). Writing a byte of EEPROM takes 3.3 ms, so Log only
+	queues the entry in ram and Poll writes a byte whenever the EEPROM is ready.
+	Begin finds where the ring left off by its sequence numbers, after a reset or power loss.
+*/
+class EEPROM_Journal : public Access_Journal
+{
+	public:
+		static const byte QUEUE_SIZE = 4;	// entries waiting to be written, must be a power of two
+
+		// Parameter: first EEPROM address to use
+		// Parameter: number of entries in the ring (16 bytes each)
+		EEPROM_Journal(int start, int capacity);
+
+		// Finds the newest entry, call once before logging
+		// Returns: the number of valid entries in the ring
+		int Begin();
+
+		// Writes queued entries a byte at a time while the EEPROM is free, call from loop()
+		// Returns: True if nothing is left to write
+		bool Poll();
+
+		// Waits until every queued entry has been written
+		void Flush();
+
+		// Reads the ring from the oldest entry to the newest, skipping blank or torn entries
+		void Rewind();
+		// Returns: True if an entry was read, false after the newest
+		bool Read(Access_Entry& entry);
+
+	protected:
+		bool Write(const Access_Entry& entry);
+
+	private:
+		int _start;
+		int _capacity;
+		int _reading;						// entries left for Read
+		int _readslot;
+		Access_Entry _queue[QUEUE_SIZE];
+		byte _queuehead;
+		byte _queuetail;
+		byte _written;						// bytes of the entry at _queuetail already written
+		int _writeslot;						// ring slot of the entry at _queuetail
+		void ReadSlot(int slot, Access_Entry& entry);
+};
+#endif  //__AVR__
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
+
+/*
+	Object for controlling the GT-511C3 Finger Print Scanner (FPS)
+*/
+class FPS_GT511C3
+{
+ 
+ public:
+	// Enables verbose debug output using hardware Serial (when compiled with FPS_DEBUG 1)
+	bool UseSerialDebug;
+
+	// Records the traffic with the fps when set, NULL (the default) for no recording
+	Session_Recorder* Recorder;
+
+	// Logs every Verify1_1 and Identify1_N outcome when set, NULL (the default) for no journal
+	Access_Journal* Journal;
+
+	// ms to wait for each response (and each byte of a data transfer), 0 (the default) to wait forever
+	// When it runs out the command fails as if the fps had answered with a NACK
+	unsigned long ResponseTimeout;
+
+	// Responses that timed out or arrived garbled, see Link_Watchdog
+	unsigned long LinkFailures;
+
+	// Kept in step with EnrollStart/Enroll3, SetTemplate, DeleteID and DeleteAll when set, NULL (the default) for none
+	Warm_Start* Snapshot;
+
+	// Everything the fps sends goes through this ring (read only), see Pump
+	Rx_Ring<FPS_RX_RING_SIZE> Rx;
+
+	// The outcome of the last command: error code, raw parameter and timing (read only)
+	Command_Result LastResult;
+
+	// The baud rate in use, and the LED state last set with SetLED (read only)
+	unsigned long BaudRate;
+	bool LedOn;
+
+#ifndef __GNUC__
+	#pragma region -= Constructor/Destructor =-
+#endif  //__GNUC__
+	// Creates a new object to interface with the fingerprint scanner
+	FPS_GT511C3(uint8_t rx, uint8_t tx);
+	
+	// destructor
+	~FPS_GT511C3();
+#ifndef __GNUC__
+	#pragma endregion
+#endif  //__GNUC__
+
+
+#ifndef __GNUC__
+	#pragma region -= Device Commands =-
+#endif  //__GNUC__
+	//Initialises the device and gets ready for commands
+	// Returns: True if the fps answered
+	bool Open();
+
+	// Initialises the device and reads its device info
+	// Parameter: where to put the device info (DEVICE_INFO_SIZE bytes): firmware version (4),
+	//            iso area max size (4) and the device serial number (16), NULL for none
+	// Returns: True if the fps answered (and the device info checked out)
+	bool Open(byte* info);
+
+	// Opens the fps at a baud rate it is expected to be running at, with a short ResponseTimeout
+	// Parameter: 9600, 19200, 38400, 57600, 115200
+	// Parameter: as Open, NULL for none
+	// Returns: True if the fps answered at that rate
+	bool OpenAt(unsigned long baud, byte* info);
+
+	// Finds the baud rate the fps answers at (after it was reset or lost power) and opens it
+	// Tries each rate with a short ResponseTimeout, starting with 9600 (the power on rate)
+	// Returns: the baud rate, 0 if the fps did not answer at any of them
+	unsigned long DetectBaudRate();
+
+	// Does not actually do anything (according to the datasheet)
+	// I implemented open, so had to do closed too... lol
+	void Close();
+
+	// Turns on or off the LED backlight
+	// LED must be on to see fingerprints
+	// Parameter: true turns on the backlight, false turns it off
+	// Returns: True if successful, false if not
+	bool SetLED(bool on);
+	
+	// Changes the baud rate of the connection
+	// Parameter: 9600 - 115200
+	// Returns: True if success, false if invalid baud
+	// NOTE: Untested (don't have a logic level changer and a voltage divider is too slow)
+	bool ChangeBaudRate(unsigned long baud);
+
+	// Gets the number of enrolled fingerprints
+	// Return: The total number of enrolled fingerprints, -1 if the fps did not answer properly
+	int GetEnrollCount();
+
+	// checks to see if the ID number is in use or not
+	// Parameter: 0-2999, if using GT-521F52
+        //            0-199, if using GT-521F32/GT-511C3
+	// Return: True if the ID number is enrolled, false if not
+	bool CheckEnrolled(int id);
+
+	// Starts the Enrollment Process
+	// Parameter: 0-2999, if using GT-521F52
+        //            0-199, if using GT-521F32/GT-511C3
+	// Return:
+	//	0 - ACK
+	//	1 - Database is full
+	//	2 - Invalid Position
+	//	3 - Position(ID) is already used
+	//	4 - Communications error (no proper answer)
+	int EnrollStart(int id);
+
+	// Gets the first scan of an enrollment
+	// Return: 
+	//	0 - ACK
+	//	1 - Enroll Failed
+	//	2 - Bad finger
+	//	3 - ID in use
+	//	4 - Communications error (no proper answer)
+	int Enroll1();
+
+	// Gets the Second scan of an enrollment
+	// Return: 
+	//	0 - ACK
+	//	1 - Enroll Failed
+	//	2 - Bad finger
+	//	3 - ID in use
+	//	4 - Communications error (no proper answer)
+	int Enroll2();
+
+	// Gets the Third scan of an enrollment
+	// Finishes Enrollment
+	// Return: 
+	//	0 - ACK
+	//	1 - Enroll Failed
+	//	2 - Bad finger
+	//	3 - ID in use
+	//	4 - Communications error (no proper answer)
+	int Enroll3();
+
+	// Checks to see if a finger is pressed on the FPS
+	// Return: true if finger pressed, false if not (or if the fps did not answer properly)
+	bool IsPressFinger();
+
+	// Deletes the specified ID (enrollment) from the database
+	// Returns: true if successful, false if position invalid
+	bool DeleteID(int ID);
+
+	// Deletes all IDs (enrollments) from the database
+	// Returns: true if successful, false if db is empty
+	bool DeleteAll();
+
+	// Checks the currently pressed finger against a specific ID
+	// Parameter: 0-2999, if using GT-521F52 (id number to be checked)
+        //            0-199, if using GT-521F32/GT-511C3 (id number to be checked)
+	// Returns:
+	//	0 - Verified OK (the correct finger)
+	//	1 - Invalid Position
+	//	2 - ID is not in use
+	//	3 - Verified FALSE (not the correct finger)
+	//	4 - Communications error (the response timed out or arrived garbled)
+	int Verify1_1(int id);
+
+	// Checks the currently pressed finger against all enrolled fingerprints
+	// Returns:
+	//	Verified against the specified ID (found, and here is the ID number)
+        //           0-2999, if using GT-521F52
+        //           0-199, if using GT-521F32/GT-511C3
+        //      Failed to find the fingerprint in the database (or the fps did not answer properly)
+        // 	     3000, if using GT-521F52
+        //           200, if using GT-521F32/GT-511C3
+	int Identify1_N();
+
+	// Captures the currently pressed finger into onboard ram
+	// Parameter: true for high quality image(slower), false for low quality image (faster)
+	// Generally, use high quality for enrollment, and low quality for verification/identification
+	// Returns: True if ok, false if no finger pressed
+	bool CaptureFinger(bool highquality);
+
+	// Uploads a template to the fps 
+	// Parameter: the template (498 bytes)
+	// Parameter: 0-2999, if using GT-521F52 (the ID number to upload)
+	//            0-199, if using GT-521F32/GT-511C3 (the ID number to upload)
+	// Parameter: Check for duplicate fingerprints already on fps
+	// Returns: 
+	//	0-2999 - ID duplicated (the ID the template matched)
+	//	3000 - Uploaded ok (no duplicate if enabled)
+	//	3001 - Invalid position
+	//	3002 - Communications error
+	//	3003 - Device error
+	//      (the same on every model, so a duplicated ID is never taken for one of the codes;
+	//       LastResult.ACK is true only when the upload went through)
+	int SetTemplate(byte* tmplt, int id, bool duplicateCheck);
+
+	// Downloads a template from the fps
+	// Parameter: 0-2999, if using GT-521F52 (the ID number to download)
+	//            0-199, if using GT-521F32/GT-511C3 (the ID number to download)
+	// Parameter: buffer that receives the template (498 bytes)
+	// Returns: 
+	//	0 - ACK Download ok
+	//	1 - Invalid position
+	//	2 - ID not used (no template to download)
+	//	3 - Communications error (data checksum did not match)
+	int GetTemplate(int id, byte* tmplt);
+
+	// Downloads the image of the last CaptureFinger, 258x202 (52116 bytes)
+	// The image is never held in ram, each row is handed to the handler as it arrives
+	// Parameter: the handler that receives the rows
+	// Returns: True if the whole image arrived and its checksum matched
+	bool GetImage(Image_Row_Handler& handler);
+
+	// Makes a template from the last CaptureFinger and downloads it, without storing it on the fps
+	// Parameter: buffer that receives the template (498 bytes)
+	// Returns:
+	//	0 - ACK Template made
+	//	1 - Bad finger
+	//	2 - Communications error
+	int MakeTemplate(byte* tmplt);
+
+	// Uploads a template and checks it against all enrolled fingerprints
+	// Parameter: the template (498 bytes), from MakeTemplate or GetTemplate
+	// Returns:
+	//	Verified against the specified ID (found, and here is the ID number)
+	//           0-2999, if using GT-521F52
+	//           0-199, if using GT-521F32/GT-511C3
+	//      Failed to find the fingerprint in the database
+	//           3000, if using GT-521F52
+	//           200, if using GT-521F32/GT-511C3
+	//      Communications error (the fps did not take the template)
+	//           3001, if using GT-521F52
+	//           201, if using GT-521F32/GT-511C3
+	int IdentifyTemplate1_N(byte* tmplt);
+
+	// Uploads a template and checks it against a specific ID
+	// Parameter: 0-2999, if using GT-521F52 (id number to be checked)
+	//            0-199, if using GT-521F32/GT-511C3 (id number to be checked)
+	// Parameter: the template (498 bytes), from MakeTemplate or GetTemplate
+	// Returns:
+	//	0 - Verified OK (the correct finger)
+	//	1 - Invalid Position
+	//	2 - ID is not in use
+	//	3 - Verified FALSE (not the correct finger)
+	//	4 - Communications error (the fps did not take the template)
+	int VerifyTemplate1_1(int id, byte* tmplt);
+
+	// Captures the currently pressed finger and downloads its template, so it can be matched
+	// any number of times (against any fps) without capturing again
+	// Each match uploads the template, which below 115200 baud takes longer than a new capture
+	// Parameter: buffer that receives the template (498 bytes)
+	// Parameter: true for high quality image(slower), false for low quality image (faster)
+	// Returns: True if ok, false if no finger pressed or the template could not be made
+	bool CaptureTemplate(byte* tmplt, bool highquality);
+
+	// Checks a template against each of a list of IDs, in order, stopping at the first match
+	// Parameter: the template (498 bytes), from CaptureTemplate
+	// Parameter: the IDs to check and how many there are
+	// Returns: the first ID that verified OK, or -1 if none did
+	int VerifyTemplateAny(byte* tmplt, const int* ids, int count);
+
+	// Size of the image from GetImage
+	static const int IMAGE_WIDTH = 258;
+	static const int IMAGE_HEIGHT = 202;
+
+	// Size in bytes of a single template as stored by the fps
+	static const int TEMPLATE_SIZE = 498;
+
+	// Size in bytes of the device info from Open
+	static const int DEVICE_INFO_SIZE = 24;
+#ifndef __GNUC__
+	#pragma endregion
+#endif  //__GNUC__
+
+#ifndef __GNUC__
+	#pragma region -= Not implemented commands =-
+#endif  //__GNUC__
+	// Gets an image that is qvga 160x120 (19200 bytes) and returns it in 150 Data_Packets
+	// Use StartDataDownload, and then GetNextDataPacket until done
+	// Returns: True (device confirming download starting)
+	// Not implemented due to memory restrictions on the arduino
+	// may revisit this if I find a need for it
+	//bool GetRawImage();
+
+	// Commands that are not implemented (and why)
+	// UsbInternalCheck - not implemented - Not valid config for arduino
+	// GetDatabaseStart - historical command, no longer supported
+	// GetDatabaseEnd - historical command, no longer supported
+	// UpgradeFirmware - Data Sheet says not supported
+	// UpgradeISOCDImage - Data Sheet says not supported
+	// SetIAPMode - for upgrading firmware (which is not supported)
+	// Ack and Nack	are listed as a commands for some unknown reason... not implemented
+#ifndef __GNUC__
+  #pragma endregion
+#endif  //__GNUC__
+
+#ifndef __GNUC__
+	#pragma endregion
+#endif  //__GNUC__
+
+	// Moves what the fps has sent from the SoftwareSerial buffer (64 bytes) into Rx
+	// The library calls it while it waits on the fps. A slow Image_Row_Handler (one that writes
+	// to an SD card, for example) should call it between its steps too, so the rest of the image
+	// has room to arrive while the handler works (Rx.Overruns goes up when some didn't)
+	// Returns: the bytes waiting in Rx
+	int Pump();
+
+	void serialPrintHex(byte data);
+	void SendToSerial(byte data[], int length);
+
+private:
+	 void SendCommand(byte cmd[], int length);
+	 void SendData(byte data[], int length);
+	 bool GetData(byte data[], int length);
+	 bool GetDataRows(Image_Row_Handler& handler, int width, int height);
+	 void GetDataHeader(Data_Checksum& checksum);
+	 bool GetDataChecksum(Data_Checksum& checksum);
+	 bool ReadData(byte* data, int length);
+	 Response_Packet* GetResponse();
+	 uint8_t pin_RX,pin_TX;
+	 SoftwareSerial _serial;
+	 unsigned long _capturemillis;
+	 unsigned long _commandstarted;
+	 int _enrollingid;
+	 byte _lastcommand;
+	 bool _datatimedout;
+	 bool TimedOut(unsigned long started);
+};
+
+#ifndef __GNUC__
+#pragma region -= Shard_Set =-
+#endif  //__GNUC__
+/*
+	Shard_Set spreads one template database over several scanners, for more people than one
+	scanner holds. Global ID = shard number * ShardCapacity + the slot on that shard.
+	A finger is captured once on the first scanner, turned into a template with MakeTemplate,
+	and that template is searched on every shard with IdentifyTemplate1_N.
+	Shards are asked one at a time (SoftwareSerial only listens to one port) and the search
+	stops at the first match. A shard that fails to answer properly is skipped and reported.
+*/
+class Shard_Set
+{
+	public:
+		static const int MAX_SHARDS = 8;
+
+		// Parameter: the scanners, the first one is used to capture
+		// Parameter: templates per scanner (3000 for GT-521F52, 200 for GT-521F32/GT-511C3)
+		Shard_Set(FPS_GT511C3** shards, int count, int shardcapacity);
+
+		int ShardCapacity;
+
+		// Captures the finger on the first scanner and searches every shard for it
+		// Parameter: buffer of 498 bytes to use while transferring
+		// Returns: the global ID, -1 if not found, -2 if the capture failed
+		long Identify(byte* tmplt);
+
+		// Loads a template store (global slot numbers) into the shards
+		// Parameter: buffer of 498 bytes to use while transferring
+		// Returns: the number of templates loaded, or -1 if the header is invalid
+		long Import(Template_Store& store, byte* tmplt);
+
+		// Statistics for the last Identify
+		int LastShard;					// shard that matched, -1 if none
+		byte FailedShards;				// bit N is set if shard N did not answer properly
+		unsigned long CaptureMillis;	// CaptureFinger + MakeTemplate
+		unsigned long SearchMillis;		// all IdentifyTemplate1_N calls
+
+	private:
+		FPS_GT511C3** _shards;
+		int _count;
+};
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
+
+#ifndef __GNUC__
+#pragma region -= Badge_Index =-
+#endif  //__GNUC__
+/*
+	Badge_Entry maps a badge (card or key number) to the slot holding its owner's template
+*/
+struct Badge_Entry
+{
+	uint32_t Badge;
+	uint16_t Slot;
+};
+
+/*
+	Badge_Index turns a badge into a slot with a binary search over a table sorted by badge,
+	so a badge plus finger needs only a 1:1 verify instead of a 1:N search of the whole database.
+	The table is read with pgm_read_*, declare it PROGMEM so it stays in flash on AVR:
+	  const Badge_Entry badges[] PROGMEM = { { 1001, 0 }, { 1042, 1 }, ... };  // sorted by Badge
+*/
+class Badge_Index
+{
+	public:
+		class Paths
+		{
+			public:
+				enum Paths_Enum
+				{
+					None		= 0,
+					Verify		= 1,		// badge found, finger checked with Verify1_1
+					Identify	= 2			// badge unknown, finger searched with Identify1_N
+				};
+		};
+
+		Badge_Index(const Badge_Entry* entries, int count);
+
+		// Finds the slot for a badge
+		// Returns: the slot, or -1 if the badge is not in the table
+		int Lookup(uint32_t badge);
+
+		// Checks the captured finger (call CaptureFinger first) against the badge's slot,
+		// falling back to Identify1_N if the badge is not in the table
+		// Returns: the matching ID, or -1 if the finger does not match (or the fps did not answer)
+		int Identify(FPS_GT511C3& fps, uint32_t badge);
+
+		// Statistics, per path
+		Paths::Paths_Enum LastPath;
+		unsigned long LastMillis;
+		unsigned long VerifyCount;
+		unsigned long VerifyMillis;		// total time spent on the verify path
+		unsigned long IdentifyCount;
+		unsigned long IdentifyMillis;	// total time spent on the identify path
+
+	private:
+		const Badge_Entry* _entries;
+		int _count;
+};
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
+
+#ifndef __GNUC__
+#pragma region -= Power_Manager =-
+#endif  //__GNUC__
+/*
+	Power_Manager keeps the CMOS LED (the biggest current draw) off while nobody is at the scanner
+
+	While idle the LED is only switched on for a short presence check every CheckInterval ms,
+	or not at all if the scanner's touch output is wired to TouchPin. Once a finger is found the
+	LED stays on (ready for CaptureFinger) until no finger has been seen for IdleTimeout ms.
+
+	Duty-cycle model (polling, no touch pin):
+	  LED duty    = CheckTime / CheckInterval
+	  wake delay  = CheckInterval / 2 + CheckTime on average, CheckInterval + CheckTime at worst
+	                (one more command round trip for the Open when CloseWhenIdle is set)
+	  where CheckTime is the LED on time of one check (LastCheckMillis, about 2 command
+	  round trips: IsPressFinger, and half of each LED command). With a touch pin the LED
+	  duty while idle is 0 and the wake delay is only the time to bring the LED back up
+	  (LastWakeMillis).
+*/
+class Power_Manager
+{
+	public:
+		Power_Manager(FPS_GT511C3& fps);
+
+		// Settings, change before calling Begin
+		unsigned long CheckInterval;	// ms between presence checks while idle (default 500)
+		unsigned long IdleTimeout;		// ms without a finger before going back to idle (default 3000)
+		int TouchPin;					// pin wired to the scanner's touch output, -1 for none (default)
+		int TouchActiveLevel;			// level of TouchPin when a finger is on the sensor (default HIGH)
+		bool CloseWhenIdle;				// issue Close while idle and Open on wake (default true)
+
+		// Statistics
+		unsigned long LastCheckMillis;	// LED on time of the last presence check that found no finger
+		unsigned long LastWakeMillis;	// time from detecting a finger to the LED being ready
+		unsigned long LedOnMillis;		// total LED on time since Begin
+		unsigned long Wakes;			// number of times a finger woke the scanner
+
+		// Starts in the idle state (LED off)
+		void Begin();
+		// Call from loop()
+		// Returns: True when a finger is on the sensor and the LED is on, ready for CaptureFinger
+		bool Poll();
+		// Returns: True while the LED is on
+		bool IsAwake();
+		// Percentage of the time since Begin that the LED was on
+		float DutyCycle();
+
+		void Sleep();
+		void Wake();
+
+	private:
+		FPS_GT511C3& _fps;
+		bool _awake;
+		unsigned long _started;
+		unsigned long _ledon;
+		unsigned long _ledoff;
+		unsigned long _lastcheck;
+		unsigned long _lastfinger;
+		void LedOn();
+		void LedOff();
+		bool TouchActive();
+};
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
+
+#ifndef __GNUC__
+#pragma region -= Command_Queue =-
+#endif  //__GNUC__
+/*
+	Command_Queue lets several parts of a sketch (and interrupt handlers) share one scanner
+	without waiting on it. Requests are queued and run one at a time from Poll(), and each
+	one reports its result through a callback.
+
+	There are two lanes: Urgent requests (an identify for someone at the door) always run
+	before Housekeeping ones (enroll counts, LED changes). Each lane is a ring buffer with
+	one writer and one reader (Poll), so it needs no locking as long as each lane is only
+	submitted to from one place: loop() or one interrupt handler, not both.
+*/
+class Command_Queue
+{
+	public:
+		class Operations
+		{
+			public:
+				enum Operations_Enum
+				{
+					IsPressFinger,	// result: 1 if pressed, 0 if not
+					SetLED,			// parameter: 0 for off, anything else for on. result: 1 if ok
+					GetEnrollCount,	// result: the count
+					CheckEnrolled,	// parameter: the ID. result: 1 if enrolled
+					DeleteID,		// parameter: the ID. result: 1 if deleted
+					Identify,		// CaptureFinger + Identify1_N. result: as Identify1_N, -1 if no finger
+					Verify			// CaptureFinger + Verify1_1. parameter: the ID. result: as Verify1_1, -1 if no finger
+				};
+		};
+
+		class Lanes
+		{
+			public:
+				enum Lanes_Enum
+				{
+					Urgent = 0,
+					Housekeeping = 1
+				};
+		};
+
+		// Called from Poll when a request has run
+		typedef void (*Callback)(byte operation, int parameter, int result, void* context);
+
+		static const byte LANE_COUNT = 2;
+		static const byte LANE_SIZE = 8;	// requests per lane, must be a power of two
+
+		Command_Queue(FPS_GT511C3& fps);
+
+		// Queues a request, safe to call from an interrupt handler (see above)
+		// Parameter: what to run, and its parameter (see Operations)
+		// Parameter: function to call with the result, or NULL
+		// Parameter: passed to the callback unchanged
+		// Returns: True if queued, false if the lane is full
+		bool Submit(Operations::Operations_Enum operation, int parameter, Callback done, void* context, Lanes::Lanes_Enum lane);
+
+		// Runs the oldest request in the most urgent lane, call from loop()
+		// Returns: True if a request was run
+		bool Poll();
+
+		// Returns: the number of requests waiting in a lane
+		byte Pending(Lanes::Lanes_Enum lane);
+
+		// Withdraws the requests waiting in a lane that report to done with context, they are
+		// skipped when their turn comes (and done is not called). Call from loop(), like Poll
+		// Returns: the number of requests withdrawn
+		byte Withdraw(Lanes::Lanes_Enum lane, Callback done, void* context);
+
+		// Returns: the requests a lane refused because it was full
+		// (read in one piece, Submit can count one from an interrupt handler at any time)
+		unsigned long Dropped(Lanes::Lanes_Enum lane);
+
+		// Statistics, per lane
+		unsigned long Completed[LANE_COUNT];
+		unsigned long LastWaitMillis[LANE_COUNT];	// time the last request spent queued
+		unsigned long MaxWaitMillis[LANE_COUNT];
+
+	private:
+		struct Request
+		{
+			byte Operation;
+			int Parameter;
+			Callback Done;
+			void* Context;
+			unsigned long Submitted;
+		};
+		static const byte WITHDRAWN = 0xFF;	// Operation of a withdrawn request
+		FPS_GT511C3& _fps;
+		Request _requests[LANE_COUNT][LANE_SIZE];
+		volatile byte _head[LANE_COUNT];	// next slot to write, only changed by Submit
+		volatile byte _tail[LANE_COUNT];	// next slot to run, only changed by Poll
+		volatile unsigned long _dropped[LANE_COUNT];	// only changed by Submit
+		int Run(const Request& request);
+};
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
+
+#ifndef __GNUC__
+#pragma region -= Link_Watchdog =-
+#endif  //__GNUC__
+/*
+	Link_Watchdog notices when the fps stops answering (a brown out, a loose wire, a reset
+	adapter) and brings it back without a power cycle of the arduino.
+	It gives the fps a ResponseTimeout, so a command to a dead scanner fails instead of waiting
+	forever, and counts timed out or garbled responses. While the link is down Poll looks for
+	the scanner's baud rate every RetryInterval ms, opens it, puts the baud rate and the LED
+	back the way they were, and reports how long it took.
+	Only send commands while Poll returns true; queued work (Command_Queue) simply waits.
+*/
+class Link_Watchdog
+{
+	public:
+		class States
+		{
+			public:
+				enum States_Enum
+				{
+					Up,			// answering normally
+					Down		// not answering, trying to reopen
+				};
+		};
+
+		// Called from Poll whenever the state changes
+		typedef void (*StateCallback)(States::States_Enum from, States::States_Enum to);
+
+		Link_Watchdog(FPS_GT511C3& fps);
+
+		// Settings, change before calling Begin
+		unsigned long ResponseTimeout;		// given to the fps (default 2000)
+		unsigned long HeartbeatInterval;	// ms between link checks while up, 0 for none (default 5000)
+		unsigned long RetryInterval;		// ms between reopen attempts while down (default 1000)
+		StateCallback StateChanged;			// NULL (the default) for no callback
+
+		States::States_Enum State;
+
+		// Statistics
+		unsigned long Failures;				// times the link went down
+		unsigned long Recoveries;			// times it came back
+		unsigned long LastRecoveryMillis;	// from going down to being back up
+		unsigned long TotalRecoveryMillis;
+		unsigned long MeanRecoveryMillis();
+
+		// Sets the fps timeout and checks the link
+		// Returns: True if the fps answered
+		bool Begin();
+
+		// Call from loop()
+		// Returns: True while the link is up
+		bool Poll();
+
+	private:
+		FPS_GT511C3& _fps;
+		unsigned long _failures;		// fps.LinkFailures last seen
+		unsigned long _lastcheck;
+		unsigned long _downsince;
+		unsigned long _lastattempt;
+		unsigned long _baud;			// baud rate and LED state to put back
+		bool _ledon;
+		void ChangeState(States::States_Enum to);
+		bool Reopen();
+};
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
+
+#ifndef __GNUC__
+#pragma region -= Capture_Policy =-
+#endif  //__GNUC__
+/*
+	Capture_Policy picks fast or high quality for each CaptureFinger from how recent captures went
+	For each mode it keeps the match rate and the time per attempt (capture + match), and picks
+	the mode with the lower expected time to unlock, retries included: time / match rate.
+	First attempts and retries are kept apart: a finger that failed once is more likely to
+	fail again (dry or worn), so a retry often pays off in high quality when a first try doesn't.
+	With a user table (one byte per ID) it also keeps each user's own fast match rate, used when
+	the ID is known up front (Verify). Every ExploreInterval'th attempt uses the other mode, so
+	the estimates stay current.
+*/
+class Capture_Policy
+{
+	public:
+		class Mode_Stats
+		{
+			public:
+				unsigned long Attempts;
+				unsigned long Matches;
+				float MatchRate;			// recent match rate (0-1)
+				float MeanMillis;			// recent time per attempt
+				// Returns: the expected ms to unlock, retrying in this mode until it matches
+				float ExpectedMillis();
+				void Record(bool matched, unsigned long millis);
+		};
+
+		Capture_Policy();
+
+		int ExploreInterval;				// every Nth attempt uses the other mode, 0 for never (default 50)
+
+		// Statistics the choice is based on, for first attempts and for retries
+		Mode_Stats Fast;
+		Mode_Stats High;
+		Mode_Stats RetryFast;
+		Mode_Stats RetryHigh;
+		int LastAttempts;					// attempts in the last Identify / Verify
+		unsigned long LastUnlockMillis;		// time the last Identify / Verify took
+
+		// Keeps a fast match rate per user
+		// Parameter: one byte per ID (200 for GT-521F32/GT-511C3, 3000 for GT-521F52), NULL for none
+		void SetUserTable(byte* table, int count);
+
+		// Parameter: the user's ID if known, -1 if not
+		// Parameter: 0 for the first attempt, 1 and up for retries
+		// Returns: True if the next capture should be high quality
+		bool ChooseHighQuality(int id, int attempt);
+
+		// Records how an attempt went
+		// Parameter: the user's ID if known, -1 if not
+		// Parameter: 0 for the first attempt, 1 and up for retries
+		void Record(bool highquality, bool matched, unsigned long millis, int id, int attempt);
+
+		// Captures and identifies until a match, the finger is lifted or the attempts run out
+		// Returns: the ID found, or -1 if not found
+		int Identify(FPS_GT511C3& fps, int maxattempts);
+
+		// Captures and verifies until a match, the finger is lifted or the attempts run out
+		// Returns: as Verify1_1 (0 for a match)
+		int Verify(FPS_GT511C3& fps, int id, int maxattempts);
+
+	private:
+		byte* _users;
+		int _usercount;
+		unsigned long _attempts;
+		void Reset(Mode_Stats& stats, float matchrate);
+		void RecordUser(int id, bool matched);
+};
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
+
+#ifndef __GNUC__
+#pragma region -= Warm_Start =-
+#endif  //__GNUC__
+/*
+	Warm_Start saves what the sketch learns about the fps at startup (baud rate, device info and
+	which IDs are enrolled), so the next boot can skip the baud rate probe and the CheckEnrolled
+	sweep (one command per ID, many seconds on a GT-521F52).
+	Start checks a loaded snapshot with an Open and a GetEnrollCount, and only scans if it does
+	not match (another scanner, or templates added or deleted while the snapshot was not kept up).
+	Set fps.Snapshot to keep the bitmap in step with enrollments and deletes, and save again
+	whenever Changed says so. Generation counts the changes, so state saved along with the
+	snapshot can tell if it is out of date.
+
+	Layout (all values little endian, same as the fps):
+	  0-3    "FPSW"
+	  4      format version (1)
+	  5      reserved (0)
+	  6-7    capacity (number of IDs)
+	  8-11   baud rate
+	  12-15  generation
+	  16-39  device info, as Open returns it
+	  40-    enrollment bitmap, bit (id % 8) of byte (id / 8)
+	  then   checksum of everything before it (byte addition, same as the data phase)
+*/
+class Warm_Start
+{
+	public:
+		static const byte FORMAT_VERSION = 1;
+
+		// Parameter: ram for the bitmap, BitmapSize(capacity) bytes
+		// Parameter: 3000, if using GT-521F52
+		//            200, if using GT-521F32/GT-511C3
+		Warm_Start(byte* bitmap, int capacity);
+
+		// Returns: the bytes the bitmap takes, and the bytes the whole snapshot takes when saved
+		static int BitmapSize(int capacity);
+		static int Size(int capacity);
+
+		int Capacity;
+		unsigned long BaudRate;							// the rate to run the fps at (default 9600)
+		unsigned long Generation;						// increased with every change
+		byte DeviceInfo[FPS_GT511C3::DEVICE_INFO_SIZE];
+		bool Warm;										// true if the last Start could use the snapshot
+		bool Valid;										// true once a Load, LoadEEPROM, Start or Scan filled in the fps's real state
+		unsigned long StartMillis;						// time the last Start took
+
+		bool IsEnrolled(int id);
+		void SetEnrolled(int id, bool enrolled);
+		void Clear();
+		// Returns: the number of IDs marked as enrolled
+		int Count();
+
+		// Returns: True if it changed since it was last loaded or saved
+		bool Changed();
+
+		// Gets the fps ready: uses the snapshot if it matches the fps, scans the fps if not
+		// Parameter: true if a snapshot was loaded
+		// Returns: True if the fps is ready
+		bool Start(FPS_GT511C3& fps, bool loaded);
+
+		// Opens the fps at BaudRate and checks the device info and the enroll count
+		// If the fps was powered off (so it is back at 9600) it is moved to BaudRate again
+		// Returns: True if the snapshot matches the fps
+		bool Validate(FPS_GT511C3& fps);
+
+		// Finds the baud rate, moves the fps to BaudRate and checks every ID with CheckEnrolled
+		// Returns: True if the fps answered
+		bool Scan(FPS_GT511C3& fps);
+
+		// Saves / loads the snapshot to a file (or anything else that is a Print / Stream)
+		void Save(Print& out);
+		// Returns: True if a valid snapshot for the same capacity was read
+		//          if not the bitmap is left empty, so Start will scan
+		bool Load(Stream& in);
+
+#if defined(__AVR__)
+		// Saves / loads the snapshot to EEPROM, Size(Capacity) bytes from the given address
+		// Only the bytes that changed are written (3.3 ms each), so a save after one enrollment
+		// writes a few bytes instead of the whole snapshot
+		void SaveEEPROM(int address);
+		// Returns: True if a valid snapshot for the same capacity was read, nothing is changed if not
+		bool LoadEEPROM(int address);
+#endif  //__AVR__
+
+	private:
+		byte* _bitmap;
+		unsigned long _savedgeneration;
+		static const int HEADER_SIZE = 40;
+		void GetHeader(byte* header);
+		bool CheckHeader(const byte* header);
+		void SetHeader(const byte* header);
+		word Checksum(const byte* header);
+};
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
+
+#ifndef __GNUC__
+#pragma region -= Expiry_Scheduler =-
+#endif  //__GNUC__
+/*
+	Expiry_Scheduler deletes enrollments when they expire (contractors at the end of their
+	engagement, visitors at the end of the day) without getting in the way of the door.
+	Expiries are kept in a min-heap of (deadline, ID) in ram the sketch provides (6 bytes per
+	entry on AVR), so the next one is found at once and adding or removing one takes log n steps.
+	Poll only calls DeleteID while the scanner is idle (the Power_Manager is asleep, or the
+	Command_Queue has nothing waiting), one per call, so a finger that arrives meanwhile waits for
+	at most one round trip. A DeleteID that got no answer is tried again on a later Poll.
+	A queued DeleteID leaves its entry in the heap until it has run, so a Save meanwhile still
+	has it; Cancel or Schedule of that ID withdraws the DeleteID from the queue.
+	Save the heap along with the Warm_Start snapshot. Load drops the entries of IDs the snapshot
+	no longer has enrolled (deleted after the heap was last saved), once the snapshot is Valid.
+	Deadlines are compared wrap-safe (as millis() is), so they must be within 2^31 of each other.
+	Saving needs a Clock that survives a reset, millis() deadlines mean nothing after one.
+
+	Layout (all values little endian, same as the fps):
+	  0-3    "FPSX"
+	  4      format version (1)
+	  5      reserved (0)
+	  6-7    number of entries
+	  8-11   Warm_Start generation when it was saved
+	  12-    entries, 6 bytes each: deadline (4), ID (2)
+	  then   checksum of everything before it (byte addition, same as the data phase)
+*/
+class Expiry_Scheduler
+{
+	public:
+		class Entry
+		{
+			public:
+				unsigned long Deadline;
+				int ID;
+		};
+
+		static const byte FORMAT_VERSION = 1;
+
+		// Parameter: ram for the heap, room for capacity entries
+		Expiry_Scheduler(FPS_GT511C3& fps, Entry* heap, int capacity);
+
+		// Time source for the deadlines (seconds from an RTC, for example), NULL for millis()
+		unsigned long (*Clock)();
+
+		// Statistics
+		unsigned long Deleted;				// IDs deleted by Poll
+		unsigned long Retries;				// DeleteIDs that got no answer, tried again later
+		unsigned long LastDeleteMillis;		// time the last DeleteID took
+
+		// Schedules the expiry of an ID, or moves it if it already had one
+		// Returns: True if scheduled, false if the heap is full
+		bool Schedule(int id, unsigned long deadline);
+		// Call when an ID is deleted or enrolled again by other means
+		// Returns: True if the ID had an expiry
+		bool Cancel(int id);
+		// Returns: the number of expiries waiting
+		int Count();
+		// Returns: the earliest deadline, only valid if Count() > 0
+		unsigned long NextDeadline();
+		// Returns: True if an expiry is due
+		bool Due();
+
+		// Deletes the next due ID if the scanner is idle, call from loop()
+		// Parameter: true when nobody is using the scanner
+		// Returns: True if an ID was deleted (or its DeleteID queued)
+		bool Poll(bool idle);
+		// Idle while the Power_Manager is asleep (no finger for its IdleTimeout)
+		bool Poll(Power_Manager& power);
+		// Idle while neither lane of the queue has anything waiting. The DeleteID goes through
+		// the Housekeeping lane, so an identify submitted meanwhile still runs first
+		bool Poll(Command_Queue& queue);
+
+		// Returns: True if it changed since it was last loaded or saved
+		bool Changed();
+
+		// Returns: the bytes the heap takes when saved
+		static int Size(int capacity);
+
+		// Saves / loads the heap to a file (or anything else that is a Print / Stream)
+		// Returns: True if saved, false (and nothing written) without a Clock
+		bool Save(Print& out, Warm_Start& snapshot);
+		// Returns: True if a valid heap was read, if not the heap is left empty
+		bool Load(Stream& in, Warm_Start& snapshot);
+
+#if defined(__AVR__)
+		// Saves / loads the heap to EEPROM, Size(capacity) bytes from the given address
+		// Returns: True if saved, false (and nothing written) without a Clock
+		bool SaveEEPROM(int address, Warm_Start& snapshot);
+		// Returns: True if a valid heap was read, nothing is changed if not
+		bool LoadEEPROM(int address, Warm_Start& snapshot);
+#endif  //__AVR__
+
+	private:
+		FPS_GT511C3& _fps;
+		Entry* _heap;
+		int _capacity;
+		int _count;
+		bool _changed;
+		int _queuedid;						// ID whose DeleteID is waiting in the Command_Queue, -1 for none
+		Command_Queue* _queue;
+		static const int HEADER_SIZE = 12;
+		static const int ENTRY_SIZE = 6;
+		unsigned long Now();
+		static bool Before(unsigned long a, unsigned long b);
+		int Find(int id);
+		void RemoveAt(int i);
+		void SiftUp(int i);
+		void SiftDown(int i);
+		void GetHeader(byte* header, Warm_Start& snapshot);
+		int CheckHeader(const byte* header, unsigned long& generation);
+		static void GetEntry(const Entry& entry, byte* bytes);
+		static void SetEntry(Entry& entry, const byte* bytes);
+		void Restore(unsigned long generation, Warm_Start& snapshot);
+		void Withdraw(int id);
+		static void Done(byte operation, int parameter, int result, void* context);
+};
+#ifndef __GNUC__
+#pragma endregion
+#endif  //__GNUC__
+
+#endif